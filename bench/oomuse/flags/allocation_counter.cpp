@@ -0,0 +1,72 @@
+/**
+ * Copyright 2015 Eric W. Barndollar. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "allocation_counter.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+namespace {
+
+
+std::atomic<int64> allocations(0);
+std::atomic<int64> bytes(0);
+
+
+}  // namespace
+
+
+void* operator new(std::size_t size) {
+  allocations.fetch_add(1, std::memory_order_relaxed);
+  bytes.fetch_add(static_cast<int64>(size), std::memory_order_relaxed);
+  void* memory = std::malloc((size > 0) ? size : 1);
+  if (!memory) {
+    throw std::bad_alloc();
+  }
+  return memory;
+}
+
+
+void operator delete(void* memory) noexcept {
+  std::free(memory);
+}
+
+
+void operator delete(void* memory, std::size_t) noexcept {
+  std::free(memory);
+}
+
+
+namespace oomuse {
+namespace flags {
+namespace bench {
+
+
+int64 allocationCount() {
+  return allocations.load(std::memory_order_relaxed);
+}
+
+
+int64 allocatedBytes() {
+  return bytes.load(std::memory_order_relaxed);
+}
+
+
+}  // namespace bench
+}  // namespace flags
+}  // namespace oomuse
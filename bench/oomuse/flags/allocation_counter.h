@@ -0,0 +1,58 @@
+/**
+ * Copyright 2015 Eric W. Barndollar. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * =============================================================================
+ * Heap allocation counting for benchmarks. Linking allocation_counter.cpp
+ * replaces global operator new so that every allocation (and its size) is
+ * counted.
+ */
+
+#ifndef OOMUSE_FLAGS_BENCH_ALLOCATION_COUNTER_H
+#define OOMUSE_FLAGS_BENCH_ALLOCATION_COUNTER_H
+
+#include "benchmark/benchmark.h"
+#include "oomuse/core/int_types.h"
+
+namespace oomuse {
+namespace flags {
+namespace bench {
+
+
+/** Returns number of heap allocations made by this process so far. */
+int64 allocationCount();
+
+
+/** Returns total bytes requested by heap allocations so far. */
+int64 allocatedBytes();
+
+
+/**
+ * Reports allocations (counted over all benchmark iterations) as a counter
+ * with given name, averaged per iteration and per item within an iteration.
+ */
+inline void reportAllocations(benchmark::State& state, int64 allocations,
+                              int64 itemsPerIteration,
+                              const char* counterName) {
+  double items = static_cast<double>(state.iterations()) * itemsPerIteration;
+  state.counters[counterName] =
+      benchmark::Counter((items > 0) ? allocations / items : 0.0);
+}
+
+
+}  // namespace bench
+}  // namespace flags
+}  // namespace oomuse
+
+#endif  // OOMUSE_FLAGS_BENCH_ALLOCATION_COUNTER_H
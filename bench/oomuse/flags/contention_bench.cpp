@@ -0,0 +1,171 @@
+/**
+ * Copyright 2015 Eric W. Barndollar. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "oomuse/core/int_types.h"
+#include "oomuse/flags/CachedFlagReader.h"
+#include "oomuse/flags/MutableFlag.h"
+#include "oomuse/flags/flags.h"
+
+using oomuse::CachedFlagReader;
+using oomuse::MutableFlag;
+using std::string;
+using std::thread;
+using std::vector;
+
+namespace flags = oomuse::flags;
+
+namespace {
+
+
+/** Number of flag reads each reader thread makes per benchmark iteration. */
+const int READS_PER_THREAD = 1000000;
+
+/** How long the writer thread (if any) waits between flag changes. */
+const std::chrono::microseconds WRITE_INTERVAL(100);
+
+
+int64 weigh(int64 value) { return value; }
+int64 weigh(const string& value) { return static_cast<int64>(value.size()); }
+
+
+/** Returns a new value of type T for the writer thread to set. */
+template<typename T> T makeValue(int64 i);
+
+template<>
+int64 makeValue<int64>(int64 i) { return i; }
+
+template<>
+string makeValue<string>(int64 i) {
+  return string(32 + i % 32, 'x');
+}
+
+
+/** Reads flag READS_PER_THREAD times directly from its shared value. */
+template<typename T>
+int64 readDirectly(const MutableFlag<T>& flag) {
+  int64 total = 0;
+  for (int i = 0; i < READS_PER_THREAD; ++i) {
+    total += flag.read([](const T& value) { return weigh(value); });
+  }
+  return total;
+}
+
+
+/** Reads flag READS_PER_THREAD times through a thread's CachedFlagReader. */
+template<typename T>
+int64 readThroughCache(const MutableFlag<T>& flag) {
+  CachedFlagReader<T> reader(flag);
+  int64 total = 0;
+  for (int i = 0; i < READS_PER_THREAD; ++i) {
+    total += weigh(reader.value());
+  }
+  return total;
+}
+
+
+/**
+ * Benchmarks range(0) threads reading one MutableFlag<T> at once, through
+ * cached readers if isCached. If range(1) is nonzero, another thread also
+ * changes the flag every WRITE_INTERVAL while the readers run.
+ */
+template<typename T, bool isCached>
+void BM_contendedReads(benchmark::State& state) {
+  const int threadCount = static_cast<int>(state.range(0));
+  const bool hasWriter = (state.range(1) != 0);
+  flags::resetForTest();
+  MutableFlag<T> flag("contended_flag", "A flag read by many threads",
+                      makeValue<T>(0));
+
+  for (auto _ : state) {
+    std::atomic<int> runningReaders(threadCount);
+    vector<thread> threads;
+    for (int i = 0; i < threadCount; ++i) {
+      threads.emplace_back([&flag, &runningReaders]() {
+        int64 total = isCached ? readThroughCache(flag) : readDirectly(flag);
+        benchmark::DoNotOptimize(total);
+        --runningReaders;
+      });
+    }
+    if (hasWriter) {
+      threads.emplace_back([&flag, &runningReaders]() {
+        for (int64 i = 1; runningReaders.load() > 0; ++i) {
+          flag.set(makeValue<T>(i));
+          std::this_thread::sleep_for(WRITE_INTERVAL);
+        }
+      });
+    }
+    for (thread& t : threads) {
+      t.join();
+    }
+  }
+
+  state.SetItemsProcessed(state.iterations() * threadCount * READS_PER_THREAD);
+}
+
+
+/**
+ * Benchmarks range(0) threads counting reads of one flag at once (which reads
+ * do when compiled with OOMUSE_FLAGS_COUNT_READS), each into its own counter.
+ */
+void BM_countedReads(benchmark::State& state) {
+  const int threadCount = static_cast<int>(state.range(0));
+  flags::resetForTest();
+  MutableFlag<int64> flag("counted_flag", "A flag read by many threads", 0);
+
+  for (auto _ : state) {
+    vector<thread> threads;
+    for (int i = 0; i < threadCount; ++i) {
+      threads.emplace_back([&flag]() {
+        for (int j = 0; j < READS_PER_THREAD; ++j) {
+          flag.countRead();
+        }
+      });
+    }
+    for (thread& t : threads) {
+      t.join();
+    }
+  }
+
+  state.SetItemsProcessed(state.iterations() * threadCount * READS_PER_THREAD);
+}
+
+BENCHMARK(BM_countedReads)->Arg(1)->Arg(4)->Arg(16)
+    ->UseRealTime()->Unit(benchmark::kMillisecond);
+
+
+void contentionArgs(benchmark::internal::Benchmark* benchmark) {
+  for (int threadCount : {1, 2, 4, 8, 16}) {
+    for (int hasWriter : {0, 1}) {
+      benchmark->Args({threadCount, hasWriter});
+    }
+  }
+  benchmark->UseRealTime()->Unit(benchmark::kMillisecond);
+}
+
+BENCHMARK_TEMPLATE(BM_contendedReads, int64, false)->Apply(contentionArgs);
+BENCHMARK_TEMPLATE(BM_contendedReads, int64, true)->Apply(contentionArgs);
+BENCHMARK_TEMPLATE(BM_contendedReads, string, false)->Apply(contentionArgs);
+BENCHMARK_TEMPLATE(BM_contendedReads, string, true)->Apply(contentionArgs);
+
+
+}  // namespace
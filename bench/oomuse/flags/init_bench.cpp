@@ -0,0 +1,321 @@
+/**
+ * Copyright 2015 Eric W. Barndollar. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdlib.h>
+
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "allocation_counter.h"
+#include "benchmark/benchmark.h"
+#include "oomuse/core/int_types.h"
+#include "oomuse/flags/Flag.h"
+#include "oomuse/flags/flags.h"
+
+using oomuse::AbstractFlag;
+using oomuse::Flag;
+using oomuse::flags::bench::allocationCount;
+using oomuse::flags::bench::reportAllocations;
+using std::string;
+using std::stringstream;
+using std::unique_ptr;
+using std::vector;
+
+namespace flags = oomuse::flags;
+
+namespace {
+
+
+/**
+ * Creates argCount flags of mixed types, and argv[] text setting each one.
+ * Every third flag is a string flag, since those must allocate their value.
+ */
+void createFlagsAndArgs(int argCount,
+                        vector<unique_ptr<AbstractFlag>>* createdFlags,
+                        vector<string>* args) {
+  for (int i = 0; i < argCount; ++i) {
+    string name = "flag_" + std::to_string(i);
+    switch (i % 3) {
+      case 0:
+        createdFlags->emplace_back(new Flag<int32>(name, "An int32 flag"));
+        args->push_back("--" + name + "=" + std::to_string(i));
+        break;
+      case 1:
+        createdFlags->emplace_back(new Flag<bool>(name, "A bool flag"));
+        args->push_back("--" + name);
+        break;
+      default:
+        createdFlags->emplace_back(new Flag<string>(name, "A string flag"));
+        args->push_back("--" + name + "=some_string_value_" + name);
+        break;
+    }
+  }
+}
+
+
+/**
+ * Benchmarks init() over argv[] setting range(0) distinct flags, optionally
+ * profiling init() (with allocations counted).
+ */
+void benchmarkInitArgs(benchmark::State& state, bool isProfiled) {
+  const int argCount = static_cast<int>(state.range(0));
+  stringstream errors;
+  int64 allocations = 0;
+
+  for (auto _ : state) {
+    state.PauseTiming();
+    flags::resetForTest();
+    flags::setOutputStream(&errors);
+    flags::setInitProfiling(isProfiled,
+                            isProfiled ? &allocationCount : nullptr);
+    vector<unique_ptr<AbstractFlag>> createdFlags;
+    vector<string> args;
+    createFlagsAndArgs(argCount, &createdFlags, &args);
+
+    vector<const char*> argv = {"App"};
+    for (const string& arg : args) {
+      argv.push_back(arg.c_str());
+    }
+    argv.push_back(nullptr);
+    int argc = static_cast<int>(argv.size()) - 1;
+    state.ResumeTiming();
+
+    int64 allocationsBefore = allocationCount();
+    bool wasSuccessful = flags::init(&argc, argv.data());
+    allocations += allocationCount() - allocationsBefore;
+    benchmark::DoNotOptimize(wasSuccessful);
+
+    state.PauseTiming();
+    createdFlags.clear();
+    state.ResumeTiming();
+  }
+
+  state.SetItemsProcessed(state.iterations() * argCount);
+  reportAllocations(state, allocations, argCount, "allocs_per_arg");
+}
+
+
+void BM_initArgs(benchmark::State& state) {
+  benchmarkInitArgs(state, false);
+}
+BENCHMARK(BM_initArgs)->Arg(10)->Arg(1000)->Arg(100000);
+
+
+/** Like BM_initArgs, but with init() profiling on, to show its overhead. */
+void BM_initArgsProfiled(benchmark::State& state) {
+  benchmarkInitArgs(state, true);
+}
+BENCHMARK(BM_initArgsProfiled)->Arg(10)->Arg(1000)->Arg(100000);
+
+
+/** Benchmarks init() with one --flagfile setting range(0) distinct flags. */
+void BM_initFlagFile(benchmark::State& state) {
+  const int argCount = static_cast<int>(state.range(0));
+  string path = (std::filesystem::temp_directory_path()
+                 / "oomuse_flags_init_bench.flags").string();
+  {
+    vector<unique_ptr<AbstractFlag>> unusedFlags;
+    vector<string> args;
+    createFlagsAndArgs(argCount, &unusedFlags, &args);
+    std::ofstream file(path, std::ios::binary);
+    file << "# Generated flag file.\n";
+    for (const string& arg : args) {
+      file << arg << "\n";
+    }
+  }
+  string flagFileArg = "--flagfile=" + path;
+  stringstream errors;
+  int64 allocations = 0;
+
+  for (auto _ : state) {
+    state.PauseTiming();
+    flags::resetForTest();
+    flags::setOutputStream(&errors);
+    vector<unique_ptr<AbstractFlag>> createdFlags;
+    vector<string> unusedArgs;
+    createFlagsAndArgs(argCount, &createdFlags, &unusedArgs);
+    const char* argv[] = {"App", flagFileArg.c_str(), nullptr};
+    int argc = 2;
+    state.ResumeTiming();
+
+    int64 allocationsBefore = allocationCount();
+    bool wasSuccessful = flags::init(&argc, argv);
+    allocations += allocationCount() - allocationsBefore;
+    benchmark::DoNotOptimize(wasSuccessful);
+
+    state.PauseTiming();
+    createdFlags.clear();
+    state.ResumeTiming();
+  }
+
+  std::remove(path.c_str());
+  state.SetItemsProcessed(state.iterations() * argCount);
+  reportAllocations(state, allocations, argCount, "allocs_per_line");
+}
+BENCHMARK(BM_initFlagFile)->Arg(1000)->Arg(50000);
+
+
+/**
+ * Benchmarks init() setting range(0) distinct flags from a flag snapshot of
+ * the same flags, for comparison with BM_initFlagFile.
+ */
+void BM_initFlagSnapshot(benchmark::State& state) {
+  const int argCount = static_cast<int>(state.range(0));
+  string path = (std::filesystem::temp_directory_path()
+                 / "oomuse_flags_init_bench.snapshot").string();
+  stringstream errors;
+  {
+    flags::resetForTest();
+    flags::setOutputStream(&errors);
+    vector<unique_ptr<AbstractFlag>> createdFlags;
+    vector<string> args;
+    createFlagsAndArgs(argCount, &createdFlags, &args);
+    vector<const char*> argv = {"App"};
+    for (const string& arg : args) {
+      argv.push_back(arg.c_str());
+    }
+    argv.push_back(nullptr);
+    int argc = static_cast<int>(argv.size()) - 1;
+    if (!flags::init(&argc, argv.data())
+        || !flags::writeFlagSnapshot(path)) {
+      state.SkipWithError("Could not write flag snapshot.");
+      return;
+    }
+  }
+  string flagSnapshotArg = "--flag_snapshot=" + path;
+  int64 allocations = 0;
+
+  for (auto _ : state) {
+    state.PauseTiming();
+    flags::resetForTest();
+    flags::setOutputStream(&errors);
+    vector<unique_ptr<AbstractFlag>> createdFlags;
+    vector<string> unusedArgs;
+    createFlagsAndArgs(argCount, &createdFlags, &unusedArgs);
+    const char* argv[] = {"App", flagSnapshotArg.c_str(), nullptr};
+    int argc = 2;
+    state.ResumeTiming();
+
+    int64 allocationsBefore = allocationCount();
+    bool wasSuccessful = flags::init(&argc, argv);
+    allocations += allocationCount() - allocationsBefore;
+    benchmark::DoNotOptimize(wasSuccessful);
+
+    state.PauseTiming();
+    createdFlags.clear();
+    state.ResumeTiming();
+  }
+
+  std::remove(path.c_str());
+  state.SetItemsProcessed(state.iterations() * argCount);
+  reportAllocations(state, allocations, argCount, "allocs_per_flag");
+}
+BENCHMARK(BM_initFlagSnapshot)->Arg(1000)->Arg(50000);
+
+
+#if !defined(_WIN32)  // For setenv() and unsetenv().
+
+/**
+ * Benchmarks init() setting 10 flags from the environment, among range(0)
+ * other (unprefixed) variables that should cost just a prefix check each.
+ */
+void BM_initEnvironment(benchmark::State& state) {
+  const int otherCount = static_cast<int>(state.range(0));
+  const int flagCount = 10;
+  const string prefix = "OOMUSE_BENCH_FLAG_";
+  vector<string> variableNames;
+  for (int i = 0; i < otherCount; ++i) {
+    variableNames.push_back("OOMUSE_BENCH_OTHER_" + std::to_string(i));
+    setenv(variableNames.back().c_str(), "some_unrelated_value", 1);
+  }
+  for (int i = 0; i < flagCount; ++i) {
+    variableNames.push_back(prefix + "flag_" + std::to_string(i));
+    setenv(variableNames.back().c_str(), std::to_string(i).c_str(), 1);
+  }
+  stringstream errors;
+
+  for (auto _ : state) {
+    state.PauseTiming();
+    flags::resetForTest();
+    flags::setOutputStream(&errors);
+    flags::setEnvironmentPrefix(prefix);
+    vector<unique_ptr<Flag<int32>>> createdFlags;
+    for (int i = 0; i < flagCount; ++i) {
+      createdFlags.emplace_back(
+          new Flag<int32>("flag_" + std::to_string(i), "An int32 flag"));
+    }
+    const char* argv[] = {"App", nullptr};
+    int argc = 1;
+    state.ResumeTiming();
+
+    bool wasSuccessful = flags::init(&argc, argv);
+    benchmark::DoNotOptimize(wasSuccessful);
+
+    state.PauseTiming();
+    createdFlags.clear();
+    state.ResumeTiming();
+  }
+
+  for (const string& name : variableNames) {
+    unsetenv(name.c_str());
+  }
+  state.SetItemsProcessed(state.iterations() * (otherCount + flagCount));
+}
+BENCHMARK(BM_initEnvironment)->Arg(100)->Arg(10000);
+
+#endif  // !defined(_WIN32)
+
+
+/** Benchmarks constructing (and so registering) range(0) flags. */
+void BM_registerFlags(benchmark::State& state) {
+  const int flagCount = static_cast<int>(state.range(0));
+  vector<string> names;
+  for (int i = 0; i < flagCount; ++i) {
+    names.push_back("flag_" + std::to_string(i));
+  }
+  int64 allocations = 0;
+
+  for (auto _ : state) {
+    state.PauseTiming();
+    flags::resetForTest();
+    vector<unique_ptr<Flag<int32>>> createdFlags;
+    createdFlags.reserve(flagCount);
+    state.ResumeTiming();
+
+    int64 allocationsBefore = allocationCount();
+    for (const string& name : names) {
+      createdFlags.emplace_back(
+          new Flag<int32>(name, "A flag registered during the benchmark"));
+    }
+    allocations += allocationCount() - allocationsBefore;
+
+    state.PauseTiming();
+    createdFlags.clear();
+    state.ResumeTiming();
+  }
+
+  state.SetItemsProcessed(state.iterations() * flagCount);
+  reportAllocations(state, allocations, flagCount, "allocs_per_flag");
+}
+BENCHMARK(BM_registerFlags)->Arg(100)->Arg(6000);
+
+
+}  // namespace
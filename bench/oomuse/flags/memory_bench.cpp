@@ -0,0 +1,95 @@
+/**
+ * Copyright 2015 Eric W. Barndollar. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "allocation_counter.h"
+#include "benchmark/benchmark.h"
+#include "oomuse/core/int_types.h"
+#include "oomuse/flags/Flag.h"
+#include "oomuse/flags/flags.h"
+
+using oomuse::Flag;
+using oomuse::FlagText;
+using oomuse::flags::bench::allocatedBytes;
+using oomuse::flags::bench::allocationCount;
+using oomuse::flags::bench::reportAllocations;
+using std::string;
+using std::unique_ptr;
+using std::vector;
+
+namespace flags = oomuse::flags;
+
+namespace {
+
+
+/** A description about as long as typical ones. */
+const char DESCRIPTION[] =
+    "Maximum number of times to retry a failed request before giving up.";
+
+
+/**
+ * Benchmarks the memory footprint of range(0) heap-allocated Flag<int32>s
+ * (counting the flag objects themselves), with names and descriptions that
+ * are either referenced through FlagText::fromStatic() or copied.
+ */
+template<bool isStaticText>
+void BM_flagFootprint(benchmark::State& state) {
+  const int flagCount = static_cast<int>(state.range(0));
+  vector<string> names;
+  for (int i = 0; i < flagCount; ++i) {
+    names.push_back("memory_bench_flag_" + std::to_string(i));
+  }
+  vector<unique_ptr<Flag<int32>>> flags;
+  flags.reserve(flagCount);
+  int64 allocations = 0;
+  int64 bytes = 0;
+
+  for (auto _ : state) {
+    flags::resetForTest();
+    int64 allocationsBefore = allocationCount();
+    int64 bytesBefore = allocatedBytes();
+    for (const string& name : names) {
+      if (isStaticText) {
+        flags.emplace_back(new Flag<int32>(FlagText::fromStatic(name),
+                                           FlagText::fromStatic(DESCRIPTION),
+                                           3));
+      } else {
+        flags.emplace_back(new Flag<int32>(name, string(DESCRIPTION), 3));
+      }
+    }
+    allocations += allocationCount() - allocationsBefore;
+    bytes += allocatedBytes() - bytesBefore;
+
+    state.PauseTiming();
+    flags::resetForTest();
+    flags.clear();
+    state.ResumeTiming();
+  }
+
+  state.SetItemsProcessed(state.iterations() * flagCount);
+  reportAllocations(state, allocations, flagCount, "allocs_per_flag");
+  reportAllocations(state, bytes, flagCount, "heap_bytes_per_flag");
+  state.counters["sizeof_flag"] =
+      benchmark::Counter(static_cast<double>(sizeof(Flag<int32>)));
+}
+BENCHMARK_TEMPLATE(BM_flagFootprint, true)->Arg(10000);
+BENCHMARK_TEMPLATE(BM_flagFootprint, false)->Arg(10000);
+
+
+}  // namespace
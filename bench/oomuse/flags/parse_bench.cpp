@@ -0,0 +1,292 @@
+/**
+ * Copyright 2015 Eric W. Barndollar. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <chrono>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "allocation_counter.h"
+#include "benchmark/benchmark.h"
+#include "oomuse/core/Validators.h"
+#include "oomuse/core/int_types.h"
+#include "oomuse/flags/ByteSize.h"
+#include "oomuse/flags/Checks.h"
+#include "oomuse/flags/EnumValues.h"
+#include "oomuse/flags/Flag.h"
+#include "oomuse/flags/flags.h"
+
+using oomuse::Checks;
+using oomuse::Flag;
+using oomuse::Validators;
+using oomuse::flags::bench::allocationCount;
+using oomuse::flags::bench::reportAllocations;
+using std::string;
+using std::string_view;
+using std::vector;
+
+namespace flags = oomuse::flags;
+
+namespace {
+
+
+/** Exposes Flag<T>::parseValidateAndSet() for benchmarking. */
+template<typename T>
+class BenchFlag : public Flag<T> {
+ public:
+  template<typename... Args>
+  explicit BenchFlag(Args&&... args) : Flag<T>(std::forward<Args>(args)...) {}
+
+  using Flag<T>::parseValidateAndSet;
+};
+
+
+/** Benchmarks repeatedly parsing textValue into flag. */
+template<typename T>
+void benchmarkParse(benchmark::State& state, BenchFlag<T>* flag,
+                    string_view textValue) {
+  int64 allocations = 0;
+  for (auto _ : state) {
+    int64 allocationsBefore = allocationCount();
+    benchmark::DoNotOptimize(flag->parseValidateAndSet(textValue));
+    allocations += allocationCount() - allocationsBefore;
+  }
+
+  state.SetItemsProcessed(state.iterations());
+  reportAllocations(state, allocations, 1, "allocs_per_parse");
+}
+
+
+void BM_parseBool(benchmark::State& state) {
+  flags::resetForTest();
+  BenchFlag<bool> flag("flag", "A bool flag");
+  benchmarkParse(state, &flag, " False ");
+}
+BENCHMARK(BM_parseBool);
+
+
+void BM_parseInt32(benchmark::State& state) {
+  flags::resetForTest();
+  BenchFlag<int32> flag("flag", "An int32 flag");
+  benchmarkParse(state, &flag, "-2147483648");
+}
+BENCHMARK(BM_parseInt32);
+
+
+void BM_parseInt64(benchmark::State& state) {
+  flags::resetForTest();
+  BenchFlag<int64> flag("flag", "An int64 flag");
+  benchmarkParse(state, &flag, "9223372036854775807");
+}
+BENCHMARK(BM_parseInt64);
+
+
+void BM_parseFloat(benchmark::State& state) {
+  flags::resetForTest();
+  BenchFlag<float> flag("flag", "A float flag");
+  benchmarkParse(state, &flag, "3.14159");
+}
+BENCHMARK(BM_parseFloat);
+
+
+void BM_parseDouble(benchmark::State& state) {
+  flags::resetForTest();
+  BenchFlag<double> flag("flag", "A double flag");
+  benchmarkParse(state, &flag, "-2.718281828459045e-3");
+}
+BENCHMARK(BM_parseDouble);
+
+
+void BM_parseString(benchmark::State& state) {
+  flags::resetForTest();
+  BenchFlag<string> flag("flag", "A string flag");
+  benchmarkParse(state, &flag, "a string value longer than the SSO buffer");
+}
+BENCHMARK(BM_parseString);
+
+
+/** An enum with enough values that parsing does a few comparisons. */
+enum class Codec {NONE, GZIP, ZSTD, LZ4, SNAPPY, BROTLI, LZMA, BZIP2};
+
+constexpr auto flagEnumValues(Codec) {
+  return flags::enumValues<Codec>({
+      {"none", Codec::NONE}, {"gzip", Codec::GZIP}, {"zstd", Codec::ZSTD},
+      {"lz4", Codec::LZ4}, {"snappy", Codec::SNAPPY},
+      {"brotli", Codec::BROTLI}, {"lzma", Codec::LZMA},
+      {"bzip2", Codec::BZIP2}});
+}
+
+
+void BM_parseEnum(benchmark::State& state) {
+  flags::resetForTest();
+  BenchFlag<Codec> flag("flag", "An enum flag");
+  benchmarkParse(state, &flag, "snappy");
+}
+BENCHMARK(BM_parseEnum);
+
+
+void BM_parseDuration(benchmark::State& state) {
+  flags::resetForTest();
+  BenchFlag<std::chrono::milliseconds> flag("flag", "A duration flag");
+  benchmarkParse(state, &flag, "1h30m15.5s");
+}
+BENCHMARK(BM_parseDuration);
+
+
+void BM_parseByteSize(benchmark::State& state) {
+  flags::resetForTest();
+  BenchFlag<oomuse::ByteSize> flag("flag", "A byte size flag");
+  benchmarkParse(state, &flag, "1.5GiB");
+}
+BENCHMARK(BM_parseByteSize);
+
+
+/** Benchmarks parsing an int32 flag with range(0) passing validators. */
+void BM_parseInt32WithValidators(benchmark::State& state) {
+  flags::resetForTest();
+  switch (state.range(0)) {
+    case 0: {
+      BenchFlag<int32> flag("flag", "No validators");
+      benchmarkParse(state, &flag, "42");
+      break;
+    }
+    case 1: {
+      BenchFlag<int32> flag("flag", "One validator",
+                            Validators<int32>::greaterOrEqual(0));
+      benchmarkParse(state, &flag, "42");
+      break;
+    }
+    default: {
+      BenchFlag<int32> flag("flag", "Two validators",
+                            Validators<int32>::greaterOrEqual(0),
+                            Validators<int32>::lessOrEqual(100));
+      benchmarkParse(state, &flag, "42");
+      break;
+    }
+  }
+}
+BENCHMARK(BM_parseInt32WithValidators)->Arg(0)->Arg(1)->Arg(2);
+
+
+/** Benchmarks parsing a string flag with range(0) passing validators. */
+void BM_parseStringWithValidators(benchmark::State& state) {
+  flags::resetForTest();
+  if (state.range(0) == 0) {
+    BenchFlag<string> flag("flag", "No validators");
+    benchmarkParse(state, &flag, "username");
+  } else {
+    BenchFlag<string> flag("flag", "Two validators",
+                           Validators<string>::sizeGreaterOrEqual(3),
+                           Validators<string>::sizeLessOrEqual(15));
+    benchmarkParse(state, &flag, "username");
+  }
+}
+BENCHMARK(BM_parseStringWithValidators)->Arg(0)->Arg(2);
+
+
+/** Benchmarks parsing an int32 flag with range(0) passing Checks. */
+void BM_parseInt32WithChecks(benchmark::State& state) {
+  flags::resetForTest();
+  if (state.range(0) == 1) {
+    BenchFlag<int32> flag("flag", "One check", Checks<int32>::greaterOrEqual(0));
+    benchmarkParse(state, &flag, "42");
+  } else {
+    BenchFlag<int32> flag("flag", "Two checks",
+                          Checks<int32>::allOf(
+                              Checks<int32>::greaterOrEqual(0),
+                              Checks<int32>::lessOrEqual(100)));
+    benchmarkParse(state, &flag, "42");
+  }
+}
+BENCHMARK(BM_parseInt32WithChecks)->Arg(1)->Arg(2);
+
+
+/** Benchmarks parsing a string flag with two passing Checks. */
+void BM_parseStringWithChecks(benchmark::State& state) {
+  flags::resetForTest();
+  BenchFlag<string> flag("flag", "Two checks",
+                         Checks<string>::allOf(
+                             Checks<string>::sizeGreaterOrEqual(3),
+                             Checks<string>::sizeLessOrEqual(15)));
+  benchmarkParse(state, &flag, "username");
+}
+BENCHMARK(BM_parseStringWithChecks);
+
+
+/** Returns a list of count shard IDs (like "100000,100001,..."). */
+string idListText(int64 count) {
+  string text;
+  for (int64 i = 0; i < count; ++i) {
+    if (i != 0) {
+      text += ',';
+    }
+    text += std::to_string(100000 + i);
+  }
+  return text;
+}
+
+
+/** Benchmarks parsing a list flag of range(0) int64 IDs. */
+void BM_parseInt64List(benchmark::State& state) {
+  flags::resetForTest();
+  BenchFlag<vector<int64>> flag("flag", "An int64 list flag");
+  string text = idListText(state.range(0));
+  benchmarkParse(state, &flag, text);
+  state.SetBytesProcessed(state.iterations() * text.size());
+}
+BENCHMARK(BM_parseInt64List)->Arg(10)->Arg(1000)->Arg(100000);
+
+
+/** Benchmarks parsing a list flag of range(0) string IDs. */
+void BM_parseStringList(benchmark::State& state) {
+  flags::resetForTest();
+  BenchFlag<vector<string>> flag("flag", "A string list flag");
+  string text = idListText(state.range(0));
+  benchmarkParse(state, &flag, text);
+  state.SetBytesProcessed(state.iterations() * text.size());
+}
+BENCHMARK(BM_parseStringList)->Arg(10)->Arg(1000)->Arg(100000);
+
+
+/**
+ * For comparison with BM_parseStringList: parses a string flag, then splits
+ * its value by hand, copying the text twice.
+ */
+void BM_parseStringThenSplit(benchmark::State& state) {
+  flags::resetForTest();
+  BenchFlag<string> flag("flag", "A string flag");
+  string text = idListText(state.range(0));
+  for (auto _ : state) {
+    flag.parseValidateAndSet(text);
+    vector<string> items;
+    string::size_type start = 0;
+    while (true) {
+      string::size_type end = flag.value().find(',', start);
+      items.push_back(flag.value().substr(start, end - start));
+      if (end == string::npos) {
+        break;
+      }
+      start = end + 1;
+    }
+    benchmark::DoNotOptimize(items.data());
+  }
+  state.SetBytesProcessed(state.iterations() * text.size());
+}
+BENCHMARK(BM_parseStringThenSplit)->Arg(10)->Arg(1000)->Arg(100000);
+
+
+}  // namespace
@@ -0,0 +1,141 @@
+/**
+ * Copyright 2015 Eric W. Barndollar. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "allocation_counter.h"
+#include "benchmark/benchmark.h"
+#include "oomuse/core/int_types.h"
+#include "oomuse/flags/Flag.h"
+#include "oomuse/flags/FlagRegistry.h"
+#include "oomuse/flags/FlagSet.h"
+#include "oomuse/flags/flags.h"
+
+using oomuse::Flag;
+using oomuse::flags::FlagRegistry;
+using oomuse::flags::StaticFlagIndex;
+using oomuse::flags::bench::allocationCount;
+using oomuse::flags::bench::reportAllocations;
+using std::size_t;
+using std::string;
+using std::unique_ptr;
+using std::vector;
+
+namespace flags = oomuse::flags;
+
+namespace {
+
+
+/** Number of lookups per benchmark iteration. */
+const int LOOKUPS_PER_ITERATION = 256;
+
+
+/** Flags registered with a FlagRegistry (not the global one) for lookups. */
+class RegistryFixture {
+ public:
+  explicit RegistryFixture(int flagCount) {
+    flags::resetForTest();
+    for (int i = 0; i < flagCount; ++i) {
+      names_.push_back("registered_flag_" + std::to_string(i));
+      missingNames_.push_back("missing_flag_" + std::to_string(i));
+      flags_.emplace_back(new Flag<int32>(names_.back(), "A flag"));
+      registry_.add(flags_.back().get());
+    }
+    registry_.buildIndex();
+    flags::resetForTest();
+  }
+
+  FlagRegistry& registry() { return registry_; }
+  const string& name(int i) const { return names_[i % names_.size()]; }
+  const string& missingName(int i) const {
+    return missingNames_[i % missingNames_.size()];
+  }
+
+ private:
+  vector<string> names_;
+  vector<string> missingNames_;
+  vector<unique_ptr<Flag<int32>>> flags_;
+  FlagRegistry registry_;
+};
+
+
+/**
+ * Benchmarks registry lookups among range(0) flags, where range(1) percent
+ * of lookups are hits and the rest are misses.
+ */
+void BM_registryFind(benchmark::State& state) {
+  RegistryFixture fixture(static_cast<int>(state.range(0)));
+  const int hitPercent = static_cast<int>(state.range(1));
+  int64 allocations = 0;
+
+  int next = 0;
+  for (auto _ : state) {
+    int64 allocationsBefore = allocationCount();
+    for (int i = 0; i < LOOKUPS_PER_ITERATION; ++i, ++next) {
+      bool isHit = (next % 100) < hitPercent;
+      const string& name = isHit ? fixture.name(next * 7919)
+                                 : fixture.missingName(next * 7919);
+      benchmark::DoNotOptimize(fixture.registry().find(name));
+    }
+    allocations += allocationCount() - allocationsBefore;
+  }
+
+  state.SetItemsProcessed(state.iterations() * LOOKUPS_PER_ITERATION);
+  reportAllocations(state, allocations, LOOKUPS_PER_ITERATION,
+                    "allocs_per_lookup");
+}
+BENCHMARK(BM_registryFind)
+    ->Args({100, 100})->Args({100, 50})->Args({100, 0})
+    ->Args({6000, 100})->Args({6000, 50})->Args({6000, 0});
+
+
+static constexpr auto staticFlags = flags::makeFlagSet(
+    "retry_limit", "username", "verbose", "timeout_ms", "shard", "log_dir",
+    "threads", "batch_size", "sampling_rate", "dry_run", "output_path",
+    "input_path", "max_memory", "num_workers", "cache_size", "port");
+
+
+/** Benchmarks compile-time FlagSet lookups (all hits, or all misses). */
+void BM_staticFlagSetFind(benchmark::State& state) {
+  const bool areHits = (state.range(0) != 0);
+  vector<string> names;
+  for (size_t slot = 0; slot < staticFlags.index().size(); ++slot) {
+    string name(staticFlags.index().nameAt(slot));
+    names.push_back(areHits ? name : name + "_missing");
+  }
+  int64 allocations = 0;
+
+  int next = 0;
+  for (auto _ : state) {
+    int64 allocationsBefore = allocationCount();
+    for (int i = 0; i < LOOKUPS_PER_ITERATION; ++i, ++next) {
+      benchmark::DoNotOptimize(
+          staticFlags.find(names[next % names.size()]));
+    }
+    allocations += allocationCount() - allocationsBefore;
+  }
+
+  state.SetItemsProcessed(state.iterations() * LOOKUPS_PER_ITERATION);
+  reportAllocations(state, allocations, LOOKUPS_PER_ITERATION,
+                    "allocs_per_lookup");
+}
+BENCHMARK(BM_staticFlagSetFind)->Arg(1)->Arg(0);
+
+
+}  // namespace
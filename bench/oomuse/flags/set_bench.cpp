@@ -0,0 +1,137 @@
+/**
+ * Copyright 2015 Eric W. Barndollar. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <string>
+#include <unordered_set>
+
+#include "allocation_counter.h"
+#include "benchmark/benchmark.h"
+#include "oomuse/core/int_types.h"
+#include "oomuse/flags/DenseIntSet.h"
+#include "oomuse/flags/Flag.h"
+#include "oomuse/flags/flags.h"
+
+using oomuse::DenseIntSet;
+using oomuse::Flag;
+using oomuse::flags::bench::allocationCount;
+using oomuse::flags::bench::reportAllocations;
+using std::string;
+using std::unordered_set;
+
+namespace flags = oomuse::flags;
+
+namespace {
+
+
+/** Number of items in each benchmarked set flag. */
+const int64 SET_SIZE = 1000;
+
+
+/** Returns flag text for items 0, 2, 4, ... (so half of lookups match). */
+string evenItemsText() {
+  string text;
+  for (int64 i = 0; i < SET_SIZE; ++i) {
+    text += (i == 0) ? "" : ",";
+    text += std::to_string(2 * i);
+  }
+  return text;
+}
+
+
+/** Initializes flags with --name set to evenItemsText(). */
+void initWithEvenItems(const string& name) {
+  string arg = "--" + name + "=" + evenItemsText();
+  int argc = 2;
+  const char* argv[] = {"App", arg.c_str(), nullptr};
+  flags::init(&argc, argv);
+}
+
+
+/** Benchmarks lookups with lookup(int64 item), counting allocations. */
+template<typename Lookup>
+void benchmarkLookups(benchmark::State& state, Lookup lookup) {
+  int64 allocations = 0;
+  int64 item = 0;
+  for (auto _ : state) {
+    int64 allocationsBefore = allocationCount();
+    benchmark::DoNotOptimize(lookup(item));
+    allocations += allocationCount() - allocationsBefore;
+    item = (item + 1) % (2 * SET_SIZE);
+  }
+
+  state.SetItemsProcessed(state.iterations());
+  reportAllocations(state, allocations, 1, "allocs_per_lookup");
+}
+
+
+void BM_containsInInt64Set(benchmark::State& state) {
+  flags::resetForTest();
+  Flag<unordered_set<int64>> flag("ids", "An int64 set flag");
+  initWithEvenItems("ids");
+  benchmarkLookups(state, [&flag](int64 item) {
+    return flag.value().count(item) != 0;
+  });
+}
+BENCHMARK(BM_containsInInt64Set);
+
+
+void BM_containsInDenseIntSet(benchmark::State& state) {
+  flags::resetForTest();
+  Flag<DenseIntSet> flag("ids", "A dense int set flag");
+  initWithEvenItems("ids");
+  benchmarkLookups(state, [&flag](int64 item) {
+    return flag.value().contains(item);
+  });
+}
+BENCHMARK(BM_containsInDenseIntSet);
+
+
+void BM_containsInStringSet(benchmark::State& state) {
+  flags::resetForTest();
+  Flag<unordered_set<string>> flag("ids", "A string set flag");
+  initWithEvenItems("ids");
+
+  // Keys already held as strings, as when read from a request.
+  string keys[2 * SET_SIZE];
+  for (int64 i = 0; i < 2 * SET_SIZE; ++i) {
+    keys[i] = std::to_string(i);
+  }
+  benchmarkLookups(state, [&flag, &keys](int64 item) {
+    return flag.value().count(keys[item]) != 0;
+  });
+}
+BENCHMARK(BM_containsInStringSet);
+
+
+/** For comparison: searching a comma-separated string flag by hand. */
+void BM_containsInStringFlagByHand(benchmark::State& state) {
+  flags::resetForTest();
+  Flag<string> flag("ids", "A string flag");
+  initWithEvenItems("ids");
+
+  string keys[2 * SET_SIZE];
+  for (int64 i = 0; i < 2 * SET_SIZE; ++i) {
+    keys[i] = "," + std::to_string(i) + ",";
+  }
+  string paddedValue = "," + flag.value() + ",";
+  benchmarkLookups(state, [&paddedValue, &keys](int64 item) {
+    return paddedValue.find(keys[item]) != string::npos;
+  });
+}
+BENCHMARK(BM_containsInStringFlagByHand);
+
+
+}  // namespace
@@ -0,0 +1,85 @@
+/**
+ * Copyright 2015 Eric W. Barndollar. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "allocation_counter.h"
+#include "benchmark/benchmark.h"
+#include "oomuse/core/int_types.h"
+#include "oomuse/flags/Flag.h"
+#include "oomuse/flags/flags.h"
+
+using oomuse::AbstractFlag;
+using oomuse::Flag;
+using oomuse::FlagRequired;
+using oomuse::flags::bench::allocationCount;
+using oomuse::flags::bench::reportAllocations;
+using std::string;
+using std::stringstream;
+using std::unique_ptr;
+using std::vector;
+
+namespace flags = oomuse::flags;
+
+namespace {
+
+
+/** Benchmarks printUsage() with range(0) flags, a mix of all kinds. */
+void BM_printUsage(benchmark::State& state) {
+  const int flagCount = static_cast<int>(state.range(0));
+  flags::resetForTest();
+
+  vector<unique_ptr<AbstractFlag>> createdFlags;
+  for (int i = 0; i < flagCount; ++i) {
+    string name = "flag_" + std::to_string(i);
+    switch (i % 3) {
+      case 0:
+        createdFlags.emplace_back(new Flag<string>(
+            name, "A required flag", FlagRequired::YES));
+        break;
+      case 1:
+        createdFlags.emplace_back(new Flag<double>(
+            name, "An optional flag with a default value", 0.5));
+        break;
+      default:
+        createdFlags.emplace_back(new Flag<bool>(name, "An optional flag"));
+        break;
+    }
+  }
+
+  int64 allocations = 0;
+  for (auto _ : state) {
+    stringstream output;
+    flags::setOutputStream(&output);
+
+    int64 allocationsBefore = allocationCount();
+    flags::printUsage("App", "input_file", "Some usage notes.");
+    allocations += allocationCount() - allocationsBefore;
+
+    benchmark::DoNotOptimize(output.tellp());
+  }
+
+  state.SetItemsProcessed(state.iterations() * flagCount);
+  reportAllocations(state, allocations, flagCount, "allocs_per_flag");
+  flags::resetForTest();
+}
+BENCHMARK(BM_printUsage)->Arg(1000)->Arg(5000);
+
+
+}  // namespace
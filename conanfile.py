@@ -37,6 +37,7 @@ class OOMuseFlagsConan(conans.ConanFile):
   #=============================================================================
 
   options = {
+    "benchmarking": [False, True],
     "include_pdbs": [False, True],
     "testing": [False, True],
   }
@@ -47,7 +48,8 @@ class OOMuseFlagsConan(conans.ConanFile):
 
   # Note that gtest in shared mode produces compiler warnings, so link against
   # as a static library so this build can treat warnings as errors.
-  default_options = "include_pdbs=False", "testing=False", "gtest:shared=False"
+  default_options = ("benchmarking=False", "include_pdbs=False",
+                     "testing=False", "gtest:shared=False")
 
 
   #=============================================================================
@@ -61,6 +63,9 @@ class OOMuseFlagsConan(conans.ConanFile):
     if self.options.testing:
       self.requires("gtest/1.8.0@lasote/stable")
 
+    if self.options.benchmarking:
+      self.requires("google-benchmark/1.4.1@mpusz/stable")
+
   def imports(self):
     """Copies dynamic libs from deps needed to run & test this package."""
     self.copy("*.dll", dst="bin", src="bin")
@@ -80,9 +85,12 @@ class OOMuseFlagsConan(conans.ConanFile):
 
     cmake_test_def = ("-DOOMUSE_FLAGS_TESTING=1" if self.options.testing
                       else "")
-    self.run("cmake %s %s %s" % (self.conanfile_directory,
-                                 cmake.command_line,
-                                 cmake_test_def))
+    cmake_bench_def = ("-DOOMUSE_FLAGS_BENCHMARKING=1"
+                       if self.options.benchmarking else "")
+    self.run("cmake %s %s %s %s" % (self.conanfile_directory,
+                                    cmake.command_line,
+                                    cmake_test_def,
+                                    cmake_bench_def))
     self.run("cmake --build . %s" % cmake.build_config)
 
     # If testing, run unit tests to make sure library works before packaging.
@@ -102,6 +110,9 @@ class OOMuseFlagsConan(conans.ConanFile):
     # Include headers:
     self.copy("*.h", dst="include", src="include", keep_path=True)
 
+    # Tools:
+    self.copy("oomuse-flags_dump", dst="bin", src=".", keep_path=False)
+
     # Static libs:
     self.copy("*.a", dst="lib", src=".", keep_path=False)
     self.copy("*.lib", dst="lib", src=".", keep_path=False)
@@ -0,0 +1,77 @@
+/**
+ * Copyright 2015 Eric W. Barndollar. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef OOMUSE_FLAGS_BYTE_SIZE_H
+#define OOMUSE_FLAGS_BYTE_SIZE_H
+
+#include <ostream>
+
+#include "oomuse/core/int_types.h"
+#include "oomuse/flags/unit_parsing.h"
+
+namespace oomuse {
+
+
+/**
+ * A number of bytes, as for flags like --cacheSize=1.5GiB (see
+ * unit_parsing.h for accepted units). Just holds the count, so reading it is
+ * free.
+ */
+class ByteSize {
+ public:
+  constexpr ByteSize() {}
+  constexpr explicit ByteSize(uint64 bytes) : bytes_(bytes) {}
+
+  static constexpr ByteSize kib(uint64 count) { return ByteSize(count << 10); }
+  static constexpr ByteSize mib(uint64 count) { return ByteSize(count << 20); }
+  static constexpr ByteSize gib(uint64 count) { return ByteSize(count << 30); }
+
+  constexpr uint64 bytes() const { return bytes_; }
+
+  constexpr bool operator==(ByteSize other) const {
+    return bytes_ == other.bytes_;
+  }
+  constexpr bool operator!=(ByteSize other) const {
+    return bytes_ != other.bytes_;
+  }
+  constexpr bool operator<(ByteSize other) const {
+    return bytes_ < other.bytes_;
+  }
+  constexpr bool operator<=(ByteSize other) const {
+    return bytes_ <= other.bytes_;
+  }
+  constexpr bool operator>(ByteSize other) const {
+    return bytes_ > other.bytes_;
+  }
+  constexpr bool operator>=(ByteSize other) const {
+    return bytes_ >= other.bytes_;
+  }
+
+ private:
+  uint64 bytes_ = 0;
+};
+
+
+/** Outputs size with a unit, like "64KiB" (see outputByteSize()). */
+inline std::ostream& operator<<(std::ostream& output, ByteSize size) {
+  oomuse::flags::outputByteSize(size.bytes(), &output);
+  return output;
+}
+
+
+}  // namespace oomuse
+
+#endif  // OOMUSE_FLAGS_BYTE_SIZE_H
@@ -0,0 +1,91 @@
+/**
+ * Copyright 2015 Eric W. Barndollar. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef OOMUSE_FLAGS_CACHED_FLAG_READER_H
+#define OOMUSE_FLAGS_CACHED_FLAG_READER_H
+
+#include <atomic>
+#include <cassert>
+#include <utility>
+
+#include "oomuse/core/int_types.h"
+#include "oomuse/core/readability_macros.h"
+#include "oomuse/flags/MutableFlag.h"
+
+namespace oomuse {
+
+
+/**
+ * A single thread's cached copy of a MutableFlag value, for flags read in
+ * tight loops. Each value() call only loads the global mutable flag
+ * generation, which stays in every core's cache until some MutableFlag
+ * changes; only then does the reader go back to the flag's shared value.
+ *
+ * Each thread should own its own reader, for example:
+ *
+ * thread_local CachedFlagReader<int32> batchSize(batchSizeFlag);
+ * ...
+ * for (auto& packet : packets) {
+ *   if (packet.size() > batchSize.value()) { ... }
+ * }
+ */
+template<typename T>
+class CachedFlagReader {
+ public:
+  /** Caches flag's current value; flag must have a value & outlive this. */
+  explicit CachedFlagReader(const MutableFlag<T>& flag)
+      : flag_(flag), generation_(currentGeneration()), value_(flag.value()) {}
+
+  /**
+   * Returns flag value, as of some point since the latest flag change that
+   * this thread could observe (never partway through a MutableFlagBatch). The
+   * reference is valid until the next call.
+   */
+  const T& value() {
+#if defined(OOMUSE_FLAGS_COUNT_READS)
+    flag_.countRead();
+#endif
+    uint64 generation = currentGeneration();
+    if ((generation != generation_) && (generation % 2 == 0)) {
+      // Only keep the value if no change started while reading it.
+      T value = flag_.value();
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (oomuse::flags::mutableFlagGeneration.count.load(
+              std::memory_order_relaxed) == generation) {
+        generation_ = generation;
+        value_ = std::move(value);
+      }
+    }
+    return value_;
+  }
+
+ private:
+  CANT_COPY(CachedFlagReader);
+
+  static uint64 currentGeneration() {
+    return oomuse::flags::mutableFlagGeneration.count.load(
+        std::memory_order_acquire);
+  }
+
+  const MutableFlag<T>& flag_;
+  uint64 generation_;
+  T value_;
+};
+
+
+}  // namespace oomuse
+
+#endif  // OOMUSE_FLAGS_CACHED_FLAG_READER_H
@@ -0,0 +1,289 @@
+/**
+ * Copyright 2015 Eric W. Barndollar. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * =============================================================================
+ * Value checks for flags, as plain value types composed at compile time (so
+ * unlike oomuse::Validators, they're inlined and never allocate unless a value
+ * fails). A check type provides:
+ *
+ *   bool isValid(const T& value) const;
+ *   void outputRequirement(const T& value, std::ostream* output) const;
+ *
+ * where outputRequirement() is only called for values that aren't valid, to
+ * describe what they must be instead (like "Must be greater than 0.").
+ */
+
+#ifndef OOMUSE_FLAGS_CHECKS_H
+#define OOMUSE_FLAGS_CHECKS_H
+
+#include <chrono>
+#include <cstddef>
+#include <ostream>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include "oomuse/flags/unit_parsing.h"
+
+namespace oomuse {
+namespace flags {
+
+
+/** Comparison made by a BoundCheck. */
+enum class Comparison {GREATER, GREATER_OR_EQUAL, LESS, LESS_OR_EQUAL};
+
+
+/** Outputs a check's bound for a requirement. */
+template<typename Bound>
+void outputBound(const Bound& bound, std::ostream* output) {
+  *output << bound;
+}
+
+/** Outputs a duration bound with a unit, like "250ms". */
+template<typename Rep, typename Period>
+void outputBound(const std::chrono::duration<Rep, Period>& bound,
+                 std::ostream* output) {
+  outputDuration(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(bound).count(),
+      output);
+}
+
+
+/** Checks that a value (or its size(), if isSize) compares to a bound. */
+template<typename Bound, Comparison comparison, bool isSize>
+class BoundCheck {
+ public:
+  constexpr explicit BoundCheck(Bound bound) : bound_(bound) {}
+
+  template<typename T>
+  constexpr bool isValid(const T& value) const {
+    if constexpr (isSize) {
+      return compare(value.size());
+    } else {
+      return compare(value);
+    }
+  }
+
+  template<typename T>
+  void outputRequirement(const T&, std::ostream* output) const {
+    *output << (isSize ? "Size/length must be " : "Must be ");
+    switch (comparison) {
+      case Comparison::GREATER: *output << "greater than "; break;
+      case Comparison::GREATER_OR_EQUAL:
+        *output << "greater than or equal to ";
+        break;
+      case Comparison::LESS: *output << "less than "; break;
+      case Comparison::LESS_OR_EQUAL:
+        *output << "less than or equal to ";
+        break;
+    }
+    outputBound(bound_, output);
+    *output << ".";
+  }
+
+ private:
+  template<typename Value>
+  constexpr bool compare(const Value& value) const {
+    switch (comparison) {
+      case Comparison::GREATER: return value > bound_;
+      case Comparison::GREATER_OR_EQUAL: return value >= bound_;
+      case Comparison::LESS: return value < bound_;
+      case Comparison::LESS_OR_EQUAL: return value <= bound_;
+    }
+    return false;
+  }
+
+  Bound bound_;
+};
+
+
+/** Checks a value with a predicate, failing with a fixed requirement. */
+template<typename Predicate>
+class PredicateCheck {
+ public:
+  constexpr PredicateCheck(Predicate predicate, const char* requirement)
+      : predicate_(std::move(predicate)), requirement_(requirement) {}
+
+  template<typename T>
+  constexpr bool isValid(const T& value) const { return predicate_(value); }
+
+  template<typename T>
+  void outputRequirement(const T&, std::ostream* output) const {
+    *output << requirement_;
+  }
+
+ private:
+  Predicate predicate_;
+  const char* requirement_;  // Must outlive check, like a string literal.
+};
+
+
+/** Checks that a value passes every one of several checks. */
+template<typename... Checks>
+class AllOfChecks {
+ public:
+  constexpr explicit AllOfChecks(Checks... checks)
+      : checks_(std::move(checks)...) {}
+
+  template<typename T>
+  constexpr bool isValid(const T& value) const {
+    return std::apply([&value](const Checks&... checks) {
+      return (checks.isValid(value) && ...);
+    }, checks_);
+  }
+
+  /** Outputs requirement of the first check that value fails. */
+  template<typename T>
+  void outputRequirement(const T& value, std::ostream* output) const {
+    std::apply([&value, output](const Checks&... checks) {
+      bool isOutput = false;
+      auto outputIfFailed = [&](const auto& check) {
+        if (!isOutput && !check.isValid(value)) {
+          check.outputRequirement(value, output);
+          isOutput = true;
+        }
+      };
+      (outputIfFailed(checks), ...);
+    }, checks_);
+  }
+
+ private:
+  std::tuple<Checks...> checks_;
+};
+
+
+/** Checks that every item in a list (like a std::vector) passes a check. */
+template<typename ItemCheck>
+class EachItemCheck {
+ public:
+  constexpr explicit EachItemCheck(ItemCheck itemCheck)
+      : itemCheck_(std::move(itemCheck)) {}
+
+  template<typename List>
+  constexpr bool isValid(const List& list) const {
+    for (const auto& item : list) {
+      if (!itemCheck_.isValid(item)) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  /** Outputs requirement of the first item that fails. */
+  template<typename List>
+  void outputRequirement(const List& list, std::ostream* output) const {
+    std::size_t itemNumber = 1;
+    for (const auto& item : list) {
+      if (!itemCheck_.isValid(item)) {
+        *output << "List item " << itemNumber << " (" << item << "): ";
+        itemCheck_.outputRequirement(item, output);
+        return;
+      }
+      ++itemNumber;
+    }
+  }
+
+ private:
+  ItemCheck itemCheck_;
+};
+
+
+/** True if Check is a check type (see above) for values of type T. */
+template<typename Check, typename T, typename = void>
+constexpr bool isCheckFor = false;
+
+template<typename Check, typename T>
+constexpr bool isCheckFor<Check, T, std::void_t<
+    decltype(std::declval<const Check&>().outputRequirement(
+        std::declval<const T&>(), std::declval<std::ostream*>()))>> =
+    std::is_convertible<decltype(std::declval<const Check&>().isValid(
+        std::declval<const T&>())), bool>::value;
+
+
+}  // namespace flags
+
+
+/**
+ * Factories for common flag value checks, mirroring oomuse::Validators. For
+ * example, to accept 1 to 100:
+ *
+ *   Flag<int32> retryLimit("retry_limit", "Max # of times to retry",
+ *                          Checks<int32>::allOf(
+ *                              Checks<int32>::greaterOrEqual(1),
+ *                              Checks<int32>::lessOrEqual(100)));
+ */
+template<typename T>
+class Checks {
+ public:
+  static constexpr auto greater(T bound) {
+    return flags::BoundCheck<T, flags::Comparison::GREATER, false>(bound);
+  }
+
+  static constexpr auto greaterOrEqual(T bound) {
+    return flags::BoundCheck<T, flags::Comparison::GREATER_OR_EQUAL, false>(
+        bound);
+  }
+
+  static constexpr auto less(T bound) {
+    return flags::BoundCheck<T, flags::Comparison::LESS, false>(bound);
+  }
+
+  static constexpr auto lessOrEqual(T bound) {
+    return flags::BoundCheck<T, flags::Comparison::LESS_OR_EQUAL, false>(
+        bound);
+  }
+
+  static constexpr auto sizeGreaterOrEqual(std::size_t bound) {
+    return flags::BoundCheck<std::size_t,
+                             flags::Comparison::GREATER_OR_EQUAL, true>(bound);
+  }
+
+  static constexpr auto sizeLessOrEqual(std::size_t bound) {
+    return flags::BoundCheck<std::size_t,
+                             flags::Comparison::LESS_OR_EQUAL, true>(bound);
+  }
+
+  /**
+   * Checks values with predicate(const T&), which returns true if valid. The
+   * requirement (like "Must be even.") must outlive the check.
+   */
+  template<typename Predicate>
+  static constexpr auto satisfies(Predicate predicate,
+                                  const char* requirement) {
+    return flags::PredicateCheck<Predicate>(std::move(predicate), requirement);
+  }
+
+  /** Checks that values pass all of the given checks. */
+  template<typename... Checks>
+  static constexpr auto allOf(Checks... checks) {
+    return flags::AllOfChecks<Checks...>(std::move(checks)...);
+  }
+
+  /**
+   * For list types: checks that each item passes itemCheck, a check for the
+   * item type. For example, for positive IDs:
+   *
+   *   Checks<vector<int64>>::eachItem(Checks<int64>::greater(0))
+   */
+  template<typename ItemCheck>
+  static constexpr auto eachItem(ItemCheck itemCheck) {
+    return flags::EachItemCheck<ItemCheck>(std::move(itemCheck));
+  }
+};
+
+
+}  // namespace oomuse
+
+#endif  // OOMUSE_FLAGS_CHECKS_H
@@ -0,0 +1,115 @@
+/**
+ * Copyright 2015 Eric W. Barndollar. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef OOMUSE_FLAGS_DENSE_INT_SET_H
+#define OOMUSE_FLAGS_DENSE_INT_SET_H
+
+#include <cassert>
+#include <cstddef>
+#include <initializer_list>
+#include <utility>
+#include <vector>
+
+#include "oomuse/core/int_types.h"
+
+namespace oomuse {
+
+
+/**
+ * A set of small, non-negative integers (like shard numbers) held as a bitset,
+ * one bit per integer up to the largest item. Checking membership is a bounds
+ * check and a bit test, without hashing or allocating.
+ */
+class DenseIntSet {
+ public:
+  /** Largest integer a DenseIntSet can hold (so it's at most 8 KiB). */
+  static constexpr int32 MAX_ITEM = 65535;
+
+  DenseIntSet() {}
+
+  /** Creates a set of given items, each in [0, MAX_ITEM]. */
+  DenseIntSet(std::initializer_list<int32> items) {
+    for (int32 item : items) {
+      bool isInserted = insert(item);
+      assert(isInserted);
+      (void) isInserted;
+    }
+  }
+
+  /** Returns true if item is in this set. */
+  bool contains(int64 item) const {
+    // Negative items wrap to huge indexes, which are never in range.
+    uint64 index = static_cast<uint64>(item);
+    return (index < (words_.size() * BITS_PER_WORD))
+        && (((words_[index / BITS_PER_WORD] >> (index % BITS_PER_WORD)) & 1)
+            != 0);
+  }
+
+  /** Adds item to this set, returning false if it's not in [0, MAX_ITEM]. */
+  bool insert(int32 item) {
+    if ((item < 0) || (item > MAX_ITEM)) {
+      return false;
+    }
+
+    std::size_t wordIndex = static_cast<std::size_t>(item) / BITS_PER_WORD;
+    if (wordIndex >= words_.size()) {
+      words_.resize(wordIndex + 1);
+    }
+    uint64 bit = uint64(1) << (static_cast<std::size_t>(item) % BITS_PER_WORD);
+    if ((words_[wordIndex] & bit) == 0) {
+      words_[wordIndex] |= bit;
+      ++size_;
+    }
+    return true;
+  }
+
+  /** Returns number of items in this set. */
+  std::size_t size() const { return size_; }
+
+  bool empty() const { return size_ == 0; }
+
+  /** Calls visitor(int32 item) for each item, in increasing order. */
+  template<typename Visitor>
+  void forEach(Visitor&& visitor) const {
+    for (std::size_t i = 0; i < words_.size(); ++i) {
+      for (uint64 word = words_[i]; word != 0; word &= word - 1) {
+        std::size_t bitIndex = 0;
+        while (((word >> bitIndex) & 1) == 0) {
+          ++bitIndex;
+        }
+        visitor(static_cast<int32>(i * BITS_PER_WORD + bitIndex));
+      }
+    }
+  }
+
+  bool operator==(const DenseIntSet& other) const {
+    // Storage only extends to the largest item, so matches iff items do.
+    return words_ == other.words_;
+  }
+
+  bool operator!=(const DenseIntSet& other) const { return !(*this == other); }
+
+ private:
+  static constexpr std::size_t BITS_PER_WORD = 64;
+
+  std::vector<uint64> words_;
+  std::size_t size_ = 0;
+};
+
+
+}  // namespace oomuse
+
+#endif  // OOMUSE_FLAGS_DENSE_INT_SET_H
@@ -0,0 +1,112 @@
+/**
+ * Copyright 2015 Eric W. Barndollar. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef OOMUSE_FLAGS_ENUM_SET_H
+#define OOMUSE_FLAGS_ENUM_SET_H
+
+#include <cassert>
+#include <cstddef>
+#include <initializer_list>
+#include <type_traits>
+
+#include "oomuse/core/int_types.h"
+
+namespace oomuse {
+
+
+/**
+ * A set of values of enum type E (like enabled features), held as one 64-bit
+ * mask. Every value must be in [0, MAX_VALUE]. Checking membership is a bit
+ * test, and (being trivially copyable) a MutableFlag of an EnumSet is read and
+ * set atomically.
+ */
+template<typename E>
+class EnumSet {
+ public:
+  static_assert(std::is_enum<E>::value, "EnumSet is only for enums.");
+
+  using value_type = E;
+
+  /** Largest (underlying) value an EnumSet can hold. */
+  static constexpr int64 MAX_VALUE = 63;
+
+  constexpr EnumSet() {}
+
+  /** Creates a set of given values. */
+  constexpr EnumSet(std::initializer_list<E> values) {
+    for (E value : values) {
+      insert(value);
+    }
+  }
+
+  /** Returns true if value can be held in an EnumSet. */
+  static constexpr bool canHold(E value) {
+    return (static_cast<int64>(value) >= 0)
+        && (static_cast<int64>(value) <= MAX_VALUE);
+  }
+
+  /** Returns true if value is in this set. */
+  constexpr bool contains(E value) const {
+    return canHold(value) && ((bits_ & bitOf(value)) != 0);
+  }
+
+  /** Adds value, which must be one that canHold(). */
+  constexpr void insert(E value) {
+    assert(canHold(value));
+    bits_ |= bitOf(value);
+  }
+
+  /** Returns number of values in this set. */
+  constexpr std::size_t size() const {
+    std::size_t count = 0;
+    for (uint64 bits = bits_; bits != 0; bits &= bits - 1) {
+      ++count;
+    }
+    return count;
+  }
+
+  constexpr bool empty() const { return bits_ == 0; }
+
+  /** Calls visitor(E value) for each value, in increasing order. */
+  template<typename Visitor>
+  void forEach(Visitor&& visitor) const {
+    for (int64 i = 0; i <= MAX_VALUE; ++i) {
+      if (((bits_ >> i) & 1) != 0) {
+        visitor(static_cast<E>(i));
+      }
+    }
+  }
+
+  constexpr bool operator==(const EnumSet& other) const {
+    return bits_ == other.bits_;
+  }
+
+  constexpr bool operator!=(const EnumSet& other) const {
+    return bits_ != other.bits_;
+  }
+
+ private:
+  static constexpr uint64 bitOf(E value) {
+    return uint64(1) << static_cast<int64>(value);
+  }
+
+  uint64 bits_ = 0;
+};
+
+
+}  // namespace oomuse
+
+#endif  // OOMUSE_FLAGS_ENUM_SET_H
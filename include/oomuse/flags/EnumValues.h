@@ -0,0 +1,147 @@
+/**
+ * Copyright 2015 Eric W. Barndollar. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * =============================================================================
+ * Names of enum flag values, declared once next to the enum with a
+ * flagEnumValues() function (found by argument-dependent lookup):
+ *
+ *   enum class Mode {FAST, BALANCED, SAFE};
+ *
+ *   constexpr auto flagEnumValues(Mode) {
+ *     return oomuse::flags::enumValues<Mode>({
+ *         {"fast", Mode::FAST},
+ *         {"balanced", Mode::BALANCED},
+ *         {"safe", Mode::SAFE}});
+ *   }
+ *
+ * Then Flag<Mode> parses --mode=balanced into Mode::BALANCED. The table of
+ * names is sorted at compile time, so parsing a value is a binary search.
+ */
+
+#ifndef OOMUSE_FLAGS_ENUM_VALUES_H
+#define OOMUSE_FLAGS_ENUM_VALUES_H
+
+#include <cassert>
+#include <cstddef>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+namespace oomuse {
+namespace flags {
+
+
+/** A named value of enum type E. */
+template<typename E>
+struct EnumValue {
+  std::string_view name;
+  E value = E();
+};
+
+
+/** Names of N values of enum type E, for parsing and printing flags. */
+template<typename E, std::size_t N>
+class EnumValues {
+ public:
+  static_assert(std::is_enum<E>::value, "EnumValues are only for enums.");
+  static_assert(N > 0, "Enum flags need at least one value.");
+
+  /** Copies values, sorting them by name (at compile time, if constexpr). */
+  constexpr explicit EnumValues(const EnumValue<E> (&values)[N])
+      : values_(), sortedIndexes_() {
+    for (std::size_t i = 0; i < N; ++i) {
+      values_[i] = values[i];
+
+      // Insertion sort, since std::sort isn't constexpr in C++17.
+      std::string_view name = values[i].name;
+      std::size_t j = i;
+      while ((j > 0) && (name < values_[sortedIndexes_[j - 1]].name)) {
+        sortedIndexes_[j] = sortedIndexes_[j - 1];
+        --j;
+      }
+      assert((j == 0) || (name != values_[sortedIndexes_[j - 1]].name));
+      sortedIndexes_[j] = i;
+    }
+  }
+
+  constexpr std::size_t size() const { return N; }
+
+  /** Returns i-th value, in declared order. */
+  constexpr const EnumValue<E>& operator[](std::size_t i) const {
+    return values_[i];
+  }
+
+  /** Sets *value to the value with given name, returning false if none. */
+  constexpr bool find(std::string_view name, E* value) const {
+    std::size_t low = 0;
+    std::size_t high = N;
+    while (low < high) {
+      std::size_t middle = low + (high - low) / 2;
+      const EnumValue<E>& candidate = values_[sortedIndexes_[middle]];
+      int comparison = name.compare(candidate.name);
+      if (comparison == 0) {
+        *value = candidate.value;
+        return true;
+      }
+      if (comparison < 0) {
+        high = middle;
+      } else {
+        low = middle + 1;
+      }
+    }
+    return false;
+  }
+
+  /** Returns name of value (the first, if several), or "" if unnamed. */
+  constexpr std::string_view nameOf(E value) const {
+    for (const EnumValue<E>& candidate : values_) {
+      if (candidate.value == value) {
+        return candidate.name;
+      }
+    }
+    return std::string_view();
+  }
+
+ private:
+  EnumValue<E> values_[N];  // In declared order.
+  std::size_t sortedIndexes_[N];  // Indexes into values_, sorted by name.
+};
+
+
+/** Creates EnumValues for enum E, for returning from flagEnumValues(). */
+template<typename E, std::size_t N>
+constexpr EnumValues<E, N> enumValues(const EnumValue<E> (&values)[N]) {
+  return EnumValues<E, N>(values);
+}
+
+
+/** True if E is an enum with flagEnumValues(E) declared (see above). */
+template<typename E, typename = void>
+constexpr bool isFlagEnum = false;
+
+template<typename E>
+constexpr bool isFlagEnum<E, std::void_t<decltype(flagEnumValues(
+    std::declval<E>()))>> = std::is_enum<E>::value;
+
+
+/** The values of flag enum type E, built once at compile time. */
+template<typename E>
+inline constexpr auto flagEnumTable = flagEnumValues(E());
+
+
+}  // namespace flags
+}  // namespace oomuse
+
+#endif  // OOMUSE_FLAGS_ENUM_VALUES_H
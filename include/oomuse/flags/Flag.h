@@ -18,74 +18,495 @@
 #define OOMUSE_FLAGS_FLAG_H
 
 #include <algorithm>
+#include <atomic>
 #include <cassert>
-#include <cmath>
+#include <chrono>
+#include <cstddef>
 #include <memory>
+#include <ostream>
 #include <sstream>
 #include <string>
+#include <string_view>
+#include <type_traits>
+#include <unordered_set>
 #include <utility>
 #include <vector>
 
 #include "oomuse/core/Validator.h"
 #include "oomuse/core/int_types.h"
 #include "oomuse/core/readability_macros.h"
-#include "oomuse/core/strings.h"
+#include "oomuse/flags/ByteSize.h"
+#include "oomuse/flags/Checks.h"
+#include "oomuse/flags/DenseIntSet.h"
+#include "oomuse/flags/EnumSet.h"
+#include "oomuse/flags/EnumValues.h"
+#include "oomuse/flags/InlineCheck.h"
 #include "oomuse/flags/flags.h"
+#include "oomuse/flags/list_parsing.h"
+#include "oomuse/flags/number_parsing.h"
+#include "oomuse/flags/snapshot_encoding.h"
+#include "oomuse/flags/unit_parsing.h"
 
 namespace oomuse {
+namespace flags {
+
+
+class FlagRegistry;
+
+
+/**
+ * A parsed flag value whose custom validators run later, possibly on another
+ * thread (see setValidationThreadCount()).
+ */
+class DeferredValidation {
+ public:
+  virtual ~DeferredValidation() {}
+
+  /** Returns flag whose value is being validated. */
+  virtual const oomuse::AbstractFlag* flag() const = 0;
+
+  /** Returns true if value differs from flag's current value (if any). */
+  virtual bool changesValue() const = 0;
+
+  /** Runs validators, returning true if valid (else outputs why). */
+  virtual bool validate() = 0;
+
+  /** Sets flag to the value, which must have passed validate(). */
+  virtual void commit() = 0;
+};
+
+
+/** True if T is an EnumSet. */
+template<typename T>
+constexpr bool isEnumSet = false;
+
+template<typename E>
+constexpr bool isEnumSet<oomuse::EnumSet<E>> = true;
+
+
+/** Gives the enum type of a flag enum (T) or EnumSet<T>, as type. */
+template<typename T>
+struct EnumOf {
+  using type = T;
+};
+
+template<typename E>
+struct EnumOf<oomuse::EnumSet<E>> {
+  using type = E;
+};
+
+
+/**
+ * Returns name of flag value type T (like "int32"), as shown to tools that
+ * inspect flags. Specialize for custom flag types.
+ */
+template<typename T>
+inline const char* flagTypeName() {
+  if constexpr (isFlagEnum<T>) {
+    return "enum";
+  } else if constexpr (isEnumSet<T>) {
+    return "enum_set";
+  } else {
+    return "custom";
+  }
+}
+
+template<>
+inline const char* flagTypeName<bool>() { return "bool"; }
+
+template<>
+inline const char* flagTypeName<int32>() { return "int32"; }
+
+template<>
+inline const char* flagTypeName<int64>() { return "int64"; }
+
+template<>
+inline const char* flagTypeName<float>() { return "float"; }
+
+template<>
+inline const char* flagTypeName<double>() { return "double"; }
+
+template<>
+inline const char* flagTypeName<std::string>() { return "string"; }
+
+template<>
+inline const char* flagTypeName<std::vector<int32>>() { return "list<int32>"; }
+
+template<>
+inline const char* flagTypeName<std::vector<int64>>() { return "list<int64>"; }
+
+template<>
+inline const char* flagTypeName<std::vector<float>>() { return "list<float>"; }
+
+template<>
+inline const char* flagTypeName<std::vector<double>>() {
+  return "list<double>";
+}
+
+template<>
+inline const char* flagTypeName<std::vector<std::string>>() {
+  return "list<string>";
+}
+
+template<>
+inline const char* flagTypeName<std::unordered_set<int32>>() {
+  return "set<int32>";
+}
+
+template<>
+inline const char* flagTypeName<std::unordered_set<int64>>() {
+  return "set<int64>";
+}
+
+template<>
+inline const char* flagTypeName<std::unordered_set<std::string>>() {
+  return "set<string>";
+}
+
+template<>
+inline const char* flagTypeName<oomuse::DenseIntSet>() {
+  return "dense_int_set";
+}
+
+template<>
+inline const char* flagTypeName<std::chrono::nanoseconds>() {
+  return "duration";
+}
+
+template<>
+inline const char* flagTypeName<std::chrono::microseconds>() {
+  return "duration";
+}
+
+template<>
+inline const char* flagTypeName<std::chrono::milliseconds>() {
+  return "duration";
+}
+
+template<>
+inline const char* flagTypeName<std::chrono::seconds>() {
+  return "duration";
+}
+
+template<>
+inline const char* flagTypeName<oomuse::ByteSize>() { return "byte_size"; }
+
+
+/** Outputs a flag value the way it would be written as a flag. */
+template<typename T>
+void outputFlagValue(const T& value, std::ostream* output) {
+  if constexpr (isFlagEnum<T>) {
+    std::string_view name = flagEnumTable<T>.nameOf(value);
+    if (name.empty()) {
+      *output << static_cast<int64>(value);  // Not a named value.
+    } else {
+      *output << name;
+    }
+  } else if constexpr (std::is_floating_point<T>::value) {
+    outputNumber(value, output);  // Lossless, unlike operator<<.
+  } else {
+    *output << std::boolalpha << value;
+  }
+}
+
+/** Outputs list items separated by LIST_DELIMITER. */
+template<typename T>
+void outputFlagValue(const std::vector<T>& values, std::ostream* output) {
+  for (std::size_t i = 0; i < values.size(); ++i) {
+    if (i != 0) {
+      *output << LIST_DELIMITER;
+    }
+    outputFlagValue(values[i], output);
+  }
+}
+
+/** Outputs set items in sorted order, separated by LIST_DELIMITER. */
+template<typename T>
+void outputFlagValue(const std::unordered_set<T>& values,
+                     std::ostream* output) {
+  std::vector<T> sortedValues(values.begin(), values.end());
+  std::sort(sortedValues.begin(), sortedValues.end());
+  outputFlagValue(sortedValues, output);
+}
+
+/** Outputs set items in increasing order, separated by LIST_DELIMITER. */
+inline void outputFlagValue(const oomuse::DenseIntSet& values,
+                            std::ostream* output) {
+  bool isFirst = true;
+  values.forEach([output, &isFirst](int32 value) {
+    if (!isFirst) {
+      *output << LIST_DELIMITER;
+    }
+    *output << value;
+    isFirst = false;
+  });
+}
+
+/** Outputs enum set values in increasing order, separated by LIST_DELIMITER. */
+template<typename E>
+void outputFlagValue(const oomuse::EnumSet<E>& values, std::ostream* output) {
+  bool isFirst = true;
+  values.forEach([output, &isFirst](E value) {
+    if (!isFirst) {
+      *output << LIST_DELIMITER;
+    }
+    outputFlagValue(value, output);
+    isFirst = false;
+  });
+}
+
+/** Outputs a duration with a unit, like "250ms" (see outputDuration()). */
+template<typename Rep, typename Period>
+void outputFlagValue(const std::chrono::duration<Rep, Period>& value,
+                     std::ostream* output) {
+  outputDuration(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(value).count(),
+      output);
+}
+
+/** Returns a flag value as a printable string (see outputFlagValue()). */
+template<typename T>
+std::string printFlagValue(const T& value) {
+  std::stringstream ss;
+  outputFlagValue(value, &ss);
+  return ss.str();
+}
+
+
+/** True if values of type T can be compared with ==. */
+template<typename T, typename = void>
+constexpr bool isEqualityComparable = false;
+
+template<typename T>
+constexpr bool isEqualityComparable<
+    T, std::void_t<decltype(std::declval<const T&>()
+                            == std::declval<const T&>())>> = true;
+
+/** Returns true if flag values are equal (as printed, if T has no ==). */
+template<typename T>
+bool areFlagValuesEqual(const T& a, const T& b) {
+  if constexpr (isEqualityComparable<T>) {
+    return a == b;
+  } else {
+    return printFlagValue(a) == printFlagValue(b);
+  }
+}
+
+
+}  // namespace flags
 
 
 /** Indicates whether a flag must be explicitly set for correctness. */
 enum class FlagRequired {YES, NO};
 
 
+/**
+ * Text of a flag name or description, which gets copied into the flag (in one
+ * allocation for both). Text from fromStatic() is instead referenced where it
+ * is, without copying, so the flag must not outlive it.
+ */
+class FlagText {
+ public:
+  /** Copies text (including from a string literal or char array). */
+  FlagText(const char* text) : text_(text), isStatic_(false) {}
+
+  /** Copies text. */
+  FlagText(const std::string& text) : text_(text), isStatic_(false) {}
+
+  /** Copies text. */
+  FlagText(std::string_view text) : text_(text), isStatic_(false) {}
+
+  /** References text that outlives the flag (like constexpr data). */
+  static constexpr FlagText fromStatic(std::string_view text) {
+    return FlagText(text, true);
+  }
+
+  constexpr std::string_view text() const { return text_; }
+
+  /** Returns true if text outlives the flag, so needn't be copied. */
+  constexpr bool isStatic() const { return isStatic_; }
+
+ private:
+  constexpr FlagText(std::string_view text, bool isStatic)
+      : text_(text), isStatic_(isStatic) {}
+
+  std::string_view text_;
+  bool isStatic_;
+};
+
+
 /** Abstract, type-independent base class for a command-line flag. */
 class AbstractFlag {
  public:
   virtual ~AbstractFlag() {}
 
-  const std::string& name() const { return name_; }
-  const std::string& description() const { return description_; }
+  std::string_view name() const { return name_; }
+  std::string_view description() const { return description_; }
   bool isRequired() const { return isRequired_; }
 
   /** Returns true if flag has a value (default or explicit). */
   virtual bool hasValue() const = 0;
 
+  /** Returns true if flag value has been set (by init() or otherwise). */
+  bool wasExplicitlySet() const {
+    return wasExplicitlySet_.load(std::memory_order_relaxed);
+  }
+
   /** Returns true if this flag was configured with a default value. */
   virtual bool hasDefaultValue() const = 0;
 
+  /** Returns true if value can change after init() (see MutableFlag). */
+  virtual bool isMutable() const { return false; }
+
   /** Returns default value as a printable string, "" if none. */
   virtual std::string printableDefaultValue() const = 0;
 
+  /** Returns current value as a printable string, "" if none. */
+  virtual std::string printableValue() const = 0;
+
+  /** Returns name of this flag's value type (see flagTypeName()). */
+  virtual const char* typeName() const = 0;
+
+  /**
+   * Returns the values this flag allows as printable text (like "fast, safe"),
+   * or "" if it isn't limited to named values.
+   */
+  virtual std::string printableAllowedValues() const { return ""; }
+
+  /**
+   * Returns the values this flag allows with their underlying numbers (like
+   * "fast=0, safe=1"), or "" if it isn't limited to named values.
+   */
+  virtual std::string numberedAllowedValues() const { return ""; }
+
+  /**
+   * Appends the binary encoding of the current value (see
+   * snapshot_encoding.h) to *bytes and returns true, or returns false if
+   * there's no value or its type has no encoding.
+   */
+  virtual bool appendSnapshotValue(std::string* bytes) const = 0;
+
+  /**
+   * Counts one read of this flag's value for flagReadCounts(). Reads only call
+   * this when compiled with OOMUSE_FLAGS_COUNT_READS defined.
+   */
+  void countRead() const {
+    oomuse::flags::FlagsInternal::countRead(&readCounterIndex_);
+  }
+
+  /** Returns how many reads of this flag's value have been counted. */
+  uint64 readCount() const {
+    return oomuse::flags::FlagsInternal::readCount(
+        readCounterIndex_.load(std::memory_order_relaxed));
+  }
+
  protected:
-  AbstractFlag(const std::string& name, const std::string& description,
-               FlagRequired flagRequired)
-      : name_(name), description_(description),
+  AbstractFlag(FlagText name, FlagText description, FlagRequired flagRequired)
+      : name_(name.text()), description_(description.text()),
         isRequired_(flagRequired == FlagRequired::YES) {
-    assert(!name.empty());
-    assert(!description.empty());
+    assert(!name_.empty());
+    assert(!description_.empty());
 
+    copyNonStaticText(name, description);
     oomuse::flags::FlagsInternal::registerFlag(this);
   }
 
-  /** Parses, validates, sets flag value, and returns true if successful. */
-  virtual bool parseValidateAndSet(const std::string& textValue) = 0;
+  /**
+   * Parses, validates, sets flag value, and returns true if successful. The
+   * textValue may point into argv[], so it must not be stored as a view.
+   */
+  virtual bool parseValidateAndSet(std::string_view textValue) = 0;
+
+  /**
+   * Validates and (if valid) sets flag value from bytes written by
+   * appendSnapshotValue(), without parsing, setting *isValid. Returns false
+   * (doing neither) if bytes aren't a valid encoding for this flag's type.
+   */
+  virtual bool setFromSnapshotValue(std::string_view bytes, bool* isValid) = 0;
 
   /** Outputs error message about an invalid value for this flag. */
-  void outputError(const std::string& textValue, const std::string& errorMsg) {
-    oomuse::flags::FlagsInternal::outputStream()
+  void outputError(std::string_view textValue,
+                   std::string_view errorMsg) const {
+    oomuse::flags::FlagsInternal::errorStream()
         << "Invalid value for flag --" << name() << ": " << textValue << ". "
         << errorMsg << std::endl;
   }
 
+  /** Returns numeric syntax that numeric flag values should accept. */
+  static const oomuse::flags::NumberSyntax& numberSyntax() {
+    return oomuse::flags::FlagsInternal::numberSyntax();
+  }
+
+  /** Returns true if validators should be timed (see setInitProfiling()). */
+  static bool isProfilingInit() {
+    return oomuse::flags::FlagsInternal::isProfilingInit();
+  }
+
+  /** Records time spent running this flag's validators, while profiling. */
+  void recordValidationTime(std::chrono::nanoseconds time) const {
+    oomuse::flags::FlagsInternal::recordValidationTime(this, time);
+  }
+
+  /**
+   * Returns true if validation of a value should be deferred through
+   * deferValidation(), given whether this flag has any custom validators.
+   */
+  static bool shouldDeferValidation(bool hasValidators) {
+    return oomuse::flags::FlagsInternal::shouldDeferValidation(hasValidators);
+  }
+
+  /** Must be called after each change to a flag's value. */
+  void valueChanged() {
+    wasExplicitlySet_.store(true, std::memory_order_relaxed);
+    oomuse::flags::FlagsInternal::valueChanged(this);
+  }
+
+  /** Queues validation to run (then commit if valid) later during init(). */
+  static void deferValidation(
+      std::unique_ptr<oomuse::flags::DeferredValidation> validation) {
+    oomuse::flags::FlagsInternal::deferValidation(std::move(validation));
+  }
+
  private:
   CANT_COPY(AbstractFlag);
 
-  friend oomuse::flags::FlagsInternal;  // For access to parseValidateAndSet().
+  // For access to parseValidateAndSet() and setFromSnapshotValue().
+  friend oomuse::flags::FlagsInternal;
+  friend oomuse::flags::FlagRegistry;  // For access to nextPendingFlag_.
+
+  /** Copies any name or description text that might not outlive this flag. */
+  void copyNonStaticText(const FlagText& name, const FlagText& description) {
+    std::size_t ownedSize = (name.isStatic() ? 0 : name_.size())
+        + (description.isStatic() ? 0 : description_.size());
+    if (ownedSize == 0) {
+      return;
+    }
+
+    // Use one allocation for both.
+    ownedText_.reset(new char[ownedSize]);
+    char* nextText = ownedText_.get();
+    if (!name.isStatic()) {
+      name_ = std::string_view(nextText, name_.copy(nextText, name_.size()));
+      nextText += name_.size();
+    }
+    if (!description.isStatic()) {
+      description_ = std::string_view(
+          nextText, description_.copy(nextText, description_.size()));
+    }
+  }
 
-  const std::string name_;
-  const std::string description_;
+  std::string_view name_;
+  std::string_view description_;
+  std::unique_ptr<char[]> ownedText_;  // Null if all text is static.
   bool isRequired_;
+  std::atomic<bool> wasExplicitlySet_{false};
+
+  // Assigned on first counted read (0 until then). Kept even when reads
+  // aren't counted, so the layout never depends on OOMUSE_FLAGS_COUNT_READS
+  // (and it fits in padding before the pointer below anyway).
+  mutable std::atomic<uint32> readCounterIndex_{0};
+
+  AbstractFlag* nextPendingFlag_ = nullptr;  // Intrusive registration list.
 };
 
 
@@ -94,7 +515,12 @@ class AbstractFlag {
  * bool flags can be set to true with just --flagName. All flags must be
  * initialized in main() before using by calling oomuse::flags::init().
  *
- * Supported types: bool, int32, int64, float, double, string.
+ * Supported types: bool, int32, int64, float, double, string, and lists of
+ * any of these but bool (as std::vector, written --flagName=item1,item2,...).
+ * Sets are written the same way: std::unordered_set of int32, int64, or
+ * string, or DenseIntSet for small non-negative integers. Enums with
+ * flagEnumValues() declared (see EnumValues.h) are written by value name, and
+ * EnumSets of them as lists of names.
  */
 template<typename T>
 class Flag : public AbstractFlag {
@@ -102,46 +528,66 @@ class Flag : public AbstractFlag {
   /** Type alias for unique pointer to a Validator. */
   using UniqueValidator = std::unique_ptr<oomuse::Validator<T>>;
 
+  /** Enables a template only for check types (see Checks.h). */
+  template<typename Check>
+  using EnableIfCheck = std::enable_if_t<oomuse::flags::isCheckFor<Check, T>>;
+
   /** Creates a new, optional Flag. */
-  Flag(const std::string& name, const std::string& description);
+  Flag(FlagText name, FlagText description);
 
   /** Creates a new, optional Flag with a value validator. */
-  Flag(const std::string& name, const std::string& description,
+  Flag(FlagText name, FlagText description,
        UniqueValidator validator1);
 
   /** Creates a new, optional Flag with two value validators. */
-  Flag(const std::string& name, const std::string& description,
+  Flag(FlagText name, FlagText description,
        UniqueValidator validator1, UniqueValidator validator2);
 
   /** Creates a new Flag. */
-  Flag(const std::string& name, const std::string& description,
+  Flag(FlagText name, FlagText description,
        FlagRequired flagRequired);
 
   /** Creates a new Flag with a value validator. */
-  Flag(const std::string& name, const std::string& description,
+  Flag(FlagText name, FlagText description,
        FlagRequired flagRequired, UniqueValidator validator1);
 
   /** Creates a new Flag with two value validators. */
-  Flag(const std::string& name, const std::string& description,
+  Flag(FlagText name, FlagText description,
        FlagRequired flagRequired, UniqueValidator validator1,
        UniqueValidator validator2);
 
   /** Creates a new Flag with a default value. */
-  Flag(const std::string& name, const std::string& description, T defaultValue);
+  Flag(FlagText name, FlagText description, T defaultValue);
 
   /** Creates a new Flag with a default value and value validator. */
-  Flag(const std::string& name, const std::string& description, T defaultValue,
+  Flag(FlagText name, FlagText description, T defaultValue,
        UniqueValidator validator1);
 
   /** Creates a new Flag with a default value and two value validators. */
-  Flag(const std::string& name, const std::string& description, T defaultValue,
+  Flag(FlagText name, FlagText description, T defaultValue,
        UniqueValidator validator1, UniqueValidator validator2);
 
+  /** Creates a new, optional Flag with a value check (see Checks.h). */
+  template<typename Check, typename = EnableIfCheck<Check>>
+  Flag(FlagText name, FlagText description, Check check);
+
+  /** Creates a new Flag with a value check (see Checks.h). */
+  template<typename Check, typename = EnableIfCheck<Check>>
+  Flag(FlagText name, FlagText description, FlagRequired flagRequired,
+       Check check);
+
+  /** Creates a new Flag with a default value and value check. */
+  template<typename Check, typename = EnableIfCheck<Check>>
+  Flag(FlagText name, FlagText description, T defaultValue, Check check);
+
   virtual bool hasValue() const override { return hasValue_; }
 
   /** Returns value of this command-line flag; error to call if !hasValue(). */
   const T& value() const {
     assert(hasValue_);
+#if defined(OOMUSE_FLAGS_COUNT_READS)
+    countRead();
+#endif
     return value_;
   }
 
@@ -155,19 +601,83 @@ class Flag : public AbstractFlag {
 
   virtual std::string printableDefaultValue() const override;
 
+  virtual std::string printableValue() const override;
+
+  virtual const char* typeName() const override {
+    return oomuse::flags::flagTypeName<T>();
+  }
+
+  virtual std::string printableAllowedValues() const override;
+
+  virtual std::string numberedAllowedValues() const override;
+
+  virtual bool appendSnapshotValue(std::string* bytes) const override {
+    return hasValue_ && oomuse::flags::appendSnapshotValue(value_, bytes);
+  }
+
  protected:
-  virtual bool parseValidateAndSet(const std::string& textValue) override;
+  virtual bool parseValidateAndSet(std::string_view textValue) override;
+
+  virtual bool setFromSnapshotValue(std::string_view bytes,
+                                    bool* isValid) override;
+
+  /**
+   * Validates and (if valid) sets a parsed value, returning true if valid.
+   * While init() is validating in parallel (or a flag file is reloading), only
+   * queues value for validation.
+   */
+  bool validateAndSet(T value);
+
+  /** Stores an already validated value; subclasses may store it elsewhere. */
+  virtual void setValue(T value);
+
+  /** Returns true if flag has a value equal to the given one. */
+  virtual bool hasValueEqualTo(const T& value) const {
+    return hasValue_ && oomuse::flags::areFlagValuesEqual(value_, value);
+  }
+
+  /** Returns true if value passes all custom validators (else outputs why). */
+  bool passesCustomValidators(const T& value) const;
 
  private:
-  Flag(const std::string& name, const std::string& description,
+  /** A value of this flag waiting for parallel validation. */
+  class DeferredValue : public oomuse::flags::DeferredValidation {
+   public:
+    DeferredValue(Flag<T>* flag, T value)
+        : flag_(flag), value_(std::move(value)) {}
+
+    virtual const AbstractFlag* flag() const override { return flag_; }
+
+    virtual bool changesValue() const override {
+      return !flag_->hasValueEqualTo(value_);
+    }
+
+    virtual bool validate() override {
+      return flag_->passesCustomValidators(value_);
+    }
+
+    virtual void commit() override { flag_->setValue(std::move(value_)); }
+
+   private:
+    Flag<T>* flag_;
+    T value_;
+  };
+
+  Flag(FlagText name, FlagText description,
        FlagRequired flagRequired, T defaultValue, bool hasDefaultValue,
-       UniqueValidator validator1, UniqueValidator validator2);
+       oomuse::flags::InlineCheck<T> check);
 
   CANT_COPY(Flag);
 
-  bool validateAndSet(const T& value);
-  bool passesCustomValidators(const T& value);
-  bool passesValidator(const oomuse::Validator<T>& validator, const T& value);
+  /** Returns a check running given validators (if any). */
+  static oomuse::flags::InlineCheck<T> validatorsCheck(
+      UniqueValidator validator1, UniqueValidator validator2);
+
+  /** For list & set types: parses items into a new one, then sets it. */
+  bool parseListValidateAndSet(std::string_view textValue);
+
+  /** For std::chrono duration types: parses whole ticks, then sets them. */
+  bool parseDurationValidateAndSet(std::string_view textValue);
 
   T value_;
   bool hasValue_;
@@ -175,97 +685,129 @@ class Flag : public AbstractFlag {
   T defaultValue_;
   bool hasDefaultValue_;
 
-  std::vector<UniqueValidator> validators_;
+  oomuse::flags::InlineCheck<T> check_;
 };
 
 
 template<typename T>
-Flag<T>::Flag(const std::string& name, const std::string& description)
-    : Flag(name, description, FlagRequired::NO, T(), false, nullptr, nullptr) {
+Flag<T>::Flag(FlagText name, FlagText description)
+    : Flag(name, description, FlagRequired::NO, T(), false,
+           oomuse::flags::InlineCheck<T>()) {
 }
 
 
 template<typename T>
-Flag<T>::Flag(const std::string& name, const std::string& description,
+Flag<T>::Flag(FlagText name, FlagText description,
               UniqueValidator validator1)
     : Flag(name, description, FlagRequired::NO, T(), false,
-           std::forward<UniqueValidator>(validator1), nullptr) {
+           validatorsCheck(std::move(validator1), nullptr)) {
 }
 
 
 template<typename T>
-Flag<T>::Flag(const std::string& name, const std::string& description,
+Flag<T>::Flag(FlagText name, FlagText description,
               UniqueValidator validator1, UniqueValidator validator2)
     : Flag(name, description, FlagRequired::NO, T(), false,
-           std::forward<UniqueValidator>(validator1),
-           std::forward<UniqueValidator>(validator2)) {
+           validatorsCheck(std::move(validator1), std::move(validator2))) {
 }
 
 
 template<typename T>
-Flag<T>::Flag(const std::string& name, const std::string& description,
+Flag<T>::Flag(FlagText name, FlagText description,
               FlagRequired flagRequired)
-    : Flag(name, description, flagRequired, T(), false, nullptr, nullptr) {
+    : Flag(name, description, flagRequired, T(), false,
+           oomuse::flags::InlineCheck<T>()) {
 }
 
 
 template<typename T>
-Flag<T>::Flag(const std::string& name, const std::string& description,
+Flag<T>::Flag(FlagText name, FlagText description,
               FlagRequired flagRequired, UniqueValidator validator1)
     : Flag(name, description, flagRequired, T(), false,
-           std::forward<UniqueValidator>(validator1), nullptr) {
+           validatorsCheck(std::move(validator1), nullptr)) {
 }
 
 
 template<typename T>
-Flag<T>::Flag(const std::string& name, const std::string& description,
+Flag<T>::Flag(FlagText name, FlagText description,
               FlagRequired flagRequired, UniqueValidator validator1,
               UniqueValidator validator2)
     : Flag(name, description, flagRequired, T(), false,
-           std::forward<UniqueValidator>(validator1),
-           std::forward<UniqueValidator>(validator2)) {
+           validatorsCheck(std::move(validator1), std::move(validator2))) {
 }
 
 
 template<typename T>
-Flag<T>::Flag(const std::string& name, const std::string& description,
+Flag<T>::Flag(FlagText name, FlagText description,
               T defaultValue)
     : Flag(name, description, FlagRequired::NO, defaultValue, true,
-           nullptr, nullptr) {
+           oomuse::flags::InlineCheck<T>()) {
 }
 
 
 template<typename T>
-Flag<T>::Flag(const std::string& name, const std::string& description,
+Flag<T>::Flag(FlagText name, FlagText description,
               T defaultValue, UniqueValidator validator1)
     : Flag(name, description, FlagRequired::NO, defaultValue, true,
-           std::forward<UniqueValidator>(validator1), nullptr) {
+           validatorsCheck(std::move(validator1), nullptr)) {
 }
 
 
 template<typename T>
-Flag<T>::Flag(const std::string& name, const std::string& description,
+Flag<T>::Flag(FlagText name, FlagText description,
               T defaultValue, UniqueValidator validator1,
               UniqueValidator validator2)
     : Flag(name, description, FlagRequired::NO, defaultValue, true,
-           std::forward<UniqueValidator>(validator1),
-           std::forward<UniqueValidator>(validator2)) {
+           validatorsCheck(std::move(validator1), std::move(validator2))) {
 }
 
 
 template<typename T>
-Flag<T>::Flag(const std::string& name, const std::string& description,
+Flag<T>::Flag(FlagText name, FlagText description,
               FlagRequired flagRequired, T defaultValue, bool hasDefaultValue,
-              UniqueValidator validator1, UniqueValidator validator2)
+              oomuse::flags::InlineCheck<T> check)
     : AbstractFlag(name, description, flagRequired),
       value_(hasDefaultValue ? defaultValue : T()), hasValue_(hasDefaultValue),
-      defaultValue_(defaultValue), hasDefaultValue_(hasDefaultValue) {
-  if (validator1) {
-    validators_.emplace_back(std::move(validator1));
-  }
-  if (validator2) {
-    validators_.emplace_back(std::move(validator2));
+      defaultValue_(defaultValue), hasDefaultValue_(hasDefaultValue),
+      check_(std::move(check)) {
+}
+
+
+template<typename T>
+template<typename Check, typename>
+Flag<T>::Flag(FlagText name, FlagText description, Check check)
+    : Flag(name, description, FlagRequired::NO, T(), false,
+           oomuse::flags::InlineCheck<T>(std::move(check))) {
+}
+
+
+template<typename T>
+template<typename Check, typename>
+Flag<T>::Flag(FlagText name, FlagText description, FlagRequired flagRequired,
+              Check check)
+    : Flag(name, description, flagRequired, T(), false,
+           oomuse::flags::InlineCheck<T>(std::move(check))) {
+}
+
+
+template<typename T>
+template<typename Check, typename>
+Flag<T>::Flag(FlagText name, FlagText description, T defaultValue,
+              Check check)
+    : Flag(name, description, FlagRequired::NO, defaultValue, true,
+           oomuse::flags::InlineCheck<T>(std::move(check))) {
+}
+
+
+template<typename T>
+oomuse::flags::InlineCheck<T> Flag<T>::validatorsCheck(
+    UniqueValidator validator1, UniqueValidator validator2) {
+  if (!validator1 && !validator2) {
+    return oomuse::flags::InlineCheck<T>();
   }
+
+  return oomuse::flags::InlineCheck<T>(oomuse::flags::ValidatorsCheck<T>(
+      std::move(validator1), std::move(validator2)));
 }
 
 
@@ -275,36 +817,124 @@ inline std::string Flag<T>::printableDefaultValue() const {
     return "";
   }
 
-  std::stringstream ss;
-  ss << std::boolalpha << defaultValue_;
-  return ss.str();
+  return oomuse::flags::printFlagValue(defaultValue_);
 }
 
 
-template<>
-inline bool Flag<bool>::parseValidateAndSet(const std::string& textValue) {
-  std::string lowercaseText =
-      oomuse::strings::toLowerCase(oomuse::strings::trimWhitespace(textValue));
+template<typename T>
+inline std::string Flag<T>::printableValue() const {
+  if (!hasValue_) {
+    return "";
+  }
+
+  return oomuse::flags::printFlagValue(value_);
+}
+
+
+template<typename T>
+inline std::string Flag<T>::printableAllowedValues() const {
+  if constexpr (oomuse::flags::isFlagEnum<T> || oomuse::flags::isEnumSet<T>) {
+    using Enum = typename oomuse::flags::EnumOf<T>::type;
+    const auto& table = oomuse::flags::flagEnumTable<Enum>;
+
+    std::string allowedValues;
+    for (std::size_t i = 0; i < table.size(); ++i) {
+      allowedValues += (i == 0) ? "" : ", ";
+      allowedValues += table[i].name;
+    }
+    return allowedValues;
+  } else {
+    return "";
+  }
+}
+
 
-  if ((lowercaseText == "true") || (lowercaseText == "")) {
-    return validateAndSet(true);
-  } else if (lowercaseText == "false") {
-    return validateAndSet(false);
+template<typename T>
+inline std::string Flag<T>::numberedAllowedValues() const {
+  if constexpr (oomuse::flags::isFlagEnum<T> || oomuse::flags::isEnumSet<T>) {
+    using Enum = typename oomuse::flags::EnumOf<T>::type;
+    using Number = typename std::underlying_type<Enum>::type;
+    const auto& table = oomuse::flags::flagEnumTable<Enum>;
+
+    std::string allowedValues;
+    for (std::size_t i = 0; i < table.size(); ++i) {
+      allowedValues += (i == 0) ? "" : ", ";
+      allowedValues += table[i].name;
+      allowedValues += "=";
+      allowedValues += std::to_string(static_cast<Number>(table[i].value));
+    }
+    return allowedValues;
+  } else {
+    return "";
   }
+}
 
-  outputError(textValue, "Must be true or false.");
-  return false;
+
+/** Parses enums (and EnumSets); other types must specialize this. */
+template<typename T>
+bool Flag<T>::parseValidateAndSet(std::string_view textValue) {
+  static_assert(oomuse::flags::isFlagEnum<T> || oomuse::flags::isEnumSet<T>,
+                "Custom flag types must specialize parseValidateAndSet().");
+
+  if constexpr (oomuse::flags::isEnumSet<T>) {
+    using Enum = typename T::value_type;
+    static_assert(oomuse::flags::isFlagEnum<Enum>,
+                  "EnumSet flags need flagEnumValues() for their enum.");
+    static_assert([]() {
+      const auto& table = oomuse::flags::flagEnumTable<Enum>;
+      for (std::size_t i = 0; i < table.size(); ++i) {
+        if (!T::canHold(table[i].value)) {
+          return false;
+        }
+      }
+      return true;
+    }(), "EnumSet flag values must all be in [0, EnumSet::MAX_VALUE].");
+
+    T values;
+    oomuse::flags::ListSplitter splitter(textValue);
+    std::string_view itemText;
+    for (std::size_t itemNumber = 1; splitter.next(&itemText); ++itemNumber) {
+      Enum value;
+      if (!oomuse::flags::flagEnumTable<Enum>.find(itemText, &value)) {
+        std::stringstream errorMsg;
+        errorMsg << "List item " << itemNumber << " must be one of: "
+                 << printableAllowedValues() << ".";
+        outputError(itemText, errorMsg.str());
+        return false;
+      }
+      values.insert(value);
+    }
+
+    return validateAndSet(values);
+  } else {
+    T value;
+    if (!oomuse::flags::flagEnumTable<T>.find(textValue, &value)) {
+      outputError(textValue,
+                  "Must be one of: " + printableAllowedValues() + ".");
+      return false;
+    }
+
+    return validateAndSet(value);
+  }
 }
 
 
 template<>
-inline bool Flag<int32>::parseValidateAndSet(const std::string& textValue) {
-  std::stringstream textStream(textValue);
-  int32 value;
-  textStream >> value;
+inline bool Flag<bool>::parseValidateAndSet(std::string_view textValue) {
+  bool value;
+  if (!oomuse::flags::parseBool(textValue, &value)) {
+    outputError(textValue, "Must be true or false.");
+    return false;
+  }
+
+  return validateAndSet(value);
+}
+
 
-  // Fail if text couldn't be converted to an int32 or if more text remains.
-  if (textStream.fail() || !(textStream >> std::ws).eof()) {
+template<>
+inline bool Flag<int32>::parseValidateAndSet(std::string_view textValue) {
+  int32 value;
+  if (!oomuse::flags::parseNumber(textValue, &value, numberSyntax())) {
     outputError(textValue, "Must be an int32 number.");
     return false;
   }
@@ -314,13 +944,9 @@ inline bool Flag<int32>::parseValidateAndSet(const std::string& textValue) {
 
 
 template<>
-inline bool Flag<int64>::parseValidateAndSet(const std::string& textValue) {
-  std::stringstream textStream(textValue);
+inline bool Flag<int64>::parseValidateAndSet(std::string_view textValue) {
   int64 value;
-  textStream >> value;
-
-  // Fail if text couldn't be converted to an int64 or if more text remains.
-  if (textStream.fail() || !(textStream >> std::ws).eof()) {
+  if (!oomuse::flags::parseNumber(textValue, &value, numberSyntax())) {
     outputError(textValue, "Must be an int64 number.");
     return false;
   }
@@ -330,14 +956,9 @@ inline bool Flag<int64>::parseValidateAndSet(const std::string& textValue) {
 
 
 template<>
-inline bool Flag<float>::parseValidateAndSet(const std::string& textValue) {
-  std::stringstream textStream(textValue);
+inline bool Flag<float>::parseValidateAndSet(std::string_view textValue) {
   float value;
-  textStream >> value;
-
-  // Fail if text couldn't be converted to a float or if more text remains.
-  if (textStream.fail() || !(textStream >> std::ws).eof()
-      || !std::isfinite(value)) {
+  if (!oomuse::flags::parseNumber(textValue, &value, numberSyntax())) {
     outputError(textValue, "Must be a finite float number.");
     return false;
   }
@@ -347,14 +968,9 @@ inline bool Flag<float>::parseValidateAndSet(const std::string& textValue) {
 
 
 template<>
-inline bool Flag<double>::parseValidateAndSet(const std::string& textValue) {
-  std::stringstream textStream(textValue);
+inline bool Flag<double>::parseValidateAndSet(std::string_view textValue) {
   double value;
-  textStream >> value;
-
-  // Fail if text couldn't be converted to a double or if more text remains.
-  if (textStream.fail() || !(textStream >> std::ws).eof()
-      || !std::isfinite(value)) {
+  if (!oomuse::flags::parseNumber(textValue, &value, numberSyntax())) {
     outputError(textValue, "Must be a finite double number.");
     return false;
   }
@@ -365,44 +981,235 @@ inline bool Flag<double>::parseValidateAndSet(const std::string& textValue) {
 
 template<>
 inline bool Flag<std::string>::parseValidateAndSet(
-    const std::string& textValue) {
-  return validateAndSet(textValue);
+    std::string_view textValue) {
+  // The only allocation while parsing: the string value that gets stored.
+  return validateAndSet(std::string(textValue));
+}
+
+
+template<>
+inline bool Flag<std::vector<int32>>::parseValidateAndSet(
+    std::string_view textValue) {
+  return parseListValidateAndSet(textValue);
+}
+
+
+template<>
+inline bool Flag<std::vector<int64>>::parseValidateAndSet(
+    std::string_view textValue) {
+  return parseListValidateAndSet(textValue);
+}
+
+
+template<>
+inline bool Flag<std::vector<float>>::parseValidateAndSet(
+    std::string_view textValue) {
+  return parseListValidateAndSet(textValue);
+}
+
+
+template<>
+inline bool Flag<std::vector<double>>::parseValidateAndSet(
+    std::string_view textValue) {
+  return parseListValidateAndSet(textValue);
+}
+
+
+template<>
+inline bool Flag<std::vector<std::string>>::parseValidateAndSet(
+    std::string_view textValue) {
+  return parseListValidateAndSet(textValue);
+}
+
+
+template<>
+inline bool Flag<std::unordered_set<int32>>::parseValidateAndSet(
+    std::string_view textValue) {
+  return parseListValidateAndSet(textValue);
+}
+
+
+template<>
+inline bool Flag<std::unordered_set<int64>>::parseValidateAndSet(
+    std::string_view textValue) {
+  return parseListValidateAndSet(textValue);
+}
+
+
+template<>
+inline bool Flag<std::unordered_set<std::string>>::parseValidateAndSet(
+    std::string_view textValue) {
+  return parseListValidateAndSet(textValue);
+}
+
+
+template<>
+inline bool Flag<oomuse::DenseIntSet>::parseValidateAndSet(
+    std::string_view textValue) {
+  oomuse::DenseIntSet items;
+  oomuse::flags::ListSplitter splitter(textValue);
+  std::string_view itemText;
+  for (std::size_t itemNumber = 1; splitter.next(&itemText); ++itemNumber) {
+    int32 item;
+    if (!oomuse::flags::parseNumber(itemText, &item, numberSyntax())
+        || !items.insert(item)) {
+      std::stringstream errorMsg;
+      errorMsg << "List item " << itemNumber << " must be an integer from 0 to "
+               << oomuse::DenseIntSet::MAX_ITEM << ".";
+      outputError(itemText, errorMsg.str());
+      return false;
+    }
+  }
+
+  return validateAndSet(std::move(items));
+}
+
+
+template<>
+inline bool Flag<std::chrono::nanoseconds>::parseValidateAndSet(
+    std::string_view textValue) {
+  return parseDurationValidateAndSet(textValue);
+}
+
+
+template<>
+inline bool Flag<std::chrono::microseconds>::parseValidateAndSet(
+    std::string_view textValue) {
+  return parseDurationValidateAndSet(textValue);
+}
+
+
+template<>
+inline bool Flag<std::chrono::milliseconds>::parseValidateAndSet(
+    std::string_view textValue) {
+  return parseDurationValidateAndSet(textValue);
+}
+
+
+template<>
+inline bool Flag<std::chrono::seconds>::parseValidateAndSet(
+    std::string_view textValue) {
+  return parseDurationValidateAndSet(textValue);
+}
+
+
+template<>
+inline bool Flag<oomuse::ByteSize>::parseValidateAndSet(
+    std::string_view textValue) {
+  uint64 bytes;
+  if (!oomuse::flags::parseByteSize(textValue, &bytes)) {
+    outputError(textValue,
+                "Must be a whole number of bytes, like 512, 64KiB, or 1.5GB.");
+    return false;
+  }
+
+  return validateAndSet(oomuse::ByteSize(bytes));
+}
+
+
+template<typename T>
+bool Flag<T>::parseListValidateAndSet(std::string_view textValue) {
+  using Item = typename T::value_type;
+
+  T items;
+  items.reserve(oomuse::flags::countListItems(textValue));
+
+  oomuse::flags::ListSplitter splitter(textValue);
+  std::string_view itemText;
+  Item item;
+  for (std::size_t itemNumber = 1; splitter.next(&itemText); ++itemNumber) {
+    if (!oomuse::flags::parseListItem(itemText, &item, numberSyntax())) {
+      std::stringstream errorMsg;
+      errorMsg << "List item " << itemNumber << " must be a valid "
+               << oomuse::flags::flagTypeName<Item>() << ".";
+      outputError(itemText, errorMsg.str());
+      return false;
+    }
+
+    // Appends to lists; adds to sets (ignoring duplicates).
+    items.insert(items.end(), std::move(item));
+  }
+
+  return validateAndSet(std::move(items));
+}
+
+
+template<typename T>
+bool Flag<T>::parseDurationValidateAndSet(std::string_view textValue) {
+  int64 nanoseconds;
+  if (!oomuse::flags::parseDuration(textValue, &nanoseconds)) {
+    outputError(textValue, "Must be a duration like 250ms, 1.5s, or 1h30m.");
+    return false;
+  }
+
+  // Coarser units (like seconds) can't hold a fraction of a tick.
+  const int64 tickNanoseconds =
+      std::chrono::duration_cast<std::chrono::nanoseconds>(T(1)).count();
+  if ((nanoseconds % tickNanoseconds) != 0) {
+    outputError(textValue, "Must be a whole multiple of "
+                               + oomuse::flags::printFlagValue(T(1)) + ".");
+    return false;
+  }
+
+  return validateAndSet(T(nanoseconds / tickNanoseconds));
+}
+
+
+template<typename T>
+bool Flag<T>::setFromSnapshotValue(std::string_view bytes, bool* isValid) {
+  T value;
+  if (!oomuse::flags::readSnapshotValue(bytes, &value)) {
+    return false;
+  }
+
+  // Checks aren't part of the snapshot schema, so may have changed since the
+  // value was snapshotted.
+  *isValid = validateAndSet(std::move(value));
+  return true;
 }
 
 
 template<typename T>
-bool Flag<T>::validateAndSet(const T& value) {
+bool Flag<T>::validateAndSet(T value) {
+  // Defer validation (to run in parallel) if needed:
+  if (shouldDeferValidation(check_.isSet())) {
+    deferValidation(std::make_unique<DeferredValue>(this, std::move(value)));
+    return true;
+  }
+
   // Validate:
   if (!passesCustomValidators(value)) {
     return false;
   }
 
   // Set:
-  value_ = value;
-  hasValue_ = true;
+  setValue(std::move(value));
   return true;
 }
 
 
 template<typename T>
-bool Flag<T>::passesCustomValidators(const T& value) {
-  return std::all_of(validators_.begin(), validators_.end(),
-      [this, &value](const UniqueValidator& validator) {
-        return passesValidator(*validator, value);
-      });
+void Flag<T>::setValue(T value) {
+  value_ = std::move(value);
+  hasValue_ = true;
+  valueChanged();
 }
 
 
 template<typename T>
-bool Flag<T>::passesValidator(const oomuse::Validator<T>& validator,
-                              const T& value) {
-  std::string validationError = validator.checkValidationErrors(value);
-  if (!validationError.empty()) {
-    // Convert value to string and output error.
-    std::stringstream ss;
-    ss << value;
+bool Flag<T>::passesCustomValidators(const T& value) const {
+  using Clock = std::chrono::steady_clock;
+  bool isTimed = check_.isSet() && isProfilingInit();
+  Clock::time_point startTime = isTimed ? Clock::now() : Clock::time_point();
+
+  std::string requirement;
+  bool isValid = check_.check(value, &requirement);
+  if (isTimed) {
+    recordValidationTime(Clock::now() - startTime);
+  }
 
-    outputError(ss.str(), validationError);
+  if (!isValid) {
+    outputError(oomuse::flags::printFlagValue(value), requirement);
     return false;
   }
 
@@ -0,0 +1,115 @@
+/**
+ * Copyright 2015 Eric W. Barndollar. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef OOMUSE_FLAGS_FLAG_FILE_WATCHER_H
+#define OOMUSE_FLAGS_FLAG_FILE_WATCHER_H
+
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "oomuse/core/readability_macros.h"
+
+namespace oomuse {
+  class AbstractFlag;
+}
+
+namespace oomuse {
+namespace flags {
+
+
+/**
+ * Reloads a flag file (see reloadFlagFile() in flags.h) whenever it or any
+ * file it includes changes, so that edits to MutableFlag values take effect
+ * within milliseconds, without a restart. Invalid edits are reported to the
+ * flags output stream, leaving all flags unchanged. Watching requires Linux
+ * (inotify), but reload() works anywhere.
+ *
+ * Sample usage, after init():
+ *
+ * FlagFileWatcher watcher;
+ * watcher.addReloadCallback([](const vector<const AbstractFlag*>& changed) {
+ *   ...
+ * });
+ * string errorMsg;
+ * if (!watcher.start("/etc/server.flags", &errorMsg)) {
+ *   ...
+ * }
+ */
+class FlagFileWatcher {
+ public:
+  /** Called with flags whose values changed, after all are set. */
+  using ReloadCallback =
+      std::function<void(const std::vector<const AbstractFlag*>& changed)>;
+
+  FlagFileWatcher() {}
+
+  /** Stops watching, if started. */
+  ~FlagFileWatcher() { stop(); }
+
+  /**
+   * Adds callback to call (on the watching thread) after each reload that
+   * changes any flag values.
+   */
+  void addReloadCallback(ReloadCallback callback);
+
+  /**
+   * Reloads flag file at path (to catch any edits since init()), then starts
+   * watching it on a new thread. Returns true if successful, else sets
+   * *errorMsg to describe why not. Can only be called once.
+   */
+  bool start(const std::string& path, std::string* errorMsg);
+
+  /** Stops watching the flag file, waiting for any reload in progress. */
+  void stop();
+
+  /**
+   * Reloads the flag file now, then calls reload callbacks if any flag values
+   * changed. Returns true if the flag file was valid.
+   */
+  bool reload();
+
+ private:
+  CANT_COPY(FlagFileWatcher);
+
+  /** Watches directories of all flag files that the latest reload read. */
+  bool watchFlagFiles(std::string* errorMsg);
+
+  /** Reads pending change events, returning true if any flag file changed. */
+  bool readEvents();
+
+  /** Reloads after flag files change, until stop(). */
+  void watch();
+
+  std::string path_;
+  std::vector<ReloadCallback> reloadCallbacks_;
+  std::vector<std::string> flagFilePaths_;  // Read by the latest reload.
+  std::mutex mutex_;  // Guards all of the above.
+
+  int inotifyFd_ = -1;
+  int stopFd_ = -1;  // An eventfd, signaled by stop().
+  std::vector<std::pair<int, std::string>> watchedFiles_;  // Watch id, name.
+  std::thread watchingThread_;
+};
+
+
+}  // namespace flags
+}  // namespace oomuse
+
+#endif  // OOMUSE_FLAGS_FLAG_FILE_WATCHER_H
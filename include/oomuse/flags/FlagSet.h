@@ -0,0 +1,262 @@
+/**
+ * Copyright 2015 Eric W. Barndollar. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * =============================================================================
+ * Compile-time minimal perfect hash over a statically known set of flag names.
+ * When a binary's flags are all known at build time, declaring them as a
+ * FlagSet lets init() resolve each --name with one hash and one comparison
+ * instead of building and probing a generic hash table:
+ *
+ * static constexpr auto appFlags =
+ *     oomuse::flags::makeFlagSet("retry_limit", "username", "verbose");
+ *
+ * int main(int argc, char* argv[]) {
+ *   oomuse::flags::setStaticFlagIndex(appFlags.index());
+ *   oomuse::flags::initOrDie(&argc, argv);
+ *   ...
+ * }
+ *
+ * Flags that aren't in the FlagSet still work, through the generic lookup.
+ * The hash is built by the compiler (using hash-and-displace), so duplicate
+ * names are compile errors. Sets of up to about 4000 names stay within
+ * default compiler constexpr evaluation limits (-fconstexpr-ops-limit).
+ */
+
+#ifndef OOMUSE_FLAGS_FLAG_SET_H
+#define OOMUSE_FLAGS_FLAG_SET_H
+
+#include <array>
+#include <cstddef>
+#include <stdexcept>
+#include <string_view>
+
+#include "oomuse/core/int_types.h"
+
+namespace oomuse {
+namespace flags {
+
+
+/** Hash functions shared by compile-time FlagSet and runtime lookups. */
+class FlagSetHashing {
+ public:
+  /** 64-bit FNV-1a hash of a flag name. */
+  static constexpr uint64 hashName(std::string_view name) {
+    uint64 hash = 14695981039346656037ULL;
+    for (char c : name) {
+      hash ^= static_cast<unsigned char>(c);
+      hash *= 1099511628211ULL;
+    }
+    return hash;
+  }
+
+  /** Mixes bits of x thoroughly (the splitmix64 finalizer). */
+  static constexpr uint64 mix(uint64 x) {
+    x ^= x >> 30;
+    x *= 0xBF58476D1CE4E5B9ULL;
+    x ^= x >> 27;
+    x *= 0x94D049BB133111EBULL;
+    x ^= x >> 31;
+    return x;
+  }
+
+  /** Returns first-level bucket for a name hash. */
+  static constexpr std::size_t bucket(uint64 nameHash,
+                                      std::size_t bucketCount) {
+    return static_cast<std::size_t>(mix(nameHash) % bucketCount);
+  }
+
+  /** Returns final slot for a name hash, given its bucket's displacement. */
+  static constexpr std::size_t slot(uint64 nameHash, uint32 displacement,
+                                    std::size_t slotCount) {
+    return static_cast<std::size_t>(
+        mix(nameHash ^ (displacement * 0x9E3779B97F4A7C15ULL)) % slotCount);
+  }
+
+ private:
+  FlagSetHashing() = delete;
+};
+
+
+/**
+ * A type-erased view of a FlagSet's perfect hash, as passed to
+ * setStaticFlagIndex(). The default-constructed index is empty.
+ */
+class StaticFlagIndex {
+ public:
+  /** Returned by find() for names not in the set. */
+  static constexpr std::size_t NOT_FOUND = ~static_cast<std::size_t>(0);
+
+  constexpr StaticFlagIndex()
+      : slotNames_(nullptr), displacements_(nullptr), size_(0),
+        bucketCount_(0) {}
+
+  constexpr StaticFlagIndex(const std::string_view* slotNames,
+                            const uint32* displacements, std::size_t size,
+                            std::size_t bucketCount)
+      : slotNames_(slotNames), displacements_(displacements), size_(size),
+        bucketCount_(bucketCount) {}
+
+  /** Returns number of names (and slots) in the set. */
+  constexpr std::size_t size() const { return size_; }
+
+  /** Returns name stored in given slot, which must be < size(). */
+  constexpr std::string_view nameAt(std::size_t slot) const {
+    return slotNames_[slot];
+  }
+
+  /** Returns slot in [0, size()) for given name, or NOT_FOUND. */
+  constexpr std::size_t find(std::string_view name) const {
+    if (size_ == 0) {
+      return NOT_FOUND;
+    }
+
+    uint64 nameHash = FlagSetHashing::hashName(name);
+    uint32 displacement =
+        displacements_[FlagSetHashing::bucket(nameHash, bucketCount_)];
+    std::size_t slot = FlagSetHashing::slot(nameHash, displacement, size_);
+    return (slotNames_[slot] == name) ? slot : NOT_FOUND;
+  }
+
+ private:
+  const std::string_view* slotNames_;
+  const uint32* displacements_;
+  std::size_t size_;
+  std::size_t bucketCount_;
+};
+
+
+/**
+ * A set of N flag names with a minimal perfect hash computed at compile time.
+ * Construct with makeFlagSet() and store in a static constexpr variable.
+ */
+template<std::size_t N>
+class FlagSet {
+ public:
+  static_assert(N > 0, "FlagSet must contain at least one flag name");
+
+  /** Number of first-level hash buckets (one name per bucket on average). */
+  static constexpr std::size_t BUCKET_COUNT = N;
+
+  /** Builds perfect hash; throws (a compile error if constexpr) on failure. */
+  constexpr explicit FlagSet(const std::array<std::string_view, N>& names);
+
+  /** Returns index for setStaticFlagIndex(); must outlive its use. */
+  constexpr StaticFlagIndex index() const {
+    return StaticFlagIndex(slotNames_.data(), displacements_.data(), N,
+                           BUCKET_COUNT);
+  }
+
+  /** Returns slot in [0, N) for given name, or StaticFlagIndex::NOT_FOUND. */
+  constexpr std::size_t find(std::string_view name) const {
+    return index().find(name);
+  }
+
+ private:
+  /** Upper bound on displacements tried per bucket before giving up. */
+  static constexpr uint32 MAX_DISPLACEMENT = 100000;
+
+  std::array<std::string_view, N> slotNames_;
+  std::array<uint32, BUCKET_COUNT> displacements_;
+};
+
+
+template<std::size_t N>
+constexpr FlagSet<N>::FlagSet(const std::array<std::string_view, N>& names)
+    : slotNames_(), displacements_() {
+  std::array<uint64, N> hashes{};
+  std::array<std::size_t, N> buckets{};
+  std::array<std::size_t, BUCKET_COUNT + 1> bucketStarts{};
+  std::size_t maxBucketSize = 0;
+  for (std::size_t i = 0; i < N; ++i) {
+    if (names[i].empty()) {
+      throw std::invalid_argument("Flag names must not be empty");
+    }
+    hashes[i] = FlagSetHashing::hashName(names[i]);
+    buckets[i] = FlagSetHashing::bucket(hashes[i], BUCKET_COUNT);
+    std::size_t bucketSize = ++bucketStarts[buckets[i] + 1];
+    maxBucketSize = (bucketSize > maxBucketSize) ? bucketSize : maxBucketSize;
+  }
+
+  // Group name indices by bucket (counting sort).
+  for (std::size_t b = 0; b < BUCKET_COUNT; ++b) {
+    bucketStarts[b + 1] += bucketStarts[b];
+  }
+  std::array<std::size_t, N> namesByBucket{};
+  std::array<std::size_t, BUCKET_COUNT> bucketFill{};
+  for (std::size_t i = 0; i < N; ++i) {
+    namesByBucket[bucketStarts[buckets[i]] + bucketFill[buckets[i]]++] = i;
+  }
+
+  // Place largest buckets first, while most slots are still free.
+  std::array<bool, N> isSlotUsed{};
+  std::array<std::size_t, N> memberSlots{};
+  for (std::size_t size = maxBucketSize; size > 0; --size) {
+    for (std::size_t b = 0; b < BUCKET_COUNT; ++b) {
+      if (bucketStarts[b + 1] - bucketStarts[b] != size) {
+        continue;
+      }
+      const std::size_t* members = &namesByBucket[bucketStarts[b]];
+
+      // Identical names always share a bucket (and would never separate).
+      for (std::size_t m = 1; m < size; ++m) {
+        for (std::size_t other = 0; other < m; ++other) {
+          if (names[members[m]] == names[members[other]]) {
+            throw std::invalid_argument("Flag names must be unique");
+          }
+        }
+      }
+
+      // Try displacements until all members land in distinct free slots.
+      bool isPlaced = false;
+      for (uint32 displacement = 0; !isPlaced; ++displacement) {
+        if (displacement >= MAX_DISPLACEMENT) {
+          throw std::invalid_argument("Could not build perfect hash");
+        }
+
+        isPlaced = true;
+        for (std::size_t m = 0; isPlaced && (m < size); ++m) {
+          memberSlots[m] =
+              FlagSetHashing::slot(hashes[members[m]], displacement, N);
+          isPlaced = !isSlotUsed[memberSlots[m]];
+          for (std::size_t other = 0; isPlaced && (other < m); ++other) {
+            isPlaced = (memberSlots[other] != memberSlots[m]);
+          }
+        }
+
+        if (isPlaced) {
+          displacements_[b] = displacement;
+          for (std::size_t m = 0; m < size; ++m) {
+            isSlotUsed[memberSlots[m]] = true;
+            slotNames_[memberSlots[m]] = names[members[m]];
+          }
+        }
+      }
+    }
+  }
+}
+
+
+/** Returns a FlagSet over the given flag names (typically string literals). */
+template<typename... Names>
+constexpr FlagSet<sizeof...(Names)> makeFlagSet(const Names&... names) {
+  return FlagSet<sizeof...(Names)>(
+      std::array<std::string_view, sizeof...(Names)>{{names...}});
+}
+
+
+}  // namespace flags
+}  // namespace oomuse
+
+#endif  // OOMUSE_FLAGS_FLAG_SET_H
@@ -0,0 +1,114 @@
+/**
+ * Copyright 2015 Eric W. Barndollar. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef OOMUSE_FLAGS_FLAG_USAGE_REPORT_H
+#define OOMUSE_FLAGS_FLAG_USAGE_REPORT_H
+
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "oomuse/core/int_types.h"
+#include "oomuse/core/readability_macros.h"
+
+namespace oomuse {
+namespace flags {
+
+
+/** How a flag was used over the runs added to a FlagUsageReport. */
+enum class FlagUsageStatus {
+  USED,  // Both set explicitly and read (or reads weren't counted).
+  UNUSED,  // Never set explicitly, and never read or without any value.
+  NEVER_SET,  // Read, but always left at its default (or with no value).
+  NEVER_READ,  // Set explicitly, but never read: setting it does nothing.
+};
+
+
+/** One flag's usage, merged over all runs added to a FlagUsageReport. */
+struct FlagUsage {
+  std::string name;
+  int32 runCount = 0;  // Runs of programs that had this flag.
+  int32 setRunCount = 0;  // Runs that set it explicitly.
+  uint64 readCount = 0;  // Total reads, if counted (see areReadsCounted()).
+  bool hasDefaultValue = false;  // In any run.
+  FlagUsageStatus status = FlagUsageStatus::USED;
+};
+
+
+/**
+ * Merges flag usage files written by many runs (see writeFlagUsage() in
+ * flags.h), of one program or of several sharing flags, to find flags that
+ * could be deleted: those never set explicitly in any run, or never read (if
+ * every run counted reads, see OOMUSE_FLAGS_COUNT_READS), or both. A flag that
+ * was never set and has no default value never had a value to read, so it's
+ * unused even if reads weren't counted.
+ *
+ * Sample usage:
+ *
+ * FlagUsageReport report;
+ * string errorMsg;
+ * for (const string& path : usageFilePaths) {
+ *   if (!report.addFile(path, &errorMsg)) {
+ *     ...
+ *   }
+ * }
+ * report.printUnusedFlags(&std::cout);
+ */
+class FlagUsageReport {
+ public:
+  FlagUsageReport() {}
+
+  /**
+   * Adds the run recorded in usage file at path, returning true if
+   * successful. Otherwise, sets *errorMsg to describe why not (and adds
+   * nothing).
+   */
+  bool addFile(const std::string& path, std::string* errorMsg);
+
+  /** Returns number of runs added. */
+  int32 runCount() const { return runCount_; }
+
+  /** Returns true if every run added counted flag reads. */
+  bool areReadsCounted() const { return areReadsCounted_; }
+
+  /** Returns usage of every flag in any run, sorted by name. */
+  std::vector<FlagUsage> flagUsages() const;
+
+  /**
+   * Outputs each flag that isn't USED, sorted by name, as tab-separated lines
+   * after a header line naming the columns:
+   *
+   * <name>\t<unused|never_set|never_read>\t<runs>\t<set runs>\t<reads>\t
+   * <has default: 0|1>
+   *
+   * Reads are "-" if not counted by every run.
+   */
+  void printUnusedFlags(std::ostream* output) const;
+
+ private:
+  CANT_COPY(FlagUsageReport);
+
+  std::map<std::string, FlagUsage> usages_;  // By flag name.
+  int32 runCount_ = 0;
+  bool areReadsCounted_ = true;
+};
+
+
+}  // namespace flags
+}  // namespace oomuse
+
+#endif  // OOMUSE_FLAGS_FLAG_USAGE_REPORT_H
@@ -0,0 +1,192 @@
+/**
+ * Copyright 2015 Eric W. Barndollar. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef OOMUSE_FLAGS_INLINE_CHECK_H
+#define OOMUSE_FLAGS_INLINE_CHECK_H
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <sstream>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+#include "oomuse/core/Validator.h"
+#include "oomuse/flags/Checks.h"
+
+namespace oomuse {
+namespace flags {
+
+
+/** Runs up to two oomuse::Validators as a check (see Checks.h). */
+template<typename T>
+class ValidatorsCheck {
+ public:
+  using UniqueValidator = std::unique_ptr<oomuse::Validator<T>>;
+
+  ValidatorsCheck(UniqueValidator validator1, UniqueValidator validator2)
+      : validators_{std::move(validator1), std::move(validator2)} {}
+
+  bool isValid(const T& value) const {
+    for (const UniqueValidator& validator : validators_) {
+      if (validator && !validator->checkValidationErrors(value).empty()) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  void outputRequirement(const T& value, std::ostream* output) const {
+    for (const UniqueValidator& validator : validators_) {
+      if (validator) {
+        std::string validationError = validator->checkValidationErrors(value);
+        if (!validationError.empty()) {
+          *output << validationError;
+          return;
+        }
+      }
+    }
+  }
+
+ private:
+  UniqueValidator validators_[2];
+};
+
+
+/**
+ * Holds any check type for values of type T (see Checks.h), in place if small
+ * enough (like most composed Checks), else on the heap. Running a check is one
+ * call through a function pointer, with the check's own code all inlined.
+ */
+template<typename T>
+class InlineCheck {
+ public:
+  /** Checks up to this size (and alignment) are held without allocating. */
+  static constexpr std::size_t CAPACITY = 2 * sizeof(void*);
+
+  /** Creates an empty InlineCheck, which every value passes. */
+  InlineCheck() {}
+
+  template<typename Check,
+           typename = std::enable_if_t<isCheckFor<Check, T>>>
+  explicit InlineCheck(Check check) : operations_(&operationsFor<Check>) {
+    if constexpr (isInline<Check>()) {
+      new (&storage_) Check(std::move(check));
+    } else {
+      *reinterpret_cast<Check**>(&storage_) = new Check(std::move(check));
+    }
+  }
+
+  InlineCheck(InlineCheck&& other) : operations_(other.operations_) {
+    if (operations_) {
+      operations_->move(&other.storage_, &storage_);
+      other.operations_ = nullptr;
+    }
+  }
+
+  ~InlineCheck() {
+    if (operations_) {
+      operations_->destroy(&storage_);
+    }
+  }
+
+  InlineCheck& operator=(const InlineCheck&) = delete;
+
+  /** Returns true if there's a check (that some values might fail). */
+  bool isSet() const { return operations_ != nullptr; }
+
+  /**
+   * Returns true if value passes check. Otherwise, sets *requirement to what
+   * value must be instead (so that only failures build any text).
+   */
+  bool check(const T& value, std::string* requirement) const {
+    return !operations_ || operations_->check(&storage_, value, requirement);
+  }
+
+ private:
+  using Storage = std::aligned_storage_t<CAPACITY, alignof(void*)>;
+
+  /** Type-specific operations on a check held in storage_. */
+  struct Operations {
+    bool (*check)(const Storage* storage, const T& value,
+                  std::string* requirement);
+    void (*move)(Storage* from, Storage* to);
+    void (*destroy)(Storage* storage);
+  };
+
+  template<typename Check>
+  static constexpr bool isInline() {
+    return (sizeof(Check) <= sizeof(Storage))
+        && (alignof(Check) <= alignof(Storage))
+        && std::is_nothrow_move_constructible<Check>::value;
+  }
+
+  template<typename Check>
+  static Check* get(Storage* storage) {
+    if constexpr (isInline<Check>()) {
+      return std::launder(reinterpret_cast<Check*>(storage));
+    } else {
+      return *reinterpret_cast<Check**>(storage);
+    }
+  }
+
+  template<typename Check>
+  static bool checkValue(const Storage* storage, const T& value,
+                         std::string* requirement) {
+    const Check& check = *get<Check>(const_cast<Storage*>(storage));
+    if (check.isValid(value)) {
+      return true;
+    }
+
+    std::stringstream ss;
+    check.outputRequirement(value, &ss);
+    *requirement = ss.str();
+    return false;
+  }
+
+  template<typename Check>
+  static void moveCheck(Storage* from, Storage* to) {
+    if constexpr (isInline<Check>()) {
+      new (to) Check(std::move(*get<Check>(from)));
+      destroyCheck<Check>(from);
+    } else {
+      *reinterpret_cast<Check**>(to) = get<Check>(from);
+    }
+  }
+
+  template<typename Check>
+  static void destroyCheck(Storage* storage) {
+    if constexpr (isInline<Check>()) {
+      get<Check>(storage)->~Check();
+    } else {
+      delete get<Check>(storage);
+    }
+  }
+
+  template<typename Check>
+  static constexpr Operations operationsFor = {
+      &checkValue<Check>, &moveCheck<Check>, &destroyCheck<Check>};
+
+  Storage storage_;
+  const Operations* operations_ = nullptr;
+};
+
+
+}  // namespace flags
+}  // namespace oomuse
+
+#endif  // OOMUSE_FLAGS_INLINE_CHECK_H
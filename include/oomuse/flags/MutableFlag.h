@@ -0,0 +1,325 @@
+/**
+ * Copyright 2015 Eric W. Barndollar. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef OOMUSE_FLAGS_MUTABLE_FLAG_H
+#define OOMUSE_FLAGS_MUTABLE_FLAG_H
+
+#include <atomic>
+#include <cassert>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+#include "oomuse/core/int_types.h"
+#include "oomuse/core/readability_macros.h"
+#include "oomuse/flags/Flag.h"
+
+namespace oomuse {
+namespace flags {
+
+
+/** Holds a trivially copyable value in a std::atomic. */
+template<typename T>
+class AtomicValue {
+ public:
+  explicit AtomicValue(T initialValue) : value_(initialValue) {}
+
+  /** Returns current value. */
+  T load() const { return value_.load(std::memory_order_acquire); }
+
+  /** Calls reader(current value) and returns its result. */
+  template<typename Reader>
+  auto read(Reader&& reader) const {
+    T value = load();
+    return std::forward<Reader>(reader)(static_cast<const T&>(value));
+  }
+
+  /** Replaces current value. */
+  void store(T value) { value_.store(value, std::memory_order_release); }
+
+ private:
+  CANT_COPY(AtomicValue);
+
+  std::atomic<T> value_;
+};
+
+
+/**
+ * Holds a value of any copyable type behind an atomically swapped pointer.
+ * Reads are wait-free: a reader announces itself in one of two per-epoch
+ * reader counts, uses the current value, then leaves. Writers are serialized
+ * and, after swapping in a new value, flip the epoch and wait for both reader
+ * counts to drain before deleting the old value (as in Left-Right), so the
+ * wait is bounded by reads already in progress.
+ */
+template<typename T>
+class EpochProtectedValue {
+ public:
+  explicit EpochProtectedValue(T initialValue)
+      : current_(new T(std::move(initialValue))) {}
+
+  ~EpochProtectedValue() { delete current_.load(); }
+
+  /** Returns a copy of the current value. */
+  T load() const { return read([](const T& value) { return value; }); }
+
+  /**
+   * Calls reader(current value) and returns its result. The reference passed
+   * to reader must not be used after it returns.
+   */
+  template<typename Reader>
+  auto read(Reader&& reader) const {
+    ReadGuard guard(this);
+    return std::forward<Reader>(reader)(
+        static_cast<const T&>(*current_.load()));
+  }
+
+  /** Replaces current value, blocking until no reader can see the old one. */
+  void store(T value) {
+    T* newValue = new T(std::move(value));
+
+    std::lock_guard<std::mutex> lock(writeMutex_);
+    T* oldValue = current_.exchange(newValue);
+
+    // Drain stragglers still in the idle epoch, switch new readers to it, and
+    // then drain the readers that might have seen oldValue.
+    uint32 previousEpoch = epoch_.load();
+    uint32 nextEpoch = previousEpoch ^ 1;
+    waitForReaders(nextEpoch);
+    epoch_.store(nextEpoch);
+    waitForReaders(previousEpoch);
+
+    delete oldValue;
+  }
+
+ private:
+  CANT_COPY(EpochProtectedValue);
+
+  /** A reader count on its own cache line. */
+  struct alignas(64) ReaderCount {
+    std::atomic<uint64> count{0};
+  };
+
+  /** Counts a reader as active in the current epoch during its lifetime. */
+  class ReadGuard {
+   public:
+    explicit ReadGuard(const EpochProtectedValue* owner)
+        : readerCount_(&owner->readerCounts_[owner->epoch_.load()].count) {
+      readerCount_->fetch_add(1);
+    }
+
+    ~ReadGuard() { readerCount_->fetch_sub(1); }
+
+   private:
+    CANT_COPY(ReadGuard);
+
+    std::atomic<uint64>* readerCount_;
+  };
+
+  void waitForReaders(uint32 epoch) const {
+    while (readerCounts_[epoch].count.load() != 0) {
+      std::this_thread::yield();
+    }
+  }
+
+  mutable ReaderCount readerCounts_[2];
+  std::atomic<uint32> epoch_{0};
+  std::atomic<T*> current_;
+  std::mutex writeMutex_;
+};
+
+
+/** A generation count on its own cache line. */
+struct alignas(64) FlagGeneration {
+  std::atomic<uint64> count{0};
+};
+
+/**
+ * Advanced by 2 after every MutableFlag value change, so that per-thread
+ * caches (see CachedFlagReader) can tell when to refresh. Odd while a
+ * MutableFlagBatch is setting values, when caches shouldn't refresh.
+ */
+inline FlagGeneration mutableFlagGeneration;
+
+/** True while this thread is setting values for a MutableFlagBatch. */
+inline thread_local bool isSettingMutableFlagBatch = false;
+
+
+/**
+ * During its lifetime, MutableFlag values set on this thread change together:
+ * CachedFlagReaders keep seeing all old values until every one is set. (Reads
+ * directly from MutableFlags may still see some new values before others.)
+ * Change listeners (see subscribeToFlagChanges()) get all of them at once.
+ * Batches on different threads take turns.
+ */
+class MutableFlagBatch {
+ public:
+  MutableFlagBatch() : lock_(batchMutex()) {
+    assert(!isSettingMutableFlagBatch);
+    isSettingMutableFlagBatch = true;
+    FlagsInternal::beginValueChangeBatch();
+
+    // Make generation odd before any new value can be seen.
+    mutableFlagGeneration.count.fetch_add(1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+  }
+
+  ~MutableFlagBatch() {
+    mutableFlagGeneration.count.fetch_add(1, std::memory_order_release);
+    isSettingMutableFlagBatch = false;
+    FlagsInternal::endValueChangeBatch();
+  }
+
+ private:
+  CANT_COPY(MutableFlagBatch);
+
+  static std::mutex& batchMutex() {
+    static std::mutex theMutex;
+    return theMutex;
+  }
+
+  std::lock_guard<std::mutex> lock_;
+};
+
+
+/** Storage for a MutableFlag<T> value, chosen by type. */
+template<typename T>
+using MutableValue = std::conditional_t<std::is_trivially_copyable<T>::value,
+                                        AtomicValue<T>,
+                                        EpochProtectedValue<T>>;
+
+
+}  // namespace flags
+
+
+/**
+ * A Flag whose value can also be changed at runtime (after init()) from any
+ * thread, for tuning knobs in long-running servers. Reads are wait-free:
+ * trivially copyable types (bool, int32, int64, float, double) are held in a
+ * std::atomic, and other types (like string) in an EpochProtectedValue. New
+ * values go through the same parsing and validators as at init().
+ *
+ * A MutableFlag isn't a Flag<T>, since Flag<T>::value() returns a reference
+ * that a change could invalidate: read through value() or read() instead. Use
+ * flag() to pass it where an AbstractFlag is expected (like to
+ * subscribeToFlagChanges()).
+ */
+template<typename T>
+class MutableFlag : protected Flag<T> {
+ public:
+  using Flag<T>::Flag;
+
+  using AbstractFlag::countRead;
+  using AbstractFlag::description;
+  using AbstractFlag::isRequired;
+  using AbstractFlag::name;
+  using AbstractFlag::readCount;
+  using AbstractFlag::wasExplicitlySet;
+  using Flag<T>::defaultValue;
+  using Flag<T>::hasDefaultValue;
+  using Flag<T>::numberedAllowedValues;
+  using Flag<T>::printableAllowedValues;
+  using Flag<T>::printableDefaultValue;
+  using Flag<T>::typeName;
+
+  /** Returns this flag as an AbstractFlag, to list or compare with others. */
+  const AbstractFlag* flag() const { return this; }
+
+  virtual bool hasValue() const override {
+    return hasValue_.load(std::memory_order_acquire);
+  }
+
+  virtual bool isMutable() const override { return true; }
+
+  /** Returns a copy of the current value; error to call if !hasValue(). */
+  T value() const {
+    assert(hasValue());
+#if defined(OOMUSE_FLAGS_COUNT_READS)
+    this->countRead();
+#endif
+    return value_.load();
+  }
+
+  /**
+   * Calls reader(const T& currentValue) and returns its result, without
+   * copying the value. The reference must not be used after reader returns.
+   */
+  template<typename Reader>
+  auto read(Reader&& reader) const {
+    assert(hasValue());
+#if defined(OOMUSE_FLAGS_COUNT_READS)
+    this->countRead();
+#endif
+    return value_.read(std::forward<Reader>(reader));
+  }
+
+  virtual std::string printableValue() const override {
+    if (!hasValue()) {
+      return "";
+    }
+
+    // Read value_ directly, so that printing isn't counted as a read.
+    return value_.read([](const T& value) {
+      return oomuse::flags::printFlagValue(value);
+    });
+  }
+
+  virtual bool appendSnapshotValue(std::string* bytes) const override {
+    return hasValue() && value_.read([bytes](const T& value) {
+      return oomuse::flags::appendSnapshotValue(value, bytes);
+    });
+  }
+
+  /** Validates and sets a new value, returning true if valid. */
+  bool set(T newValue) { return this->validateAndSet(std::move(newValue)); }
+
+  /** Parses, validates, and sets a new value, returning true if valid. */
+  bool setFromText(std::string_view textValue) {
+    return this->parseValidateAndSet(textValue);
+  }
+
+ protected:
+  virtual bool hasValueEqualTo(const T& otherValue) const override {
+    return hasValue() && value_.read([&otherValue](const T& value) {
+      return oomuse::flags::areFlagValuesEqual(value, otherValue);
+    });
+  }
+
+  virtual void setValue(T newValue) override {
+    value_.store(std::move(newValue));
+    hasValue_.store(true, std::memory_order_release);
+    if (!oomuse::flags::isSettingMutableFlagBatch) {
+      oomuse::flags::mutableFlagGeneration.count.fetch_add(
+          2, std::memory_order_release);
+    }
+    this->valueChanged();
+  }
+
+ private:
+  CANT_COPY(MutableFlag);
+
+  oomuse::flags::MutableValue<T> value_{
+      this->hasDefaultValue() ? this->defaultValue() : T()};
+  std::atomic<bool> hasValue_{this->hasDefaultValue()};
+};
+
+
+}  // namespace oomuse
+
+#endif  // OOMUSE_FLAGS_MUTABLE_FLAG_H
@@ -0,0 +1,95 @@
+/**
+ * Copyright 2015 Eric W. Barndollar. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef OOMUSE_FLAGS_SHARED_FLAGS_READER_H
+#define OOMUSE_FLAGS_SHARED_FLAGS_READER_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "oomuse/core/int_types.h"
+#include "oomuse/core/readability_macros.h"
+
+namespace oomuse {
+namespace flags {
+
+
+/** One flag, as published by some process's publishToSharedMemory(). */
+struct SharedFlagInfo {
+  std::string name;
+  std::string typeName;
+  std::string value;  // Empty if none.
+  std::string defaultValue;  // Empty if none.
+  bool hasValue = false;
+  bool hasDefaultValue = false;
+  bool wasExplicitlySet = false;
+  bool isValueTruncated = false;  // Value was too long to publish in full.
+};
+
+
+/**
+ * Reads flags published by another process into shared memory (see
+ * publishToSharedMemory() in flags.h). After open(), taking snapshots makes
+ * no system calls or calls into the publishing process.
+ *
+ * Sample usage:
+ *
+ * SharedFlagsReader reader;
+ * string errorMsg;
+ * if (!reader.open(SharedFlagsReader::segmentNameForProcess(pid), &errorMsg)) {
+ *   ...
+ * }
+ * vector<SharedFlagInfo> flags;
+ * if (reader.readSnapshot(&flags)) {
+ *   ...
+ * }
+ */
+class SharedFlagsReader {
+ public:
+  SharedFlagsReader() {}
+  ~SharedFlagsReader();
+
+  /** Returns default name of segment published by process with given pid. */
+  static std::string segmentNameForProcess(int64 pid);
+
+  /**
+   * Maps published segment with given name, returning true if successful.
+   * Otherwise, sets *errorMsg to describe why not. Can only succeed once.
+   */
+  bool open(const std::string& segmentName, std::string* errorMsg);
+
+  /**
+   * Replaces *flags with a consistent snapshot of all published flags, in
+   * name order. Returns false if the segment was too busy being changed to
+   * take a snapshot, or is corrupt.
+   */
+  bool readSnapshot(std::vector<SharedFlagInfo>* flags) const;
+
+ private:
+  CANT_COPY(SharedFlagsReader);
+
+  /** Copies flags without synchronization; returns false if out of bounds. */
+  bool copyFlags(std::vector<SharedFlagInfo>* flags) const;
+
+  const char* segment_ = nullptr;
+  std::size_t segmentSize_ = 0;
+};
+
+
+}  // namespace flags
+}  // namespace oomuse
+
+#endif  // OOMUSE_FLAGS_SHARED_FLAGS_READER_H
@@ -18,7 +18,7 @@
  * supported flag types are bool, int32, int64, float, double, and string.
  *
  * To support other types, you can provide a specialized implementation of
- * Flag<YourType>::parseValidateAndSet(const std::string& textValue); see Flag.h
+ * Flag<YourType>::parseValidateAndSet(std::string_view textValue); see Flag.h
  * to reference the default implementations.
  *
  * Sample command-line usage:
@@ -78,31 +78,186 @@
 #ifndef OOMUSE_FLAGS_FLAGS_H
 #define OOMUSE_FLAGS_FLAGS_H
 
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <memory>
 #include <ostream>
 #include <string>
+#include <string_view>
+#include <vector>
 
+#include "oomuse/core/int_types.h"
 #include "oomuse/core/readability_macros.h"
+#include "oomuse/flags/number_parsing.h"
 
 namespace oomuse {
   class AbstractFlag;
+
+  namespace flags {
+    class DeferredValidation;
+    class MutableFlagBatch;
+    class StaticFlagIndex;
+  }
 }
 
 namespace oomuse {
 namespace flags {
 
 
+/** Kinds of problems with command-line flags that init() can find. */
+enum class FlagErrorType {
+  UNRECOGNIZED_FLAG,
+  INVALID_VALUE,  // Either failed to parse or failed a validator.
+  MISSING_REQUIRED_FLAG,
+  BAD_FLAG_FILE,  // Missing, unreadable, or malformed --flagfile.
+};
+
+
+/** A problem with command-line flags found by initCollectingErrors(). */
+struct FlagError {
+  FlagErrorType type;
+  std::string flagName;  // Empty for BAD_FLAG_FILE.
+  std::string message;  // As output, but without the trailing newline.
+};
+
+
+/** Time and heap allocations spent in one phase of init(). */
+struct InitPhaseProfile {
+  std::chrono::nanoseconds time{0};
+  int64 allocations = -1;  // -1 if not counted (see setInitProfiling()).
+};
+
+
+/** Time init() spent setting one flag, over all of its values. */
+struct FlagInitProfile {
+  const AbstractFlag* flag;
+  int32 valueCount;  // Number of times set (by args, flag files, etc.).
+  std::chrono::nanoseconds parseTime;  // Parsing and setting values.
+  std::chrono::nanoseconds validationTime;  // Running custom validators.
+};
+
+
+/** Where init() spent its time, recorded only while profiling. */
+struct InitProfile {
+  /** Number of flags registered (during static initialization) by init(). */
+  std::size_t registeredFlagCount = 0;
+
+  /** Indexing the registered flags, which registration itself leaves out. */
+  InitPhaseProfile registration;
+
+  /** Setting flags from the environment (see setEnvironmentPrefix()). */
+  InitPhaseProfile environment;
+
+  /** Scanning argv[], including flag files and any inline validation. */
+  InitPhaseProfile args;
+
+  /** Running parallel validations and checking for required flags. */
+  InitPhaseProfile validation;
+
+  /** All of init(). */
+  InitPhaseProfile total;
+
+  /** Every flag that init() set, by parse + validation time (most first). */
+  std::vector<FlagInitProfile> flags;
+};
+
+
+/** Number of reads of one flag's value (see flagReadCounts()). */
+struct FlagReadCount {
+  const AbstractFlag* flag;
+  uint64 readCount;
+};
+
+
+/**
+ * True if this program was compiled with OOMUSE_FLAGS_COUNT_READS defined (the
+ * CMake option of that name), so that flag value reads are counted.
+ */
+#if defined(OOMUSE_FLAGS_COUNT_READS)
+constexpr bool IS_COUNTING_FLAG_READS = true;
+#else
+constexpr bool IS_COUNTING_FLAG_READS = false;
+#endif
+
+
+/** Called with flags whose values changed, each listed once. */
+using FlagChangeListener =
+    std::function<void(const std::vector<const AbstractFlag*>& changedFlags)>;
+
+
+/**
+ * Keeps a listener added by subscribeToFlagChanges() subscribed until it's
+ * destroyed (or unsubscribe() is called).
+ */
+class FlagChangeSubscription {
+ public:
+  FlagChangeSubscription() {}
+  FlagChangeSubscription(FlagChangeSubscription&& other)
+      : id_(other.id_) { other.id_ = 0; }
+  FlagChangeSubscription& operator=(FlagChangeSubscription&& other);
+  ~FlagChangeSubscription() { unsubscribe(); }
+
+  /**
+   * Stops the listener from being called. Once this returns, the listener
+   * isn't running (unless this was called from within the listener).
+   */
+  void unsubscribe();
+
+ private:
+  CANT_COPY(FlagChangeSubscription);
+
+  friend FlagChangeSubscription subscribeToFlagChanges(
+      FlagChangeListener listener,
+      std::vector<const AbstractFlag*> flags);
+
+  explicit FlagChangeSubscription(uint64 id) : id_(id) {}
+
+  uint64 id_ = 0;  // 0 if not subscribed.
+};
+
+
 /**
  * Parses and validates all command-line flags, removing all flags and values
  * from argv[] and updating *argcPtr to include only the program name and
  * remaining positional arguments. Any validation errors will be printed to
  * standard error, or an alternate stream can be set by setOutputStream().
  * Returns true if successful.
+ *
+ * A --flagfile=path arg sets flags from each line of the given file, in place
+ * of the arg (so later args override it). Lines hold one --flag[=value] each,
+ * with surrounding whitespace ignored, and may be blank or # comments. Files
+ * may include others through --flagfile lines, relative to the including file.
+ *
+ * Likewise, a --flag_snapshot=path arg (or line) sets flags from a snapshot
+ * written by writeFlagSnapshot(). If the program's flags (names, types, and
+ * enum names and numbers) are unchanged since it was written, the snapshot is
+ * mapped and its values bound to flags directly (checked by any validators),
+ * without parsing; otherwise, its values are parsed and validated as text.
+ *
+ * If setEnvironmentPrefix() was called, flags are set from the environment
+ * before any args, so args and flag files override environment values.
+ *
+ * A --flags_profile[=topCount] arg profiles init() (see setInitProfiling())
+ * and outputs the profile when done, listing the topCount (default 10) most
+ * expensive flags.
  */
 bool init(int* argcPtr, char* argv[]);
 
 /** Like init(), but accepts const char* argv[] instead. */
 bool init(int* argcPtr, const char* argv[]);
 
+/**
+ * Like init(), but instead of stopping at the first error, keeps going to find
+ * all of them in one pass: unrecognized flags, invalid values, missing required
+ * flags, and bad flag files. Each error is still output, and also appended to
+ * *errors in the order found: in argv order (with any parallel validation
+ * failures after all parse errors), then missing required flags.
+ */
+bool initCollectingErrors(int* argcPtr, const char* argv[],
+                          std::vector<FlagError>* errors);
+
 /** Like init(), but terminates the program if unsuccessful. */
 void initOrDie(int* argcPtr, const char* argv[]);
 
@@ -133,6 +288,145 @@ void printUsage(const std::string& programName,
 /** Changes output stream that error and usage messages are output to. */
 void setOutputStream(std::ostream* outputStream);
 
+/**
+ * Changes the numeric syntax accepted for int32, int64, float, and double flag
+ * values (by default, only plain decimal numbers).
+ */
+void setNumberSyntax(const NumberSyntax& numberSyntax);
+
+/**
+ * Resolves flags named in a compile-time FlagSet (see FlagSet.h) through its
+ * perfect hash instead of the generic flag index. Call before init(); the
+ * FlagSet must outlive init().
+ */
+void setStaticFlagIndex(const StaticFlagIndex& staticIndex);
+
+/**
+ * Makes init() also set flags from environment variables named prefix + flag
+ * name, like MYAPP_FLAG_cacheSize=64MiB for prefix "MYAPP_FLAG_" (or
+ * MYAPP_FLAG_flagfile=path for a flag file). The environment is read in one
+ * pass, skipping variables without the prefix before any flag lookup, and
+ * values are parsed and validated like args, with errors naming the variable.
+ * Call before init(); an empty prefix (the default) reads no variables.
+ */
+void setEnvironmentPrefix(const std::string& prefix);
+
+/**
+ * Makes init() parse all flag values first, then run their custom validators
+ * on up to threadCount threads at once, for programs with many or slow (like
+ * filesystem-checking) validators. Validation errors are still output in argv
+ * order. A threadCount of 1 (the default) validates each value as it's parsed.
+ */
+void setValidationThreadCount(int threadCount);
+
+/**
+ * Makes init() record where its time goes, by phase and by flag (see
+ * InitProfile and initProfile()), at a small cost per flag value. Call before
+ * init(). To also count heap allocations per phase, pass allocationCount: a
+ * function returning the number of allocations made by the process so far
+ * (like one counting calls to a replacement operator new).
+ */
+void setInitProfiling(bool isEnabled,
+                      int64 (*allocationCount)() = nullptr);
+
+/** Returns the profile recorded by init(), empty unless it was profiled. */
+const InitProfile& initProfile();
+
+/**
+ * Outputs profile as a readable report: the time (and any allocations) of
+ * each phase, then the topCount flags with the most parse + validation time,
+ * and the topCount flags with the slowest validators.
+ */
+void printInitProfile(const InitProfile& profile, std::ostream* output,
+                      std::size_t topCount = 10);
+
+/**
+ * Returns how many times each registered flag's value has been read (through
+ * value(), MutableFlag::read(), or a CachedFlagReader), summed over all
+ * threads, most read first (then by name). Counting only happens when the
+ * program is compiled with OOMUSE_FLAGS_COUNT_READS defined (as it is when
+ * linking the library built with that CMake option); otherwise reads compile
+ * to exactly what they would without it, and every count is 0. Each thread
+ * counts into its own counters, so counting costs a few nanoseconds per read
+ * without contention between threads.
+ */
+std::vector<FlagReadCount> flagReadCounts();
+
+/**
+ * Outputs readCounts (from flagReadCounts()) as a readable report, listing at
+ * most topCount flags (or all, if 0).
+ */
+void printFlagReadCounts(const std::vector<FlagReadCount>& readCounts,
+                         std::ostream* output, std::size_t topCount = 0);
+
+/**
+ * Publishes every registered flag (name, type, default and current values,
+ * and whether explicitly set) into a POSIX shared-memory segment, which other
+ * processes can read with SharedFlagsReader (or the oomuse-flags_dump tool)
+ * without any calls into this one. Values stay current as flags change. The
+ * segment is named segmentName, or "/oomuse-flags.<pid>" if empty, and only
+ * readable by processes of the same user (since flag values can be secrets).
+ * An existing segment with the default name (left by a dead process with the
+ * same pid) is replaced, but publishing fails if segmentName already exists.
+ * Returns true if successful (else outputs why). Not supported on Windows.
+ */
+bool publishToSharedMemory(const std::string& segmentName = "");
+
+/** Stops publishing to (and removes) any shared-memory segment. */
+void stopPublishingToSharedMemory();
+
+/**
+ * Re-reads the flag file at path (as given to --flagfile) after init(), to
+ * change MutableFlag values without a restart. Every value is parsed and
+ * validated before any is set: if all are valid, each changed MutableFlag is
+ * set at once (as one change, to CachedFlagReaders), else none are and errors
+ * are output. Changes to flags that aren't MutableFlags are output as ignored.
+ *
+ * As in init(), command-line args after --flagfile=path override the file, so
+ * flags they set keep their values (and new file values are output as
+ * ignored). Only values in the file are set: deleting a line leaves that flag
+ * at its current value, rather than reverting it to its default.
+ *
+ * Returns true if successful, filling changedFlags (if not null) with flags
+ * set to new values, and flagFilePaths (if not null) with paths of the file
+ * and any files it includes, even if unsuccessful. Can be called from any
+ * thread, even while others declare or list flags. See also FlagFileWatcher.
+ */
+bool reloadFlagFile(const std::string& path,
+                    std::vector<const AbstractFlag*>* changedFlags = nullptr,
+                    std::vector<std::string>* flagFilePaths = nullptr);
+
+/**
+ * Subscribes listener to changes in the values of given flags (or of all
+ * flags, if empty), which must outlive the subscription. Listeners run on a
+ * dedicated notifier thread, so flag writers never wait for them. Changes are
+ * delivered in batches: each listener gets one call listing every changed flag
+ * since its previous call, and flags set together (by init(), by
+ * reloadFlagFile(), or in a MutableFlagBatch) are always delivered together.
+ */
+FlagChangeSubscription subscribeToFlagChanges(
+    FlagChangeListener listener,
+    std::vector<const AbstractFlag*> flags = {});
+
+/**
+ * Writes a snapshot of all flags set (by init() or otherwise) to the file at
+ * path, for later runs to load quickly through --flag_snapshot. Flag values
+ * are stored in binary (with text for when the program's flags have changed),
+ * so call after init() succeeds. Returns true if successful (else outputs why).
+ */
+bool writeFlagSnapshot(const std::string& path);
+
+/**
+ * Writes whether each registered flag was set explicitly, whether it has a
+ * default value, and how many times it was read (if counted, see
+ * flagReadCounts()) to the file at path, for FlagUsageReport (or the
+ * oomuse-flags_unused tool) to merge with other runs' files and find flags
+ * that are never used. Call near exit, so the run's reads are all counted.
+ * Reads are counted if the calling program was compiled to count them.
+ * Returns true if successful (else outputs why).
+ */
+inline bool writeFlagUsage(const std::string& path);
+
 /** Testing only: clears all registered flags. Test with flags on stack. */
 void resetForTest();
 
@@ -144,20 +438,97 @@ class FlagsInternal {
 
   // For access to these functions:
   friend AbstractFlag;
+  friend class FlagFileWatcher;
+  friend MutableFlagBatch;
   friend bool init(int* argcPtr, const char* argv[]);
+  friend bool reloadFlagFile(const std::string& path,
+                             std::vector<const AbstractFlag*>* changedFlags,
+                             std::vector<std::string>* flagFilePaths);
+  friend bool writeFlagUsage(const std::string& path);
 
   /** Returns output stream for error messages (standard error by default). */
   static std::ostream& outputStream();
 
+  /**
+   * Returns outputStream(), after outputting the flag file location (like
+   * "flags.txt:12: ") or environment variable name of the flag being parsed,
+   * if it came from one.
+   */
+  static std::ostream& errorStream();
+
+  /** Returns numeric syntax accepted when parsing numeric flag values. */
+  static const NumberSyntax& numberSyntax();
+
+  /** Returns true if init() is being profiled (see setInitProfiling()). */
+  static bool isProfilingInit();
+
+  /** While profiling, adds time spent running flag's custom validators. */
+  static void recordValidationTime(const AbstractFlag* flag,
+                                   std::chrono::nanoseconds time);
+
+  /** Counts a read of the flag with given counter index (see countRead()). */
+  static void countRead(std::atomic<uint32>* counterIndex);
+
+  /** Returns reads counted for given counter index, over all threads. */
+  static uint64 readCount(uint32 counterIndex);
+
   /** For AbstractFlag: registers given flag so it can be parsed & set. */
   static void registerFlag(AbstractFlag* flag);
 
+  /** For AbstractFlag: updates anything tracking flag values. */
+  static void valueChanged(const AbstractFlag* flag);
+
+  /**
+   * For MutableFlagBatch: holds back change notifications from the start of a
+   * batch of value changes until its end.
+   */
+  static void beginValueChangeBatch();
+  static void endValueChangeBatch();
+
+  /**
+   * Returns true if validation of a value should be queued: while init() is
+   * validating in parallel, for flags with validators, and while reloading a
+   * flag file, for every flag (to validate everything before setting any).
+   */
+  static bool shouldDeferValidation(bool hasValidators);
+
+  /** Queues validation to run (and commit if valid) later. */
+  static void deferValidation(std::unique_ptr<DeferredValidation> validation);
+
   /** Parses, validates, and sets the given flag from the user's fullArg. */
-  static bool parseValidateAndSet(AbstractFlag* flag,
-                                  const std::string& fullArg);
+  static bool parseValidateAndSet(AbstractFlag* flag, std::string_view fullArg);
+
+  /**
+   * Sets the flag named flagName from fullArg, or if it is --flagfile or
+   * --flag_snapshot, all flags in that file, nested flagFileDepth files deep.
+   */
+  static bool setFlag(std::string_view fullArg, std::string_view flagName,
+                      int flagFileDepth);
+
+  /** Sets each flag named by an environment variable with the prefix. */
+  static bool setFlagsFromEnvironment();
+
+  /** Parses, validates, and sets each flag in the flag file at path. */
+  static bool parseFlagFile(std::string_view path, int flagFileDepth);
+
+  /**
+   * For writeFlagUsage(): writes flag usage to the file at path, recording
+   * whether the program counted reads (per isCountingReads).
+   */
+  static bool writeFlagUsage(const std::string& path, bool isCountingReads);
+
+  /** Sets each flag in the flag snapshot file at path. */
+  static bool loadFlagSnapshot(const std::string& path);
 };
 
 
+inline bool writeFlagUsage(const std::string& path) {
+  // Reads are counted inline, in the program rather than this library, so
+  // only the program knows whether they were counted.
+  return FlagsInternal::writeFlagUsage(path, IS_COUNTING_FLAG_READS);
+}
+
+
 }  // namespace flags
 }  // namespace oomuse
 
@@ -0,0 +1,145 @@
+/**
+ * Copyright 2015 Eric W. Barndollar. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * =============================================================================
+ * Splitting of list flag values (like --hosts=a,b,c) into items without
+ * copying any text. Delimiters are found 64 bytes at a time as a bit mask,
+ * using AVX2 or SSE2 where available (else plain loops), so even lists with
+ * many thousands of items are split in one quick pass.
+ */
+
+#ifndef OOMUSE_FLAGS_LIST_PARSING_H
+#define OOMUSE_FLAGS_LIST_PARSING_H
+
+#include <algorithm>
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+#include "oomuse/core/int_types.h"
+#include "oomuse/flags/number_parsing.h"
+
+namespace oomuse {
+namespace flags {
+
+
+/** Separates items in list flag values. */
+constexpr char LIST_DELIMITER = ',';
+
+/** Number of chars scanned for delimiters at once. */
+constexpr std::size_t LIST_BLOCK_SIZE = 64;
+
+
+/**
+ * Returns a mask with bit i set if text[i] is delimiter, for the first size
+ * (at most LIST_BLOCK_SIZE) chars of text.
+ */
+uint64 findDelimiters(const char* text, std::size_t size, char delimiter);
+
+/** Returns number of items in list text: 0 if empty, else 1 + delimiters. */
+std::size_t countListItems(std::string_view text,
+                           char delimiter = LIST_DELIMITER);
+
+
+/**
+ * Splits list text into items, as views into text. Empty text has no items,
+ * but otherwise every delimiter separates two (possibly empty) items.
+ */
+class ListSplitter {
+ public:
+  explicit ListSplitter(std::string_view text,
+                        char delimiter = LIST_DELIMITER)
+      : text_(text), delimiter_(delimiter), isDone_(text.empty()) {}
+
+  /** Sets *item to the next item and returns true, or returns false if none. */
+  bool next(std::string_view* item);
+
+ private:
+  /** Returns index of the lowest set bit in (non-zero) mask. */
+  static std::size_t lowestBitIndex(uint64 mask);
+
+  std::string_view text_;
+  char delimiter_;
+  bool isDone_;
+
+  std::size_t itemStart_ = 0;
+  std::size_t nextBlockStart_ = 0;
+  std::size_t blockStart_ = 0;
+  uint64 blockDelimiters_ = 0;  // Delimiters in block not yet split at.
+};
+
+
+/** Parses a numeric list item into *value, returning true if valid. */
+template<typename Number>
+inline bool parseListItem(std::string_view text, Number* value,
+                          const NumberSyntax& syntax) {
+  return parseNumber(text, value, syntax);
+}
+
+/** Sets a string list item, which is always valid. */
+inline bool parseListItem(std::string_view text, std::string* value,
+                          const NumberSyntax&) {
+  value->assign(text);
+  return true;
+}
+
+
+inline bool ListSplitter::next(std::string_view* item) {
+  while (blockDelimiters_ == 0) {
+    if (nextBlockStart_ >= text_.size()) {
+      if (isDone_) {
+        return false;
+      }
+
+      // Last item runs to the end of text.
+      isDone_ = true;
+      *item = text_.substr(itemStart_);
+      return true;
+    }
+
+    std::size_t blockSize =
+        std::min(LIST_BLOCK_SIZE, text_.size() - nextBlockStart_);
+    blockDelimiters_ =
+        findDelimiters(text_.data() + nextBlockStart_, blockSize, delimiter_);
+    blockStart_ = nextBlockStart_;
+    nextBlockStart_ += blockSize;
+  }
+
+  std::size_t itemEnd = blockStart_ + lowestBitIndex(blockDelimiters_);
+  blockDelimiters_ &= blockDelimiters_ - 1;  // Clear lowest set bit.
+  *item = text_.substr(itemStart_, itemEnd - itemStart_);
+  itemStart_ = itemEnd + 1;
+  return true;
+}
+
+
+inline std::size_t ListSplitter::lowestBitIndex(uint64 mask) {
+#if defined(__GNUC__)
+  return static_cast<std::size_t>(__builtin_ctzll(mask));
+#else
+  std::size_t index = 0;
+  while ((mask & 1) == 0) {
+    mask >>= 1;
+    ++index;
+  }
+  return index;
+#endif
+}
+
+
+}  // namespace flags
+}  // namespace oomuse
+
+#endif  // OOMUSE_FLAGS_LIST_PARSING_H
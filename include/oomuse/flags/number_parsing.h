@@ -0,0 +1,86 @@
+/**
+ * Copyright 2015 Eric W. Barndollar. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * =============================================================================
+ * Locale-independent, allocation-free parsing of numeric (and bool) flag
+ * values. Numbers are parsed with std::from_chars (falling back to
+ * strtof()/strtod() for floating-point values on standard libraries that don't
+ * provide a floating-point from_chars).
+ *
+ * Surrounding whitespace is ignored, but any other trailing text, out-of-range
+ * values, and (for float & double) non-finite values are rejected.
+ *
+ * Floating-point values are output losslessly, so that printed values parse
+ * back to exactly the same value.
+ */
+
+#ifndef OOMUSE_FLAGS_NUMBER_PARSING_H
+#define OOMUSE_FLAGS_NUMBER_PARSING_H
+
+#include <iosfwd>
+#include <string_view>
+
+#include "oomuse/core/int_types.h"
+
+namespace oomuse {
+namespace flags {
+
+
+/** Optional numeric syntax accepted in addition to plain decimal numbers. */
+struct NumberSyntax {
+  /** Accept 0x (hex), 0o (octal), and 0b (binary) prefixes for integers. */
+  bool allowRadixPrefixes = false;
+
+  /** Accept _ separators between digits, as in 1_000_000. */
+  bool allowDigitSeparators = false;
+};
+
+
+/** Returns text without leading or trailing whitespace. */
+std::string_view trimWhitespace(std::string_view text);
+
+/**
+ * Parses text as a bool into *value, returning true if successful. Accepts
+ * true or false in any case, and treats empty text as true (as in --flag).
+ */
+bool parseBool(std::string_view text, bool* value);
+
+/** Parses text as an int32 into *value, returning true if successful. */
+bool parseNumber(std::string_view text, int32* value,
+                 const NumberSyntax& syntax = NumberSyntax());
+
+/** Parses text as an int64 into *value, returning true if successful. */
+bool parseNumber(std::string_view text, int64* value,
+                 const NumberSyntax& syntax = NumberSyntax());
+
+/** Parses text as a finite float into *value, returning true if successful. */
+bool parseNumber(std::string_view text, float* value,
+                 const NumberSyntax& syntax = NumberSyntax());
+
+/** Parses text as a finite double into *value, returning true if successful. */
+bool parseNumber(std::string_view text, double* value,
+                 const NumberSyntax& syntax = NumberSyntax());
+
+/** Outputs value with the fewest digits that parse back to exactly it. */
+void outputNumber(float value, std::ostream* output);
+
+/** Outputs value with the fewest digits that parse back to exactly it. */
+void outputNumber(double value, std::ostream* output);
+
+
+}  // namespace flags
+}  // namespace oomuse
+
+#endif  // OOMUSE_FLAGS_NUMBER_PARSING_H
@@ -0,0 +1,186 @@
+/**
+ * Copyright 2015 Eric W. Barndollar. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * =============================================================================
+ * Binary encoding of flag values in flag snapshots (see writeFlagSnapshot()),
+ * read back without any text parsing. Encodings use native byte order:
+ *
+ *   Fixed-size values (numbers, enums, EnumSets, durations, ByteSizes): their
+ *     bytes, as copied by memcpy().
+ *   std::string: its characters.
+ *   Lists and sets of numbers (including DenseIntSet): the items' bytes, one
+ *     after another.
+ *   Lists and sets of strings: each item as a uint32 length, then characters.
+ *
+ * Other (custom) types have no encoding, so snapshots hold them only as text.
+ */
+
+#ifndef OOMUSE_FLAGS_SNAPSHOT_ENCODING_H
+#define OOMUSE_FLAGS_SNAPSHOT_ENCODING_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <unordered_set>
+#include <vector>
+
+#include "oomuse/core/int_types.h"
+#include "oomuse/flags/ByteSize.h"
+#include "oomuse/flags/DenseIntSet.h"
+#include "oomuse/flags/EnumSet.h"
+
+namespace oomuse {
+namespace flags {
+
+
+/** True if values of type T are encoded as their bytes. */
+template<typename T>
+constexpr bool isFixedSizeSnapshotValue =
+    std::is_arithmetic<T>::value || std::is_enum<T>::value
+    || std::is_same<T, oomuse::ByteSize>::value;
+
+template<typename E>
+constexpr bool isFixedSizeSnapshotValue<oomuse::EnumSet<E>> = true;
+
+template<typename Rep, typename Period>
+constexpr bool isFixedSizeSnapshotValue<std::chrono::duration<Rep, Period>> =
+    std::is_arithmetic<Rep>::value;
+
+
+/** True if T is a list or set of numbers or strings. */
+template<typename T>
+constexpr bool isSnapshotContainer = false;
+
+template<typename Item>
+constexpr bool isSnapshotContainer<std::vector<Item>> =
+    std::is_arithmetic<Item>::value || std::is_same<Item, std::string>::value;
+
+template<typename Item>
+constexpr bool isSnapshotContainer<std::unordered_set<Item>> =
+    std::is_arithmetic<Item>::value || std::is_same<Item, std::string>::value;
+
+
+/** True if values of type T have a binary snapshot encoding. */
+template<typename T>
+constexpr bool hasSnapshotEncoding = isFixedSizeSnapshotValue<T>
+    || isSnapshotContainer<T> || std::is_same<T, std::string>::value
+    || std::is_same<T, oomuse::DenseIntSet>::value;
+
+
+/** Appends the bytes of fixed-size value to *bytes. */
+template<typename T>
+void appendValueBytes(const T& value, std::string* bytes) {
+  bytes->append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+
+/**
+ * Reads a fixed-size value from the front of *bytes, removing it. Returns
+ * false if there aren't enough bytes.
+ */
+template<typename T>
+bool consumeValueBytes(std::string_view* bytes, T* value) {
+  if (bytes->size() < sizeof(T)) {
+    return false;
+  }
+
+  std::memcpy(value, bytes->data(), sizeof(T));
+  bytes->remove_prefix(sizeof(T));
+  return true;
+}
+
+
+/**
+ * Appends the encoding of value to *bytes, returning true, or returns false
+ * if type T has no encoding.
+ */
+template<typename T>
+bool appendSnapshotValue(const T& value, std::string* bytes) {
+  if constexpr (isFixedSizeSnapshotValue<T>) {
+    appendValueBytes(value, bytes);
+  } else if constexpr (std::is_same<T, std::string>::value) {
+    bytes->append(value);
+  } else if constexpr (std::is_same<T, oomuse::DenseIntSet>::value) {
+    value.forEach([bytes](int32 item) { appendValueBytes(item, bytes); });
+  } else if constexpr (isSnapshotContainer<T>) {
+    for (const auto& item : value) {
+      if constexpr (std::is_same<typename T::value_type, std::string>::value) {
+        appendValueBytes(static_cast<uint32>(item.size()), bytes);
+        bytes->append(item);
+      } else {
+        appendValueBytes(item, bytes);
+      }
+    }
+  } else {
+    return false;
+  }
+  return true;
+}
+
+
+/**
+ * Decodes bytes (from appendSnapshotValue()) into *value, returning false if
+ * they aren't a valid encoding (or type T has none).
+ */
+template<typename T>
+bool readSnapshotValue(std::string_view bytes, T* value) {
+  if constexpr (isFixedSizeSnapshotValue<T>) {
+    return (bytes.size() == sizeof(T)) && consumeValueBytes(&bytes, value);
+  } else if constexpr (std::is_same<T, std::string>::value) {
+    value->assign(bytes);
+    return true;
+  } else if constexpr (std::is_same<T, oomuse::DenseIntSet>::value) {
+    *value = oomuse::DenseIntSet();
+    int32 item;
+    while (consumeValueBytes(&bytes, &item)) {
+      if (!value->insert(item)) {
+        return false;
+      }
+    }
+    return bytes.empty();
+  } else if constexpr (isSnapshotContainer<T>) {
+    using Item = typename T::value_type;
+    *value = T();
+    if constexpr (std::is_arithmetic<Item>::value) {
+      value->reserve(bytes.size() / sizeof(Item));
+    }
+    while (!bytes.empty()) {
+      Item item;
+      if constexpr (std::is_same<Item, std::string>::value) {
+        uint32 length;
+        if (!consumeValueBytes(&bytes, &length) || (bytes.size() < length)) {
+          return false;
+        }
+        item.assign(bytes.substr(0, length));
+        bytes.remove_prefix(length);
+      } else if (!consumeValueBytes(&bytes, &item)) {
+        return false;
+      }
+      value->insert(value->end(), std::move(item));
+    }
+    return true;
+  } else {
+    return false;
+  }
+}
+
+
+}  // namespace flags
+}  // namespace oomuse
+
+#endif  // OOMUSE_FLAGS_SNAPSHOT_ENCODING_H
@@ -0,0 +1,68 @@
+/**
+ * Copyright 2015 Eric W. Barndollar. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * =============================================================================
+ * Exact, allocation-free parsing and printing of durations (like "250ms" or
+ * "1h30m") and byte sizes (like "64KiB" or "1.5GB") with unit suffixes.
+ * Fractional amounts are allowed as long as they come to a whole number of
+ * nanoseconds or bytes, and out-of-range values are rejected.
+ *
+ * Duration units: ns, us, ms, s, m, h.
+ * Byte size units: B, KB, MB, GB, TB (powers of 1000), and KiB, MiB, GiB, TiB
+ * (powers of 1024).
+ */
+
+#ifndef OOMUSE_FLAGS_UNIT_PARSING_H
+#define OOMUSE_FLAGS_UNIT_PARSING_H
+
+#include <ostream>
+#include <string_view>
+
+#include "oomuse/core/int_types.h"
+
+namespace oomuse {
+namespace flags {
+
+
+/**
+ * Parses text as a duration into *nanoseconds, returning true if successful.
+ * A duration is one or more amounts with units (like "1h30m"), optionally
+ * negative, or just "0".
+ */
+bool parseDuration(std::string_view text, int64* nanoseconds);
+
+/**
+ * Parses text as a byte size into *bytes, returning true if successful. A
+ * byte size is one amount with an optional unit (bytes if none).
+ */
+bool parseByteSize(std::string_view text, uint64* bytes);
+
+/**
+ * Outputs a duration in the largest unit that shows it exactly with at most
+ * two decimal places (like "1.5s" or "250ms"), as parseDuration() accepts.
+ */
+void outputDuration(int64 nanoseconds, std::ostream* output);
+
+/**
+ * Outputs a byte size in the largest unit that shows it exactly with at most
+ * two decimal places (like "1.5GiB" or "100MB"), as parseByteSize() accepts.
+ */
+void outputByteSize(uint64 bytes, std::ostream* output);
+
+
+}  // namespace flags
+}  // namespace oomuse
+
+#endif  // OOMUSE_FLAGS_UNIT_PARSING_H
@@ -0,0 +1,163 @@
+/**
+ * Copyright 2015 Eric W. Barndollar. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "oomuse/flags/FlagChangeNotifier.h"
+
+#include <algorithm>
+#include <cassert>
+#include <utility>
+
+using oomuse::AbstractFlag;
+using std::shared_ptr;
+using std::vector;
+
+namespace oomuse {
+namespace flags {
+
+
+uint64 FlagChangeNotifier::subscribe(FlagChangeListener listener,
+                                     vector<const AbstractFlag*> flags) {
+  assert(listener);
+  auto newListener = std::make_shared<Listener>();
+  newListener->listener = std::move(listener);
+  newListener->flags.insert(flags.begin(), flags.end());
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  newListener->id = nextId_++;
+  listeners_.push_back(newListener);
+  listenerCount_.store(listeners_.size(), std::memory_order_relaxed);
+
+  if (!notifierThread_.joinable()) {
+    isStopping_ = false;
+    notifierThread_ = std::thread(&FlagChangeNotifier::deliverChanges, this);
+  }
+  return newListener->id;
+}
+
+
+void FlagChangeNotifier::unsubscribe(uint64 id) {
+  bool isOnNotifierThread;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto listener = std::find_if(listeners_.begin(), listeners_.end(),
+        [id](const shared_ptr<Listener>& each) { return each->id == id; });
+    if (listener == listeners_.end()) {
+      return;
+    }
+
+    (*listener)->isRemoved.store(true);
+    listeners_.erase(listener);
+    listenerCount_.store(listeners_.size(), std::memory_order_relaxed);
+    isOnNotifierThread =
+        (std::this_thread::get_id() == notifierThread_.get_id());
+  }
+
+  // Wait out any delivery that might be calling the listener.
+  if (!isOnNotifierThread) {
+    std::lock_guard<std::mutex> waitForDelivery(deliveryMutex_);
+  }
+}
+
+
+void FlagChangeNotifier::valueChanged(const AbstractFlag* flag) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (listeners_.empty() || !changedFlagSet_.insert(flag).second) {
+    return;
+  }
+
+  changedFlags_.push_back(flag);
+  if (batchDepth_ == 0) {
+    hasWork_.notify_one();
+  }
+}
+
+
+void FlagChangeNotifier::beginBatch() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  ++batchDepth_;
+}
+
+
+void FlagChangeNotifier::endBatch() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  assert(batchDepth_ > 0);
+  if ((--batchDepth_ == 0) && !changedFlags_.empty()) {
+    hasWork_.notify_one();
+  }
+}
+
+
+void FlagChangeNotifier::stop() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    isStopping_ = true;
+    for (auto& listener : listeners_) {
+      listener->isRemoved.store(true);
+    }
+    listeners_.clear();
+    listenerCount_.store(0, std::memory_order_relaxed);
+    changedFlags_.clear();
+    changedFlagSet_.clear();
+    batchDepth_ = 0;
+    hasWork_.notify_one();
+  }
+
+  if (notifierThread_.joinable()) {
+    notifierThread_.join();
+  }
+}
+
+
+void FlagChangeNotifier::deliverChanges() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    hasWork_.wait(lock, [this]() {
+      return isStopping_ || (!changedFlags_.empty() && (batchDepth_ == 0));
+    });
+    if (isStopping_) {
+      return;
+    }
+
+    vector<const AbstractFlag*> changedFlags;
+    changedFlags.swap(changedFlags_);
+    changedFlagSet_.clear();
+    vector<shared_ptr<Listener>> listeners = listeners_;
+
+    // Deliver without blocking flag writers or (un)subscribers.
+    lock.unlock();
+    {
+      std::lock_guard<std::mutex> delivering(deliveryMutex_);
+      vector<const AbstractFlag*> listenerFlags;
+      for (const shared_ptr<Listener>& listener : listeners) {
+        listenerFlags.clear();
+        for (const AbstractFlag* flag : changedFlags) {
+          if (listener->flags.empty() || listener->flags.count(flag)) {
+            listenerFlags.push_back(flag);
+          }
+        }
+
+        if (!listenerFlags.empty() && !listener->isRemoved.load()) {
+          listener->listener(listenerFlags);
+        }
+      }
+    }
+    lock.lock();
+  }
+}
+
+
+}  // namespace flags
+}  // namespace oomuse
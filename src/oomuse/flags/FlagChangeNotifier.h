@@ -0,0 +1,115 @@
+/**
+ * Copyright 2015 Eric W. Barndollar. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef OOMUSE_FLAGS_FLAG_CHANGE_NOTIFIER_H
+#define OOMUSE_FLAGS_FLAG_CHANGE_NOTIFIER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+#include "oomuse/core/int_types.h"
+#include "oomuse/core/readability_macros.h"
+#include "oomuse/flags/flags.h"
+
+namespace oomuse {
+  class AbstractFlag;
+}
+
+namespace oomuse {
+namespace flags {
+
+
+/**
+ * Internal deliverer of flag changes to listeners (see subscribeToFlagChanges()
+ * in flags.h), in batches on its own thread so that flag writers never wait
+ * for listeners. Changes made during a batch (see beginBatch()) are only
+ * delivered after it ends, and changes made while listeners are running are
+ * collected into the next delivery.
+ */
+class FlagChangeNotifier {
+ public:
+  FlagChangeNotifier() {}
+
+  /** Stops the notifier thread, dropping any undelivered changes. */
+  ~FlagChangeNotifier() { stop(); }
+
+  /**
+   * Adds listener for changes to given flags (or all, if empty), returning an
+   * id for unsubscribe(). Starts the notifier thread if needed.
+   */
+  uint64 subscribe(FlagChangeListener listener,
+                   std::vector<const AbstractFlag*> flags);
+
+  /**
+   * Removes listener with given id. Once this returns, the listener isn't
+   * running and won't be called again (unless this is called from a listener,
+   * which can't wait for itself to finish).
+   */
+  void unsubscribe(uint64 id);
+
+  /** Returns true if anything is subscribed (a quick check for writers). */
+  bool hasListeners() const {
+    return listenerCount_.load(std::memory_order_relaxed) != 0;
+  }
+
+  /** Queues flag change for delivery. */
+  void valueChanged(const AbstractFlag* flag);
+
+  /** Holds back delivery of changes until endBatch(). Batches may nest. */
+  void beginBatch();
+  void endBatch();
+
+  /** Stops the notifier thread and removes all listeners and changes. */
+  void stop();
+
+ private:
+  CANT_COPY(FlagChangeNotifier);
+
+  /** A subscribed listener. */
+  struct Listener {
+    uint64 id;
+    FlagChangeListener listener;
+    std::unordered_set<const AbstractFlag*> flags;  // Empty for all flags.
+    std::atomic<bool> isRemoved{false};
+  };
+
+  /** Delivers batches of changes until stop(). */
+  void deliverChanges();
+
+  std::mutex mutex_;  // Guards everything below, but not delivery.
+  std::condition_variable hasWork_;
+  std::vector<std::shared_ptr<Listener>> listeners_;
+  std::atomic<uint64> listenerCount_{0};
+  uint64 nextId_ = 1;
+  std::vector<const AbstractFlag*> changedFlags_;  // In order of first change.
+  std::unordered_set<const AbstractFlag*> changedFlagSet_;
+  int batchDepth_ = 0;
+  bool isStopping_ = false;
+  std::thread notifierThread_;
+
+  std::mutex deliveryMutex_;  // Held while listeners are being called.
+};
+
+
+}  // namespace flags
+}  // namespace oomuse
+
+#endif  // OOMUSE_FLAGS_FLAG_CHANGE_NOTIFIER_H
@@ -0,0 +1,301 @@
+/**
+ * Copyright 2015 Eric W. Barndollar. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "oomuse/flags/FlagFileWatcher.h"
+
+#include <cassert>
+#include <cerrno>
+#include <cstring>
+#include <ostream>
+#include <unordered_set>
+#include <utility>
+
+#include "oomuse/core/int_types.h"
+#include "oomuse/flags/flags.h"
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+using oomuse::AbstractFlag;
+using std::string;
+using std::vector;
+
+namespace oomuse {
+namespace flags {
+
+
+namespace {
+
+
+/**
+ * How long flag files must go without changing before reloading, so that a
+ * burst of writes (like an editor saving) causes a single reload.
+ */
+const int SETTLE_MILLIS = 5;
+
+
+/** Splits path into its directory (or "." if none) and file name. */
+std::pair<string, string> splitPath(const string& path) {
+  auto separatorIndex = path.find_last_of('/');
+  if (separatorIndex == string::npos) {
+    return {".", path};
+  }
+
+  string directory = path.substr(0, separatorIndex);
+  return {directory.empty() ? "/" : directory,
+          path.substr(separatorIndex + 1)};
+}
+
+
+}  // namespace
+
+
+void FlagFileWatcher::addReloadCallback(ReloadCallback callback) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  reloadCallbacks_.push_back(std::move(callback));
+}
+
+
+bool FlagFileWatcher::reload() {
+  string path;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    path = path_;
+  }
+
+  vector<const AbstractFlag*> changedFlags;
+  vector<string> flagFilePaths;
+  bool wasSuccessful = reloadFlagFile(path, &changedFlags, &flagFilePaths);
+
+  vector<ReloadCallback> reloadCallbacks;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    flagFilePaths_ = std::move(flagFilePaths);
+    reloadCallbacks = reloadCallbacks_;
+  }
+
+  if (!changedFlags.empty()) {
+    for (ReloadCallback& reloadCallback : reloadCallbacks) {
+      reloadCallback(changedFlags);
+    }
+  }
+
+  return wasSuccessful;
+}
+
+
+#ifndef __linux__
+
+
+bool FlagFileWatcher::start(const string& path, string* errorMsg) {
+  assert(!path.empty());
+  *errorMsg = "Watching flag files is only supported on Linux.";
+  return false;
+}
+
+
+void FlagFileWatcher::stop() {}
+
+
+bool FlagFileWatcher::watchFlagFiles(string*) { return false; }
+
+
+bool FlagFileWatcher::readEvents() { return false; }
+
+
+void FlagFileWatcher::watch() {}
+
+
+#else  // __linux__
+
+
+bool FlagFileWatcher::start(const string& path, string* errorMsg) {
+  assert(!path.empty());
+  assert(inotifyFd_ < 0);
+
+  inotifyFd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  stopFd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if ((inotifyFd_ < 0) || (stopFd_ < 0)) {
+    *errorMsg = std::strerror(errno);
+    stop();
+    return false;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    path_ = path;
+    flagFilePaths_ = {path};
+  }
+
+  // Watch before reloading, so no edit in between can be missed.
+  if (!watchFlagFiles(errorMsg)) {
+    stop();
+    return false;
+  }
+  reload();
+  if (!watchFlagFiles(errorMsg)) {
+    stop();
+    return false;
+  }
+
+  watchingThread_ = std::thread(&FlagFileWatcher::watch, this);
+  return true;
+}
+
+
+void FlagFileWatcher::stop() {
+  if (watchingThread_.joinable()) {
+    uint64 signal = 1;
+    if (write(stopFd_, &signal, sizeof(signal)) < 0) {
+      assert(false);
+    }
+    watchingThread_.join();
+  }
+
+  if (inotifyFd_ >= 0) {
+    close(inotifyFd_);
+    inotifyFd_ = -1;
+  }
+  if (stopFd_ >= 0) {
+    close(stopFd_);
+    stopFd_ = -1;
+  }
+  watchedFiles_.clear();
+}
+
+
+bool FlagFileWatcher::watchFlagFiles(string* errorMsg) {
+  vector<string> flagFilePaths;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    flagFilePaths = flagFilePaths_;
+  }
+
+  // Watch directories rather than files, to also see files being replaced
+  // (as editors often save) or created. A directory watched already keeps
+  // its watch id.
+  vector<std::pair<int, string>> watchedFiles;
+  bool wasSuccessful = true;
+  for (const string& path : flagFilePaths) {
+    auto directoryAndName = splitPath(path);
+    const string& directory = directoryAndName.first;
+    int watchId = inotify_add_watch(inotifyFd_, directory.c_str(),
+                                    IN_CLOSE_WRITE | IN_MOVED_TO);
+    if (watchId < 0) {
+      *errorMsg = "Could not watch flag file directory " + directory + ": "
+          + std::strerror(errno);
+      wasSuccessful = false;
+      break;
+    }
+
+    watchedFiles.emplace_back(watchId, directoryAndName.second);
+  }
+
+  // Keep watching the previous files if any new one can't be watched, and
+  // stop watching directories of neither.
+  if (wasSuccessful) {
+    watchedFiles.swap(watchedFiles_);
+  }
+  std::unordered_set<int> keptWatchIds;
+  for (auto& watchedFile : watchedFiles_) {
+    keptWatchIds.insert(watchedFile.first);
+  }
+  for (auto& watchedFile : watchedFiles) {
+    if (keptWatchIds.insert(watchedFile.first).second) {
+      inotify_rm_watch(inotifyFd_, watchedFile.first);
+    }
+  }
+
+  return wasSuccessful;
+}
+
+
+bool FlagFileWatcher::readEvents() {
+  alignas(inotify_event) char buffer[4096];
+  bool hasFlagFileChanged = false;
+
+  ssize_t length;
+  while ((length = read(inotifyFd_, buffer, sizeof(buffer))) > 0) {
+    for (ssize_t offset = 0; offset < length;) {
+      auto event = reinterpret_cast<const inotify_event*>(&buffer[offset]);
+      offset += sizeof(inotify_event) + event->len;
+      if (event->len == 0) {
+        continue;
+      }
+
+      string name(event->name);
+      for (auto& watchedFile : watchedFiles_) {
+        if ((watchedFile.first == event->wd) && (watchedFile.second == name)) {
+          hasFlagFileChanged = true;
+        }
+      }
+    }
+  }
+
+  return hasFlagFileChanged;
+}
+
+
+void FlagFileWatcher::watch() {
+  pollfd pollFds[2] = {{inotifyFd_, POLLIN, 0}, {stopFd_, POLLIN, 0}};
+  while (true) {
+    if (poll(pollFds, 2, -1) < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return;
+    }
+    if (pollFds[1].revents != 0) {
+      return;
+    }
+
+    if (!readEvents()) {
+      continue;
+    }
+
+    // Wait for writes to settle, unless stopping.
+    while ((poll(pollFds, 2, SETTLE_MILLIS) > 0)
+           && (pollFds[1].revents == 0)) {
+      readEvents();
+    }
+    if (pollFds[1].revents != 0) {
+      return;
+    }
+
+    reload();
+
+    // Includes may have changed, so watch any new flag files, reloading again
+    // in case they changed before being watched.
+    auto previouslyWatchedFiles = watchedFiles_;
+    string errorMsg;
+    if (!watchFlagFiles(&errorMsg)) {
+      FlagsInternal::outputStream() << errorMsg << std::endl;
+    } else if (watchedFiles_ != previouslyWatchedFiles) {
+      reload();
+    }
+  }
+}
+
+
+#endif  // __linux__
+
+
+}  // namespace flags
+}  // namespace oomuse
@@ -0,0 +1,220 @@
+/**
+ * Copyright 2015 Eric W. Barndollar. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "oomuse/flags/FlagRegistry.h"
+
+#include <algorithm>
+#include <cassert>
+
+#include "oomuse/flags/Flag.h"
+
+using std::lock_guard;
+using std::mutex;
+using std::size_t;
+using std::string_view;
+using std::unique_ptr;
+using std::vector;
+
+namespace oomuse {
+namespace flags {
+
+
+void FlagRegistry::add(AbstractFlag* flag) {
+  assert(flag);
+
+  lock_guard<mutex> lock(mutex_);
+  flag->nextPendingFlag_ = pendingFlags_;
+  pendingFlags_ = flag;
+  ++pendingFlagCount_;
+  currentIndex_.store(nullptr);
+}
+
+
+void FlagRegistry::setStaticIndex(const StaticFlagIndex& staticIndex) {
+  lock_guard<mutex> lock(mutex_);
+  staticIndex_ = staticIndex;
+  currentIndex_.store(nullptr);
+}
+
+
+AbstractFlag* FlagRegistry::find(string_view name) {
+  const Index& index = this->index();
+
+  // Names in the static index can only belong to a statically bound flag.
+  size_t staticSlot = index.staticIndex.find(name);
+  if (staticSlot != StaticFlagIndex::NOT_FOUND) {
+    return index.staticFlags[staticSlot];
+  }
+  if (index.slots.empty()) {
+    return nullptr;
+  }
+
+  // Linear probing; the table is at most half full, so this terminates.
+  uint32 hash = hashName(name);
+  size_t mask = index.slots.size() - 1;
+  for (size_t i = hash & mask; ; i = (i + 1) & mask) {
+    const Slot& slot = index.slots[i];
+    if (slot.entryIndex == EMPTY_SLOT) {
+      return nullptr;
+    }
+
+    const Entry& entry = index.entries[slot.entryIndex];
+    if ((slot.hash == hash) && (entry.name == name)) {
+      return entry.flag;
+    }
+  }
+}
+
+
+const vector<FlagRegistry::Entry>& FlagRegistry::sortedEntries() {
+  lock_guard<mutex> lock(mutex_);
+  Index& index = indexLocked();
+  if (!index.isSorted) {
+    // Sort a copy, since the hash index refers to entries by position.
+    index.sortedEntries = index.entries;
+    std::sort(index.sortedEntries.begin(), index.sortedEntries.end(),
+        [](const Entry& a, const Entry& b) { return a.name < b.name; });
+    index.isSorted = true;
+  }
+
+  return index.sortedEntries;
+}
+
+
+const vector<FlagRegistry::Entry>& FlagRegistry::entries() {
+  return index().entries;
+}
+
+
+void FlagRegistry::buildIndex() {
+  lock_guard<mutex> lock(mutex_);
+  indexLocked();
+}
+
+
+size_t FlagRegistry::size() const {
+  lock_guard<mutex> lock(mutex_);
+  return entries_.size() + pendingFlagCount_;
+}
+
+
+void FlagRegistry::clear() {
+  lock_guard<mutex> lock(mutex_);
+  pendingFlags_ = nullptr;
+  pendingFlagCount_ = 0;
+  entries_.clear();
+  staticIndex_ = StaticFlagIndex();
+  currentIndex_.store(nullptr);
+  indexes_.clear();
+}
+
+
+FlagRegistry::Index& FlagRegistry::index() {
+  Index* index = currentIndex_.load();
+  if (index) {
+    return *index;
+  }
+
+  lock_guard<mutex> lock(mutex_);
+  return indexLocked();
+}
+
+
+FlagRegistry::Index& FlagRegistry::indexLocked() {
+  Index* currentIndex = currentIndex_.load();
+  if (currentIndex) {
+    return *currentIndex;
+  }
+
+  // Take pending flags, filling new entries back to front, since the list is
+  // newest first.
+  size_t entryIndex = entries_.size() + pendingFlagCount_;
+  entries_.resize(entryIndex);
+  for (AbstractFlag* flag = pendingFlags_; flag;
+       flag = flag->nextPendingFlag_) {
+    entries_[--entryIndex] = Entry{flag->name(), flag};
+  }
+  pendingFlags_ = nullptr;
+  pendingFlagCount_ = 0;
+
+  // Build a new index, leaving any earlier one intact for current readers.
+  unique_ptr<Index> index(new Index());
+  index->entries = entries_;
+  index->staticIndex = staticIndex_;
+
+  // Bind statically indexed flags, collecting the rest for the hash index.
+  index->staticFlags.assign(staticIndex_.size(), nullptr);
+  vector<size_t> hashedEntryIndices;
+  hashedEntryIndices.reserve(entries_.size());
+  for (size_t i = 0; i < entries_.size(); ++i) {
+    const Entry& entry = entries_[i];
+    size_t staticSlot = staticIndex_.find(entry.name);
+    if (staticSlot == StaticFlagIndex::NOT_FOUND) {
+      hashedEntryIndices.push_back(i);
+      continue;
+    }
+
+    assert(!index->staticFlags[staticSlot] && "Flag names must be unique");
+    index->staticFlags[staticSlot] = entry.flag;
+  }
+
+  // Size table to a power of two at least twice the number of hashed flags.
+  size_t tableSize = 1;
+  while (tableSize < 2 * hashedEntryIndices.size()) {
+    tableSize *= 2;
+  }
+
+  index->slots.assign(hashedEntryIndices.empty() ? 0 : tableSize,
+                      Slot{0, EMPTY_SLOT});
+  for (size_t i : hashedEntryIndices) {
+    addToHashIndex(i, index.get());
+  }
+
+  currentIndex = index.get();
+  indexes_.push_back(std::move(index));
+  currentIndex_.store(currentIndex);
+  return *currentIndex;
+}
+
+
+void FlagRegistry::addToHashIndex(size_t entryIndex, Index* index) {
+  const Entry& entry = index->entries[entryIndex];
+  uint32 hash = hashName(entry.name);
+  size_t mask = index->slots.size() - 1;
+  size_t i = hash & mask;
+  while (index->slots[i].entryIndex != EMPTY_SLOT) {
+    assert(index->entries[index->slots[i].entryIndex].name != entry.name
+           && "Flag names must be unique");
+    i = (i + 1) & mask;
+  }
+
+  index->slots[i] = Slot{hash, static_cast<uint32>(entryIndex)};
+}
+
+
+uint32 FlagRegistry::hashName(string_view name) {
+  // 32-bit FNV-1a.
+  uint32 hash = 2166136261U;
+  for (char c : name) {
+    hash ^= static_cast<unsigned char>(c);
+    hash *= 16777619U;
+  }
+  return hash;
+}
+
+
+}  // namespace flags
+}  // namespace oomuse
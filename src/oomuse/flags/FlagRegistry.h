@@ -0,0 +1,155 @@
+/**
+ * Copyright 2015 Eric W. Barndollar. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef OOMUSE_FLAGS_FLAG_REGISTRY_H
+#define OOMUSE_FLAGS_FLAG_REGISTRY_H
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <vector>
+
+#include "oomuse/core/int_types.h"
+#include "oomuse/core/readability_macros.h"
+#include "oomuse/flags/FlagSet.h"
+
+namespace oomuse {
+  class AbstractFlag;
+}
+
+namespace oomuse {
+namespace flags {
+
+
+/**
+ * Internal registry of all flags, stored as a flat array plus an
+ * open-addressing hash index over the names. Registration (normally during
+ * static initialization) just links the flag into an intrusive list, without
+ * allocating or even touching its name. On first use after registration
+ * (normally when init() starts), pending flags get indexed, all at once, into
+ * a new immutable Index; sorting only happens when sorted iteration is needed.
+ *
+ * Registration and indexing hold an internal mutex, since flags can be
+ * declared (or looked up by a reload) on any thread, even while others are
+ * listing them. Once indexed, find() takes no lock: each Index is published
+ * atomically and kept until clear(), so readers never see one change.
+ *
+ * Flags named in an optional compile-time StaticFlagIndex are bound directly
+ * to their perfect hash slots and left out of the generic hash index.
+ */
+class FlagRegistry {
+ public:
+  /** A registered flag and its name (which points into the flag itself). */
+  struct Entry {
+    std::string_view name;
+    AbstractFlag* flag;
+  };
+
+  FlagRegistry() {}
+
+  /** Registers flag, which must outlive this registry or clear(). */
+  void add(AbstractFlag* flag);
+
+  /** Uses given compile-time index (which must outlive its use) first. */
+  void setStaticIndex(const StaticFlagIndex& staticIndex);
+
+  /**
+   * Returns flag with given name, or nullptr if none. Lock-free, unless flags
+   * were registered since last indexed.
+   */
+  AbstractFlag* find(std::string_view name);
+
+  /**
+   * Returns all registered flags, sorted by name. Stays valid (unchanged)
+   * until clear(), even if more flags are registered, which would only show
+   * up in a later call.
+   */
+  const std::vector<Entry>& sortedEntries();
+
+  /**
+   * Returns all registered flags in registration order, without sorting.
+   * Stays valid (unchanged) until clear(), like sortedEntries().
+   */
+  const std::vector<Entry>& entries();
+
+  /** Indexes flags if any were added since last indexed. */
+  void buildIndex();
+
+  /** Returns number of registered flags. */
+  std::size_t size() const;
+
+  /** Removes all registered flags. Must not run concurrently with any use. */
+  void clear();
+
+ private:
+  CANT_COPY(FlagRegistry);
+
+  /** Marks an empty hash slot. */
+  static constexpr uint32 EMPTY_SLOT = 0xFFFFFFFF;
+
+  /** Hash slot storing full name hash, to skip most string comparisons. */
+  struct Slot {
+    uint32 hash;
+    uint32 entryIndex;
+  };
+
+  /** Flags registered as of one buildIndex(), never changed once published. */
+  struct Index {
+    std::vector<Entry> entries;  // In registration order; slots index these.
+    std::vector<Slot> slots;  // Size is 0 or a power of two.
+    StaticFlagIndex staticIndex;
+    std::vector<AbstractFlag*> staticFlags;  // By staticIndex slot.
+
+    // Copy of entries sorted by name, lazily filled while holding mutex_.
+    std::vector<Entry> sortedEntries;
+    bool isSorted = false;
+  };
+
+  static uint32 hashName(std::string_view name);
+
+  /** Returns current index, building it if stale. Hold mutex_. */
+  Index& indexLocked();
+
+  /** Returns current index without locking, if already built. */
+  Index& index();
+
+  /** Adds entry to generic hash index, asserting its name is unique. */
+  static void addToHashIndex(std::size_t entryIndex, Index* index);
+
+  mutable std::mutex mutex_;  // Held to use all members below.
+
+  AbstractFlag* pendingFlags_ = nullptr;  // Most recently registered first.
+  std::size_t pendingFlagCount_ = 0;
+
+  std::vector<Entry> entries_;  // Taken from pendingFlags_, in order.
+  StaticFlagIndex staticIndex_;
+
+  // Every index built since clear(), so that references into them (and
+  // lock-free finds that loaded one) stay valid.
+  std::vector<std::unique_ptr<Index>> indexes_;
+
+  // Latest of indexes_, or null if flags were registered since; also read
+  // without holding mutex_.
+  std::atomic<Index*> currentIndex_{nullptr};
+};
+
+
+}  // namespace flags
+}  // namespace oomuse
+
+#endif  // OOMUSE_FLAGS_FLAG_REGISTRY_H
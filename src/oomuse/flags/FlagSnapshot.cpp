@@ -0,0 +1,225 @@
+/**
+ * Copyright 2015 Eric W. Barndollar. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "oomuse/flags/FlagSnapshot.h"
+
+#include <cstring>
+#include <limits>
+
+#include "oomuse/flags/Flag.h"
+#include "oomuse/flags/file_writing.h"
+
+using oomuse::AbstractFlag;
+using std::numeric_limits;
+using std::size_t;
+using std::string;
+using std::string_view;
+using std::vector;
+
+namespace oomuse {
+namespace flags {
+
+
+namespace {
+
+
+const uint64 FNV_OFFSET_BASIS = 14695981039346656037ULL;
+const uint64 FNV_PRIME = 1099511628211ULL;
+
+
+/** Mixes text, then a terminating zero byte, into FNV-1a hash *hash. */
+void hashText(string_view text, uint64* hash) {
+  for (char c : text) {
+    *hash = (*hash ^ static_cast<unsigned char>(c)) * FNV_PRIME;
+  }
+  *hash *= FNV_PRIME;  // XOR with the zero byte is a no-op.
+}
+
+
+/**
+ * Appends text to *contents, returning its offset (truncated to 32 bits, so
+ * the final size must be checked).
+ */
+uint32 appendText(string_view text, string* contents) {
+  auto offset = static_cast<uint32>(contents->size());
+  contents->append(text);
+  return offset;
+}
+
+
+/** Returns true if [offset, offset + length) is within a file of fileSize. */
+bool isInFile(uint32 offset, uint32 length, uint64 fileSize) {
+  return (uint64(offset) + length) <= fileSize;
+}
+
+
+/** Returns x with its bits well mixed (the splitmix64 finalizer). */
+uint64 mixBits(uint64 x) {
+  x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+  return x ^ (x >> 31);
+}
+
+
+}  // namespace
+
+
+uint64 flagSchemaHash(const vector<FlagRegistry::Entry>& entries) {
+  // Sum each flag's mixed hash, so that order doesn't matter (and the
+  // registry needn't be sorted to check a snapshot).
+  uint64 schemaHash = entries.size();
+  for (const FlagRegistry::Entry& entry : entries) {
+    uint64 flagHash = FNV_OFFSET_BASIS;
+    hashText(entry.name, &flagHash);
+    hashText(entry.flag->typeName(), &flagHash);
+    // Enums are stored by number, so their numbers are part of the schema.
+    hashText(entry.flag->numberedAllowedValues(), &flagHash);
+    schemaHash += mixBits(flagHash);
+  }
+  return schemaHash;
+}
+
+
+bool writeFlagSnapshotFile(const string& path,
+                           const vector<FlagRegistry::Entry>& sortedEntries,
+                           string* errorMsg) {
+  const size_t flagCount = sortedEntries.size();
+  if (flagCount > numeric_limits<uint32>::max()) {
+    *errorMsg = "Too many flags.";
+    return false;
+  }
+
+  // Fill in text and values after space for the header and records, then
+  // the records (whose offsets are then known), then the header.
+  size_t headerSize = sizeof(FlagSnapshotHeader);
+  size_t recordsSize = flagCount * sizeof(FlagSnapshotRecord);
+  string contents(headerSize + recordsSize, '\0');
+  vector<FlagSnapshotRecord> records(flagCount);
+  vector<string> binaryValues(flagCount);
+  for (size_t i = 0; i < flagCount; ++i) {
+    const AbstractFlag& flag = *sortedEntries[i].flag;
+    FlagSnapshotRecord& record = records[i];
+    record = FlagSnapshotRecord();
+    record.nameOffset = appendText(flag.name(), &contents);
+    record.nameLength = static_cast<uint32>(flag.name().size());
+    if (!flag.wasExplicitlySet() || !flag.hasValue()) {
+      continue;
+    }
+
+    string textValue = flag.printableValue();
+    record.textOffset = appendText(textValue, &contents);
+    record.textLength = static_cast<uint32>(textValue.size());
+    record.status = SNAPSHOT_HAS_VALUE;
+    if (flag.appendSnapshotValue(&binaryValues[i])) {
+      record.status |= SNAPSHOT_HAS_BINARY_VALUE;
+    }
+  }
+
+  for (size_t i = 0; i < flagCount; ++i) {
+    if ((records[i].status & SNAPSHOT_HAS_BINARY_VALUE) == 0) {
+      continue;
+    }
+
+    size_t padding = (FLAG_SNAPSHOT_VALUE_ALIGNMENT
+        - (contents.size() % FLAG_SNAPSHOT_VALUE_ALIGNMENT))
+        % FLAG_SNAPSHOT_VALUE_ALIGNMENT;
+    contents.append(padding, '\0');
+    records[i].valueOffset = appendText(binaryValues[i], &contents);
+    records[i].valueLength = static_cast<uint32>(binaryValues[i].size());
+  }
+
+  // Offsets and lengths are 32-bit, so the whole file must fit.
+  if (contents.size() > numeric_limits<uint32>::max()) {
+    *errorMsg = "Snapshot would be over 4GiB.";
+    return false;
+  }
+
+  FlagSnapshotHeader header;
+  std::memcpy(header.magic, FLAG_SNAPSHOT_MAGIC, sizeof(header.magic));
+  header.formatVersion = FLAG_SNAPSHOT_FORMAT_VERSION;
+  header.flagCount = static_cast<uint32>(flagCount);
+  header.schemaHash = flagSchemaHash(sortedEntries);
+  header.fileSize = contents.size();
+  std::memcpy(&contents[0], &header, headerSize);
+  if (flagCount > 0) {
+    std::memcpy(&contents[headerSize], records.data(), recordsSize);
+  }
+
+  // Programs must never map a partly written snapshot.
+  return writeFileAtomically(path, contents, errorMsg);
+}
+
+
+bool FlagSnapshotFile::open(const string& path, string* errorMsg) {
+  if (!file_.open(path, errorMsg)) {
+    return false;
+  }
+
+  string_view contents = file_.contents();
+  if (contents.size() < sizeof(FlagSnapshotHeader)) {
+    *errorMsg = "Not a flag snapshot.";
+    return false;
+  }
+
+  // Mapped files start page-aligned, so the header and records are aligned.
+  header_ = reinterpret_cast<const FlagSnapshotHeader*>(contents.data());
+  if (std::memcmp(header_->magic, FLAG_SNAPSHOT_MAGIC,
+                  sizeof(FLAG_SNAPSHOT_MAGIC)) != 0) {
+    *errorMsg = "Not a flag snapshot.";
+    return false;
+  }
+  if (header_->formatVersion != FLAG_SNAPSHOT_FORMAT_VERSION) {
+    *errorMsg = "Unsupported flag snapshot format version.";
+    return false;
+  }
+
+  uint64 recordsEnd = sizeof(FlagSnapshotHeader)
+      + (uint64(header_->flagCount) * sizeof(FlagSnapshotRecord));
+  if ((header_->fileSize != contents.size())
+      || (recordsEnd > contents.size())) {
+    *errorMsg = "Flag snapshot is truncated or corrupt.";
+    return false;
+  }
+
+  // Check every range up front, so that records can be read unchecked.
+  records_ = reinterpret_cast<const FlagSnapshotRecord*>(
+      contents.data() + sizeof(FlagSnapshotHeader));
+  for (size_t i = 0; i < header_->flagCount; ++i) {
+    const FlagSnapshotRecord& record = records_[i];
+    if (!isInFile(record.nameOffset, record.nameLength, contents.size())
+        || !isInFile(record.textOffset, record.textLength, contents.size())
+        || !isInFile(record.valueOffset, record.valueLength, contents.size())) {
+      *errorMsg = "Flag snapshot is truncated or corrupt.";
+      return false;
+    }
+  }
+
+  return true;
+}
+
+
+FlagSnapshotFile::Record FlagSnapshotFile::record(size_t index) const {
+  const FlagSnapshotRecord& record = records_[index];
+  return Record{range(record.nameOffset, record.nameLength),
+                range(record.textOffset, record.textLength),
+                range(record.valueOffset, record.valueLength),
+                (record.status & SNAPSHOT_HAS_VALUE) != 0,
+                (record.status & SNAPSHOT_HAS_BINARY_VALUE) != 0};
+}
+
+
+}  // namespace flags
+}  // namespace oomuse
@@ -0,0 +1,98 @@
+/**
+ * Copyright 2015 Eric W. Barndollar. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef OOMUSE_FLAGS_FLAG_SNAPSHOT_H
+#define OOMUSE_FLAGS_FLAG_SNAPSHOT_H
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "oomuse/core/int_types.h"
+#include "oomuse/core/readability_macros.h"
+#include "oomuse/flags/FlagRegistry.h"
+#include "oomuse/flags/MappedFile.h"
+#include "oomuse/flags/flag_snapshot_layout.h"
+
+namespace oomuse {
+namespace flags {
+
+
+/**
+ * Returns hash of the schema (names, type names, and allowed enum names and
+ * numbers) of given flags, which may be in any order.
+ */
+uint64 flagSchemaHash(const std::vector<FlagRegistry::Entry>& entries);
+
+
+/**
+ * Writes a snapshot (see flag_snapshot_layout.h) of the values of given flags
+ * (sorted by name) that have been set, replacing any file at path only once
+ * complete. Returns true if successful, else sets *errorMsg.
+ */
+bool writeFlagSnapshotFile(
+    const std::string& path,
+    const std::vector<FlagRegistry::Entry>& sortedEntries,
+    std::string* errorMsg);
+
+
+/** Internal reader of a memory-mapped flag snapshot file. */
+class FlagSnapshotFile {
+ public:
+  /** One flag's snapshotted value, pointing into the mapped file. */
+  struct Record {
+    std::string_view name;
+    std::string_view textValue;
+    std::string_view binaryValue;
+    bool hasValue;
+    bool hasBinaryValue;
+  };
+
+  FlagSnapshotFile() {}
+
+  /**
+   * Maps snapshot file at path and checks that it's well formed, returning
+   * true if so. Otherwise, sets *errorMsg to describe why not. Can only be
+   * called once.
+   */
+  bool open(const std::string& path, std::string* errorMsg);
+
+  uint64 schemaHash() const { return header_->schemaHash; }
+
+  /** Returns number of records (flags registered when written). */
+  std::size_t size() const { return header_->flagCount; }
+
+  /** Returns record at given index (records are sorted by flag name). */
+  Record record(std::size_t index) const;
+
+ private:
+  CANT_COPY(FlagSnapshotFile);
+
+  /** Returns given range of the file. */
+  std::string_view range(uint32 offset, uint32 length) const {
+    return file_.contents().substr(offset, length);
+  }
+
+  MappedFile file_;
+  const FlagSnapshotHeader* header_ = nullptr;
+  const FlagSnapshotRecord* records_ = nullptr;
+};
+
+
+}  // namespace flags
+}  // namespace oomuse
+
+#endif  // OOMUSE_FLAGS_FLAG_SNAPSHOT_H
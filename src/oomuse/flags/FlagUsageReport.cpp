@@ -0,0 +1,125 @@
+/**
+ * Copyright 2015 Eric W. Barndollar. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "oomuse/flags/FlagUsageReport.h"
+
+#include <utility>
+
+#include "oomuse/flags/MappedFile.h"
+#include "oomuse/flags/flag_usage_file.h"
+
+using std::endl;
+using std::ostream;
+using std::string;
+using std::vector;
+
+namespace oomuse {
+namespace flags {
+
+
+namespace {
+
+
+FlagUsageStatus usageStatus(const FlagUsage& usage, bool areReadsCounted) {
+  if (usage.setRunCount == 0) {
+    if (!usage.hasDefaultValue) {
+      return FlagUsageStatus::UNUSED;  // Never had a value to read.
+    }
+    return (areReadsCounted && (usage.readCount == 0))
+        ? FlagUsageStatus::UNUSED : FlagUsageStatus::NEVER_SET;
+  }
+
+  return (areReadsCounted && (usage.readCount == 0))
+      ? FlagUsageStatus::NEVER_READ : FlagUsageStatus::USED;
+}
+
+
+const char* statusName(FlagUsageStatus status) {
+  switch (status) {
+    case FlagUsageStatus::USED: return "used";
+    case FlagUsageStatus::UNUSED: return "unused";
+    case FlagUsageStatus::NEVER_SET: return "never_set";
+    case FlagUsageStatus::NEVER_READ: return "never_read";
+  }
+  return "";
+}
+
+
+}  // namespace
+
+
+bool FlagUsageReport::addFile(const string& path, string* errorMsg) {
+  MappedFile file;
+  if (!file.open(path, errorMsg)) {
+    return false;
+  }
+
+  bool areRunReadsCounted = false;
+  vector<FlagUsageRecord> records;
+  if (!parseFlagUsageFile(file.contents(), &areRunReadsCounted, &records,
+                          errorMsg)) {
+    return false;
+  }
+
+  ++runCount_;
+  areReadsCounted_ = areReadsCounted_ && areRunReadsCounted;
+  for (const FlagUsageRecord& record : records) {
+    string name(record.name);
+    FlagUsage& usage = usages_[name];
+    if (usage.runCount == 0) {
+      usage.name = std::move(name);
+    }
+    ++usage.runCount;
+    usage.setRunCount += record.wasExplicitlySet ? 1 : 0;
+    usage.readCount += record.readCount;
+    usage.hasDefaultValue = usage.hasDefaultValue || record.hasDefaultValue;
+  }
+  return true;
+}
+
+
+vector<FlagUsage> FlagUsageReport::flagUsages() const {
+  vector<FlagUsage> usages;
+  usages.reserve(usages_.size());
+  for (const auto& nameAndUsage : usages_) {
+    usages.push_back(nameAndUsage.second);
+    usages.back().status = usageStatus(usages.back(), areReadsCounted_);
+  }
+  return usages;
+}
+
+
+void FlagUsageReport::printUnusedFlags(ostream* output) const {
+  *output << "name\tstatus\truns\tset_runs\treads\thas_default" << endl;
+  for (const FlagUsage& usage : flagUsages()) {
+    if (usage.status == FlagUsageStatus::USED) {
+      continue;
+    }
+
+    *output << usage.name << "\t" << statusName(usage.status) << "\t"
+            << usage.runCount << "\t" << usage.setRunCount << "\t";
+    if (areReadsCounted_) {
+      *output << usage.readCount;
+    } else {
+      *output << "-";
+    }
+    *output << "\t" << (usage.hasDefaultValue ? 1 : 0) << endl;
+  }
+}
+
+
+}  // namespace flags
+}  // namespace oomuse
@@ -0,0 +1,189 @@
+/**
+ * Copyright 2015 Eric W. Barndollar. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "oomuse/flags/MappedFile.h"
+
+#include <cassert>
+#include <cerrno>
+#include <cstring>
+
+#ifdef _WIN32
+#include <fstream>
+#include <sstream>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using std::size_t;
+using std::string;
+
+namespace oomuse {
+namespace flags {
+
+
+#ifdef _WIN32
+
+
+MappedFile::~MappedFile() {}
+
+
+bool MappedFile::open(const string& path, string* errorMsg) {
+  return read(path, errorMsg);
+}
+
+
+bool MappedFile::read(const string& path, string* errorMsg) {
+  assert(!data_);
+
+  std::ifstream file(path, std::ios::in | std::ios::binary);
+  std::stringstream contents;
+  if (!file || !(contents << file.rdbuf())) {
+    *errorMsg = "Could not read file.";
+    return false;
+  }
+
+  readContents_ = contents.str();
+  data_ = readContents_.data();
+  size_ = readContents_.size();
+  return true;
+}
+
+
+#else
+
+
+namespace {
+
+
+/**
+ * Opens regular file at path for reading, setting *fileStats. Returns its
+ * descriptor, or else -1 after setting *errorMsg to describe why not.
+ */
+int openRegularFile(const string& path, struct stat* fileStats,
+                    string* errorMsg) {
+  int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    *errorMsg = std::strerror(errno);
+    return -1;
+  }
+
+  if (fstat(fd, fileStats) != 0) {
+    *errorMsg = std::strerror(errno);
+    close(fd);
+    return -1;
+  }
+  if (!S_ISREG(fileStats->st_mode)) {
+    *errorMsg = "Not a regular file.";
+    close(fd);
+    return -1;
+  }
+
+  return fd;
+}
+
+
+}  // namespace
+
+
+MappedFile::~MappedFile() {
+  if (isMapped_) {
+    munmap(const_cast<char*>(data_), size_);
+  }
+}
+
+
+bool MappedFile::open(const string& path, string* errorMsg) {
+  assert(!data_);
+
+  struct stat fileStats;
+  int fd = openRegularFile(path, &fileStats, errorMsg);
+  if (fd < 0) {
+    return false;
+  }
+
+  // Can't mmap an empty file, but there's nothing to read anyway.
+  size_ = static_cast<size_t>(fileStats.st_size);
+  if (size_ == 0) {
+    data_ = "";
+    close(fd);
+    return true;
+  }
+
+  void* mapping = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+  int mmapErrno = errno;
+  close(fd);  // The mapping stays valid after closing.
+  if (mapping == MAP_FAILED) {
+    *errorMsg = std::strerror(mmapErrno);
+    size_ = 0;
+    return false;
+  }
+
+  // Flag files are parsed front to back, once.
+  madvise(mapping, size_, MADV_SEQUENTIAL);
+  data_ = static_cast<const char*>(mapping);
+  isMapped_ = true;
+  return true;
+}
+
+
+bool MappedFile::read(const string& path, string* errorMsg) {
+  assert(!data_);
+
+  struct stat fileStats;
+  int fd = openRegularFile(path, &fileStats, errorMsg);
+  if (fd < 0) {
+    return false;
+  }
+
+  // Read until end of file, however much it has changed size since fstat().
+  readContents_.resize(static_cast<size_t>(fileStats.st_size) + 1);
+  size_t readSize = 0;
+  while (true) {
+    if (readSize == readContents_.size()) {
+      readContents_.resize(readSize * 2);
+    }
+    ssize_t result = ::read(fd, &readContents_[readSize],
+                            readContents_.size() - readSize);
+    if (result == 0) {
+      break;
+    }
+    if (result < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      *errorMsg = std::strerror(errno);
+      close(fd);
+      readContents_.clear();
+      return false;
+    }
+    readSize += static_cast<size_t>(result);
+  }
+  close(fd);
+
+  readContents_.resize(readSize);
+  data_ = readContents_.data();
+  size_ = readSize;
+  return true;
+}
+
+
+#endif  // _WIN32
+
+
+}  // namespace flags
+}  // namespace oomuse
@@ -0,0 +1,68 @@
+/**
+ * Copyright 2015 Eric W. Barndollar. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef OOMUSE_FLAGS_MAPPED_FILE_H
+#define OOMUSE_FLAGS_MAPPED_FILE_H
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+#include "oomuse/core/readability_macros.h"
+
+namespace oomuse {
+namespace flags {
+
+
+/**
+ * Internal read-only view of a whole file's contents, memory-mapped where
+ * supported so that large flag files are parsed in place without copying.
+ */
+class MappedFile {
+ public:
+  MappedFile() {}
+  ~MappedFile();
+
+  /**
+   * Maps file at path, returning true if successful. Otherwise, sets
+   * *errorMsg to describe why not. Can only be called once.
+   */
+  bool open(const std::string& path, std::string* errorMsg);
+
+  /**
+   * Like open(), but always reads file into memory instead, for files that
+   * may be written while in use (a mapping raises SIGBUS if they shrink).
+   */
+  bool read(const std::string& path, std::string* errorMsg);
+
+  /** Returns file contents, valid for the lifetime of this MappedFile. */
+  std::string_view contents() const {
+    return std::string_view(data_, size_);
+  }
+
+ private:
+  CANT_COPY(MappedFile);
+
+  const char* data_ = nullptr;
+  std::size_t size_ = 0;
+  bool isMapped_ = false;
+  std::string readContents_;  // If read into memory instead of mapped.
+};
+
+
+}  // namespace flags
+}  // namespace oomuse
+
+#endif  // OOMUSE_FLAGS_MAPPED_FILE_H
@@ -0,0 +1,226 @@
+/**
+ * Copyright 2015 Eric W. Barndollar. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "oomuse/flags/SharedFlagsPublisher.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cerrno>
+#include <cstring>
+#include <limits>
+#include <string_view>
+
+#include "oomuse/flags/Flag.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+using oomuse::AbstractFlag;
+using std::size_t;
+using std::string;
+using std::string_view;
+using std::vector;
+
+namespace oomuse {
+namespace flags {
+
+
+namespace {
+
+
+/** Starts a seqlock write section, during which readers will retry. */
+void beginWrite(SharedFlagsHeader* header) {
+  uint64 sequence = header->sequence.load(std::memory_order_relaxed);
+  header->sequence.store(sequence + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+}
+
+
+/** Ends a seqlock write section, publishing everything written in it. */
+void endWrite(SharedFlagsHeader* header) {
+  uint64 sequence = header->sequence.load(std::memory_order_relaxed);
+  header->sequence.store(sequence + 1, std::memory_order_release);
+}
+
+
+}  // namespace
+
+
+#ifdef _WIN32
+
+
+SharedFlagsPublisher::~SharedFlagsPublisher() {}
+
+
+bool SharedFlagsPublisher::publish(const string&,
+                                   const vector<const AbstractFlag*>&,
+                                   string* errorMsg) {
+  *errorMsg = "Shared memory flag publishing is not supported on Windows.";
+  return false;
+}
+
+
+#else
+
+
+SharedFlagsPublisher::~SharedFlagsPublisher() {
+  if (segment_) {
+    munmap(segment_, segmentSize_);
+    shm_unlink(segmentName_.c_str());
+  }
+}
+
+
+bool SharedFlagsPublisher::publish(const string& segmentName,
+                                   const vector<const AbstractFlag*>& flags,
+                                   string* errorMsg) {
+  assert(!segment_);
+  string name = segmentName.empty() ? defaultSharedFlagsName(getpid())
+                                    : segmentName;
+
+  // Size segment: fixed text first, then room for each value to grow a bit.
+  vector<string> values;
+  values.reserve(flags.size());
+  size_t textOffset = sizeof(SharedFlagsHeader)
+      + flags.size() * sizeof(SharedFlagRecord);
+  size_t valuesOffset = textOffset;
+  for (const AbstractFlag* flag : flags) {
+    values.push_back(flag->printableValue());
+    valuesOffset += flag->name().size() + std::strlen(flag->typeName())
+        + flag->printableDefaultValue().size();
+  }
+  size_t segmentSize = valuesOffset;
+  for (const string& value : values) {
+    segmentSize += std::max<size_t>(MIN_SHARED_VALUE_CAPACITY,
+                                    2 * value.size());
+  }
+  if (segmentSize > std::numeric_limits<uint32>::max()) {
+    *errorMsg = "Too much flag data to publish.";
+    return false;
+  }
+
+  // Create segment, readable only by this user, since flag values can be
+  // secrets. A segment with this process's default name can only be left
+  // behind by a dead process with the same pid, so it's replaced; any other
+  // may belong to a live process, so it's left alone.
+  int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+  if ((fd < 0) && (errno == EEXIST) && segmentName.empty()) {
+    shm_unlink(name.c_str());
+    fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+  }
+  if (fd < 0) {
+    *errorMsg = (errno == EEXIST)
+        ? "A segment named " + name + " already exists."
+        : std::strerror(errno);
+    return false;
+  }
+  if (ftruncate(fd, static_cast<off_t>(segmentSize)) != 0) {
+    *errorMsg = std::strerror(errno);
+    close(fd);
+    shm_unlink(name.c_str());
+    return false;
+  }
+  void* mapping = mmap(nullptr, segmentSize, PROT_READ | PROT_WRITE,
+                       MAP_SHARED, fd, 0);
+  int mmapErrno = errno;
+  close(fd);
+  if (mapping == MAP_FAILED) {
+    *errorMsg = std::strerror(mmapErrno);
+    shm_unlink(name.c_str());
+    return false;
+  }
+
+  std::lock_guard<std::mutex> lock(writeMutex_);
+  segmentName_ = name;
+  segment_ = static_cast<char*>(mapping);
+  segmentSize_ = segmentSize;
+
+  SharedFlagsHeader* header = this->header();
+  beginWrite(header);
+  header->flagCount = static_cast<uint32>(flags.size());
+  header->segmentSize = segmentSize;
+
+  auto appendText = [this, &textOffset](string_view text,
+                                        uint32* offset, uint32* length) {
+    std::memcpy(segment_ + textOffset, text.data(), text.size());
+    *offset = static_cast<uint32>(textOffset);
+    *length = static_cast<uint32>(text.size());
+    textOffset += text.size();
+  };
+
+  size_t valueOffset = valuesOffset;
+  for (size_t i = 0; i < flags.size(); ++i) {
+    const AbstractFlag& flag = *flags[i];
+    SharedFlagRecord* record = &records()[i];
+    appendText(flag.name(), &record->nameOffset, &record->nameLength);
+    appendText(flag.typeName(), &record->typeOffset, &record->typeLength);
+    appendText(flag.printableDefaultValue(), &record->defaultValueOffset,
+               &record->defaultValueLength);
+
+    record->valueOffset = static_cast<uint32>(valueOffset);
+    record->valueCapacity = static_cast<uint32>(std::max<size_t>(
+        MIN_SHARED_VALUE_CAPACITY, 2 * values[i].size()));
+    valueOffset += record->valueCapacity;
+    writeValue(flag, record);
+
+    recordIndexes_[&flag] = static_cast<uint32>(i);
+  }
+
+  // Readers check these last, once everything else is in place.
+  header->layoutVersion = SHARED_FLAGS_LAYOUT_VERSION;
+  std::memcpy(header->magic, SHARED_FLAGS_MAGIC, sizeof(header->magic));
+  endWrite(header);
+  return true;
+}
+
+
+#endif  // _WIN32
+
+
+void SharedFlagsPublisher::valueChanged(const AbstractFlag* flag) {
+  std::lock_guard<std::mutex> lock(writeMutex_);
+  auto recordIndex = recordIndexes_.find(flag);
+  if (!segment_ || (recordIndex == recordIndexes_.end())) {
+    return;
+  }
+
+  beginWrite(header());
+  writeValue(*flag, &records()[recordIndex->second]);
+  endWrite(header());
+}
+
+
+void SharedFlagsPublisher::writeValue(const AbstractFlag& flag,
+                                      SharedFlagRecord* record) {
+  string value = flag.printableValue();
+  size_t valueLength = std::min<size_t>(value.size(), record->valueCapacity);
+  std::memcpy(segment_ + record->valueOffset, value.data(), valueLength);
+  record->valueLength = static_cast<uint32>(valueLength);
+
+  uint32 status = 0;
+  status |= flag.hasValue() ? HAS_VALUE : 0;
+  status |= flag.hasDefaultValue() ? HAS_DEFAULT_VALUE : 0;
+  status |= flag.wasExplicitlySet() ? IS_EXPLICITLY_SET : 0;
+  status |= (valueLength < value.size()) ? IS_VALUE_TRUNCATED : 0;
+  record->status = status;
+}
+
+
+}  // namespace flags
+}  // namespace oomuse
@@ -0,0 +1,84 @@
+/**
+ * Copyright 2015 Eric W. Barndollar. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef OOMUSE_FLAGS_SHARED_FLAGS_PUBLISHER_H
+#define OOMUSE_FLAGS_SHARED_FLAGS_PUBLISHER_H
+
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "oomuse/core/int_types.h"
+#include "oomuse/core/readability_macros.h"
+#include "oomuse/flags/shared_flags_layout.h"
+
+namespace oomuse {
+  class AbstractFlag;
+}
+
+namespace oomuse {
+namespace flags {
+
+
+/**
+ * Internal writer of flag info into a POSIX shared-memory segment (see
+ * shared_flags_layout.h), which it removes when destroyed.
+ */
+class SharedFlagsPublisher {
+ public:
+  SharedFlagsPublisher() {}
+  ~SharedFlagsPublisher();
+
+  /**
+   * Creates segment with given name (or the default name for this process, if
+   * empty) and publishes given flags (which must outlive this) into it.
+   * Returns true if successful, else sets *errorMsg.
+   */
+  bool publish(const std::string& segmentName,
+               const std::vector<const AbstractFlag*>& flags,
+               std::string* errorMsg);
+
+  /** Republishes the current value of flag, if it's one being published. */
+  void valueChanged(const AbstractFlag* flag);
+
+ private:
+  CANT_COPY(SharedFlagsPublisher);
+
+  /** Writes flag's current value into its record (inside a write section). */
+  void writeValue(const AbstractFlag& flag, SharedFlagRecord* record);
+
+  SharedFlagsHeader* header() const {
+    return reinterpret_cast<SharedFlagsHeader*>(segment_);
+  }
+
+  SharedFlagRecord* records() const {
+    return reinterpret_cast<SharedFlagRecord*>(
+        segment_ + sizeof(SharedFlagsHeader));
+  }
+
+  std::string segmentName_;
+  char* segment_ = nullptr;
+  std::size_t segmentSize_ = 0;
+  std::unordered_map<const AbstractFlag*, uint32> recordIndexes_;
+  std::mutex writeMutex_;  // Held by the one writer allowed at a time.
+};
+
+
+}  // namespace flags
+}  // namespace oomuse
+
+#endif  // OOMUSE_FLAGS_SHARED_FLAGS_PUBLISHER_H
@@ -0,0 +1,203 @@
+/**
+ * Copyright 2015 Eric W. Barndollar. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "oomuse/flags/SharedFlagsReader.h"
+
+#include <atomic>
+#include <cassert>
+#include <cerrno>
+#include <cstring>
+
+#include "oomuse/flags/shared_flags_layout.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using std::size_t;
+using std::string;
+using std::vector;
+
+namespace oomuse {
+namespace flags {
+
+
+namespace {
+
+
+/** Number of times to retry a snapshot that raced with a change. */
+const int MAX_SNAPSHOT_ATTEMPTS = 10000;
+
+
+}  // namespace
+
+
+string SharedFlagsReader::segmentNameForProcess(int64 pid) {
+  return defaultSharedFlagsName(pid);
+}
+
+
+#ifdef _WIN32
+
+
+SharedFlagsReader::~SharedFlagsReader() {}
+
+
+bool SharedFlagsReader::open(const string&, string* errorMsg) {
+  *errorMsg = "Shared memory flag publishing is not supported on Windows.";
+  return false;
+}
+
+
+#else
+
+
+SharedFlagsReader::~SharedFlagsReader() {
+  if (segment_) {
+    munmap(const_cast<char*>(segment_), segmentSize_);
+  }
+}
+
+
+bool SharedFlagsReader::open(const string& segmentName, string* errorMsg) {
+  assert(!segment_);
+
+  int fd = shm_open(segmentName.c_str(), O_RDONLY, 0);
+  if (fd < 0) {
+    *errorMsg = std::strerror(errno);
+    return false;
+  }
+
+  struct stat segmentStats;
+  if (fstat(fd, &segmentStats) != 0) {
+    *errorMsg = std::strerror(errno);
+    close(fd);
+    return false;
+  }
+  size_t segmentSize = static_cast<size_t>(segmentStats.st_size);
+  if (segmentSize < sizeof(SharedFlagsHeader)) {
+    *errorMsg = "Not a published flags segment.";
+    close(fd);
+    return false;
+  }
+
+  void* mapping = mmap(nullptr, segmentSize, PROT_READ, MAP_SHARED, fd, 0);
+  int mmapErrno = errno;
+  close(fd);
+  if (mapping == MAP_FAILED) {
+    *errorMsg = std::strerror(mmapErrno);
+    return false;
+  }
+
+  // The publisher fills these in last. Only keep the mapping if they check
+  // out, so that a failed open() can be retried.
+  const SharedFlagsHeader* header =
+      reinterpret_cast<const SharedFlagsHeader*>(mapping);
+  header->sequence.load(std::memory_order_acquire);
+  if (std::memcmp(header->magic, SHARED_FLAGS_MAGIC, sizeof(header->magic))
+      != 0) {
+    *errorMsg = "Not a published flags segment (or not published yet).";
+    munmap(mapping, segmentSize);
+    return false;
+  }
+  if (header->layoutVersion != SHARED_FLAGS_LAYOUT_VERSION) {
+    *errorMsg = "Unsupported published flags layout version "
+        + std::to_string(header->layoutVersion) + ".";
+    munmap(mapping, segmentSize);
+    return false;
+  }
+
+  segment_ = static_cast<const char*>(mapping);
+  segmentSize_ = segmentSize;
+  return true;
+}
+
+
+#endif  // _WIN32
+
+
+bool SharedFlagsReader::readSnapshot(vector<SharedFlagInfo>* flags) const {
+  assert(flags);
+  if (!segment_) {
+    return false;
+  }
+
+  const SharedFlagsHeader* header =
+      reinterpret_cast<const SharedFlagsHeader*>(segment_);
+  for (int attempt = 0; attempt < MAX_SNAPSHOT_ATTEMPTS; ++attempt) {
+    uint64 sequence = header->sequence.load(std::memory_order_acquire);
+    if (sequence % 2 != 0) {
+      continue;  // Being changed right now.
+    }
+
+    bool isInBounds = copyFlags(flags);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (header->sequence.load(std::memory_order_relaxed) == sequence) {
+      return isInBounds;
+    }
+  }
+
+  return false;
+}
+
+
+bool SharedFlagsReader::copyFlags(vector<SharedFlagInfo>* flags) const {
+  const SharedFlagsHeader* header =
+      reinterpret_cast<const SharedFlagsHeader*>(segment_);
+  size_t flagCount = header->flagCount;
+  size_t recordsEnd = sizeof(SharedFlagsHeader)
+      + flagCount * sizeof(SharedFlagRecord);
+  if (recordsEnd > segmentSize_) {
+    return false;
+  }
+
+  // May see torn data if racing with a change, so check all bounds first.
+  auto copyText = [this](uint64 offset, uint64 length, string* text) {
+    if ((offset > segmentSize_) || (length > segmentSize_ - offset)) {
+      return false;
+    }
+    text->assign(segment_ + offset, length);
+    return true;
+  };
+
+  const SharedFlagRecord* records = reinterpret_cast<const SharedFlagRecord*>(
+      segment_ + sizeof(SharedFlagsHeader));
+  flags->resize(flagCount);
+  for (size_t i = 0; i < flagCount; ++i) {
+    SharedFlagRecord record = records[i];
+    SharedFlagInfo& flag = (*flags)[i];
+    if (!copyText(record.nameOffset, record.nameLength, &flag.name)
+        || !copyText(record.typeOffset, record.typeLength, &flag.typeName)
+        || !copyText(record.defaultValueOffset, record.defaultValueLength,
+                     &flag.defaultValue)
+        || !copyText(record.valueOffset, record.valueLength, &flag.value)) {
+      return false;
+    }
+
+    flag.hasValue = (record.status & HAS_VALUE) != 0;
+    flag.hasDefaultValue = (record.status & HAS_DEFAULT_VALUE) != 0;
+    flag.wasExplicitlySet = (record.status & IS_EXPLICITLY_SET) != 0;
+    flag.isValueTruncated = (record.status & IS_VALUE_TRUNCATED) != 0;
+  }
+
+  return true;
+}
+
+
+}  // namespace flags
+}  // namespace oomuse
@@ -0,0 +1,133 @@
+/**
+ * Copyright 2015 Eric W. Barndollar. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "oomuse/flags/file_writing.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+
+#ifdef _WIN32
+#include <process.h>
+
+#include <fstream>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+using std::string;
+using std::string_view;
+
+namespace oomuse {
+namespace flags {
+
+
+#ifdef _WIN32
+
+
+bool writeFileAtomically(const string& path, string_view contents,
+                         string* errorMsg) {
+  // Other processes may be writing the same path, so name by process.
+  string tempPath = path + "." + std::to_string(_getpid()) + ".tmp";
+  {
+    std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+    file.write(contents.data(), contents.size());
+    file.close();
+    if (!file) {
+      *errorMsg = "Could not write " + tempPath + ".";
+      std::remove(tempPath.c_str());
+      return false;
+    }
+  }
+
+  std::remove(path.c_str());  // Windows can't rename over an existing file.
+  if (std::rename(tempPath.c_str(), path.c_str()) != 0) {
+    *errorMsg = "Could not rename " + tempPath + " to " + path + ".";
+    std::remove(tempPath.c_str());
+    return false;
+  }
+
+  return true;
+}
+
+
+#else
+
+
+namespace {
+
+
+/** Writes all of contents to fd, returning false (setting errno) if not. */
+bool writeAll(int fd, string_view contents) {
+  while (!contents.empty()) {
+    ssize_t writtenSize = write(fd, contents.data(), contents.size());
+    if (writtenSize < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return false;
+    }
+    contents.remove_prefix(static_cast<size_t>(writtenSize));
+  }
+  return true;
+}
+
+
+}  // namespace
+
+
+bool writeFileAtomically(const string& path, string_view contents,
+                         string* errorMsg) {
+  // Other processes may be writing the same path, so each writes its own
+  // uniquely named file (only readable by the same user, since flag values
+  // can be secrets).
+  string tempPath = path + ".XXXXXX";
+  int fd = mkstemp(&tempPath[0]);
+  if (fd < 0) {
+    *errorMsg = "Could not create " + tempPath + ": " + std::strerror(errno);
+    return false;
+  }
+
+  // Sync contents before renaming, so a crash never leaves a partial file.
+  bool wasWritten = writeAll(fd, contents) && (fsync(fd) == 0);
+  int writeErrno = errno;
+  if ((close(fd) != 0) && wasWritten) {
+    wasWritten = false;
+    writeErrno = errno;
+  }
+  if (!wasWritten) {
+    *errorMsg = "Could not write " + tempPath + ": "
+        + std::strerror(writeErrno);
+    unlink(tempPath.c_str());
+    return false;
+  }
+
+  if (std::rename(tempPath.c_str(), path.c_str()) != 0) {
+    *errorMsg = "Could not rename " + tempPath + " to " + path + ": "
+        + std::strerror(errno);
+    unlink(tempPath.c_str());
+    return false;
+  }
+
+  return true;
+}
+
+
+#endif
+
+
+}  // namespace flags
+}  // namespace oomuse
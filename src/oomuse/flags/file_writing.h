@@ -0,0 +1,40 @@
+/**
+ * Copyright 2015 Eric W. Barndollar. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef OOMUSE_FLAGS_FILE_WRITING_H
+#define OOMUSE_FLAGS_FILE_WRITING_H
+
+#include <string>
+#include <string_view>
+
+namespace oomuse {
+namespace flags {
+
+
+/**
+ * Writes contents to a uniquely named temporary file next to path, then
+ * renames it over path, so that readers (and other processes writing the same
+ * path) never see a partly written file. On POSIX, the file is synced before
+ * renaming, and only readable by the same user. Returns true if successful,
+ * else sets *errorMsg (leaving any existing file at path as is).
+ */
+bool writeFileAtomically(const std::string& path, std::string_view contents,
+                         std::string* errorMsg);
+
+
+}  // namespace flags
+}  // namespace oomuse
+
+#endif  // OOMUSE_FLAGS_FILE_WRITING_H
@@ -0,0 +1,84 @@
+/**
+ * Copyright 2015 Eric W. Barndollar. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef OOMUSE_FLAGS_FLAG_SNAPSHOT_LAYOUT_H
+#define OOMUSE_FLAGS_FLAG_SNAPSHOT_LAYOUT_H
+
+#include "oomuse/core/int_types.h"
+
+namespace oomuse {
+namespace flags {
+
+
+/**
+ * Internal layout of a flag snapshot file, in native byte order:
+ *
+ *   FlagSnapshotHeader
+ *   FlagSnapshotRecord[flagCount]: one per registered flag, sorted by name.
+ *   Text: each flag's name and printable value.
+ *   Values: each flag's binary value (see snapshot_encoding.h), in a slot
+ *       aligned to 8 bytes.
+ *
+ * All offsets are in bytes from the start of the file. The schema hash covers
+ * every flag's name, type name, and allowed values (in any order); if a
+ * program's flags have the same hash, binary values fit its flags' types.
+ */
+struct FlagSnapshotHeader {
+  char magic[8];
+  uint32 formatVersion;
+  uint32 flagCount;
+  uint64 schemaHash;
+  uint64 fileSize;
+};
+
+
+/** Where to find one flag's snapshotted value. */
+struct FlagSnapshotRecord {
+  uint32 nameOffset;
+  uint32 nameLength;
+  uint32 textOffset;
+  uint32 textLength;
+  uint32 valueOffset;
+  uint32 valueLength;
+  uint32 status;  // FlagSnapshotStatus bits.
+  uint32 reserved;
+};
+
+
+/** Bits of FlagSnapshotRecord::status. */
+enum FlagSnapshotStatus : uint32 {
+  SNAPSHOT_HAS_VALUE = 1,  // Flag was set; else leave it alone.
+  SNAPSHOT_HAS_BINARY_VALUE = 2,  // Else only the text value can be used.
+};
+
+
+/** Identifies a flag snapshot file. */
+constexpr char FLAG_SNAPSHOT_MAGIC[8] =
+    {'O', 'O', 'M', 'F', 'S', 'N', 'A', 'P'};
+
+/**
+ * Incremented on any incompatible change to the layout above (or to value
+ * encodings). A file in a different byte order also fails this check.
+ */
+constexpr uint32 FLAG_SNAPSHOT_FORMAT_VERSION = 1;
+
+/** Alignment of binary value slots. */
+constexpr uint32 FLAG_SNAPSHOT_VALUE_ALIGNMENT = 8;
+
+
+}  // namespace flags
+}  // namespace oomuse
+
+#endif  // OOMUSE_FLAGS_FLAG_SNAPSHOT_LAYOUT_H
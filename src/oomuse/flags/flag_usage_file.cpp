@@ -0,0 +1,160 @@
+/**
+ * Copyright 2015 Eric W. Barndollar. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "oomuse/flags/flag_usage_file.h"
+
+#include <charconv>
+#include <sstream>
+
+#include "oomuse/flags/Flag.h"
+#include "oomuse/flags/file_writing.h"
+
+using oomuse::AbstractFlag;
+using std::ostringstream;
+using std::size_t;
+using std::string;
+using std::string_view;
+using std::vector;
+
+namespace oomuse {
+namespace flags {
+
+
+namespace {
+
+
+const char READS_COUNTED_KEY[] = "reads_counted";
+
+
+/**
+ * Removes and returns text up to the next tab (or all of it, if none) from
+ * *line, setting *hasMore to whether there was a tab.
+ */
+string_view nextField(string_view* line, bool* hasMore) {
+  size_t tabIndex = line->find('\t');
+  *hasMore = (tabIndex != string_view::npos);
+  string_view field = line->substr(0, tabIndex);
+  line->remove_prefix(*hasMore ? tabIndex + 1 : line->size());
+  return field;
+}
+
+
+/** Parses a "0" or "1" field into *value, returning true if successful. */
+bool parseBit(string_view field, bool* value) {
+  if ((field != "0") && (field != "1")) {
+    return false;
+  }
+
+  *value = (field == "1");
+  return true;
+}
+
+
+/** Parses a decimal field into *value, returning true if successful. */
+bool parseCount(string_view field, uint64* value) {
+  const char* end = field.data() + field.size();
+  auto result = std::from_chars(field.data(), end, *value);
+  return !field.empty() && (result.ec == std::errc()) && (result.ptr == end);
+}
+
+
+/** Parses one flag line into *record, returning true if well formed. */
+bool parseRecord(string_view line, FlagUsageRecord* record) {
+  bool hasMore = false;
+  record->name = nextField(&line, &hasMore);
+  if (record->name.empty() || !hasMore
+      || !parseBit(nextField(&line, &hasMore), &record->wasExplicitlySet)
+      || !hasMore
+      || !parseBit(nextField(&line, &hasMore), &record->hasDefaultValue)
+      || !hasMore) {
+    return false;
+  }
+
+  return parseCount(nextField(&line, &hasMore), &record->readCount)
+      && !hasMore;
+}
+
+
+}  // namespace
+
+
+bool writeFlagUsageFile(const string& path,
+                        const vector<FlagRegistry::Entry>& sortedEntries,
+                        bool areReadsCounted, string* errorMsg) {
+  ostringstream contents;
+  contents << FLAG_USAGE_FILE_HEADER << "\n"
+           << READS_COUNTED_KEY << "\t" << (areReadsCounted ? 1 : 0) << "\n";
+  for (const FlagRegistry::Entry& entry : sortedEntries) {
+    const AbstractFlag& flag = *entry.flag;
+    contents << flag.name() << "\t" << (flag.wasExplicitlySet() ? 1 : 0)
+             << "\t" << (flag.hasDefaultValue() ? 1 : 0) << "\t"
+             << flag.readCount() << "\n";
+  }
+
+  // Collectors must never see a partly written file.
+  return writeFileAtomically(path, contents.str(), errorMsg);
+}
+
+
+bool parseFlagUsageFile(string_view contents, bool* areReadsCounted,
+                        vector<FlagUsageRecord>* records, string* errorMsg) {
+  records->clear();
+  int lineNumber = 0;
+  while (!contents.empty()) {
+    size_t newlineIndex = contents.find('\n');
+    string_view line = contents.substr(0, newlineIndex);
+    contents.remove_prefix((newlineIndex != string_view::npos)
+                           ? newlineIndex + 1 : contents.size());
+    ++lineNumber;
+    if (!line.empty() && (line.back() == '\r')) {
+      line.remove_suffix(1);
+    }
+
+    if (lineNumber == 1) {
+      if (line != FLAG_USAGE_FILE_HEADER) {
+        *errorMsg = "Not a flag usage file (or an unsupported version).";
+        return false;
+      }
+    } else if (lineNumber == 2) {
+      bool hasMore = false;
+      if ((nextField(&line, &hasMore) != READS_COUNTED_KEY) || !hasMore
+          || !parseBit(line, areReadsCounted)) {
+        *errorMsg = "Line 2: Expected reads_counted.";
+        return false;
+      }
+    } else if (!line.empty()) {
+      FlagUsageRecord record;
+      if (!parseRecord(line, &record)) {
+        *errorMsg = "Line " + std::to_string(lineNumber)
+            + ": Expected <name>\\t<0|1>\\t<0|1>\\t<read count>.";
+        return false;
+      }
+      records->push_back(record);
+    }
+  }
+
+  if (lineNumber < 2) {
+    *errorMsg = (lineNumber == 0)
+        ? "Not a flag usage file (or an unsupported version)."
+        : "Line 2: Expected reads_counted.";
+    return false;
+  }
+  return true;
+}
+
+
+}  // namespace flags
+}  // namespace oomuse
@@ -0,0 +1,77 @@
+/**
+ * Copyright 2015 Eric W. Barndollar. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef OOMUSE_FLAGS_FLAG_USAGE_FILE_H
+#define OOMUSE_FLAGS_FLAG_USAGE_FILE_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "oomuse/core/int_types.h"
+#include "oomuse/flags/FlagRegistry.h"
+
+namespace oomuse {
+namespace flags {
+
+
+/**
+ * Internal format of flag usage files (see writeFlagUsage() in flags.h), as
+ * tab-separated text lines:
+ *
+ *   oomuse-flags usage 1
+ *   reads_counted<TAB>(0|1)
+ *   <name><TAB><was set: 0|1><TAB><has default: 0|1><TAB><read count>
+ *   ...one such line per registered flag, sorted by name.
+ *
+ * The version in the first line is incremented on any incompatible change.
+ */
+constexpr char FLAG_USAGE_FILE_HEADER[] = "oomuse-flags usage 1";
+
+
+/** One flag's line in a flag usage file. */
+struct FlagUsageRecord {
+  std::string_view name;
+  bool wasExplicitlySet;
+  bool hasDefaultValue;
+  uint64 readCount;  // 0 if reads weren't counted.
+};
+
+
+/**
+ * Writes usage of given flags (sorted by name) to the file at path, replacing
+ * any file there only once complete. Returns true if successful, else sets
+ * *errorMsg.
+ */
+bool writeFlagUsageFile(
+    const std::string& path,
+    const std::vector<FlagRegistry::Entry>& sortedEntries,
+    bool areReadsCounted, std::string* errorMsg);
+
+/**
+ * Parses contents of a flag usage file into *areReadsCounted and *records
+ * (whose names point into contents), returning true if well formed. Otherwise,
+ * sets *errorMsg to describe why not (with the line number).
+ */
+bool parseFlagUsageFile(std::string_view contents, bool* areReadsCounted,
+                        std::vector<FlagUsageRecord>* records,
+                        std::string* errorMsg);
+
+
+}  // namespace flags
+}  // namespace oomuse
+
+#endif  // OOMUSE_FLAGS_FLAG_USAGE_FILE_H
@@ -16,68 +16,305 @@
 
 #include "oomuse/flags/flags.h"
 
+#include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <chrono>
+#include <cstddef>
 #include <cstdlib>
+#include <cstring>
+#include <iomanip>
 #include <iostream>
-#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
-#include "oomuse/core/strings.h"
+#include "oomuse/core/int_types.h"
 #include "oomuse/flags/Flag.h"
+#include "oomuse/flags/FlagChangeNotifier.h"
+#include "oomuse/flags/FlagRegistry.h"
+#include "oomuse/flags/FlagSet.h"
+#include "oomuse/flags/FlagSnapshot.h"
+#include "oomuse/flags/MappedFile.h"
+#include "oomuse/flags/MutableFlag.h"
+#include "oomuse/flags/SharedFlagsPublisher.h"
+#include "oomuse/flags/flag_usage_file.h"
+#include "oomuse/flags/read_counting.h"
 
 using oomuse::AbstractFlag;
+using oomuse::flags::DeferredValidation;
+using oomuse::flags::FlagChangeNotifier;
+using oomuse::flags::FlagError;
+using oomuse::flags::FlagErrorType;
+using oomuse::flags::FlagInitProfile;
+using oomuse::flags::FlagReadCount;
+using oomuse::flags::FlagRegistry;
+using oomuse::flags::FlagSnapshotFile;
+using oomuse::flags::InitPhaseProfile;
+using oomuse::flags::InitProfile;
+using oomuse::flags::MappedFile;
+using oomuse::flags::MutableFlagBatch;
+using oomuse::flags::NumberSyntax;
+using oomuse::flags::SharedFlagsPublisher;
+using oomuse::flags::StaticFlagIndex;
 using std::cerr;
 using std::endl;
 using std::exit;
-using std::map;
 using std::ostream;
+using std::ostringstream;
+using std::size_t;
 using std::string;
+using std::string_view;
+using std::thread;
+using std::unique_ptr;
 using std::vector;
+using std::chrono::nanoseconds;
 
-namespace strings = oomuse::strings;
+#if !defined(_WIN32)
+extern char** environ;  // The process environment (POSIX).
+#endif
 
 namespace {
 
 
+/** Name of the flag that sets more flags from a file. */
+const string_view FLAG_FILE_FLAG_NAME = "flagfile";
+
+/** Name of the flag that sets more flags from a snapshot file. */
+const string_view FLAG_SNAPSHOT_FLAG_NAME = "flag_snapshot";
+
+/** Name of the arg that profiles init(). */
+const string_view FLAGS_PROFILE_FLAG_NAME = "flags_profile";
+
+/** Number of flags a --flags_profile report lists by default. */
+const size_t DEFAULT_PROFILE_TOP_COUNT = 10;
+
+/** Maximum nesting of flag files, which also stops include cycles. */
+const int MAX_FLAG_FILE_DEPTH = 32;
+
+using Clock = std::chrono::steady_clock;
+
+
+/**
+ * Location within a flag file, for error messages. A lineNumber of 0 instead
+ * means a value from the environment variable or flag snapshot named path.
+ */
+struct FlagFileLocation {
+  string_view path;
+  uint64 lineNumber;
+};
+
+
+/** A flag value validation deferred by init(), and its outcome once run. */
+struct PendingValidation {
+  unique_ptr<DeferredValidation> validation;
+  string location;  // Flag file location (like "flags.txt:12: "), if any.
+  ostringstream errors;
+  bool isValid = false;
+};
+
+
 bool hasBeenInitialized = false;
 ostream* output = &cerr;
+NumberSyntax numberSyntaxOptions;
+int validationThreadCount = 1;
+string environmentPrefix;  // Empty unless init() reads the environment.
+
+/** Flag file location being parsed on this thread; null if from argv[]. */
+thread_local const FlagFileLocation* currentLocation = nullptr;
+
+/** Validations being deferred by init() on this thread, if any. */
+thread_local vector<PendingValidation>* pendingValidations = nullptr;
+
+/** True if even values without validators are being deferred (to stage). */
+thread_local bool isStagingAllValues = false;
+
+/** Paths of flag files read by reloadFlagFile() on this thread, if any. */
+thread_local vector<string>* readFlagFilePaths = nullptr;
+
+/** True if reloadFlagFile() is reading files (that may be mid-edit). */
+thread_local bool isReloading = false;
+
+/** Validation being run by this thread, which collects its errors. */
+thread_local PendingValidation* currentValidation = nullptr;
+
+/** Errors being collected by initCollectingErrors() on this thread, if any. */
+thread_local vector<FlagError>* collectedErrors = nullptr;
+
+/** Error text output since the last recordError(), if collecting errors. */
+thread_local ostringstream errorText;
+
+
+/** Whether (and how) init() profiles itself; see setInitProfiling(). */
+bool isInitProfilingEnabled = false;
+int64 (*allocationCounter)() = nullptr;
+
+/** True while init() is profiling itself. */
+std::atomic<bool> isProfiling(false);
+
+/** Profile recorded by init(), with the index of each flag in its flags. */
+InitProfile profile;
+std::unordered_map<const AbstractFlag*, size_t> profiledFlagIndices;
+
+/** Held to update profiled flags, which parallel validations also time. */
+std::mutex profileMutex;
 
 
-map<string, AbstractFlag*>& flagMap() {
+/** Held while reloading a flag file, which uses the parsing state above. */
+std::mutex reloadMutex;
+
+/**
+ * Position in argv[] of the last arg that init() set each flag from (by flag
+ * name) and of the last --flagfile arg for each path, so that reloads keep
+ * values from later args.
+ */
+std::unordered_map<string, size_t> flagArgIndices;
+std::unordered_map<string, size_t> flagFileArgIndices;
+
+
+/** Publisher of flags to shared memory, if publishToSharedMemory() called. */
+unique_ptr<SharedFlagsPublisher> publisher;
+std::atomic<bool> isPublishing(false);
+std::mutex publisherMutex;
+
+
+/**
+ * Returns registry of all flags, which locks itself, since flags can be looked
+ * up by reloads (on a FlagFileWatcher thread) while others are declared.
+ */
+FlagRegistry& registry() {
+  // Use static variable to control static initialization order.
+  static FlagRegistry theRegistry;
+  return theRegistry;
+}
+
+
+FlagChangeNotifier& changeNotifier() {
   // Use static variable to control static initialization order.
-  static map<string, AbstractFlag*> theMap;
-  return theMap;
+  static FlagChangeNotifier theChangeNotifier;
+  return theChangeNotifier;
 }
 
 
-string getFlagName(const string& fullArg) {
-  if (!strings::startsWith(fullArg, "--") || (fullArg.length() < 3)) {
-    return "";
+/** Returns flag name as a view into fullArg, or empty if not a flag. */
+string_view getFlagName(string_view fullArg) {
+  if ((fullArg.length() < 3) || (fullArg.compare(0, 2, "--") != 0)) {
+    return string_view();
   }
 
   // Flag name continues up to equals sign (if any).
   auto equalsIndex = fullArg.find('=');
-  auto nameLength = (equalsIndex != string::npos) ? equalsIndex - 2
-                                                  : fullArg.length() - 2;
+  auto nameLength = (equalsIndex != string_view::npos) ? equalsIndex - 2
+                                                       : fullArg.length() - 2;
   return fullArg.substr(2, nameLength);
 }
 
 
-AbstractFlag* getFlag(const string& flagName) {
-  if (flagMap().count(flagName) == 0) {
-    *output << "Unrecognized command-line flag: --" << flagName << endl;
-    return nullptr;
+void outputCurrentLocation(ostream& stream) {
+  if (!currentLocation) {
+    return;
+  }
+
+  stream << currentLocation->path;
+  if (currentLocation->lineNumber != 0) {
+    stream << ":" << currentLocation->lineNumber;
+  }
+  stream << ": ";
+}
+
+
+/** Returns the process environment, as null-terminated NAME=value entries. */
+char** environmentVariables() {
+#if defined(_WIN32)
+  return _environ;
+#else
+  return environ;
+#endif
+}
+
+
+/** Returns output stream, after outputting any current flag file location. */
+ostream& errorOutput() {
+  // Errors from deferred validations are held to output in argv order.
+  if (currentValidation) {
+    currentValidation->errors << currentValidation->location;
+    return currentValidation->errors;
   }
 
-  return flagMap()[flagName];
+  ostream& stream = collectedErrors ? errorText : *output;
+  outputCurrentLocation(stream);
+  return stream;
+}
+
+
+/** Outputs error message, also collecting it if initCollectingErrors(). */
+void reportError(FlagErrorType type, string_view flagName,
+                 const string& message) {
+  *output << message;
+
+  if (collectedErrors) {
+    auto messageLength = message.find_last_not_of('\n') + 1;
+    collectedErrors->push_back(
+        FlagError{type, string(flagName), message.substr(0, messageLength)});
+  }
+}
+
+
+/** Finishes the error just output to errorOutput(). */
+void recordError(FlagErrorType type, string_view flagName = string_view()) {
+  if (collectedErrors) {
+    reportError(type, flagName, errorText.str());
+    errorText.str("");
+  }
+}
+
+
+AbstractFlag* getFlag(string_view flagName) {
+  AbstractFlag* flag = registry().find(flagName);
+  if (!flag) {
+    errorOutput() << "Unrecognized command-line flag: --" << flagName << endl;
+    recordError(FlagErrorType::UNRECOGNIZED_FLAG, flagName);
+  }
+
+  return flag;
+}
+
+
+bool isAbsolutePath(string_view path) {
+  return (path.front() == '/') || (path.front() == '\\')
+      || ((path.length() >= 2) && (path[1] == ':'));
+}
+
+
+/** Returns path of a flag file, relative to any flag file that includes it. */
+string resolveFlagFilePath(string_view path) {
+  bool isFromFlagFile = currentLocation && (currentLocation->lineNumber != 0);
+  if (!isFromFlagFile || isAbsolutePath(path)) {
+    return string(path);
+  }
+
+  auto separatorIndex = currentLocation->path.find_last_of("/\\");
+  if (separatorIndex == string_view::npos) {
+    return string(path);
+  }
+
+  string resolvedPath(currentLocation->path.substr(0, separatorIndex + 1));
+  resolvedPath.append(path);
+  return resolvedPath;
 }
 
 
 vector<const AbstractFlag*> getFlagsByRequiredness(bool required) {
   vector<const AbstractFlag*> flags;
 
-  for (auto& entry : flagMap()) {
-    AbstractFlag* flag = entry.second;
+  for (auto& entry : registry().sortedEntries()) {
+    AbstractFlag* flag = entry.flag;
     if (flag->isRequired() == required) {
       flags.push_back(flag);
     }
@@ -96,6 +333,10 @@ void printFlags(const vector<const AbstractFlag*>& flags, const string& label) {
 
   for (auto& flag : flags) {
     *output << "  --" << flag->name() << ": " << flag->description();
+    string allowedValues = flag->printableAllowedValues();
+    if (!allowedValues.empty()) {
+      *output << " (values: " << allowedValues << ")";
+    }
     if (flag->hasDefaultValue()) {
       *output << " (default: " << flag->printableDefaultValue() << ")";
     }
@@ -104,19 +345,379 @@ void printFlags(const vector<const AbstractFlag*>& flags, const string& label) {
 }
 
 
-bool areAllRequiredFlagsSet() {
-  bool allAreSet = true;
+/**
+ * Defers validations into given list (if not null) during its lifetime, for
+ * only flags with validators, or else all flags if isStagingAll.
+ */
+class ValidationDeferral {
+ public:
+  ValidationDeferral(vector<PendingValidation>* validations,
+                     bool isStagingAll) {
+    pendingValidations = validations;
+    isStagingAllValues = isStagingAll;
+  }
+
+  ~ValidationDeferral() {
+    pendingValidations = nullptr;
+    isStagingAllValues = false;
+  }
+
+ private:
+  CANT_COPY(ValidationDeferral);
+};
+
+
+/** Runs validations on up to validationThreadCount threads. */
+void validatePending(vector<PendingValidation>* validations) {
+  std::atomic<size_t> nextIndex(0);
+  auto validateRemaining = [validations, &nextIndex]() {
+    for (size_t i = nextIndex++; i < validations->size(); i = nextIndex++) {
+      PendingValidation& pending = (*validations)[i];
+      currentValidation = &pending;
+      pending.isValid = pending.validation->validate();
+      currentValidation = nullptr;
+    }
+  };
+
+  // This thread validates too, alongside any extra threads.
+  size_t threadCount = std::min(static_cast<size_t>(validationThreadCount),
+                                validations->size());
+  vector<thread> extraThreads;
+  for (size_t i = 1; i < threadCount; ++i) {
+    extraThreads.emplace_back(validateRemaining);
+  }
+  validateRemaining();
+  for (thread& extraThread : extraThreads) {
+    extraThread.join();
+  }
+}
+
+
+/** Remembers position of arg in argv[], for reloadFlagFile(). */
+void recordArgIndex(string_view fullArg, string_view flagName, size_t index) {
+  if (flagName == FLAG_FILE_FLAG_NAME) {
+    string path(fullArg.substr(fullArg.find('=') + 1));
+    flagFileArgIndices[path] = index;
+  } else if (flagName != FLAG_SNAPSHOT_FLAG_NAME) {
+    flagArgIndices[string(flagName)] = index;
+  }
+}
+
+
+/** Returns true if an arg after the --flagfile for path set flag in init(). */
+bool isSetByLaterArg(const AbstractFlag* flag, const string& path) {
+  auto flagArg = flagArgIndices.find(string(flag->name()));
+  if (flagArg == flagArgIndices.end()) {
+    return false;
+  }
+
+  // Args override files not given as args at all, too.
+  auto flagFileArg = flagFileArgIndices.find(path);
+  return (flagFileArg == flagFileArgIndices.end())
+      || (flagArg->second > flagFileArg->second);
+}
+
+
+/** Outputs errors of failed validations in order. */
+void reportFailedValidations(const vector<PendingValidation>& validations) {
+  for (const PendingValidation& pending : validations) {
+    if (!pending.isValid) {
+      reportError(FlagErrorType::INVALID_VALUE,
+                  pending.validation->flag()->name(), pending.errors.str());
+    }
+  }
+}
 
-  for (auto& entry : flagMap()) {
-    AbstractFlag* flag = entry.second;
+
+/** Delivers flag changes to listeners only once it's destroyed. */
+class ChangeNotificationBatch {
+ public:
+  ChangeNotificationBatch() { changeNotifier().beginBatch(); }
+  ~ChangeNotificationBatch() { changeNotifier().endBatch(); }
+
+ private:
+  CANT_COPY(ChangeNotificationBatch);
+};
+
+
+/**
+ * Runs validations, then sets valid values and outputs errors in order.
+ * Returns true if all were valid.
+ */
+bool runPendingValidations(vector<PendingValidation>* validations) {
+  validatePending(validations);
+
+  bool allAreValid = true;
+  for (PendingValidation& pending : *validations) {
+    if (pending.isValid) {
+      pending.validation->commit();
+    } else {
+      reportError(FlagErrorType::INVALID_VALUE,
+                  pending.validation->flag()->name(), pending.errors.str());
+      allAreValid = false;
+    }
+  }
+
+  return allAreValid;
+}
+
+
+bool areAllRequiredFlagsSet() {
+  // Only sort flags if some are missing (to report them in name order), since
+  // sorting every flag would be a large part of init() for many flags.
+  vector<const AbstractFlag*> missingFlags;
+  for (auto& entry : registry().entries()) {
+    AbstractFlag* flag = entry.flag;
     if (flag->isRequired() && !flag->hasValue()) {
-      *output << "Missing required command-line flag --"
-              << flag->name() << "." << endl;
-      allAreSet = false;
+      missingFlags.push_back(flag);
     }
   }
+  std::sort(missingFlags.begin(), missingFlags.end(),
+      [](const AbstractFlag* a, const AbstractFlag* b) {
+        return a->name() < b->name();
+      });
+
+  for (const AbstractFlag* flag : missingFlags) {
+    errorOutput() << "Missing required command-line flag --"
+                  << flag->name() << "." << endl;
+    recordError(FlagErrorType::MISSING_REQUIRED_FLAG, flag->name());
+  }
 
-  return allAreSet;
+  return missingFlags.empty();
+}
+
+
+/** Marks a flag in profiledFlagIndices that isn't in profile.flags yet. */
+const size_t NOT_YET_PROFILED = static_cast<size_t>(-1);
+
+
+/**
+ * Returns profile of flag, adding it if new (without allocating, so as not to
+ * skew allocation counts, unless flag was declared after init() began). Hold
+ * profileMutex.
+ */
+FlagInitProfile& flagProfile(const AbstractFlag* flag) {
+  size_t& index = profiledFlagIndices.emplace(flag, NOT_YET_PROFILED)
+      .first->second;
+  if (index == NOT_YET_PROFILED) {
+    index = profile.flags.size();
+    profile.flags.push_back(
+        FlagInitProfile{flag, 0, nanoseconds(0), nanoseconds(0)});
+  }
+  return profile.flags[index];
+}
+
+
+/** While profiling, adds the time (and allocations) of its life to phase. */
+class PhaseTimer {
+ public:
+  explicit PhaseTimer(InitPhaseProfile* phase)
+      : phase_(isProfiling.load(std::memory_order_relaxed) ? phase : nullptr) {
+    if (phase_) {
+      startAllocations_ = allocationCounter ? allocationCounter() : 0;
+      startTime_ = Clock::now();
+    }
+  }
+
+  ~PhaseTimer() { stop(); }
+
+  /** Ends the phase early. */
+  void stop() {
+    if (phase_) {
+      phase_->time += Clock::now() - startTime_;
+      if (allocationCounter) {
+        phase_->allocations += allocationCounter() - startAllocations_;
+      }
+      phase_ = nullptr;
+    }
+  }
+
+ private:
+  CANT_COPY(PhaseTimer);
+
+  InitPhaseProfile* phase_;  // Null if not profiling.
+  Clock::time_point startTime_;
+  int64 startAllocations_ = 0;
+};
+
+
+/**
+ * While profiling, adds the time of its life to flag's parse time (except
+ * for time validating, which validators record themselves).
+ */
+class FlagTimer {
+ public:
+  explicit FlagTimer(const AbstractFlag* flag)
+      : flag_(isProfiling.load(std::memory_order_relaxed) ? flag : nullptr) {
+    if (flag_) {
+      std::lock_guard<std::mutex> lock(profileMutex);
+      startValidationTime_ = flagProfile(flag_).validationTime;
+      startTime_ = Clock::now();
+    }
+  }
+
+  ~FlagTimer() {
+    if (flag_) {
+      nanoseconds time = Clock::now() - startTime_;
+      std::lock_guard<std::mutex> lock(profileMutex);
+      FlagInitProfile& flagTimes = flagProfile(flag_);
+      flagTimes.parseTime +=
+          time - (flagTimes.validationTime - startValidationTime_);
+      ++flagTimes.valueCount;
+    }
+  }
+
+ private:
+  CANT_COPY(FlagTimer);
+
+  const AbstractFlag* flag_;  // Null if not profiling.
+  Clock::time_point startTime_;
+  nanoseconds startValidationTime_{0};
+};
+
+
+/**
+ * Profiles init() during its lifetime (if enabled), then outputs the profile
+ * if a --flags_profile arg asked for it.
+ */
+class InitProfiler {
+ public:
+  explicit InitProfiler(bool isEnabled) : isEnabled_(isEnabled) {
+    if (!isEnabled_) {
+      return;
+    }
+
+    profile = InitProfile();
+    profiledFlagIndices.clear();
+    profile.registeredFlagCount = registry().size();
+    if (allocationCounter) {
+      for (InitPhaseProfile* phase : {&profile.registration,
+                                      &profile.environment, &profile.args,
+                                      &profile.validation, &profile.total}) {
+        phase->allocations = 0;
+      }
+    }
+    isProfiling.store(true);
+    totalTimer_.reset(new PhaseTimer(&profile.total));
+  }
+
+  /**
+   * Allocates room to profile every registered flag (once they're indexed),
+   * so that profiling flags later won't allocate.
+   */
+  void prepareFlagProfiles() {
+    if (!isEnabled_) {
+      return;
+    }
+
+    const vector<FlagRegistry::Entry>& entries = registry().entries();
+    profile.flags.reserve(entries.size());
+    profiledFlagIndices.reserve(entries.size());
+    for (const FlagRegistry::Entry& entry : entries) {
+      profiledFlagIndices.emplace(entry.flag, NOT_YET_PROFILED);
+    }
+  }
+
+  ~InitProfiler() {
+    if (!isEnabled_) {
+      return;
+    }
+
+    totalTimer_.reset();
+    isProfiling.store(false);
+    std::stable_sort(profile.flags.begin(), profile.flags.end(),
+        [](const FlagInitProfile& a, const FlagInitProfile& b) {
+          return (a.parseTime + a.validationTime)
+              > (b.parseTime + b.validationTime);
+        });
+    profiledFlagIndices.clear();
+
+    if (reportTopCount_ > 0) {
+      oomuse::flags::printInitProfile(profile, output, reportTopCount_);
+    }
+  }
+
+  /**
+   * Reads the topCount of a --flags_profile[=topCount] arg to report, and
+   * returns true, or returns false if invalid (after outputting why).
+   */
+  bool readReportArg(string_view fullArg) {
+    auto equalsIndex = fullArg.find('=');
+    if (equalsIndex == string_view::npos) {
+      reportTopCount_ = DEFAULT_PROFILE_TOP_COUNT;
+      return true;
+    }
+
+    string_view textValue = fullArg.substr(equalsIndex + 1);
+    int32 topCount;
+    if (!oomuse::flags::parseNumber(textValue, &topCount) || (topCount < 1)) {
+      errorOutput() << "Invalid value for flag --" << FLAGS_PROFILE_FLAG_NAME
+                    << ": " << textValue
+                    << ". Must be a positive number of flags to list." << endl;
+      recordError(FlagErrorType::INVALID_VALUE, FLAGS_PROFILE_FLAG_NAME);
+      return false;
+    }
+
+    reportTopCount_ = static_cast<size_t>(topCount);
+    return true;
+  }
+
+ private:
+  CANT_COPY(InitProfiler);
+
+  bool isEnabled_;
+  unique_ptr<PhaseTimer> totalTimer_;
+  size_t reportTopCount_ = 0;  // 0 if not reporting.
+};
+
+
+/** Returns true if argv[] has a --flags_profile arg. */
+bool hasProfileArg(const char* argv[]) {
+  const char prefix[] = "--flags_profile";
+  for (const char** arg = &argv[1]; *arg; ++arg) {
+    // Most args differ within the first few characters.
+    if ((std::strncmp(*arg, prefix, sizeof(prefix) - 1) == 0)
+        && (getFlagName(*arg) == FLAGS_PROFILE_FLAG_NAME)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+
+/** Outputs time in microseconds, right-aligned to given width. */
+void outputMicroseconds(nanoseconds time, int width, ostream* stream) {
+  ostringstream text;
+  text << std::fixed << std::setprecision(1) << (time.count() / 1000.0)
+       << "us";
+  *stream << std::setw(width) << text.str();
+}
+
+
+/** Outputs one phase line of a profile report. */
+void outputPhase(const char* name, const InitPhaseProfile& phase,
+                 ostream* stream) {
+  *stream << "  " << std::left << std::setw(14) << name << std::right;
+  outputMicroseconds(phase.time, 12, stream);
+  *stream << std::setw(13);
+  if (phase.allocations >= 0) {
+    *stream << phase.allocations;
+  } else {
+    *stream << "-";
+  }
+  *stream << endl;
+}
+
+
+/** Outputs one flag line of a profile report. */
+void outputFlagProfile(const FlagInitProfile& flagTimes, ostream* stream) {
+  *stream << "  ";
+  outputMicroseconds(flagTimes.parseTime + flagTimes.validationTime, 12,
+                     stream);
+  outputMicroseconds(flagTimes.parseTime, 12, stream);
+  outputMicroseconds(flagTimes.validationTime, 12, stream);
+  *stream << std::setw(8) << flagTimes.valueCount << "  --"
+          << flagTimes.flag->name() << endl;
 }
 
 
@@ -136,14 +737,46 @@ bool init(int* argcPtr, const char* argv[]) {
   assert(!hasBeenInitialized);
   hasBeenInitialized = true;
 
+  // Profile all of init(), if enabled by setInitProfiling() or an arg.
+  InitProfiler profiler(isInitProfilingEnabled || hasProfileArg(argv));
+
+  // Index all flags registered during static initialization up front.
+  {
+    PhaseTimer registrationTimer(&profile.registration);
+    registry().buildIndex();
+  }
+  profiler.prepareFlagProfiles();
+
+  // Any change listeners get all flags set here at once.
+  ChangeNotificationBatch notificationBatch;
+
+  // If validating in parallel, just collect validations while parsing.
+  vector<PendingValidation> validations;
+  ValidationDeferral deferral(
+      (validationThreadCount > 1) ? &validations : nullptr, false);
+
+  // Set flags from the environment first, so that args override them.
+  // Stop at the first error, unless collecting all of them.
+  bool allFlagsAreValid = true;
+  if (!environmentPrefix.empty()) {
+    PhaseTimer environmentTimer(&profile.environment);
+    if (!FlagsInternal::setFlagsFromEnvironment()) {
+      if (!collectedErrors) {
+        return false;
+      }
+      allFlagsAreValid = false;
+    }
+  }
+
   // Iterate over all command-line args and set any matching flags.
   // Remove flags from argv[], keeping only remaining positional args.
   const char** nextPositionalArg = &argv[1];
+  PhaseTimer argsTimer(&profile.args);
   for (const char** arg = &argv[1]; *arg; ++arg) {
-    string fullArg = *arg;
+    string_view fullArg = *arg;
 
     // Formatted like a command-line flag?
-    string flagName = getFlagName(fullArg);
+    string_view flagName = getFlagName(fullArg);
     if (flagName.empty()) {
       // No, it's a positional arg: keep it in argv[].
       *nextPositionalArg = *arg;
@@ -151,23 +784,125 @@ bool init(int* argcPtr, const char* argv[]) {
       continue;
     }
 
-    // Yes, this is a --flag arg, look for matching Flag.
-    AbstractFlag* flag = getFlag(flagName);
-    if (!flag) {
-      return false;
-    }
-
-    // Initialize it.
-    bool wasValid = FlagsInternal::parseValidateAndSet(flag, fullArg);
-    if (!wasValid) {
-      return false;
+    // Yes, this is a --flag arg, so set matching Flag (or flag file flags).
+    // Stop at the first error, unless collecting all of them.
+    bool wasSet = (flagName == FLAGS_PROFILE_FLAG_NAME)
+        ? profiler.readReportArg(fullArg)
+        : FlagsInternal::setFlag(fullArg, flagName, 0);
+    if (!wasSet) {
+      if (!collectedErrors) {
+        return false;
+      }
+      allFlagsAreValid = false;
     }
+    recordArgIndex(fullArg, flagName, arg - &argv[0]);
   }
 
   // Terminate argv[] and update argc to count remaining positional args.
   *nextPositionalArg = nullptr;
   *argcPtr = static_cast<int>(nextPositionalArg - &argv[0]);
-  return areAllRequiredFlagsSet();
+  argsTimer.stop();
+
+  PhaseTimer validationTimer(&profile.validation);
+  if (!runPendingValidations(&validations)) {
+    if (!collectedErrors) {
+      return false;
+    }
+    allFlagsAreValid = false;
+  }
+
+  bool allRequiredFlagsAreSet = areAllRequiredFlagsSet();
+  return allFlagsAreValid && allRequiredFlagsAreSet;
+}
+
+
+bool reloadFlagFile(const string& path,
+                    vector<const AbstractFlag*>* changedFlags,
+                    vector<string>* flagFilePaths) {
+  std::lock_guard<std::mutex> lock(reloadMutex);
+  assert(hasBeenInitialized);
+  assert(!collectedErrors);
+  if (changedFlags) {
+    changedFlags->clear();
+  }
+  if (flagFilePaths) {
+    flagFilePaths->clear();
+  }
+
+  // Parse every value into a staged validation, setting none yet.
+  vector<PendingValidation> validations;
+  bool isValid;
+  {
+    ValidationDeferral deferral(&validations, true);
+    readFlagFilePaths = flagFilePaths;
+    isReloading = true;
+    isValid = FlagsInternal::parseFlagFile(path, 1);
+    isReloading = false;
+    readFlagFilePaths = nullptr;
+  }
+
+  if (isValid) {
+    validatePending(&validations);
+    isValid = std::all_of(validations.begin(), validations.end(),
+        [](const PendingValidation& pending) { return pending.isValid; });
+    reportFailedValidations(validations);
+  }
+  if (!isValid) {
+    *output << "Flag file " << path << " not reloaded; flags are unchanged."
+            << endl;
+    return false;
+  }
+
+  // Only the last value staged for each flag counts.
+  vector<DeferredValidation*> changes;
+  std::unordered_set<const AbstractFlag*> stagedFlags;
+  for (auto pending = validations.rbegin(); pending != validations.rend();
+       ++pending) {
+    DeferredValidation* validation = pending->validation.get();
+    if (stagedFlags.insert(validation->flag()).second
+        && validation->changesValue()) {
+      changes.push_back(validation);
+    }
+  }
+  if (changes.empty()) {
+    return true;
+  }
+  std::reverse(changes.begin(), changes.end());
+
+  // Set all changed mutable flags together.
+  MutableFlagBatch batch;
+  for (DeferredValidation* change : changes) {
+    const AbstractFlag* flag = change->flag();
+    if (isSetByLaterArg(flag, path)) {
+      *output << "Ignoring new value for flag --" << flag->name()
+              << " from " << path << ", which a later command-line arg set."
+              << endl;
+      continue;
+    }
+    if (!flag->isMutable()) {
+      *output << "Ignoring new value for flag --" << flag->name()
+              << " from " << path << ", which only changes on restart."
+              << endl;
+      continue;
+    }
+
+    change->commit();
+    if (changedFlags) {
+      changedFlags->push_back(flag);
+    }
+  }
+
+  return true;
+}
+
+
+bool initCollectingErrors(int* argcPtr, const char* argv[],
+                          vector<FlagError>* errors) {
+  assert(errors);
+  collectedErrors = errors;
+  bool wasSuccessful = init(argcPtr, argv);
+  collectedErrors = nullptr;
+  return wasSuccessful;
 }
 
 
@@ -221,9 +956,203 @@ void setOutputStream(ostream* outputStream) {
 }
 
 
+void setNumberSyntax(const NumberSyntax& numberSyntax) {
+  numberSyntaxOptions = numberSyntax;
+}
+
+
+void setStaticFlagIndex(const StaticFlagIndex& staticIndex) {
+  assert(!hasBeenInitialized);
+  registry().setStaticIndex(staticIndex);
+}
+
+
+void setEnvironmentPrefix(const string& prefix) {
+  assert(!hasBeenInitialized);
+  environmentPrefix = prefix;
+}
+
+
+void setValidationThreadCount(int threadCount) {
+  assert(threadCount >= 1);
+  validationThreadCount = threadCount;
+}
+
+
+void setInitProfiling(bool isEnabled, int64 (*allocationCount)()) {
+  assert(!hasBeenInitialized);
+  isInitProfilingEnabled = isEnabled;
+  allocationCounter = allocationCount;
+}
+
+
+const InitProfile& initProfile() {
+  return profile;
+}
+
+
+void printInitProfile(const InitProfile& profileToPrint, ostream* stream,
+                      size_t topCount) {
+  *stream << "Flags init() profile: " << profileToPrint.registeredFlagCount
+          << " flags registered, " << profileToPrint.flags.size() << " set."
+          << endl;
+  *stream << "  phase                 time  allocations" << endl;
+  outputPhase("registration", profileToPrint.registration, stream);
+  outputPhase("environment", profileToPrint.environment, stream);
+  outputPhase("args", profileToPrint.args, stream);
+  outputPhase("validation", profileToPrint.validation, stream);
+  outputPhase("total", profileToPrint.total, stream);
+
+  const char header[] =
+      "         total       parse    validate  values  flag";
+  size_t flagCount = std::min(topCount, profileToPrint.flags.size());
+  *stream << "Most expensive flags:" << endl << header << endl;
+  for (size_t i = 0; i < flagCount; ++i) {
+    outputFlagProfile(profileToPrint.flags[i], stream);
+  }
+
+  vector<const FlagInitProfile*> validatedFlags;
+  for (const FlagInitProfile& flagTimes : profileToPrint.flags) {
+    if (flagTimes.validationTime.count() > 0) {
+      validatedFlags.push_back(&flagTimes);
+    }
+  }
+  std::stable_sort(validatedFlags.begin(), validatedFlags.end(),
+      [](const FlagInitProfile* a, const FlagInitProfile* b) {
+        return a->validationTime > b->validationTime;
+      });
+  flagCount = std::min(topCount, validatedFlags.size());
+  *stream << "Slowest validators:" << endl << header << endl;
+  for (size_t i = 0; i < flagCount; ++i) {
+    outputFlagProfile(*validatedFlags[i], stream);
+  }
+}
+
+
+vector<FlagReadCount> flagReadCounts() {
+  vector<FlagReadCount> readCounts;
+  for (const FlagRegistry::Entry& entry : registry().sortedEntries()) {
+    readCounts.push_back(FlagReadCount{entry.flag, entry.flag->readCount()});
+  }
+
+  // Entries are sorted by name, which stays the order among equal counts.
+  std::stable_sort(readCounts.begin(), readCounts.end(),
+      [](const FlagReadCount& a, const FlagReadCount& b) {
+        return a.readCount > b.readCount;
+      });
+  return readCounts;
+}
+
+
+void printFlagReadCounts(const vector<FlagReadCount>& readCounts,
+                         ostream* stream, size_t topCount) {
+  size_t readFlagCount = 0;
+  for (const FlagReadCount& flagReads : readCounts) {
+    if (flagReads.readCount > 0) {
+      ++readFlagCount;
+    }
+  }
+
+  *stream << "Flag reads: " << readCounts.size() << " flags, "
+          << readFlagCount << " read." << endl;
+  *stream << "                 reads  flag" << endl;
+  size_t flagCount = (topCount == 0)
+      ? readCounts.size() : std::min(topCount, readCounts.size());
+  for (size_t i = 0; i < flagCount; ++i) {
+    *stream << "  " << std::setw(20) << readCounts[i].readCount << "  --"
+            << readCounts[i].flag->name() << endl;
+  }
+}
+
+
+bool publishToSharedMemory(const string& segmentName) {
+  std::lock_guard<std::mutex> lock(publisherMutex);
+  assert(!publisher);
+
+  // Route changes to the publisher before reading values, so that a change
+  // made while publishing waits for this lock instead of being missed.
+  isPublishing.store(true);
+  vector<const AbstractFlag*> flags;
+  for (auto& entry : registry().sortedEntries()) {
+    flags.push_back(entry.flag);
+  }
+
+  unique_ptr<SharedFlagsPublisher> newPublisher(new SharedFlagsPublisher());
+  string errorMsg;
+  if (!newPublisher->publish(segmentName, flags, &errorMsg)) {
+    *output << "Could not publish flags to shared memory: " << errorMsg
+            << endl;
+    isPublishing.store(false);
+    return false;
+  }
+
+  publisher = std::move(newPublisher);
+  return true;
+}
+
+
+void stopPublishingToSharedMemory() {
+  std::lock_guard<std::mutex> lock(publisherMutex);
+  isPublishing.store(false);
+  publisher.reset();
+}
+
+
+FlagChangeSubscription& FlagChangeSubscription::operator=(
+    FlagChangeSubscription&& other) {
+  if (this != &other) {
+    unsubscribe();
+    id_ = other.id_;
+    other.id_ = 0;
+  }
+  return *this;
+}
+
+
+void FlagChangeSubscription::unsubscribe() {
+  if (id_ != 0) {
+    changeNotifier().unsubscribe(id_);
+    id_ = 0;
+  }
+}
+
+
+FlagChangeSubscription subscribeToFlagChanges(
+    FlagChangeListener listener, vector<const AbstractFlag*> flags) {
+  return FlagChangeSubscription(
+      changeNotifier().subscribe(std::move(listener), std::move(flags)));
+}
+
+
+bool writeFlagSnapshot(const string& path) {
+  string errorMsg;
+  if (!writeFlagSnapshotFile(path, registry().sortedEntries(), &errorMsg)) {
+    *output << "Could not write flag snapshot " << path << ": " << errorMsg
+            << endl;
+    return false;
+  }
+
+  return true;
+}
+
+
 void resetForTest() {
+  stopPublishingToSharedMemory();
+  changeNotifier().stop();
   hasBeenInitialized = false;
-  flagMap().clear();
+  currentLocation = nullptr;
+  flagArgIndices.clear();
+  flagFileArgIndices.clear();
+  validationThreadCount = 1;
+  environmentPrefix.clear();
+  isInitProfilingEnabled = false;
+  allocationCounter = nullptr;
+  profile = InitProfile();
+  resetFlagReadCounts();
+  collectedErrors = nullptr;
+  errorText.str("");
+  numberSyntaxOptions = NumberSyntax();
+  registry().clear();
 }
 
 
@@ -232,24 +1161,307 @@ ostream& FlagsInternal::outputStream() {
 }
 
 
+ostream& FlagsInternal::errorStream() {
+  return errorOutput();
+}
+
+
+const NumberSyntax& FlagsInternal::numberSyntax() {
+  return numberSyntaxOptions;
+}
+
+
+bool FlagsInternal::isProfilingInit() {
+  return isProfiling.load(std::memory_order_relaxed);
+}
+
+
+void FlagsInternal::recordValidationTime(const AbstractFlag* flag,
+                                         nanoseconds time) {
+  std::lock_guard<std::mutex> lock(profileMutex);
+  flagProfile(flag).validationTime += time;
+}
+
+
+void FlagsInternal::countRead(std::atomic<uint32>* counterIndex) {
+  countFlagRead(counterIndex);
+}
+
+
+uint64 FlagsInternal::readCount(uint32 counterIndex) {
+  return flagReadCount(counterIndex);
+}
+
+
 void FlagsInternal::registerFlag(AbstractFlag* flag) {
-  assert(flag);
-  assert(flagMap().count(flag->name()) == 0);
+  registry().add(flag);
+}
+
 
-  flagMap()[flag->name()] = flag;
+void FlagsInternal::valueChanged(const AbstractFlag* flag) {
+  if (changeNotifier().hasListeners()) {
+    changeNotifier().valueChanged(flag);
+  }
+
+  if (!isPublishing.load(std::memory_order_relaxed)) {
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock(publisherMutex);
+  if (publisher) {
+    publisher->valueChanged(flag);
+  }
+}
+
+
+void FlagsInternal::beginValueChangeBatch() {
+  changeNotifier().beginBatch();
+}
+
+
+void FlagsInternal::endValueChangeBatch() {
+  changeNotifier().endBatch();
+}
+
+
+bool FlagsInternal::shouldDeferValidation(bool hasValidators) {
+  return pendingValidations && (hasValidators || isStagingAllValues);
+}
+
+
+void FlagsInternal::deferValidation(unique_ptr<DeferredValidation> validation) {
+  assert(pendingValidations);
+
+  pendingValidations->emplace_back();
+  PendingValidation& pending = pendingValidations->back();
+  pending.validation = std::move(validation);
+
+  // Errors may only be output later, so remember where this value came from.
+  if (currentLocation) {
+    ostringstream location;
+    outputCurrentLocation(location);
+    pending.location = location.str();
+  }
 }
 
 
 bool FlagsInternal::parseValidateAndSet(AbstractFlag* flag,
-                                        const string& fullArg) {
+                                        string_view fullArg) {
   auto equalsIndex = fullArg.find('=');
-  string textValue = (equalsIndex != string::npos)
+  string_view textValue = (equalsIndex != string_view::npos)
       ? fullArg.substr(equalsIndex + 1)
-      : "";
+      : string_view();
 
   return flag->parseValidateAndSet(textValue);
 }
 
 
+bool FlagsInternal::setFlag(string_view fullArg, string_view flagName,
+                            int flagFileDepth) {
+  if ((flagName == FLAG_FILE_FLAG_NAME)
+      || (flagName == FLAG_SNAPSHOT_FLAG_NAME)) {
+    auto equalsIndex = fullArg.find('=');
+    if ((equalsIndex == string_view::npos)
+        || (equalsIndex + 1 == fullArg.length())) {
+      errorOutput() << "Missing file path for --" << flagName << "." << endl;
+      recordError(FlagErrorType::BAD_FLAG_FILE);
+      return false;
+    }
+
+    string path = resolveFlagFilePath(fullArg.substr(equalsIndex + 1));
+    return (flagName == FLAG_FILE_FLAG_NAME)
+        ? parseFlagFile(path, flagFileDepth + 1)
+        : loadFlagSnapshot(path);
+  }
+
+  AbstractFlag* flag = getFlag(flagName);
+  if (!flag) {
+    return false;
+  }
+
+  FlagTimer timer(flag);
+  if (!parseValidateAndSet(flag, fullArg)) {
+    recordError(FlagErrorType::INVALID_VALUE, flagName);
+    return false;
+  }
+
+  return true;
+}
+
+
+bool FlagsInternal::setFlagsFromEnvironment() {
+  // Stop at the first error, unless collecting all of them.
+  bool wasSuccessful = true;
+  char** variables = environmentVariables();  // Null if none.
+  for (char** variable = variables; variable && *variable; ++variable) {
+    if (!wasSuccessful && !collectedErrors) {
+      break;
+    }
+
+    // Skip other variables by prefix alone, without any flag lookup.
+    string_view entry = *variable;
+    if (entry.substr(0, environmentPrefix.length()) != environmentPrefix) {
+      continue;
+    }
+
+    // Flag name is the rest of the variable name (up to the equals sign), so
+    // entry can be parsed just like an arg, with errors naming the variable.
+    string_view variableName = entry.substr(0, entry.find('='));
+    string_view flagName = variableName.substr(environmentPrefix.length());
+    if (flagName.empty()) {
+      continue;  // Just the prefix (e.g. FLAGS_=x) names no flag.
+    }
+    FlagFileLocation location = {variableName, 0};
+    currentLocation = &location;
+    if (!setFlag(entry, flagName, 0)) {
+      wasSuccessful = false;
+    }
+    currentLocation = nullptr;
+  }
+
+  return wasSuccessful;
+}
+
+
+bool FlagsInternal::parseFlagFile(string_view path, int flagFileDepth) {
+  if (flagFileDepth > MAX_FLAG_FILE_DEPTH) {
+    errorOutput() << "Flag files nested too deeply (is there a cycle?): "
+                  << path << endl;
+    recordError(FlagErrorType::BAD_FLAG_FILE);
+    return false;
+  }
+
+  if (readFlagFilePaths) {
+    readFlagFilePaths->emplace_back(path);
+  }
+
+  // A reload can race with edits, so it reads a copy instead of a mapping.
+  MappedFile file;
+  string errorMsg;
+  bool wasOpened = isReloading ? file.read(string(path), &errorMsg)
+                               : file.open(string(path), &errorMsg);
+  if (!wasOpened) {
+    errorOutput() << "Could not read flag file " << path << ": " << errorMsg
+                  << endl;
+    recordError(FlagErrorType::BAD_FLAG_FILE);
+    return false;
+  }
+
+  // Report errors at this file's lines until done, then restore includer's.
+  const FlagFileLocation* includingLocation = currentLocation;
+  FlagFileLocation location = {path, 0};
+  currentLocation = &location;
+
+  // Parse in place, one line at a time; values are only copied once stored.
+  // Stop at the first error, unless collecting all of them.
+  bool wasSuccessful = true;
+  string_view remaining = file.contents();
+  while ((wasSuccessful || collectedErrors) && !remaining.empty()) {
+    auto lineEndIndex = remaining.find('\n');
+    string_view line = trimWhitespace(remaining.substr(0, lineEndIndex));
+    remaining = (lineEndIndex != string_view::npos)
+        ? remaining.substr(lineEndIndex + 1)
+        : string_view();
+    ++location.lineNumber;
+
+    // Skip blank lines and comments.
+    if (line.empty() || (line.front() == '#')) {
+      continue;
+    }
+
+    string_view flagName = getFlagName(line);
+    if (flagName.empty()) {
+      errorOutput() << "Expected --flag or --flag=value, but got: " << line
+                    << endl;
+      recordError(FlagErrorType::BAD_FLAG_FILE);
+      wasSuccessful = false;
+      continue;
+    }
+
+    if (!setFlag(line, flagName, flagFileDepth)) {
+      wasSuccessful = false;
+    }
+  }
+
+  currentLocation = includingLocation;
+  return wasSuccessful;
+}
+
+
+bool FlagsInternal::writeFlagUsage(const string& path,
+                                   bool isCountingReads) {
+  string errorMsg;
+  if (!writeFlagUsageFile(path, registry().sortedEntries(), isCountingReads,
+                          &errorMsg)) {
+    *output << "Could not write flag usage " << path << ": " << errorMsg
+            << endl;
+    return false;
+  }
+
+  return true;
+}
+
+
+bool FlagsInternal::loadFlagSnapshot(const string& path) {
+  if (readFlagFilePaths) {
+    readFlagFilePaths->push_back(path);
+  }
+
+  FlagSnapshotFile snapshot;
+  string errorMsg;
+  if (!snapshot.open(path, &errorMsg)) {
+    errorOutput() << "Could not read flag snapshot " << path << ": "
+                  << errorMsg << endl;
+    recordError(FlagErrorType::BAD_FLAG_FILE);
+    return false;
+  }
+
+  // Report errors at this snapshot until done, then restore includer's.
+  const FlagFileLocation* includingLocation = currentLocation;
+  FlagFileLocation location = {path, 0};
+  currentLocation = &location;
+
+  // If the flags are unchanged since the snapshot was written, binary values
+  // can be bound to them directly, without parsing, and records (written in
+  // name order) line up with sorted entries, without looking up names.
+  const vector<FlagRegistry::Entry>& entries = registry().sortedEntries();
+  bool isSameSchema = (snapshot.size() == entries.size())
+      && (snapshot.schemaHash() == flagSchemaHash(entries));
+
+  // Stop at the first error, unless collecting all of them.
+  bool wasSuccessful = true;
+  for (size_t i = 0; (wasSuccessful || collectedErrors)
+                     && (i < snapshot.size()); ++i) {
+    FlagSnapshotFile::Record record = snapshot.record(i);
+    if (!record.hasValue) {
+      continue;
+    }
+
+    // Names are still compared, which is cheap, in case of a hash collision.
+    AbstractFlag* flag = (isSameSchema && (entries[i].name == record.name))
+        ? entries[i].flag : getFlag(record.name);
+    if (!flag) {
+      wasSuccessful = false;
+      continue;
+    }
+
+    FlagTimer timer(flag);
+    bool isValid;
+    bool wasBound = isSameSchema && record.hasBinaryValue
+        && flag->setFromSnapshotValue(record.binaryValue, &isValid);
+    if (!wasBound) {
+      isValid = flag->parseValidateAndSet(record.textValue);
+    }
+    if (!isValid) {
+      recordError(FlagErrorType::INVALID_VALUE, record.name);
+      wasSuccessful = false;
+    }
+  }
+
+  currentLocation = includingLocation;
+  return wasSuccessful;
+}
+
+
 }  // namespace flags
 }  // namespace oomuse
@@ -0,0 +1,150 @@
+/**
+ * Copyright 2015 Eric W. Barndollar. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "oomuse/flags/list_parsing.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <string_view>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#define OOMUSE_FLAGS_HAS_SSE2 1
+#include <emmintrin.h>
+#endif
+
+// AVX2 code is compiled separately and only used if the CPU supports it.
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define OOMUSE_FLAGS_HAS_AVX2 1
+#include <immintrin.h>
+#endif
+
+using std::size_t;
+using std::string_view;
+
+namespace oomuse {
+namespace flags {
+namespace {
+
+
+/** Finds delimiters in a full LIST_BLOCK_SIZE block of text. */
+using FindBlockDelimiters = uint64 (*)(const char* text, char delimiter);
+
+
+uint64 findDelimitersScalar(const char* text, size_t size, char delimiter) {
+  uint64 delimiters = 0;
+  for (size_t i = 0; i < size; ++i) {
+    if (text[i] == delimiter) {
+      delimiters |= (uint64(1) << i);
+    }
+  }
+  return delimiters;
+}
+
+
+#if defined(OOMUSE_FLAGS_HAS_SSE2)
+uint64 findBlockDelimitersSse2(const char* text, char delimiter) {
+  const __m128i delimiters = _mm_set1_epi8(delimiter);
+  uint64 mask = 0;
+  for (size_t i = 0; i < LIST_BLOCK_SIZE; i += 16) {
+    __m128i chars =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(text + i));
+    uint32 matches = static_cast<uint32>(
+        _mm_movemask_epi8(_mm_cmpeq_epi8(chars, delimiters)));
+    mask |= (uint64(matches) << i);
+  }
+  return mask;
+}
+#endif
+
+
+#if defined(OOMUSE_FLAGS_HAS_AVX2)
+__attribute__((target("avx2")))
+uint64 findBlockDelimitersAvx2(const char* text, char delimiter) {
+  const __m256i delimiters = _mm256_set1_epi8(delimiter);
+  __m256i low = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(text));
+  __m256i high =
+      _mm256_loadu_si256(reinterpret_cast<const __m256i*>(text + 32));
+  uint32 lowMatches = static_cast<uint32>(
+      _mm256_movemask_epi8(_mm256_cmpeq_epi8(low, delimiters)));
+  uint32 highMatches = static_cast<uint32>(
+      _mm256_movemask_epi8(_mm256_cmpeq_epi8(high, delimiters)));
+  return uint64(lowMatches) | (uint64(highMatches) << 32);
+}
+#endif
+
+
+/** Returns the fastest block search this CPU supports, or null if none. */
+FindBlockDelimiters chooseFindBlockDelimiters() {
+#if defined(OOMUSE_FLAGS_HAS_AVX2)
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) {
+    return findBlockDelimitersAvx2;
+  }
+#endif
+#if defined(OOMUSE_FLAGS_HAS_SSE2)
+  return findBlockDelimitersSse2;
+#else
+  return nullptr;
+#endif
+}
+
+
+/** Returns number of set bits in mask. */
+size_t countBits(uint64 mask) {
+#if defined(__GNUC__)
+  return static_cast<size_t>(__builtin_popcountll(mask));
+#else
+  size_t count = 0;
+  for (; mask != 0; mask &= mask - 1) {
+    ++count;
+  }
+  return count;
+#endif
+}
+
+
+}  // namespace
+
+
+uint64 findDelimiters(const char* text, size_t size, char delimiter) {
+  // Chosen once, on first use (which may be during static initialization).
+  static const FindBlockDelimiters findBlockDelimiters =
+      chooseFindBlockDelimiters();
+
+  if ((size == LIST_BLOCK_SIZE) && findBlockDelimiters) {
+    return findBlockDelimiters(text, delimiter);
+  }
+  return findDelimitersScalar(text, size, delimiter);
+}
+
+
+size_t countListItems(string_view text, char delimiter) {
+  if (text.empty()) {
+    return 0;
+  }
+
+  size_t itemCount = 1;
+  for (size_t start = 0; start < text.size(); start += LIST_BLOCK_SIZE) {
+    size_t blockSize = std::min(LIST_BLOCK_SIZE, text.size() - start);
+    itemCount += countBits(findDelimiters(text.data() + start, blockSize,
+                                          delimiter));
+  }
+  return itemCount;
+}
+
+
+}  // namespace flags
+}  // namespace oomuse
@@ -0,0 +1,329 @@
+/**
+ * Copyright 2015 Eric W. Barndollar. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "oomuse/flags/number_parsing.h"
+
+#include <charconv>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <ostream>
+#include <string_view>
+#include <system_error>
+#include <type_traits>
+
+#if !defined(__cpp_lib_to_chars)
+#include <cerrno>
+#include <cstdlib>
+#endif
+
+using std::numeric_limits;
+using std::size_t;
+using std::string_view;
+
+namespace oomuse {
+namespace flags {
+namespace {
+
+
+/** Characters skipped at either end of a numeric value. */
+const char WHITESPACE[] = " \t\n\v\f\r";
+
+/**
+ * Size of the stack buffer used when digits must be copied (to drop digit
+ * separators, or to null-terminate for the strtod() fallback). Longer values
+ * are rejected.
+ */
+const size_t MAX_COPIED_LENGTH = 256;
+
+
+/** Removes a leading + or - sign from *text, returning true if negative. */
+bool consumeSign(string_view* text) {
+  if (text->empty() || ((text->front() != '+') && (text->front() != '-'))) {
+    return false;
+  }
+
+  bool isNegative = (text->front() == '-');
+  text->remove_prefix(1);
+  return isNegative;
+}
+
+
+/** Removes any 0x, 0o, or 0b prefix from *text, returning the radix. */
+int consumeRadixPrefix(string_view* text) {
+  if ((text->size() < 2) || ((*text)[0] != '0')) {
+    return 10;
+  }
+
+  int radix = 10;
+  switch ((*text)[1]) {
+    case 'x': case 'X': radix = 16; break;
+    case 'o': case 'O': radix = 8; break;
+    case 'b': case 'B': radix = 2; break;
+    default: return 10;
+  }
+
+  text->remove_prefix(2);
+  return radix;
+}
+
+
+/** Returns true if text equals lowercaseText, ignoring case of text. */
+bool equalsIgnoringCase(string_view text, string_view lowercaseText) {
+  if (text.size() != lowercaseText.size()) {
+    return false;
+  }
+
+  for (size_t i = 0; i < text.size(); ++i) {
+    char c = text[i];
+    char lowercaseC = ((c >= 'A') && (c <= 'Z')) ? static_cast<char>(c + 32)
+                                                 : c;
+    if (lowercaseC != lowercaseText[i]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+
+bool isAlphanumeric(char c) {
+  return ((c >= '0') && (c <= '9')) || ((c >= 'a') && (c <= 'z'))
+      || ((c >= 'A') && (c <= 'Z'));
+}
+
+
+/**
+ * If *text has _ digit separators, copies it without them into buffer and
+ * points *text there instead. Returns false if any separator isn't directly
+ * between two digits or if the value is too long to copy.
+ */
+bool removeDigitSeparators(string_view* text,
+                           char (&buffer)[MAX_COPIED_LENGTH]) {
+  if (text->find('_') == string_view::npos) {
+    return true;
+  }
+  if (text->size() > MAX_COPIED_LENGTH) {
+    return false;
+  }
+
+  size_t length = 0;
+  for (size_t i = 0; i < text->size(); ++i) {
+    char c = (*text)[i];
+    if (c != '_') {
+      buffer[length++] = c;
+      continue;
+    }
+
+    bool isBetweenDigits = (i > 0) && (i + 1 < text->size())
+        && isAlphanumeric((*text)[i - 1]) && isAlphanumeric((*text)[i + 1]);
+    if (!isBetweenDigits) {
+      return false;
+    }
+  }
+
+  *text = string_view(buffer, length);
+  return true;
+}
+
+
+/** Parses all of text as an unsigned magnitude in the given radix. */
+bool parseMagnitude(string_view text, int radix, uint64* magnitude) {
+  const char* end = text.data() + text.size();
+  auto result = std::from_chars(text.data(), end, *magnitude, radix);
+  return (result.ec == std::errc()) && (result.ptr == end);
+}
+
+
+template<typename Int>
+bool parseInteger(string_view text, Int* value, const NumberSyntax& syntax) {
+  static_assert(std::is_signed<Int>::value, "Only signed types supported");
+
+  text = trimWhitespace(text);
+  bool isNegative = consumeSign(&text);
+  int radix = syntax.allowRadixPrefixes ? consumeRadixPrefix(&text) : 10;
+
+  char buffer[MAX_COPIED_LENGTH];
+  if (syntax.allowDigitSeparators && !removeDigitSeparators(&text, buffer)) {
+    return false;
+  }
+
+  // Parse magnitude separately from sign so that sign can precede a prefix.
+  uint64 magnitude;
+  if (!parseMagnitude(text, radix, &magnitude)) {
+    return false;
+  }
+
+  const uint64 maxPositive = static_cast<uint64>(numeric_limits<Int>::max());
+  if (magnitude > (isNegative ? maxPositive + 1 : maxPositive)) {
+    return false;
+  }
+
+  if (isNegative && (magnitude > 0)) {
+    // Negate via (magnitude - 1) so that the minimum value can't overflow.
+    *value = static_cast<Int>(-static_cast<Int>(magnitude - 1) - 1);
+  } else {
+    *value = static_cast<Int>(magnitude);
+  }
+  return true;
+}
+
+
+#if defined(__cpp_lib_to_chars)
+
+template<typename Float>
+bool parseUnsignedFloat(string_view text, Float* value) {
+  const char* end = text.data() + text.size();
+  auto result = std::from_chars(text.data(), end, *value,
+                                std::chars_format::general);
+  return (result.ec == std::errc()) && (result.ptr == end);
+}
+
+#else  // Fall back to strtof() and strtod(), which need null termination.
+
+float convertWithStrto(const char* text, char** end, float*) {
+  return std::strtof(text, end);
+}
+
+
+double convertWithStrto(const char* text, char** end, double*) {
+  return std::strtod(text, end);
+}
+
+
+template<typename Float>
+bool parseUnsignedFloat(string_view text, Float* value) {
+  // Unlike from_chars, strto*() also accepts hex floats.
+  if ((text.size() >= MAX_COPIED_LENGTH)
+      || (text.find_first_of("xX") != string_view::npos)) {
+    return false;
+  }
+
+  char buffer[MAX_COPIED_LENGTH];
+  text.copy(buffer, text.size());
+  buffer[text.size()] = '\0';
+
+  char* end = nullptr;
+  errno = 0;
+  *value = convertWithStrto(buffer, &end, value);
+  return (errno == 0) && (end == buffer + text.size());
+}
+
+#endif  // defined(__cpp_lib_to_chars)
+
+
+template<typename Float>
+bool parseFloatingPoint(string_view text, Float* value,
+                        const NumberSyntax& syntax) {
+  text = trimWhitespace(text);
+  bool isNegative = consumeSign(&text);
+
+  // Reject anything but digits after the sign (such as a second sign).
+  if (text.empty()
+      || ((text.front() != '.') && !isAlphanumeric(text.front()))) {
+    return false;
+  }
+
+  char buffer[MAX_COPIED_LENGTH];
+  if (syntax.allowDigitSeparators && !removeDigitSeparators(&text, buffer)) {
+    return false;
+  }
+
+  Float magnitude;
+  if (!parseUnsignedFloat(text, &magnitude) || !std::isfinite(magnitude)) {
+    return false;
+  }
+
+  *value = isNegative ? -magnitude : magnitude;
+  return true;
+}
+
+
+/** Outputs value in the fewest digits that parse back to exactly it. */
+template<typename Float>
+void outputFloatingPoint(Float value, std::ostream* output) {
+#if defined(__cpp_lib_to_chars)
+  char buffer[64];
+  auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+  output->write(buffer, result.ptr - buffer);
+#else  // Not always the fewest digits, but still lossless.
+  std::streamsize oldPrecision =
+      output->precision(numeric_limits<Float>::max_digits10);
+  *output << value;
+  output->precision(oldPrecision);
+#endif  // defined(__cpp_lib_to_chars)
+}
+
+
+}  // namespace
+
+
+string_view trimWhitespace(string_view text) {
+  auto start = text.find_first_not_of(WHITESPACE);
+  if (start == string_view::npos) {
+    return string_view();
+  }
+
+  auto end = text.find_last_not_of(WHITESPACE);
+  return text.substr(start, end - start + 1);
+}
+
+
+bool parseBool(string_view text, bool* value) {
+  text = trimWhitespace(text);
+  if (text.empty() || equalsIgnoringCase(text, "true")) {
+    *value = true;
+    return true;
+  } else if (equalsIgnoringCase(text, "false")) {
+    *value = false;
+    return true;
+  }
+
+  return false;
+}
+
+
+bool parseNumber(string_view text, int32* value, const NumberSyntax& syntax) {
+  return parseInteger(text, value, syntax);
+}
+
+
+bool parseNumber(string_view text, int64* value, const NumberSyntax& syntax) {
+  return parseInteger(text, value, syntax);
+}
+
+
+bool parseNumber(string_view text, float* value, const NumberSyntax& syntax) {
+  return parseFloatingPoint(text, value, syntax);
+}
+
+
+bool parseNumber(string_view text, double* value, const NumberSyntax& syntax) {
+  return parseFloatingPoint(text, value, syntax);
+}
+
+
+void outputNumber(float value, std::ostream* output) {
+  outputFloatingPoint(value, output);
+}
+
+
+void outputNumber(double value, std::ostream* output) {
+  outputFloatingPoint(value, output);
+}
+
+
+}  // namespace flags
+}  // namespace oomuse
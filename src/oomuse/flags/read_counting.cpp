@@ -0,0 +1,191 @@
+/**
+ * Copyright 2015 Eric W. Barndollar. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "oomuse/flags/read_counting.h"
+
+#include <mutex>
+#include <vector>
+
+using std::vector;
+
+namespace oomuse {
+namespace flags {
+
+
+namespace {
+
+
+/** Each shard's counters are allocated in chunks of this many. */
+const uint32 CHUNK_SIZE = 4096;
+
+/** Chunks per shard, so counter indices past about 4 million aren't counted. */
+const uint32 MAX_CHUNK_COUNT = 1024;
+
+
+/**
+ * One thread's counters, allocated as needed, which only the thread leasing
+ * the shard writes to.
+ */
+struct Shard {
+  std::atomic<std::atomic<uint64>*> chunks[MAX_CHUNK_COUNT] = {};
+};
+
+
+/** All shards, including those free for reuse since their threads exited. */
+struct ShardPool {
+  std::mutex mutex;  // Guards shards and freeShards.
+  vector<Shard*> shards;
+  vector<Shard*> freeShards;
+  std::atomic<uint32> nextCounterIndex{1};
+};
+
+
+ShardPool& shardPool() {
+  // Never destroyed, since threads may still read flags during static
+  // destruction (so no shards or chunks are ever freed either).
+  static ShardPool* theShardPool = new ShardPool();
+  return *theShardPool;
+}
+
+
+/**
+ * This thread's shard, taken from the pool when first needed and given back
+ * when the thread exits, keeping its counts for the next thread to add to.
+ */
+class ShardLease {
+ public:
+  ShardLease() {}
+
+  ~ShardLease() {
+    if (shard_) {
+      ShardPool& pool = shardPool();
+      std::lock_guard<std::mutex> lock(pool.mutex);
+      pool.freeShards.push_back(shard_);
+      shard_ = nullptr;
+    }
+  }
+
+  Shard* shard() {
+    if (!shard_) {
+      shard_ = takeShard();
+    }
+    return shard_;
+  }
+
+ private:
+  static Shard* takeShard() {
+    ShardPool& pool = shardPool();
+    std::lock_guard<std::mutex> lock(pool.mutex);
+    if (!pool.freeShards.empty()) {
+      Shard* shard = pool.freeShards.back();
+      pool.freeShards.pop_back();
+      return shard;
+    }
+
+    pool.shards.push_back(new Shard());
+    return pool.shards.back();
+  }
+
+  Shard* shard_ = nullptr;
+};
+
+
+thread_local ShardLease threadShard;
+
+
+/** Assigns a counter index to a flag's first counted read, returning it. */
+uint32 assignCounterIndex(std::atomic<uint32>* counterIndex) {
+  uint32 newIndex = shardPool().nextCounterIndex.fetch_add(
+      1, std::memory_order_relaxed);
+  uint32 index = 0;
+  if (counterIndex->compare_exchange_strong(index, newIndex,
+                                            std::memory_order_relaxed)) {
+    return newIndex;
+  }
+  return index;  // Another thread's read assigned one first.
+}
+
+
+}  // namespace
+
+
+void countFlagRead(std::atomic<uint32>* counterIndex) {
+  uint32 index = counterIndex->load(std::memory_order_relaxed);
+  if (index == 0) {
+    index = assignCounterIndex(counterIndex);
+  }
+  uint32 chunkIndex = index / CHUNK_SIZE;
+  if (chunkIndex >= MAX_CHUNK_COUNT) {
+    return;
+  }
+
+  Shard* shard = threadShard.shard();
+  std::atomic<uint64>* chunk =
+      shard->chunks[chunkIndex].load(std::memory_order_relaxed);
+  if (!chunk) {
+    chunk = new std::atomic<uint64>[CHUNK_SIZE]();
+    shard->chunks[chunkIndex].store(chunk, std::memory_order_release);
+  }
+
+  // Only this thread writes to its shard, so a plain load and store suffice.
+  std::atomic<uint64>& count = chunk[index % CHUNK_SIZE];
+  count.store(count.load(std::memory_order_relaxed) + 1,
+              std::memory_order_relaxed);
+}
+
+
+uint64 flagReadCount(uint32 counterIndex) {
+  uint32 chunkIndex = counterIndex / CHUNK_SIZE;
+  if ((counterIndex == 0) || (chunkIndex >= MAX_CHUNK_COUNT)) {
+    return 0;
+  }
+
+  ShardPool& pool = shardPool();
+  std::lock_guard<std::mutex> lock(pool.mutex);
+  uint64 readCount = 0;
+  for (const Shard* shard : pool.shards) {
+    const std::atomic<uint64>* chunk =
+        shard->chunks[chunkIndex].load(std::memory_order_acquire);
+    if (chunk) {
+      readCount += chunk[counterIndex % CHUNK_SIZE].load(
+          std::memory_order_relaxed);
+    }
+  }
+  return readCount;
+}
+
+
+void resetFlagReadCounts() {
+  ShardPool& pool = shardPool();
+  std::lock_guard<std::mutex> lock(pool.mutex);
+  for (Shard* shard : pool.shards) {
+    for (auto& chunkPointer : shard->chunks) {
+      std::atomic<uint64>* chunk =
+          chunkPointer.load(std::memory_order_acquire);
+      if (!chunk) {
+        continue;
+      }
+
+      for (uint32 i = 0; i < CHUNK_SIZE; ++i) {
+        chunk[i].store(0, std::memory_order_relaxed);
+      }
+    }
+  }
+}
+
+
+}  // namespace flags
+}  // namespace oomuse
@@ -0,0 +1,49 @@
+/**
+ * Copyright 2015 Eric W. Barndollar. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef OOMUSE_FLAGS_READ_COUNTING_H
+#define OOMUSE_FLAGS_READ_COUNTING_H
+
+#include <atomic>
+
+#include "oomuse/core/int_types.h"
+
+namespace oomuse {
+namespace flags {
+
+
+/**
+ * Internal counting of flag value reads (see flagReadCounts()). Each thread
+ * increments its own shard of counters, without any atomic read-modify-write
+ * or shared cache lines, and shards are only summed when counts are wanted.
+ * A flag's counter index is assigned on its first counted read (0 means none
+ * yet), so that uncounted flags cost nothing.
+ */
+
+/** Counts one read of the flag with given counter index. */
+void countFlagRead(std::atomic<uint32>* counterIndex);
+
+/** Returns reads counted for given counter index, summed over all threads. */
+uint64 flagReadCount(uint32 counterIndex);
+
+/** Sets every count back to 0 (counter indices stay assigned). */
+void resetFlagReadCounts();
+
+
+}  // namespace flags
+}  // namespace oomuse
+
+#endif  // OOMUSE_FLAGS_READ_COUNTING_H
@@ -0,0 +1,92 @@
+/**
+ * Copyright 2015 Eric W. Barndollar. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef OOMUSE_FLAGS_SHARED_FLAGS_LAYOUT_H
+#define OOMUSE_FLAGS_SHARED_FLAGS_LAYOUT_H
+
+#include <atomic>
+#include <string>
+
+#include "oomuse/core/int_types.h"
+
+namespace oomuse {
+namespace flags {
+
+
+/**
+ * Internal layout of a shared-memory segment of published flags:
+ *
+ *   SharedFlagsHeader
+ *   SharedFlagRecord[flagCount]
+ *   Text: each flag's name, type name, and default value (never changes).
+ *   Values: each flag's current value, in a fixed-capacity slot.
+ *
+ * All offsets are in bytes from the start of the segment. Readers take
+ * consistent snapshots with the header's sequence number as a seqlock: the
+ * writer makes it odd while changing anything, then even again after.
+ */
+struct SharedFlagsHeader {
+  char magic[8];
+  uint32 layoutVersion;
+  uint32 flagCount;
+  std::atomic<uint64> sequence;
+  uint64 segmentSize;
+};
+
+
+/** Where to find one published flag's info. */
+struct SharedFlagRecord {
+  uint32 nameOffset;
+  uint32 nameLength;
+  uint32 typeOffset;
+  uint32 typeLength;
+  uint32 defaultValueOffset;
+  uint32 defaultValueLength;
+  uint32 valueOffset;
+  uint32 valueCapacity;
+  uint32 valueLength;
+  uint32 status;  // SharedFlagStatus bits.
+};
+
+
+/** Bits of SharedFlagRecord::status. */
+enum SharedFlagStatus : uint32 {
+  HAS_VALUE = 1,
+  HAS_DEFAULT_VALUE = 2,
+  IS_EXPLICITLY_SET = 4,
+  IS_VALUE_TRUNCATED = 8,  // Value didn't fit in its slot.
+};
+
+
+/** Identifies a segment of published flags. */
+constexpr char SHARED_FLAGS_MAGIC[8] = {'O', 'O', 'M', 'F', 'L', 'A', 'G', 'S'};
+
+/** Incremented on any incompatible change to the layout above. */
+constexpr uint32 SHARED_FLAGS_LAYOUT_VERSION = 1;
+
+/** Minimum capacity of a value slot, so short values can grow a bit. */
+constexpr uint32 MIN_SHARED_VALUE_CAPACITY = 32;
+
+
+/** Returns default segment name for flags published by process pid. */
+inline std::string defaultSharedFlagsName(int64 pid) {
+  return "/oomuse-flags." + std::to_string(pid);
+}
+
+
+}  // namespace flags
+}  // namespace oomuse
+
+#endif  // OOMUSE_FLAGS_SHARED_FLAGS_LAYOUT_H
@@ -0,0 +1,296 @@
+/**
+ * Copyright 2015 Eric W. Barndollar. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "oomuse/flags/unit_parsing.h"
+
+#include <cstddef>
+#include <limits>
+#include <ostream>
+#include <string_view>
+
+#include "oomuse/flags/number_parsing.h"
+
+using std::numeric_limits;
+using std::ostream;
+using std::size_t;
+using std::string_view;
+
+namespace oomuse {
+namespace flags {
+namespace {
+
+
+/** A unit suffix and how many nanoseconds or bytes it stands for. */
+struct Unit {
+  string_view suffix;
+  uint64 scale;
+};
+
+/** Duration units, largest first. */
+const Unit DURATION_UNITS[] = {
+    {"h", 3600000000000ULL},
+    {"m", 60000000000ULL},
+    {"s", 1000000000ULL},
+    {"ms", 1000000ULL},
+    {"us", 1000ULL},
+    {"ns", 1ULL}};
+
+/** Byte size units, largest first. */
+const Unit BYTE_SIZE_UNITS[] = {
+    {"TiB", 1ULL << 40},
+    {"TB", 1000000000000ULL},
+    {"GiB", 1ULL << 30},
+    {"GB", 1000000000ULL},
+    {"MiB", 1ULL << 20},
+    {"MB", 1000000ULL},
+    {"KiB", 1ULL << 10},
+    {"KB", 1000ULL},
+    {"B", 1ULL}};
+
+/**
+ * Most digits allowed after a decimal point, which keeps the fraction's
+ * numerator and denominator below 2^30 (see multiplyDivide()).
+ */
+const size_t MAX_FRACTION_DIGITS = 9;
+
+
+/** An amount like 1.25, as whole + (fraction / fractionScale). */
+struct Amount {
+  uint64 whole = 0;
+  uint64 fraction = 0;
+  uint64 fractionScale = 1;
+};
+
+
+bool isDigit(char c) {
+  return (c >= '0') && (c <= '9');
+}
+
+
+bool isLetter(char c) {
+  return ((c >= 'a') && (c <= 'z')) || ((c >= 'A') && (c <= 'Z'));
+}
+
+
+/**
+ * Removes an amount like "12", "1.5", or ".5" from the front of *text,
+ * returning false if there isn't one or it's out of range.
+ */
+bool consumeAmount(string_view* text, Amount* amount) {
+  *amount = Amount();
+  size_t i = 0;
+  for (; (i < text->size()) && isDigit((*text)[i]); ++i) {
+    uint64 digit = static_cast<uint64>((*text)[i] - '0');
+    if (amount->whole > (numeric_limits<uint64>::max() - digit) / 10) {
+      return false;
+    }
+    amount->whole = (amount->whole * 10) + digit;
+  }
+  size_t digitCount = i;
+
+  if ((i < text->size()) && ((*text)[i] == '.')) {
+    size_t fractionDigitCount = 0;
+    for (++i; (i < text->size()) && isDigit((*text)[i]); ++i) {
+      if (++fractionDigitCount > MAX_FRACTION_DIGITS) {
+        return false;
+      }
+      uint64 digit = static_cast<uint64>((*text)[i] - '0');
+      amount->fraction = (amount->fraction * 10) + digit;
+      amount->fractionScale *= 10;
+    }
+    digitCount += fractionDigitCount;
+  }
+
+  text->remove_prefix(i);
+  return digitCount > 0;
+}
+
+
+/** Removes leading letters from *text, returning them. */
+string_view consumeLetters(string_view* text) {
+  size_t length = 0;
+  while ((length < text->size()) && isLetter((*text)[length])) {
+    ++length;
+  }
+
+  string_view letters = text->substr(0, length);
+  text->remove_prefix(length);
+  return letters;
+}
+
+
+/** Finds scale of unit with given suffix, returning false if none. */
+template<size_t N>
+bool findUnitScale(const Unit (&units)[N], string_view suffix, uint64* scale) {
+  for (const Unit& unit : units) {
+    if (unit.suffix == suffix) {
+      *scale = unit.scale;
+      return true;
+    }
+  }
+  return false;
+}
+
+
+/**
+ * Returns (numerator * scale) / divisor exactly, setting *remainder. The
+ * numerator and divisor must be below 2^30 and scale below 2^42, so the
+ * product can be split at bit 21 with no partial result overflowing.
+ */
+uint64 multiplyDivide(uint64 numerator, uint64 scale, uint64 divisor,
+                      uint64* remainder) {
+  const uint64 lowMask = (uint64(1) << 21) - 1;
+  uint64 highProduct = numerator * (scale >> 21);
+  uint64 lowPart = ((highProduct % divisor) << 21)
+      + (numerator * (scale & lowMask));
+  *remainder = lowPart % divisor;
+  return ((highProduct / divisor) << 21) + (lowPart / divisor);
+}
+
+
+/**
+ * Sets *result to amount in units of given scale, returning false if that
+ * isn't a whole number or is over limit.
+ */
+bool scaleAmount(const Amount& amount, uint64 scale, uint64 limit,
+                 uint64* result) {
+  if (amount.whole > limit / scale) {
+    return false;
+  }
+
+  uint64 remainder;
+  uint64 fractionPart = multiplyDivide(amount.fraction, scale,
+                                       amount.fractionScale, &remainder);
+  uint64 wholePart = amount.whole * scale;
+  if ((remainder != 0) || (fractionPart > limit - wholePart)) {
+    return false;
+  }
+
+  *result = wholePart + fractionPart;
+  return true;
+}
+
+
+/**
+ * Outputs magnitude in the first (largest) unit showing it exactly with at
+ * most two decimal places, or as "0" with zeroSuffix.
+ */
+template<size_t N>
+void outputInUnits(uint64 magnitude, const Unit (&units)[N],
+                   string_view zeroSuffix, ostream* output) {
+  if (magnitude == 0) {
+    *output << '0' << zeroSuffix;
+    return;
+  }
+
+  for (const Unit& unit : units) {
+    uint64 whole = magnitude / unit.scale;
+    uint64 remainder = magnitude % unit.scale;
+    if ((whole == 0) || (((remainder * 100) % unit.scale) != 0)) {
+      continue;  // Scales are below 2^42, so remainder * 100 can't overflow.
+    }
+
+    uint64 hundredths = (remainder * 100) / unit.scale;
+    *output << whole;
+    if (hundredths != 0) {
+      *output << '.' << (hundredths / 10);
+      if ((hundredths % 10) != 0) {
+        *output << (hundredths % 10);
+      }
+    }
+    *output << unit.suffix;
+    return;
+  }
+}
+
+
+}  // namespace
+
+
+bool parseDuration(string_view text, int64* nanoseconds) {
+  text = trimWhitespace(text);
+  bool isNegative = !text.empty() && (text.front() == '-');
+  if (!text.empty() && ((text.front() == '-') || (text.front() == '+'))) {
+    text.remove_prefix(1);
+  }
+
+  if (text == "0") {
+    *nanoseconds = 0;
+    return true;
+  }
+
+  // The most negative value has one more unit of magnitude than the most
+  // positive.
+  const uint64 maxPositive = static_cast<uint64>(numeric_limits<int64>::max());
+  const uint64 limit = isNegative ? maxPositive + 1 : maxPositive;
+
+  uint64 magnitude = 0;
+  do {
+    Amount amount;
+    uint64 scale;
+    uint64 componentNanoseconds;
+    if (!consumeAmount(&text, &amount)
+        || !findUnitScale(DURATION_UNITS, consumeLetters(&text), &scale)
+        || !scaleAmount(amount, scale, limit - magnitude,
+                        &componentNanoseconds)) {
+      return false;
+    }
+    magnitude += componentNanoseconds;
+  } while (!text.empty());
+
+  if (isNegative && (magnitude > 0)) {
+    // Negate via (magnitude - 1) so that the minimum value can't overflow.
+    *nanoseconds = -static_cast<int64>(magnitude - 1) - 1;
+  } else {
+    *nanoseconds = static_cast<int64>(magnitude);
+  }
+  return true;
+}
+
+
+bool parseByteSize(string_view text, uint64* bytes) {
+  text = trimWhitespace(text);
+
+  Amount amount;
+  if (!consumeAmount(&text, &amount)) {
+    return false;
+  }
+
+  uint64 scale = 1;
+  if (!text.empty() && !findUnitScale(BYTE_SIZE_UNITS, text, &scale)) {
+    return false;
+  }
+  return scaleAmount(amount, scale, numeric_limits<uint64>::max(), bytes);
+}
+
+
+void outputDuration(int64 nanoseconds, ostream* output) {
+  uint64 magnitude = static_cast<uint64>(nanoseconds);
+  if (nanoseconds < 0) {
+    *output << '-';
+    magnitude = static_cast<uint64>(-(nanoseconds + 1)) + 1;
+  }
+  outputInUnits(magnitude, DURATION_UNITS, "s", output);
+}
+
+
+void outputByteSize(uint64 bytes, ostream* output) {
+  outputInUnits(bytes, BYTE_SIZE_UNITS, "B", output);
+}
+
+
+}  // namespace flags
+}  // namespace oomuse
@@ -0,0 +1,121 @@
+/**
+ * Copyright 2015 Eric W. Barndollar. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "oomuse/flags/CachedFlagReader.h"
+
+#include <atomic>
+#include <string>
+#include <thread>
+
+#include "gtest/gtest.h"
+#include "oomuse/core/int_types.h"
+#include "oomuse/flags/MutableFlag.h"
+#include "oomuse/flags/flags.h"
+
+using oomuse::CachedFlagReader;
+using oomuse::MutableFlag;
+using std::string;
+using std::thread;
+using testing::Test;
+
+namespace flags = oomuse::flags;
+
+namespace {
+
+
+/** Test fixture for common cached flag reader test setup. */
+class CachedFlagReaderTest : public Test {
+ protected:
+  /** Reset flags library global state before every test. */
+  CachedFlagReaderTest() { flags::resetForTest(); }
+};
+
+
+TEST_F(CachedFlagReaderTest, seesValueAtConstruction) {
+  MutableFlag<int32> batchSizeFlag("batchSize", "Batch size", 16);
+  CachedFlagReader<int32> batchSize(batchSizeFlag);
+
+  EXPECT_EQ(16, batchSize.value());
+  EXPECT_EQ(16, batchSize.value());
+}
+
+
+TEST_F(CachedFlagReaderTest, refreshesAfterAnyMutableFlagChanges) {
+  MutableFlag<string> modeFlag("mode", "Mode", "slow");
+  MutableFlag<int64> otherFlag("other", "Another flag", 1);
+  CachedFlagReader<string> mode(modeFlag);
+  EXPECT_EQ("slow", mode.value());
+
+  ASSERT_TRUE(modeFlag.set("fast"));
+  EXPECT_EQ("fast", mode.value());
+
+  // Changes to other flags just cause a (harmless) refresh.
+  ASSERT_TRUE(otherFlag.set(2));
+  EXPECT_EQ("fast", mode.value());
+
+  // Rejected values don't change anything.
+  uint64 generation = flags::mutableFlagGeneration.count.load();
+  EXPECT_FALSE(otherFlag.setFromText("bad"));
+  EXPECT_EQ(generation, flags::mutableFlagGeneration.count.load());
+}
+
+
+TEST_F(CachedFlagReaderTest, otherThreadsEventuallySeeLatestValue) {
+  MutableFlag<int64> counterFlag("counter", "A counter", 0);
+  std::atomic<bool> sawBackwardsValue(false);
+
+  thread reader([&]() {
+    CachedFlagReader<int64> counter(counterFlag);
+    int64 lastValue = 0;
+    while (lastValue != 1000) {
+      int64 value = counter.value();
+      if (value < lastValue) {
+        sawBackwardsValue.store(true);
+      }
+      lastValue = value;
+    }
+  });
+
+  for (int64 i = 1; i <= 1000; ++i) {
+    ASSERT_TRUE(counterFlag.set(i));
+  }
+  reader.join();
+
+  EXPECT_FALSE(sawBackwardsValue.load());
+}
+
+
+TEST_F(CachedFlagReaderTest, seesBatchedChangesOnlyOnceAllAreSet) {
+  MutableFlag<int32> lowFlag("low", "Low bound", 0);
+  MutableFlag<int32> highFlag("high", "High bound", 10);
+  CachedFlagReader<int32> low(lowFlag);
+  CachedFlagReader<int32> high(highFlag);
+
+  {
+    flags::MutableFlagBatch batch;
+    ASSERT_TRUE(lowFlag.set(20));
+    EXPECT_EQ(0, low.value());
+    ASSERT_TRUE(highFlag.set(30));
+    EXPECT_EQ(0, low.value());
+    EXPECT_EQ(10, high.value());
+  }
+
+  EXPECT_EQ(20, low.value());
+  EXPECT_EQ(30, high.value());
+}
+
+
+}  // namespace
@@ -0,0 +1,156 @@
+/**
+ * Copyright 2015 Eric W. Barndollar. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "oomuse/flags/Checks.h"
+
+#include <string>
+
+#include "gtest/gtest.h"
+#include "oomuse/core/int_types.h"
+#include "oomuse/flags/Flag.h"
+#include "oomuse/flags/InlineCheck.h"
+#include "oomuse/flags/flags.h"
+#include "oomuse/flags/flags_test_util.h"
+
+using oomuse::Checks;
+using oomuse::Flag;
+using oomuse::FlagRequired;
+using oomuse::flags::InlineCheck;
+using oomuse::flags::test::FlagsTestBase;
+using std::string;
+
+namespace flags = oomuse::flags;
+
+namespace {
+
+
+/** Test fixture for common flag checks test setup. */
+class ChecksTest : public FlagsTestBase {};
+
+
+TEST_F(ChecksTest, boundChecksCompareValues) {
+  static_assert(Checks<int32>::greater(0).isValid(1));
+  static_assert(!Checks<int32>::greater(0).isValid(0));
+  static_assert(Checks<int32>::greaterOrEqual(0).isValid(0));
+  static_assert(!Checks<int32>::less(0).isValid(0));
+  static_assert(Checks<int32>::lessOrEqual(0).isValid(0));
+  static_assert(!Checks<int32>::lessOrEqual(0).isValid(1));
+
+  EXPECT_TRUE(Checks<string>::sizeGreaterOrEqual(3).isValid(string("abc")));
+  EXPECT_FALSE(Checks<string>::sizeLessOrEqual(2).isValid(string("abc")));
+}
+
+
+TEST_F(ChecksTest, flagsRunChecks) {
+  Flag<int32> percentFlag("percent", "A percentage",
+                          Checks<int32>::allOf(
+                              Checks<int32>::greaterOrEqual(0),
+                              Checks<int32>::lessOrEqual(100)));
+  Flag<string> usernameFlag("username", "A username", FlagRequired::YES,
+                            Checks<string>::allOf(
+                                Checks<string>::sizeGreaterOrEqual(3),
+                                Checks<string>::sizeLessOrEqual(15)));
+
+  int argc = 3;
+  const char* argv[] = {"App", "--percent=100", "--username=slyfox31",
+                        nullptr};
+  ASSERT_TRUE(flags::init(&argc, argv));
+
+  EXPECT_EQ(100, percentFlag.value());
+  EXPECT_EQ("slyfox31", usernameFlag.value());
+  EXPECT_EQ("", output());
+}
+
+
+TEST_F(ChecksTest, outputsFirstFailedRequirement) {
+  Flag<int64> starRatingFlag("starRating", "A star rating in [1, 5]", 3,
+                             Checks<int64>::allOf(
+                                 Checks<int64>::greater(0),
+                                 Checks<int64>::lessOrEqual(5)));
+
+  int argc = 2;
+  const char* argv[] = {"App", "--starRating=6", nullptr};
+  EXPECT_FALSE(flags::init(&argc, argv));
+
+  EXPECT_EQ(3, starRatingFlag.value());
+  EXPECT_EQ(
+      "Invalid value for flag --starRating: 6."
+          " Must be less than or equal to 5.\n",
+      output());
+}
+
+
+TEST_F(ChecksTest, outputsSizeRequirement) {
+  Flag<string> usernameFlag("username", "A username",
+                            Checks<string>::sizeGreaterOrEqual(3));
+
+  int argc = 2;
+  const char* argv[] = {"App", "--username=ab", nullptr};
+  EXPECT_FALSE(flags::init(&argc, argv));
+
+  EXPECT_EQ(
+      "Invalid value for flag --username: ab."
+          " Size/length must be greater than or equal to 3.\n",
+      output());
+}
+
+
+TEST_F(ChecksTest, predicateChecksOutputGivenRequirement) {
+  Flag<int32> evenFlag("even", "An even number",
+                       Checks<int32>::satisfies(
+                           [](int32 value) { return value % 2 == 0; },
+                           "Must be even."));
+
+  int argc = 2;
+  const char* argv[] = {"App", "--even=7", nullptr};
+  EXPECT_FALSE(flags::init(&argc, argv));
+
+  EXPECT_EQ("Invalid value for flag --even: 7. Must be even.\n", output());
+}
+
+
+TEST_F(ChecksTest, inlineCheckHoldsLargeChecksToo) {
+  auto smallCheck = Checks<int64>::allOf(Checks<int64>::greater(0),
+                                         Checks<int64>::less(10));
+  auto largeCheck = Checks<int64>::allOf(Checks<int64>::greater(0),
+                                         Checks<int64>::less(10),
+                                         Checks<int64>::satisfies(
+                                             [](int64 value) {
+                                               return value != 5;
+                                             },
+                                             "Must not be 5."));
+  static_assert(sizeof(smallCheck) <= InlineCheck<int64>::CAPACITY);
+  static_assert(sizeof(largeCheck) > InlineCheck<int64>::CAPACITY);
+
+  InlineCheck<int64> movedCheck(largeCheck);
+  InlineCheck<int64> check(std::move(movedCheck));
+  EXPECT_FALSE(movedCheck.isSet());
+  ASSERT_TRUE(check.isSet());
+
+  string requirement;
+  EXPECT_TRUE(check.check(4, &requirement));
+  EXPECT_EQ("", requirement);
+  EXPECT_FALSE(check.check(5, &requirement));
+  EXPECT_EQ("Must not be 5.", requirement);
+  EXPECT_FALSE(check.check(10, &requirement));
+  EXPECT_EQ("Must be less than 10.", requirement);
+
+  // An empty InlineCheck passes every value.
+  EXPECT_TRUE(InlineCheck<int64>().check(-1, &requirement));
+}
+
+
+}  // namespace
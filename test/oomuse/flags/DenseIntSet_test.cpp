@@ -0,0 +1,78 @@
+/**
+ * Copyright 2015 Eric W. Barndollar. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "oomuse/flags/DenseIntSet.h"
+
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "oomuse/core/int_types.h"
+
+using oomuse::DenseIntSet;
+using std::vector;
+
+namespace {
+
+
+/** Returns items of set, in the order forEach() visits them. */
+vector<int32> itemsOf(const DenseIntSet& set) {
+  vector<int32> items;
+  set.forEach([&items](int32 item) { items.push_back(item); });
+  return items;
+}
+
+
+TEST(DenseIntSetTest, holdsInsertedItems) {
+  DenseIntSet set;
+  EXPECT_TRUE(set.empty());
+  EXPECT_FALSE(set.contains(0));
+
+  EXPECT_TRUE(set.insert(63));
+  EXPECT_TRUE(set.insert(0));
+  EXPECT_TRUE(set.insert(64));
+  EXPECT_TRUE(set.insert(DenseIntSet::MAX_ITEM));
+  EXPECT_TRUE(set.insert(64));  // Already there.
+
+  EXPECT_EQ(4U, set.size());
+  EXPECT_EQ((vector<int32>{0, 63, 64, DenseIntSet::MAX_ITEM}), itemsOf(set));
+  for (int64 item : {0, 63, 64, 65535}) {
+    EXPECT_TRUE(set.contains(item)) << item;
+  }
+  for (int64 item : {-1, 1, 62, 65, 65534, 65536, -65536}) {
+    EXPECT_FALSE(set.contains(item)) << item;
+  }
+}
+
+
+TEST(DenseIntSetTest, rejectsItemsOutOfRange) {
+  DenseIntSet set;
+  EXPECT_FALSE(set.insert(-1));
+  EXPECT_FALSE(set.insert(DenseIntSet::MAX_ITEM + 1));
+  EXPECT_TRUE(set.empty());
+}
+
+
+TEST(DenseIntSetTest, comparesItems) {
+  DenseIntSet set{1, 2, 3};
+  DenseIntSet sameSet{3, 2, 1};
+  EXPECT_EQ(set, sameSet);
+  EXPECT_NE(set, (DenseIntSet{1, 2, 3, 1000}));
+  EXPECT_NE(DenseIntSet(), DenseIntSet{0});
+  EXPECT_EQ(DenseIntSet(), DenseIntSet());
+}
+
+
+}  // namespace
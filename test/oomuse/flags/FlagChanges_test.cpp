@@ -0,0 +1,232 @@
+/**
+ * Copyright 2015 Eric W. Barndollar. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "oomuse/core/int_types.h"
+#include "oomuse/flags/Flag.h"
+#include "oomuse/flags/MutableFlag.h"
+#include "oomuse/flags/flags.h"
+
+using oomuse::AbstractFlag;
+using oomuse::Flag;
+using oomuse::MutableFlag;
+using oomuse::flags::FlagChangeSubscription;
+using oomuse::flags::MutableFlagBatch;
+using std::string;
+using std::vector;
+using testing::Test;
+
+namespace flags = oomuse::flags;
+
+namespace {
+
+
+/** How long to wait for changes that should be delivered right away. */
+const auto DELIVERY_TIMEOUT = std::chrono::seconds(10);
+
+
+/** Records batches of changed flags delivered to a listener. */
+class ChangeRecorder {
+ public:
+  /** Subscribes to changes in given flags (or all, if empty). */
+  FlagChangeSubscription subscribe(vector<const AbstractFlag*> flags = {}) {
+    return flags::subscribeToFlagChanges(
+        [this](const vector<const AbstractFlag*>& changedFlags) {
+          std::lock_guard<std::mutex> lock(mutex_);
+          batches_.push_back(changedFlags);
+          delivered_.notify_all();
+        },
+        flags);
+  }
+
+  /** Waits for at least count batches, returning all of them. */
+  vector<vector<const AbstractFlag*>> waitForBatches(size_t count) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    delivered_.wait_for(lock, DELIVERY_TIMEOUT,
+                        [this, count]() { return batches_.size() >= count; });
+    return batches_;
+  }
+
+ private:
+  std::mutex mutex_;
+  std::condition_variable delivered_;
+  vector<vector<const AbstractFlag*>> batches_;
+};
+
+
+/** Test fixture for common flag change listener test setup. */
+class FlagChangesTest : public Test {
+ protected:
+  /** Reset flags library global state before every test. */
+  FlagChangesTest() { flags::resetForTest(); }
+
+  /** Also stops delivery before test flags are destroyed. */
+  virtual ~FlagChangesTest() { flags::resetForTest(); }
+};
+
+
+TEST_F(FlagChangesTest, deliversChangesMadeTogetherInOneBatch) {
+  MutableFlag<int32> poolSizeFlag("poolSize", "Pool size", 4);
+  MutableFlag<string> cacheModeFlag("cacheMode", "Cache mode", "lru");
+  MutableFlag<bool> verboseFlag("verbose", "Verbose logging", false);
+  ChangeRecorder recorder;
+  FlagChangeSubscription subscription = recorder.subscribe();
+
+  {
+    MutableFlagBatch batch;
+    ASSERT_TRUE(poolSizeFlag.set(8));
+    ASSERT_TRUE(cacheModeFlag.set("lfu"));
+    ASSERT_TRUE(poolSizeFlag.set(16));
+  }
+
+  auto batches = recorder.waitForBatches(1);
+  ASSERT_EQ(1U, batches.size());
+  EXPECT_EQ((vector<const AbstractFlag*>{poolSizeFlag.flag(),
+                                         cacheModeFlag.flag()}),
+            batches[0]);
+
+  ASSERT_TRUE(verboseFlag.set(true));
+  batches = recorder.waitForBatches(2);
+  ASSERT_EQ(2U, batches.size());
+  EXPECT_EQ((vector<const AbstractFlag*>{verboseFlag.flag()}), batches[1]);
+}
+
+
+TEST_F(FlagChangesTest, deliversFlagsSetByInitTogether) {
+  Flag<int32> portFlag("port", "Port to listen on");
+  MutableFlag<int32> poolSizeFlag("poolSize", "Pool size", 4);
+  ChangeRecorder recorder;
+  FlagChangeSubscription subscription = recorder.subscribe();
+
+  int argc = 3;
+  const char* argv[] = {"App", "--port=80", "--poolSize=8", nullptr};
+  ASSERT_TRUE(flags::init(&argc, argv));
+
+  auto batches = recorder.waitForBatches(1);
+  ASSERT_EQ(1U, batches.size());
+  EXPECT_EQ((vector<const AbstractFlag*>{&portFlag, poolSizeFlag.flag()}),
+            batches[0]);
+}
+
+
+TEST_F(FlagChangesTest, onlyDeliversSubscribedFlags) {
+  MutableFlag<int32> poolSizeFlag("poolSize", "Pool size", 4);
+  MutableFlag<string> cacheModeFlag("cacheMode", "Cache mode", "lru");
+  ChangeRecorder poolRecorder;
+  ChangeRecorder allRecorder;
+  FlagChangeSubscription poolSubscription =
+      poolRecorder.subscribe({poolSizeFlag.flag()});
+  FlagChangeSubscription allSubscription = allRecorder.subscribe();
+
+  ASSERT_TRUE(cacheModeFlag.set("lfu"));
+  ASSERT_EQ(1U, allRecorder.waitForBatches(1).size());
+  ASSERT_TRUE(poolSizeFlag.set(8));
+  ASSERT_EQ(2U, allRecorder.waitForBatches(2).size());
+
+  // Stopping delivery makes sure nothing else is on its way.
+  auto poolBatches = poolRecorder.waitForBatches(1);
+  flags::resetForTest();
+  EXPECT_EQ((vector<vector<const AbstractFlag*>>{{poolSizeFlag.flag()}}),
+            poolBatches);
+}
+
+
+TEST_F(FlagChangesTest, slowListenersDontBlockWritersAndCatchUpInBatches) {
+  MutableFlag<int64> counterFlag("counter", "A counter", 0);
+  std::atomic<bool> isReleased(false);
+  std::atomic<int> callCount(0);
+  std::atomic<int64> lastSeen(0);
+  FlagChangeSubscription subscription = flags::subscribeToFlagChanges(
+      [&](const vector<const AbstractFlag*>&) {
+        while (!isReleased.load()) {
+          std::this_thread::yield();
+        }
+        lastSeen.store(counterFlag.value());
+        ++callCount;
+      });
+
+  // Writers keep going while the listener is stuck on the first change.
+  for (int64 i = 1; i <= 1000; ++i) {
+    ASSERT_TRUE(counterFlag.set(i));
+  }
+  isReleased.store(true);
+
+  auto deadline = std::chrono::steady_clock::now() + DELIVERY_TIMEOUT;
+  while ((lastSeen.load() != 1000)
+         && (std::chrono::steady_clock::now() < deadline)) {
+    std::this_thread::yield();
+  }
+  EXPECT_EQ(1000, lastSeen.load());
+  EXPECT_LE(callCount.load(), 2);
+}
+
+
+TEST_F(FlagChangesTest, unsubscribeWaitsForRunningListener) {
+  MutableFlag<int32> poolSizeFlag("poolSize", "Pool size", 4);
+  std::atomic<bool> isRunning(false);
+  std::atomic<bool> isFinished(false);
+  std::atomic<int> callCount(0);
+  FlagChangeSubscription subscription = flags::subscribeToFlagChanges(
+      [&](const vector<const AbstractFlag*>&) {
+        ++callCount;
+        isRunning.store(true);
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        isFinished.store(true);
+      });
+
+  ASSERT_TRUE(poolSizeFlag.set(8));
+  while (!isRunning.load()) {
+    std::this_thread::yield();
+  }
+  subscription.unsubscribe();
+  EXPECT_TRUE(isFinished.load());
+
+  // No more calls after unsubscribing.
+  ASSERT_TRUE(poolSizeFlag.set(16));
+  flags::resetForTest();
+  EXPECT_EQ(1, callCount.load());
+}
+
+
+TEST_F(FlagChangesTest, listenersCanUnsubscribeThemselves) {
+  MutableFlag<int32> poolSizeFlag("poolSize", "Pool size", 4);
+  ChangeRecorder recorder;
+  FlagChangeSubscription recorderSubscription = recorder.subscribe();
+  std::atomic<int> callCount(0);
+  FlagChangeSubscription subscription;
+  subscription = flags::subscribeToFlagChanges(
+      [&](const vector<const AbstractFlag*>&) {
+        ++callCount;
+        subscription.unsubscribe();
+      });
+
+  ASSERT_TRUE(poolSizeFlag.set(8));
+  ASSERT_EQ(1U, recorder.waitForBatches(1).size());
+  ASSERT_TRUE(poolSizeFlag.set(16));
+  ASSERT_EQ(2U, recorder.waitForBatches(2).size());
+  EXPECT_EQ(1, callCount.load());
+}
+
+
+}  // namespace
@@ -0,0 +1,228 @@
+/**
+ * Copyright 2015 Eric W. Barndollar. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "oomuse/flags/FlagFileWatcher.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "oomuse/core/int_types.h"
+#include "oomuse/flags/MutableFlag.h"
+#include "oomuse/flags/flags.h"
+#include "oomuse/flags/flags_test_util.h"
+
+using oomuse::AbstractFlag;
+using oomuse::MutableFlag;
+using oomuse::flags::FlagFileWatcher;
+using oomuse::flags::test::FlagsTestBase;
+using std::string;
+using std::vector;
+
+namespace filesystem = std::filesystem;
+namespace flags = oomuse::flags;
+
+namespace {
+
+
+/** How long to wait for a reload that should happen within milliseconds. */
+const auto RELOAD_TIMEOUT = std::chrono::seconds(10);
+
+
+/** Returns how many inotify watches this process has. */
+int countInotifyWatches() {
+  int count = 0;
+  for (auto& entry : filesystem::directory_iterator("/proc/self/fdinfo")) {
+    std::ifstream fdInfo(entry.path());
+    string line;
+    while (std::getline(fdInfo, line)) {
+      count += (line.rfind("inotify wd:", 0) == 0) ? 1 : 0;
+    }
+  }
+  return count;
+}
+
+
+/** Waits until this process has count inotify watches. */
+bool waitForInotifyWatches(int count) {
+  auto deadline = std::chrono::steady_clock::now() + RELOAD_TIMEOUT;
+  while (countInotifyWatches() != count) {
+    if (std::chrono::steady_clock::now() > deadline) {
+      return false;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  return true;
+}
+
+
+/** Test fixture that watches flag files in a fresh temporary directory. */
+class FlagFileWatcherTest : public FlagsTestBase {
+ protected:
+  /** Creates a fresh temporary directory for the test. */
+  FlagFileWatcherTest()
+      : directory_(filesystem::temp_directory_path()
+                   / "oomuse_flag_file_watcher_test"
+                   / testing::UnitTest::GetInstance()->current_test_info()
+                         ->name()) {
+    filesystem::create_directories(directory_);
+  }
+
+  virtual ~FlagFileWatcherTest() { filesystem::remove_all(directory_); }
+
+  /** Writes a file in place with given name & contents, returning its path. */
+  string writeFile(const string& name, const string& contents) {
+    filesystem::path path = directory_ / name;
+    filesystem::create_directories(path.parent_path());
+    std::ofstream(path, std::ios::binary) << contents;
+    return path.string();
+  }
+
+  /** Replaces a file by renaming a new one over it, as editors often do. */
+  void replaceFile(const string& name, const string& contents) {
+    string newPath = writeFile(name + ".new", contents);
+    filesystem::rename(newPath, directory_ / name);
+  }
+
+  /** Initializes flags from the flag file at path. */
+  void initWithFlagFile(const string& path) {
+    string flagFileArg = "--flagfile=" + path;
+    int argc = 2;
+    const char* argv[] = {"App", flagFileArg.c_str(), nullptr};
+    ASSERT_TRUE(flags::init(&argc, argv));
+  }
+
+  /** Starts watcher watching the flag file at path, counting reloads. */
+  void startWatching(FlagFileWatcher* watcher, const string& path) {
+    watcher->addReloadCallback(
+        [this](const vector<const AbstractFlag*>& changedFlags) {
+          countReload(changedFlags);
+        });
+    string errorMsg;
+    ASSERT_TRUE(watcher->start(path, &errorMsg)) << errorMsg;
+  }
+
+  /** Counts reloads that change flags, as a reload callback. */
+  void countReload(const vector<const AbstractFlag*>& changedFlags) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ++reloadCount_;
+    lastChangedFlags_ = changedFlags;
+    reloaded_.notify_all();
+  }
+
+  /** Waits until there have been count reloads that changed flags. */
+  bool waitForReloads(int count) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    return reloaded_.wait_for(
+        lock, RELOAD_TIMEOUT, [this, count]() { return reloadCount_ >= count; });
+  }
+
+  vector<const AbstractFlag*> lastChangedFlags() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return lastChangedFlags_;
+  }
+
+ private:
+  filesystem::path directory_;
+
+  std::mutex mutex_;
+  std::condition_variable reloaded_;
+  int reloadCount_ = 0;
+  vector<const AbstractFlag*> lastChangedFlags_;
+};
+
+
+TEST_F(FlagFileWatcherTest, reloadsEditedFlagFiles) {
+  MutableFlag<int32> batchSizeFlag("batchSize", "Batch size", 16);
+  MutableFlag<string> modeFlag("mode", "Mode", "slow");
+  string path = writeFile("server.flags", "--batchSize=32\n");
+  initWithFlagFile(path);
+
+  FlagFileWatcher watcher;
+  startWatching(&watcher, path);
+
+  // Edited in place.
+  writeFile("server.flags", "--batchSize=64\n--mode=fast\n");
+  ASSERT_TRUE(waitForReloads(1));
+  EXPECT_EQ(64, batchSizeFlag.value());
+  EXPECT_EQ("fast", modeFlag.value());
+  EXPECT_EQ((vector<const AbstractFlag*>{batchSizeFlag.flag(),
+                                         modeFlag.flag()}),
+            lastChangedFlags());
+
+  // Replaced, now including another file, which is then edited too.
+  writeFile("extra.flags", "--mode=faster\n");
+  replaceFile("server.flags", "--batchSize=128\n--flagfile=extra.flags\n");
+  ASSERT_TRUE(waitForReloads(2));
+  EXPECT_EQ(128, batchSizeFlag.value());
+  EXPECT_EQ("faster", modeFlag.value());
+
+  writeFile("extra.flags", "--mode=fastest\n");
+  ASSERT_TRUE(waitForReloads(3));
+  EXPECT_EQ("fastest", modeFlag.value());
+  EXPECT_EQ((vector<const AbstractFlag*>{modeFlag.flag()}), lastChangedFlags());
+
+  watcher.stop();
+  EXPECT_EQ("", output());
+}
+
+
+TEST_F(FlagFileWatcherTest, stopsWatchingDirectoriesOfRemovedIncludes) {
+  MutableFlag<int32> batchSizeFlag("batchSize", "Batch size", 16);
+  MutableFlag<string> modeFlag("mode", "Mode", "slow");
+  writeFile("extra/extra.flags", "--mode=fast\n");
+  string path = writeFile("server.flags",
+                          "--batchSize=32\n--flagfile=extra/extra.flags\n");
+  initWithFlagFile(path);
+
+  FlagFileWatcher watcher;
+  startWatching(&watcher, path);
+  EXPECT_TRUE(waitForInotifyWatches(2));
+
+  replaceFile("server.flags", "--batchSize=64\n");
+  ASSERT_TRUE(waitForReloads(1));
+  EXPECT_TRUE(waitForInotifyWatches(1));
+
+  watcher.stop();
+  EXPECT_EQ(0, countInotifyWatches());
+}
+
+
+TEST_F(FlagFileWatcherTest, keepsFlagsIfEditIsInvalid) {
+  MutableFlag<int32> batchSizeFlag("batchSize", "Batch size", 16);
+  MutableFlag<string> modeFlag("mode", "Mode", "slow");
+  string path = writeFile("server.flags", "--batchSize=32\n");
+  initWithFlagFile(path);
+
+  FlagFileWatcher watcher;
+  startWatching(&watcher, path);
+
+  // An invalid edit changes nothing, but a later valid one takes effect.
+  writeFile("server.flags", "--mode=fast\n--batchSize=many\n");
+  writeFile("server.flags", "--batchSize=8\n");
+  ASSERT_TRUE(waitForReloads(1));
+  EXPECT_EQ(8, batchSizeFlag.value());
+  EXPECT_EQ("slow", modeFlag.value());
+}
+
+
+}  // namespace
@@ -0,0 +1,147 @@
+/**
+ * Copyright 2015 Eric W. Barndollar. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "oomuse/flags/FlagSet.h"
+
+#include <array>
+#include <cstddef>
+#include <set>
+#include <string>
+
+#include "gtest/gtest.h"
+#include "oomuse/core/int_types.h"
+#include "oomuse/flags/Flag.h"
+#include "oomuse/flags/flags.h"
+#include "oomuse/flags/flags_test_util.h"
+
+using oomuse::Flag;
+using oomuse::flags::StaticFlagIndex;
+using oomuse::flags::makeFlagSet;
+using oomuse::flags::test::FlagsTestBase;
+using std::size_t;
+using std::string;
+
+namespace flags = oomuse::flags;
+
+namespace {
+
+
+static constexpr auto appFlags = makeFlagSet(
+    "retry_limit", "username", "verbose", "timeout_ms", "shard", "log_dir",
+    "threads", "a", "b", "c", "dry_run");
+
+// The perfect hash is usable (and checked) at compile time.
+static_assert(appFlags.find("verbose") != StaticFlagIndex::NOT_FOUND,
+              "verbose should be found");
+static_assert(appFlags.find("verbos") == StaticFlagIndex::NOT_FOUND,
+              "verbos should not be found");
+static_assert(appFlags.index().nameAt(appFlags.find("shard")) == "shard",
+              "shard should map to its own slot");
+
+
+TEST(FlagSetTest, mapsEachNameToDistinctSlot) {
+  const char* names[] = {"retry_limit", "username", "verbose", "timeout_ms",
+                         "shard", "log_dir", "threads", "a", "b", "c",
+                         "dry_run"};
+
+  std::set<size_t> slots;
+  for (const char* name : names) {
+    size_t slot = appFlags.find(name);
+    ASSERT_LT(slot, appFlags.index().size()) << name;
+    EXPECT_EQ(name, appFlags.index().nameAt(slot));
+    slots.insert(slot);
+  }
+
+  // Minimal: every slot is used exactly once.
+  EXPECT_EQ(appFlags.index().size(), slots.size());
+}
+
+
+TEST(FlagSetTest, doesNotFindOtherNames) {
+  for (const char* name : {"", "x", "Verbose", "usernam", "usernamee", "ab"}) {
+    EXPECT_EQ(StaticFlagIndex::NOT_FOUND, appFlags.find(name)) << name;
+  }
+
+  EXPECT_EQ(StaticFlagIndex::NOT_FOUND, StaticFlagIndex().find("verbose"));
+}
+
+
+TEST(FlagSetTest, buildsLargerSetsAtCompileTime) {
+  static constexpr std::array<std::string_view, 64> names = {{
+    "f00", "f01", "f02", "f03", "f04", "f05", "f06", "f07", "f08", "f09",
+    "f10", "f11", "f12", "f13", "f14", "f15", "f16", "f17", "f18", "f19",
+    "f20", "f21", "f22", "f23", "f24", "f25", "f26", "f27", "f28", "f29",
+    "f30", "f31", "f32", "f33", "f34", "f35", "f36", "f37", "f38", "f39",
+    "f40", "f41", "f42", "f43", "f44", "f45", "f46", "f47", "f48", "f49",
+    "f50", "f51", "f52", "f53", "f54", "f55", "f56", "f57", "f58", "f59",
+    "f60", "f61", "f62", "f63"
+  }};
+  static constexpr oomuse::flags::FlagSet<64> largeSet(names);
+
+  std::set<size_t> slots;
+  for (std::string_view name : names) {
+    size_t slot = largeSet.find(name);
+    ASSERT_NE(StaticFlagIndex::NOT_FOUND, slot) << name;
+    slots.insert(slot);
+  }
+  EXPECT_EQ(64U, slots.size());
+}
+
+
+/** Test fixture for flags initialized through a static flag index. */
+class StaticFlagIndexTest : public FlagsTestBase {};
+
+
+TEST_F(StaticFlagIndexTest, initResolvesStaticAndOtherFlags) {
+  Flag<int32> retryLimitFlag("retry_limit", "Max # of times to retry");
+  Flag<bool> verboseFlag("verbose", "Print extra info", false);
+  Flag<string> extraFlag("extra", "A flag not in the static set");
+  flags::setStaticFlagIndex(appFlags.index());
+
+  int argc = 4;
+  const char* argv[] =
+      {"App", "--retry_limit=3", "--extra=hi", "--verbose", nullptr};
+
+  // Should parse successfully.
+  ASSERT_TRUE(flags::init(&argc, argv));
+
+  // Verify flag values.
+  EXPECT_EQ(3, retryLimitFlag.value());
+  EXPECT_TRUE(verboseFlag.value());
+  EXPECT_EQ("hi", extraFlag.value());
+
+  // No errors should have been output.
+  EXPECT_EQ("", output());
+}
+
+
+TEST_F(StaticFlagIndexTest, initFailsForStaticNameWithoutRegisteredFlag) {
+  Flag<int32> retryLimitFlag("retry_limit", "Max # of times to retry");
+  flags::setStaticFlagIndex(appFlags.index());
+
+  // "username" is in the static set, but no such flag was linked in.
+  int argc = 2;
+  const char* argv[] = {"App", "--username=bob", nullptr};
+
+  // Trying to parse flags should fail.
+  EXPECT_FALSE(flags::init(&argc, argv));
+
+  // Verify validation error for unrecognized flag name.
+  EXPECT_EQ("Unrecognized command-line flag: --username\n", output());
+}
+
+
+}  // namespace
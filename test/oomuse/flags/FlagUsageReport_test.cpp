@@ -0,0 +1,246 @@
+/**
+ * Copyright 2015 Eric W. Barndollar. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "oomuse/core/int_types.h"
+#include "oomuse/flags/Flag.h"
+#include "oomuse/flags/FlagUsageReport.h"
+#include "oomuse/flags/flags.h"
+#include "oomuse/flags/flags_test_util.h"
+
+using oomuse::Flag;
+using oomuse::flags::FlagUsage;
+using oomuse::flags::FlagUsageReport;
+using oomuse::flags::FlagUsageStatus;
+using oomuse::flags::IS_COUNTING_FLAG_READS;
+using oomuse::flags::test::FlagsTestBase;
+using oomuse::flags::test::initWithArgs;
+using std::string;
+using std::stringstream;
+using std::vector;
+
+namespace filesystem = std::filesystem;
+namespace flags = oomuse::flags;
+
+namespace {
+
+
+/** Test fixture that writes usage files into a fresh temporary directory. */
+class FlagUsageReportTest : public FlagsTestBase {
+ protected:
+  /** Creates a fresh temporary directory for the test. */
+  FlagUsageReportTest()
+      : directory_(filesystem::temp_directory_path()
+                   / "oomuse_flag_usage_report_test"
+                   / testing::UnitTest::GetInstance()->current_test_info()
+                         ->name()) {
+    filesystem::create_directories(directory_);
+  }
+
+  virtual ~FlagUsageReportTest() { filesystem::remove_all(directory_); }
+
+  /** Returns path of a file with given name in the temporary directory. */
+  string pathOf(const string& name) const {
+    return (directory_ / name).string();
+  }
+
+  /** Writes a file with given name and contents, returning its path. */
+  string writeFile(const string& name, const string& contents) const {
+    string path = pathOf(name);
+    std::ofstream(path, std::ios::binary) << contents;
+    return path;
+  }
+
+ private:
+  filesystem::path directory_;
+};
+
+
+/** Returns contents of the file at path. */
+string readFile(const string& path) {
+  std::ifstream file(path, std::ios::binary);
+  stringstream contents;
+  contents << file.rdbuf();
+  return contents.str();
+}
+
+
+/** Returns report's unused flags output. */
+string unusedFlags(const FlagUsageReport& report) {
+  stringstream unused;
+  report.printUnusedFlags(&unused);
+  return unused.str();
+}
+
+
+TEST_F(FlagUsageReportTest, writesUsageOfEveryFlag) {
+  Flag<int32> portFlag("port", "Port to listen on", 80);
+  Flag<int32> shardFlag("shard", "Shard to serve");
+  Flag<bool> verboseFlag("verbose", "Log more", false);
+  ASSERT_TRUE(initWithArgs({"--shard=3"}));
+  shardFlag.countRead();
+  shardFlag.countRead();
+
+  string path = pathOf("run.usage");
+  ASSERT_TRUE(flags::writeFlagUsage(path));
+  EXPECT_EQ(string("oomuse-flags usage 1\n")
+                + "reads_counted\t" + (IS_COUNTING_FLAG_READS ? "1" : "0")
+                + "\n"
+                + "port\t0\t1\t0\n"
+                + "shard\t1\t0\t2\n"
+                + "verbose\t0\t1\t0\n",
+            readFile(path));
+  EXPECT_EQ("", output());
+}
+
+
+TEST_F(FlagUsageReportTest, mergesRunsByFlagName) {
+  FlagUsageReport report;
+  string errorMsg;
+  ASSERT_TRUE(report.addFile(
+      writeFile("a.usage", "oomuse-flags usage 1\n"
+                           "reads_counted\t1\n"
+                           "port\t1\t1\t5\n"
+                           "shard\t0\t0\t0\n"),
+      &errorMsg)) << errorMsg;
+  ASSERT_TRUE(report.addFile(
+      writeFile("b.usage", "oomuse-flags usage 1\n"
+                           "reads_counted\t1\n"
+                           "port\t0\t1\t2\n"
+                           "verbose\t1\t1\t0\n"),
+      &errorMsg)) << errorMsg;
+  EXPECT_EQ(2, report.runCount());
+  EXPECT_TRUE(report.areReadsCounted());
+
+  vector<FlagUsage> usages = report.flagUsages();
+  ASSERT_EQ(3u, usages.size());
+  EXPECT_EQ("port", usages[0].name);
+  EXPECT_EQ(2, usages[0].runCount);
+  EXPECT_EQ(1, usages[0].setRunCount);
+  EXPECT_EQ(7u, usages[0].readCount);
+  EXPECT_TRUE(usages[0].hasDefaultValue);
+  EXPECT_EQ(FlagUsageStatus::USED, usages[0].status);
+  EXPECT_EQ("shard", usages[1].name);
+  EXPECT_EQ(1, usages[1].runCount);
+  EXPECT_EQ(FlagUsageStatus::UNUSED, usages[1].status);
+  EXPECT_EQ("verbose", usages[2].name);
+  EXPECT_EQ(FlagUsageStatus::NEVER_READ, usages[2].status);
+}
+
+
+TEST_F(FlagUsageReportTest, listsUnusedFlagsWhenReadsCounted) {
+  FlagUsageReport report;
+  string errorMsg;
+  ASSERT_TRUE(report.addFile(
+      writeFile("a.usage", "oomuse-flags usage 1\n"
+                           "reads_counted\t1\n"
+                           "backlog\t0\t1\t9\n"
+                           "port\t1\t1\t5\n"
+                           "retries\t0\t1\t0\n"
+                           "verbose\t1\t1\t0\n"),
+      &errorMsg)) << errorMsg;
+
+  EXPECT_EQ("name\tstatus\truns\tset_runs\treads\thas_default\n"
+            "backlog\tnever_set\t1\t0\t9\t1\n"
+            "retries\tunused\t1\t0\t0\t1\n"
+            "verbose\tnever_read\t1\t1\t0\t1\n",
+            unusedFlags(report));
+}
+
+
+TEST_F(FlagUsageReportTest, listsNeverSetFlagsWhenReadsNotCounted) {
+  FlagUsageReport report;
+  string errorMsg;
+  ASSERT_TRUE(report.addFile(
+      writeFile("a.usage", "oomuse-flags usage 1\n"
+                           "reads_counted\t1\n"
+                           "port\t1\t1\t0\n"
+                           "retries\t0\t1\t0\n"
+                           "shard\t0\t0\t0\n"),
+      &errorMsg)) << errorMsg;
+  ASSERT_TRUE(report.addFile(
+      writeFile("b.usage", "oomuse-flags usage 1\n"
+                           "reads_counted\t0\n"
+                           "port\t0\t1\t0\n"),
+      &errorMsg)) << errorMsg;
+  EXPECT_FALSE(report.areReadsCounted());
+
+  // Without a default value, a flag that's never set can't have been read.
+  EXPECT_EQ("name\tstatus\truns\tset_runs\treads\thas_default\n"
+            "retries\tnever_set\t1\t0\t-\t1\n"
+            "shard\tunused\t1\t0\t-\t0\n",
+            unusedFlags(report));
+}
+
+
+TEST_F(FlagUsageReportTest, rejectsMissingAndMalformedFiles) {
+  FlagUsageReport report;
+  string errorMsg;
+  EXPECT_FALSE(report.addFile(pathOf("missing.usage"), &errorMsg));
+
+  EXPECT_FALSE(report.addFile(writeFile("empty.usage", ""), &errorMsg));
+  EXPECT_EQ("Not a flag usage file (or an unsupported version).", errorMsg);
+
+  EXPECT_FALSE(report.addFile(
+      writeFile("v2.usage", "oomuse-flags usage 2\nreads_counted\t0\n"),
+      &errorMsg));
+  EXPECT_EQ("Not a flag usage file (or an unsupported version).", errorMsg);
+
+  EXPECT_FALSE(report.addFile(
+      writeFile("no_reads.usage", "oomuse-flags usage 1\n"), &errorMsg));
+  EXPECT_EQ("Line 2: Expected reads_counted.", errorMsg);
+
+  EXPECT_FALSE(report.addFile(
+      writeFile("bad.usage", "oomuse-flags usage 1\n"
+                             "reads_counted\t1\n"
+                             "port\t1\t1\t5\n"
+                             "shard\t2\t0\t0\n"),
+      &errorMsg));
+  EXPECT_EQ("Line 4: Expected <name>\\t<0|1>\\t<0|1>\\t<read count>.",
+            errorMsg);
+
+  EXPECT_FALSE(report.addFile(
+      writeFile("short.usage", "oomuse-flags usage 1\n"
+                               "reads_counted\t1\n"
+                               "port\t1\t1\n"),
+      &errorMsg));
+  EXPECT_EQ("Line 3: Expected <name>\\t<0|1>\\t<0|1>\\t<read count>.",
+            errorMsg);
+
+  // Nothing from the malformed files was added.
+  EXPECT_EQ(0, report.runCount());
+  EXPECT_TRUE(report.flagUsages().empty());
+}
+
+
+TEST_F(FlagUsageReportTest, outputsWhyUsageCouldNotBeWritten) {
+  Flag<int32> portFlag("port", "Port to listen on", 80);
+  ASSERT_TRUE(initWithArgs({}));
+
+  string path = pathOf("no_such_directory/run.usage");
+  EXPECT_FALSE(flags::writeFlagUsage(path));
+  EXPECT_EQ(0u, output().find("Could not write flag usage " + path))
+      << output();
+}
+
+
+}  // namespace
@@ -0,0 +1,182 @@
+/**
+ * Copyright 2015 Eric W. Barndollar. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "oomuse/flags/MutableFlag.h"
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "oomuse/core/Validators.h"
+#include "oomuse/core/int_types.h"
+#include "oomuse/flags/Flag.h"
+#include "oomuse/flags/flags.h"
+#include "oomuse/flags/flags_test_util.h"
+
+using oomuse::AbstractFlag;
+using oomuse::Flag;
+using oomuse::FlagRequired;
+using oomuse::MutableFlag;
+using oomuse::Validators;
+using oomuse::flags::test::FlagsTestBase;
+using std::string;
+using std::thread;
+using std::vector;
+
+namespace flags = oomuse::flags;
+
+namespace {
+
+
+// Flag<T>::value() can't read a MutableFlag, so it mustn't be usable as one.
+static_assert(!std::is_convertible_v<const MutableFlag<int32>&,
+                                     const Flag<int32>&>,
+              "MutableFlag shouldn't be usable as a Flag.");
+
+
+/** Test fixture for common mutable flags test setup. */
+class MutableFlagTest : public FlagsTestBase {};
+
+
+TEST_F(MutableFlagTest, initSetsMutableFlags) {
+  MutableFlag<int32> batchSizeFlag("batchSize", "Batch size", 16);
+  MutableFlag<string> modeFlag("mode", "Mode", FlagRequired::YES);
+
+  int argc = 3;
+  const char* argv[] = {"App", "--batchSize=64", "--mode=fast", nullptr};
+
+  // Should parse successfully.
+  ASSERT_TRUE(flags::init(&argc, argv));
+
+  // Verify flag values.
+  EXPECT_EQ(64, batchSizeFlag.value());
+  EXPECT_EQ("fast", modeFlag.value());
+  EXPECT_EQ(16, batchSizeFlag.defaultValue());
+
+  // No errors should have been output.
+  EXPECT_EQ("", output());
+}
+
+
+TEST_F(MutableFlagTest, isListedAsItsFlag) {
+  MutableFlag<int32> batchSizeFlag("batchSize", "Batch size", 16);
+
+  const AbstractFlag* flag = batchSizeFlag.flag();
+  EXPECT_EQ("batchSize", flag->name());
+  EXPECT_TRUE(flag->isMutable());
+
+  ASSERT_TRUE(batchSizeFlag.set(32));
+  EXPECT_EQ("32", flag->printableValue());
+}
+
+
+TEST_F(MutableFlagTest, startsWithDefaultValueIfAny) {
+  MutableFlag<double> rateFlag("rate", "Sampling rate", 0.25);
+  MutableFlag<string> nameFlag("name", "A name");
+
+  ASSERT_TRUE(rateFlag.hasValue());
+  EXPECT_EQ(0.25, rateFlag.value());
+  EXPECT_FALSE(nameFlag.hasValue());
+
+  // Setting a value at runtime makes it available.
+  EXPECT_TRUE(nameFlag.set("runtime"));
+  ASSERT_TRUE(nameFlag.hasValue());
+  EXPECT_EQ("runtime", nameFlag.value());
+}
+
+
+TEST_F(MutableFlagTest, runtimeSetsGoThroughValidators) {
+  MutableFlag<int64> timeoutFlag("timeoutMs", "Timeout in milliseconds", 100,
+                                 Validators<int64>::greater(0),
+                                 Validators<int64>::lessOrEqual(60000));
+
+  EXPECT_TRUE(timeoutFlag.set(250));
+  EXPECT_EQ(250, timeoutFlag.value());
+
+  // Invalid values are rejected, keeping the old value.
+  EXPECT_FALSE(timeoutFlag.set(0));
+  EXPECT_FALSE(timeoutFlag.setFromText("60001"));
+  EXPECT_FALSE(timeoutFlag.setFromText("soon"));
+  EXPECT_EQ(250, timeoutFlag.value());
+
+  EXPECT_TRUE(timeoutFlag.setFromText(" 5000 "));
+  EXPECT_EQ(5000, timeoutFlag.value());
+
+  EXPECT_EQ(
+      "Invalid value for flag --timeoutMs: 0. Must be greater than 0.\n"
+          "Invalid value for flag --timeoutMs: 60001."
+          " Must be less than or equal to 60000.\n"
+          "Invalid value for flag --timeoutMs: soon."
+          " Must be an int64 number.\n",
+      output());
+}
+
+
+TEST_F(MutableFlagTest, readPassesCurrentValueWithoutCopying) {
+  MutableFlag<string> hostFlag("host", "Host name", "localhost");
+
+  EXPECT_EQ(9U, hostFlag.read([](const string& host) { return host.size(); }));
+
+  EXPECT_TRUE(hostFlag.set("example.com"));
+  EXPECT_TRUE(hostFlag.read(
+      [](const string& host) { return host == "example.com"; }));
+}
+
+
+TEST_F(MutableFlagTest, concurrentReadersSeeWholeValues) {
+  MutableFlag<string> valueFlag("value", "A string value", string(64, 'a'));
+  MutableFlag<int64> counterFlag("counter", "A counter", 0);
+
+  std::atomic<bool> isDone(false);
+  std::atomic<int> badReads(0);
+  vector<thread> readers;
+  for (int i = 0; i < 4; ++i) {
+    readers.emplace_back([&]() {
+      int64 lastCounter = 0;
+      while (!isDone.load()) {
+        // Every value written is a run of one repeated letter.
+        bool isWhole = valueFlag.read([](const string& value) {
+          return (value.size() == 64)
+              && (value.find_first_not_of(value[0]) == string::npos);
+        });
+        int64 counter = counterFlag.value();
+        if (!isWhole || (counter < lastCounter)) {
+          ++badReads;
+        }
+        lastCounter = counter;
+      }
+    });
+  }
+
+  for (int64 i = 1; i <= 2000; ++i) {
+    ASSERT_TRUE(valueFlag.set(string(64, static_cast<char>('a' + i % 26))));
+    ASSERT_TRUE(counterFlag.set(i));
+  }
+  isDone.store(true);
+  for (thread& reader : readers) {
+    reader.join();
+  }
+
+  EXPECT_EQ(0, badReads.load());
+  EXPECT_EQ(2000, counterFlag.value());
+  EXPECT_EQ(string(64, static_cast<char>('a' + 2000 % 26)), valueFlag.value());
+}
+
+
+}  // namespace
@@ -0,0 +1,350 @@
+/**
+ * Copyright 2015 Eric W. Barndollar. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "oomuse/flags/SharedFlagsReader.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "oomuse/core/int_types.h"
+#include "oomuse/flags/Flag.h"
+#include "oomuse/flags/MutableFlag.h"
+#include "oomuse/flags/flags.h"
+#include "oomuse/flags/flags_test_util.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using oomuse::Flag;
+using oomuse::MutableFlag;
+using oomuse::flags::SharedFlagInfo;
+using oomuse::flags::SharedFlagsReader;
+using oomuse::flags::test::FlagsTestBase;
+using std::string;
+using std::string_view;
+using std::thread;
+using std::vector;
+
+namespace flags = oomuse::flags;
+
+namespace {
+
+
+/** Called whenever a PrintHook is printed, if set. */
+std::function<void()> onPrint;
+
+
+/** Custom flag type whose printing calls onPrint, to act mid-publish. */
+struct PrintHook {};
+
+std::ostream& operator<<(std::ostream& output, PrintHook) {
+  if (onPrint) {
+    onPrint();
+  }
+  return output << "hook";
+}
+
+
+}  // namespace
+
+
+namespace oomuse {
+
+template<>
+bool Flag<PrintHook>::parseValidateAndSet(string_view) {
+  return false;
+}
+
+}  // namespace oomuse
+
+
+namespace {
+
+
+/** Name of shared-memory segment used by these tests. */
+const char SEGMENT_NAME[] = "/oomuse-flags-shared-flags-test";
+
+
+/** Test fixture for common shared flags test setup. */
+class SharedFlagsTest : public FlagsTestBase {
+ protected:
+  /** Stops publishing, which removes the segment. */
+  virtual ~SharedFlagsTest() { flags::resetForTest(); }
+};
+
+
+TEST_F(SharedFlagsTest, readsPublishedFlags) {
+  Flag<int32> portFlag("port", "Port to listen on", 80);
+  Flag<string> nameFlag("name", "Server name");
+  Flag<bool> verboseFlag("verbose", "Verbose logging", false);
+  Flag<double> rateFlag("rate", "Sampling rate");
+
+  int argc = 3;
+  const char* argv[] = {"App", "--port=8080", "--verbose=false", nullptr};
+  ASSERT_TRUE(flags::init(&argc, argv));
+  ASSERT_TRUE(flags::publishToSharedMemory(SEGMENT_NAME));
+
+  SharedFlagsReader reader;
+  string errorMsg;
+  ASSERT_TRUE(reader.open(SEGMENT_NAME, &errorMsg)) << errorMsg;
+  vector<SharedFlagInfo> sharedFlags;
+  ASSERT_TRUE(reader.readSnapshot(&sharedFlags));
+
+  // Flags are in name order.
+  ASSERT_EQ(4U, sharedFlags.size());
+  EXPECT_EQ("name", sharedFlags[0].name);
+  EXPECT_EQ("string", sharedFlags[0].typeName);
+  EXPECT_FALSE(sharedFlags[0].hasValue);
+  EXPECT_FALSE(sharedFlags[0].hasDefaultValue);
+
+  EXPECT_EQ("port", sharedFlags[1].name);
+  EXPECT_EQ("int32", sharedFlags[1].typeName);
+  EXPECT_EQ("8080", sharedFlags[1].value);
+  EXPECT_EQ("80", sharedFlags[1].defaultValue);
+  EXPECT_TRUE(sharedFlags[1].wasExplicitlySet);
+
+  EXPECT_EQ("rate", sharedFlags[2].name);
+  EXPECT_EQ("double", sharedFlags[2].typeName);
+
+  // Explicitly set, even though it's the same as the default value.
+  EXPECT_EQ("verbose", sharedFlags[3].name);
+  EXPECT_EQ("false", sharedFlags[3].value);
+  EXPECT_TRUE(sharedFlags[3].hasValue);
+  EXPECT_TRUE(sharedFlags[3].wasExplicitlySet);
+
+  EXPECT_EQ("", output());
+}
+
+
+TEST_F(SharedFlagsTest, readersSeeMutableFlagChanges) {
+  MutableFlag<string> modeFlag("mode", "Mode", "slow");
+  ASSERT_TRUE(flags::publishToSharedMemory(SEGMENT_NAME));
+
+  SharedFlagsReader reader;
+  string errorMsg;
+  ASSERT_TRUE(reader.open(SEGMENT_NAME, &errorMsg)) << errorMsg;
+  vector<SharedFlagInfo> sharedFlags;
+  ASSERT_TRUE(reader.readSnapshot(&sharedFlags));
+  ASSERT_EQ(1U, sharedFlags.size());
+  EXPECT_EQ("slow", sharedFlags[0].value);
+  EXPECT_FALSE(sharedFlags[0].wasExplicitlySet);
+
+  ASSERT_TRUE(modeFlag.set("fast"));
+  ASSERT_TRUE(reader.readSnapshot(&sharedFlags));
+  EXPECT_EQ("fast", sharedFlags[0].value);
+  EXPECT_TRUE(sharedFlags[0].wasExplicitlySet);
+
+  // Values too long for their slot get truncated.
+  ASSERT_TRUE(modeFlag.set(string(1000, 'x')));
+  ASSERT_TRUE(reader.readSnapshot(&sharedFlags));
+  EXPECT_TRUE(sharedFlags[0].isValueTruncated);
+  EXPECT_EQ(string(sharedFlags[0].value.size(), 'x'), sharedFlags[0].value);
+}
+
+
+TEST_F(SharedFlagsTest, snapshotsAreConsistentDuringChanges) {
+  MutableFlag<string> firstFlag("first", "First", string(20, 'a'));
+  MutableFlag<string> secondFlag("second", "Second", string(20, 'a'));
+  ASSERT_TRUE(flags::publishToSharedMemory(SEGMENT_NAME));
+
+  std::atomic<bool> isDone(false);
+  thread writer([&]() {
+    for (int i = 0; !isDone.load(); ++i) {
+      // Each value is a run of one letter, of a length up to its capacity.
+      string value(10 + i % 30, static_cast<char>('a' + i % 26));
+      firstFlag.set(value);
+      secondFlag.set(value);
+    }
+  });
+
+  SharedFlagsReader reader;
+  string errorMsg;
+  ASSERT_TRUE(reader.open(SEGMENT_NAME, &errorMsg)) << errorMsg;
+  vector<SharedFlagInfo> sharedFlags;
+  int badSnapshots = 0;
+  for (int i = 0; i < 2000; ++i) {
+    if (!reader.readSnapshot(&sharedFlags)) {
+      continue;  // Too busy; fine as long as snapshots taken are consistent.
+    }
+    for (const SharedFlagInfo& flag : sharedFlags) {
+      if (flag.value.find_first_not_of(flag.value[0]) != string::npos) {
+        ++badSnapshots;
+      }
+    }
+  }
+  isDone.store(true);
+  writer.join();
+
+  EXPECT_EQ(0, badSnapshots);
+}
+
+
+TEST_F(SharedFlagsTest, publishesChangesMadeWhilePublishingStarts) {
+  MutableFlag<string> modeFlag("mode", "Mode", "slow");
+  Flag<PrintHook> hookFlag("zhook", "Printed after mode", PrintHook());
+
+  // Each time the hook is printed, a writer thread changes mode, which lands
+  // after mode's value has been read once hookFlag (last by name) is printed.
+  std::mutex mutex;
+  std::condition_variable hasRequest;
+  int requestedValue = 0;
+  std::atomic<int> setValue(0);
+  bool isDone = false;
+  thread writer([&]() {
+    std::unique_lock<std::mutex> lock(mutex);
+    for (int value = 0; !isDone || value < requestedValue;) {
+      if (value == requestedValue) {
+        hasRequest.wait(lock);
+        continue;
+      }
+      value = requestedValue;
+      lock.unlock();
+      modeFlag.set("value" + std::to_string(value));
+      setValue.store(value);
+      lock.lock();
+    }
+  });
+
+  // Give each change time to finish; with publishing already under way, it
+  // should instead wait until publishing finishes, then reach the publisher.
+  onPrint = [&]() {
+    int value;
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      value = ++requestedValue;
+    }
+    hasRequest.notify_one();
+    auto deadline =
+        std::chrono::steady_clock::now() + std::chrono::milliseconds(50);
+    while (setValue.load() < value
+           && std::chrono::steady_clock::now() < deadline) {
+      std::this_thread::yield();
+    }
+  };
+  bool wasPublished = flags::publishToSharedMemory(SEGMENT_NAME);
+  onPrint = nullptr;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    isDone = true;
+  }
+  hasRequest.notify_one();
+  writer.join();
+  ASSERT_TRUE(wasPublished);
+  ASSERT_GT(setValue.load(), 0);
+
+  // Readers should see the last change, even though it raced with publishing.
+  SharedFlagsReader reader;
+  string errorMsg;
+  ASSERT_TRUE(reader.open(SEGMENT_NAME, &errorMsg)) << errorMsg;
+  vector<SharedFlagInfo> sharedFlags;
+  ASSERT_TRUE(reader.readSnapshot(&sharedFlags));
+  ASSERT_EQ(2U, sharedFlags.size());
+  EXPECT_EQ("mode", sharedFlags[0].name);
+  EXPECT_EQ("value" + std::to_string(setValue.load()), sharedFlags[0].value);
+}
+
+
+TEST_F(SharedFlagsTest, openFailsIfNotPublished) {
+  SharedFlagsReader reader;
+  string errorMsg;
+  EXPECT_FALSE(reader.open(SEGMENT_NAME, &errorMsg));
+  EXPECT_NE("", errorMsg);
+
+  vector<SharedFlagInfo> sharedFlags;
+  EXPECT_FALSE(reader.readSnapshot(&sharedFlags));
+}
+
+
+TEST_F(SharedFlagsTest, segmentIsOnlyReadableByUser) {
+  Flag<int32> portFlag("port", "Port to listen on", 80);
+  ASSERT_TRUE(flags::publishToSharedMemory(SEGMENT_NAME));
+
+  int fd = shm_open(SEGMENT_NAME, O_RDONLY, 0);
+  ASSERT_GE(fd, 0);
+  struct stat segmentStats;
+  ASSERT_EQ(0, fstat(fd, &segmentStats));
+  close(fd);
+  EXPECT_EQ(0600u, segmentStats.st_mode & 0777u);
+}
+
+
+TEST_F(SharedFlagsTest, doesNotReplaceExistingNamedSegment) {
+  // Another process's segment, with the name this one is asked to publish to.
+  int fd = shm_open(SEGMENT_NAME, O_CREAT | O_EXCL | O_RDWR, 0600);
+  ASSERT_GE(fd, 0);
+  close(fd);
+
+  Flag<int32> portFlag("port", "Port to listen on", 80);
+  EXPECT_FALSE(flags::publishToSharedMemory(SEGMENT_NAME));
+  EXPECT_EQ("Could not publish flags to shared memory: A segment named "
+                + string(SEGMENT_NAME) + " already exists.\n",
+            output());
+
+  fd = shm_open(SEGMENT_NAME, O_RDONLY, 0);
+  EXPECT_GE(fd, 0);  // Still there.
+  close(fd);
+  shm_unlink(SEGMENT_NAME);
+}
+
+
+TEST_F(SharedFlagsTest, openCanBeRetriedOnceSegmentIsPublished) {
+  // A segment that exists, but hasn't been filled in yet.
+  int fd = shm_open(SEGMENT_NAME, O_CREAT | O_EXCL | O_RDWR, 0600);
+  ASSERT_GE(fd, 0);
+  ASSERT_EQ(0, ftruncate(fd, 4096));
+  close(fd);
+
+  SharedFlagsReader reader;
+  string errorMsg;
+  EXPECT_FALSE(reader.open(SEGMENT_NAME, &errorMsg));
+  EXPECT_EQ("Not a published flags segment (or not published yet).",
+            errorMsg);
+  vector<SharedFlagInfo> sharedFlags;
+  EXPECT_FALSE(reader.readSnapshot(&sharedFlags));
+  shm_unlink(SEGMENT_NAME);
+
+  Flag<int32> portFlag("port", "Port to listen on", 80);
+  ASSERT_TRUE(flags::publishToSharedMemory(SEGMENT_NAME));
+  ASSERT_TRUE(reader.open(SEGMENT_NAME, &errorMsg)) << errorMsg;
+  ASSERT_TRUE(reader.readSnapshot(&sharedFlags));
+  ASSERT_EQ(1u, sharedFlags.size());
+  EXPECT_EQ("80", sharedFlags[0].value);
+}
+
+
+TEST_F(SharedFlagsTest, stopPublishingRemovesSegment) {
+  Flag<int32> portFlag("port", "Port to listen on", 80);
+  ASSERT_TRUE(flags::publishToSharedMemory(SEGMENT_NAME));
+  flags::stopPublishingToSharedMemory();
+
+  SharedFlagsReader reader;
+  string errorMsg;
+  EXPECT_FALSE(reader.open(SEGMENT_NAME, &errorMsg));
+}
+
+
+}  // namespace
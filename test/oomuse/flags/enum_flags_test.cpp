@@ -0,0 +1,204 @@
+/**
+ * Copyright 2015 Eric W. Barndollar. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <string>
+
+#include "gtest/gtest.h"
+#include "oomuse/flags/EnumSet.h"
+#include "oomuse/flags/EnumValues.h"
+#include "oomuse/flags/Flag.h"
+#include "oomuse/flags/MutableFlag.h"
+#include "oomuse/flags/flags.h"
+#include "oomuse/flags/flags_test_util.h"
+
+using oomuse::EnumSet;
+using oomuse::Flag;
+using oomuse::FlagRequired;
+using oomuse::MutableFlag;
+using oomuse::flags::test::FlagsTestBase;
+using std::string;
+
+namespace flags = oomuse::flags;
+
+namespace {
+
+
+enum class Mode {FAST, BALANCED, SAFE};
+
+constexpr auto flagEnumValues(Mode) {
+  return flags::enumValues<Mode>({
+      {"fast", Mode::FAST},
+      {"balanced", Mode::BALANCED},
+      {"safe", Mode::SAFE}});
+}
+
+
+enum class Feature {ZOOM = 0, PAN = 1, ROTATE = 5};
+
+constexpr auto flagEnumValues(Feature) {
+  return flags::enumValues<Feature>({
+      {"zoom", Feature::ZOOM},
+      {"pan", Feature::PAN},
+      {"rotate", Feature::ROTATE}});
+}
+
+
+// Enum values are looked up at compile time.
+static_assert(flags::isFlagEnum<Mode>, "Mode should be a flag enum.");
+static_assert(!flags::isFlagEnum<int>, "int isn't an enum.");
+static_assert([]() {
+  Mode mode = Mode::FAST;
+  return flags::flagEnumTable<Mode>.find("safe", &mode)
+      && (mode == Mode::SAFE) && !flags::flagEnumTable<Mode>.find("x", &mode);
+}(), "Should find values by name at compile time.");
+
+
+/** Test fixture for common enum flag test setup. */
+class EnumFlagsTest : public FlagsTestBase {};
+
+
+TEST_F(EnumFlagsTest, findsEveryValueByName) {
+  const auto& table = flags::flagEnumTable<Feature>;
+  ASSERT_EQ(3U, table.size());
+  for (std::size_t i = 0; i < table.size(); ++i) {
+    Feature feature = Feature::ZOOM;
+    EXPECT_TRUE(table.find(table[i].name, &feature)) << table[i].name;
+    EXPECT_EQ(table[i].value, feature);
+    EXPECT_EQ(table[i].name, table.nameOf(feature));
+  }
+
+  Feature feature = Feature::ZOOM;
+  for (const char* name : {"", "Zoom", "zoo", "zoomm", "a", "z"}) {
+    EXPECT_FALSE(table.find(name, &feature)) << name;
+  }
+}
+
+
+TEST_F(EnumFlagsTest, parsesEnumFlags) {
+  Flag<Mode> modeFlag("mode", "Speed mode", Mode::FAST);
+  Flag<Mode> fallbackFlag("fallbackMode", "Fallback mode", FlagRequired::YES);
+
+  int argc = 2;
+  const char* argv[] = {"App", "--fallbackMode=balanced", nullptr};
+
+  // Should parse successfully.
+  ASSERT_TRUE(flags::init(&argc, argv));
+
+  // Verify flag values.
+  EXPECT_EQ(Mode::FAST, modeFlag.value());
+  EXPECT_EQ(Mode::BALANCED, fallbackFlag.value());
+  EXPECT_EQ("balanced", fallbackFlag.printableValue());
+  EXPECT_EQ("fast", modeFlag.printableDefaultValue());
+  EXPECT_STREQ("enum", modeFlag.typeName());
+  EXPECT_EQ("fast, balanced, safe", modeFlag.printableAllowedValues());
+
+  // No errors should have been output.
+  EXPECT_EQ("", output());
+}
+
+
+TEST_F(EnumFlagsTest, unknownEnumValueFailsValidation) {
+  Flag<Mode> modeFlag("mode", "Speed mode", Mode::FAST);
+
+  int argc = 2;
+  const char* argv[] = {"App", "--mode=Fast", nullptr};
+
+  // Trying to parse flags should fail.
+  EXPECT_FALSE(flags::init(&argc, argv));
+
+  // Verify validation error lists allowed values.
+  EXPECT_EQ(
+      "Invalid value for flag --mode: Fast."
+          " Must be one of: fast, balanced, safe.\n",
+      output());
+}
+
+
+TEST_F(EnumFlagsTest, parsesEnumSetFlags) {
+  Flag<EnumSet<Feature>> featuresFlag("features", "Enabled features",
+                                      EnumSet<Feature>{Feature::ZOOM});
+
+  int argc = 2;
+  const char* argv[] = {"App", "--features=rotate,pan,rotate", nullptr};
+
+  // Should parse successfully.
+  ASSERT_TRUE(flags::init(&argc, argv));
+
+  // Verify flag value.
+  EXPECT_EQ((EnumSet<Feature>{Feature::PAN, Feature::ROTATE}),
+            featuresFlag.value());
+  EXPECT_TRUE(featuresFlag.value().contains(Feature::ROTATE));
+  EXPECT_FALSE(featuresFlag.value().contains(Feature::ZOOM));
+  EXPECT_EQ(2U, featuresFlag.value().size());
+  EXPECT_EQ("pan,rotate", featuresFlag.printableValue());
+  EXPECT_EQ("zoom", featuresFlag.printableDefaultValue());
+  EXPECT_STREQ("enum_set", featuresFlag.typeName());
+
+  // No errors should have been output.
+  EXPECT_EQ("", output());
+}
+
+
+TEST_F(EnumFlagsTest, unknownEnumSetValueFailsValidation) {
+  Flag<EnumSet<Feature>> featuresFlag("features", "Enabled features");
+
+  int argc = 2;
+  const char* argv[] = {"App", "--features=pan,tilt", nullptr};
+
+  // Trying to parse flags should fail.
+  EXPECT_FALSE(flags::init(&argc, argv));
+
+  // Verify validation error names just the bad item.
+  EXPECT_EQ(
+      "Invalid value for flag --features: tilt."
+          " List item 2 must be one of: zoom, pan, rotate.\n",
+      output());
+}
+
+
+TEST_F(EnumFlagsTest, mutableEnumFlagsCanChange) {
+  MutableFlag<Mode> modeFlag("mode", "Speed mode", Mode::FAST);
+  MutableFlag<EnumSet<Feature>> featuresFlag("features", "Enabled features",
+                                             EnumSet<Feature>());
+
+  EXPECT_TRUE(modeFlag.setFromText("safe"));
+  EXPECT_EQ(Mode::SAFE, modeFlag.value());
+  EXPECT_FALSE(modeFlag.setFromText("slow"));
+  EXPECT_EQ(Mode::SAFE, modeFlag.value());
+
+  EXPECT_TRUE(featuresFlag.setFromText("zoom"));
+  EXPECT_TRUE(featuresFlag.value().contains(Feature::ZOOM));
+}
+
+
+TEST_F(EnumFlagsTest, printUsageListsAllowedValues) {
+  Flag<Mode> modeFlag("mode", "Speed mode", Mode::FAST);
+  Flag<EnumSet<Feature>> featuresFlag("features", "Enabled features");
+
+  flags::printUsage("App");
+
+  EXPECT_EQ(
+      "Usage: App [flags]\n"
+          "\n"
+          "Optional flags:\n"
+          "  --features: Enabled features (values: zoom, pan, rotate)\n"
+          "  --mode: Speed mode (values: fast, balanced, safe)"
+          " (default: fast)\n",
+      output());
+}
+
+
+}  // namespace
@@ -0,0 +1,214 @@
+/**
+ * Copyright 2015 Eric W. Barndollar. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdlib.h>
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "oomuse/core/Validators.h"
+#include "oomuse/core/int_types.h"
+#include "oomuse/flags/Flag.h"
+#include "oomuse/flags/flags.h"
+#include "oomuse/flags/flags_test_util.h"
+
+using oomuse::Flag;
+using oomuse::FlagRequired;
+using oomuse::Validators;
+using oomuse::flags::FlagError;
+using oomuse::flags::FlagErrorType;
+using oomuse::flags::test::FlagsTestBase;
+using std::string;
+using std::vector;
+
+namespace filesystem = std::filesystem;
+namespace flags = oomuse::flags;
+
+namespace {
+
+
+/** Prefix of environment variables that set flags in these tests. */
+const char PREFIX[] = "OOMUSE_TEST_FLAG_";
+
+
+/** Test fixture that sets environment variables for the test's duration. */
+class EnvironmentFlagsTest : public FlagsTestBase {
+ protected:
+  /** Sets flags from environment variables with PREFIX. */
+  EnvironmentFlagsTest() { flags::setEnvironmentPrefix(PREFIX); }
+
+  virtual ~EnvironmentFlagsTest() {
+    for (const string& name : variableNames_) {
+      unsetenv(name.c_str());
+    }
+  }
+
+  /** Sets environment variable with given name (unset after the test). */
+  void setVariable(const string& name, const string& value) {
+    ASSERT_EQ(0, setenv(name.c_str(), value.c_str(), 1));
+    variableNames_.push_back(name);
+  }
+
+ private:
+  vector<string> variableNames_;
+};
+
+
+TEST_F(EnvironmentFlagsTest, setsFlagsFromPrefixedVariables) {
+  Flag<int32> countFlag("count", "A count", 1);
+  Flag<string> nameFlag("name", "A name", FlagRequired::YES);
+  Flag<bool> verboseFlag("verbose", "Verbose output", false);
+  Flag<string> hostFlag("host", "A host", "localhost");
+
+  setVariable(string(PREFIX) + "count", "42");
+  setVariable(string(PREFIX) + "name", "from env");
+  setVariable(string(PREFIX) + "verbose", "");
+  setVariable("host", "example.com");  // No prefix, so ignored.
+  setVariable("OOMUSE_TEST_FLAGhost", "example.com");
+
+  int argc = 2;
+  const char* argv[] = {"App", "pos", nullptr};
+
+  // Should parse successfully, with required flag set from the environment.
+  ASSERT_TRUE(flags::init(&argc, argv));
+  EXPECT_EQ(42, countFlag.value());
+  EXPECT_EQ("from env", nameFlag.value());
+  EXPECT_TRUE(verboseFlag.value());
+  EXPECT_EQ("localhost", hostFlag.value());
+
+  // Positional args are untouched.
+  ASSERT_EQ(2, argc);
+  EXPECT_STREQ("pos", argv[1]);
+
+  // No errors should have been output.
+  EXPECT_EQ("", output());
+}
+
+
+TEST_F(EnvironmentFlagsTest, argsAndFlagFilesOverrideEnvironment) {
+  Flag<int32> countFlag("count", "A count");
+  Flag<string> nameFlag("name", "A name");
+  Flag<string> hostFlag("host", "A host");
+
+  filesystem::path path = filesystem::temp_directory_path()
+      / "oomuse_environment_flags_test.txt";
+  std::ofstream(path) << "--host=file.example.com\n";
+
+  setVariable(string(PREFIX) + "count", "1");
+  setVariable(string(PREFIX) + "name", "env");
+  setVariable(string(PREFIX) + "host", "env.example.com");
+
+  int argc = 3;
+  const char* argv[] = {"App", "--count=2", nullptr, nullptr};
+  string flagFileArg = "--flagfile=" + path.string();
+  argv[2] = flagFileArg.c_str();
+
+  ASSERT_TRUE(flags::init(&argc, argv));
+  filesystem::remove(path);
+
+  EXPECT_EQ(2, countFlag.value());
+  EXPECT_EQ("env", nameFlag.value());
+  EXPECT_EQ("file.example.com", hostFlag.value());
+  EXPECT_EQ("", output());
+}
+
+
+TEST_F(EnvironmentFlagsTest, errorsNameTheVariable) {
+  Flag<int32> countFlag("count", "A count", Validators<int32>::greater(0));
+
+  setVariable(string(PREFIX) + "count", "0");
+
+  int argc = 1;
+  const char* argv[] = {"App", nullptr};
+
+  EXPECT_FALSE(flags::init(&argc, argv));
+  EXPECT_EQ(
+      "OOMUSE_TEST_FLAG_count: Invalid value for flag --count: 0."
+          " Must be greater than 0.\n",
+      output());
+}
+
+
+TEST_F(EnvironmentFlagsTest, initCollectingErrorsFindsAllErrors) {
+  Flag<int32> countFlag("count", "A count");
+  Flag<string> nameFlag("name", "A name");
+
+  setVariable(string(PREFIX) + "count", "many");
+  setVariable(string(PREFIX) + "colour", "red");
+  setVariable(string(PREFIX) + "name", "env");
+
+  int argc = 1;
+  const char* argv[] = {"App", nullptr};
+
+  vector<FlagError> errors;
+  EXPECT_FALSE(flags::initCollectingErrors(&argc, argv, &errors));
+
+  // Environment order is unspecified, so look for each error.
+  ASSERT_EQ(2U, errors.size());
+  bool hasInvalidCount = false;
+  bool hasUnrecognizedColour = false;
+  for (const FlagError& error : errors) {
+    hasInvalidCount |= (error.type == FlagErrorType::INVALID_VALUE)
+        && (error.flagName == "count");
+    hasUnrecognizedColour |= (error.type == FlagErrorType::UNRECOGNIZED_FLAG)
+        && (error.message
+            == "OOMUSE_TEST_FLAG_colour: Unrecognized command-line flag:"
+                   " --colour");
+  }
+  EXPECT_TRUE(hasInvalidCount);
+  EXPECT_TRUE(hasUnrecognizedColour);
+
+  // Valid values are still set.
+  EXPECT_EQ("env", nameFlag.value());
+}
+
+
+TEST_F(EnvironmentFlagsTest, ignoresVariableNamedJustThePrefix) {
+  Flag<int32> countFlag("count", "A count", 1);
+
+  setVariable(PREFIX, "x");
+  setVariable(string(PREFIX) + "count", "2");
+
+  int argc = 1;
+  const char* argv[] = {"App", nullptr};
+
+  // Should parse successfully, without reporting an unrecognized flag.
+  ASSERT_TRUE(flags::init(&argc, argv));
+  EXPECT_EQ(2, countFlag.value());
+  EXPECT_EQ("", output());
+}
+
+
+TEST_F(EnvironmentFlagsTest, readsNoVariablesWithoutPrefix) {
+  flags::setEnvironmentPrefix("");
+  Flag<int32> countFlag("count", "A count", 1);
+
+  setVariable(string(PREFIX) + "count", "2");
+  setVariable("count", "3");
+
+  int argc = 1;
+  const char* argv[] = {"App", nullptr};
+
+  ASSERT_TRUE(flags::init(&argc, argv));
+  EXPECT_EQ(1, countFlag.value());
+  EXPECT_EQ("", output());
+}
+
+
+}  // namespace
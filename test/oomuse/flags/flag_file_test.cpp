@@ -0,0 +1,459 @@
+/**
+ * Copyright 2015 Eric W. Barndollar. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "oomuse/core/Validators.h"
+#include "oomuse/core/int_types.h"
+#include "oomuse/flags/Checks.h"
+#include "oomuse/flags/Flag.h"
+#include "oomuse/flags/MutableFlag.h"
+#include "oomuse/flags/flags.h"
+#include "oomuse/flags/flags_test_util.h"
+
+using oomuse::AbstractFlag;
+using oomuse::Checks;
+using oomuse::Flag;
+using oomuse::FlagRequired;
+using oomuse::MutableFlag;
+using oomuse::Validators;
+using oomuse::flags::FlagError;
+using oomuse::flags::FlagErrorType;
+using oomuse::flags::test::FlagsTestBase;
+using oomuse::flags::test::initWithArgs;
+using std::string;
+using std::stringstream;
+using std::unique_ptr;
+using std::vector;
+
+namespace filesystem = std::filesystem;
+namespace flags = oomuse::flags;
+
+namespace {
+
+
+/** Test fixture that writes flag files into a fresh temporary directory. */
+class FlagFileTest : public FlagsTestBase {
+ protected:
+  /** Creates a fresh temporary directory for the test. */
+  FlagFileTest()
+      : directory_(filesystem::temp_directory_path() / "oomuse_flag_file_test"
+                   / testing::UnitTest::GetInstance()->current_test_info()
+                         ->name()) {
+    filesystem::create_directories(directory_);
+  }
+
+  virtual ~FlagFileTest() { filesystem::remove_all(directory_); }
+
+  /** Writes a file with given relative name & contents, returning its path. */
+  string writeFile(const string& name, const string& contents) {
+    filesystem::path path = directory_ / name;
+    filesystem::create_directories(path.parent_path());
+    std::ofstream(path, std::ios::binary) << contents;
+    return path.string();
+  }
+
+ private:
+  filesystem::path directory_;
+};
+
+
+TEST_F(FlagFileTest, setsFlagsFromFileLines) {
+  Flag<int32> portFlag("port", "Port to listen on", FlagRequired::YES);
+  Flag<string> nameFlag("name", "Server name");
+  Flag<bool> verboseFlag("verbose", "Verbose logging", false);
+  Flag<double> rateFlag("rate", "Sampling rate", 0.5);
+
+  string path = writeFile("server.flags",
+                          "# Server configuration.\n"
+                          "\n"
+                          "--port=8080\r\n"
+                          "   --name=Main server  \n"
+                          "\t# Indented comment.\n"
+                          "--verbose");
+
+  ASSERT_TRUE(initWithArgs({"--flagfile=" + path, "--rate=0.25"}));
+
+  EXPECT_EQ(8080, portFlag.value());
+  EXPECT_EQ("Main server", nameFlag.value());
+  EXPECT_TRUE(verboseFlag.value());
+  EXPECT_EQ(0.25, rateFlag.value());
+  EXPECT_EQ("", output());
+}
+
+
+TEST_F(FlagFileTest, laterArgsOverrideEarlierOnes) {
+  Flag<int32> portFlag("port", "Port to listen on");
+  string path = writeFile("server.flags", "--port=1\n");
+
+  ASSERT_TRUE(initWithArgs({"--port=2", "--flagfile=" + path}));
+  EXPECT_EQ(1, portFlag.value());
+
+  flags::resetForTest();
+  Flag<int32> portFlag2("port", "Port to listen on");
+  ASSERT_TRUE(initWithArgs({"--flagfile=" + path, "--port=2"}));
+  EXPECT_EQ(2, portFlag2.value());
+}
+
+
+TEST_F(FlagFileTest, includesNestedFilesRelativeToIncludingFile) {
+  Flag<int32> portFlag("port", "Port to listen on");
+  Flag<string> nameFlag("name", "Server name");
+
+  writeFile("common/ports.flags", "--port=9000\n");
+  writeFile("common/base.flags", "--name=base\n--flagfile=ports.flags\n");
+  string path = writeFile("main.flags", "--flagfile=common/base.flags\n");
+
+  ASSERT_TRUE(initWithArgs({"--flagfile=" + path}));
+  EXPECT_EQ(9000, portFlag.value());
+  EXPECT_EQ("base", nameFlag.value());
+}
+
+
+TEST_F(FlagFileTest, reportsInvalidValuesWithFileAndLine) {
+  Flag<int32> portFlag("port", "Port to listen on",
+                       Validators<int32>::lessOrEqual(65535));
+  string path = writeFile("server.flags", "# Comment.\n\n--port=70000\n");
+
+  EXPECT_FALSE(initWithArgs({"--flagfile=" + path}));
+  EXPECT_EQ(path + ":3: Invalid value for flag --port: 70000."
+                " Must be less than or equal to 65535.\n",
+            output());
+}
+
+
+TEST_F(FlagFileTest, reportsParallelValidationErrorsWithFileAndLine) {
+  flags::setValidationThreadCount(2);
+  Flag<int32> portFlag("port", "Port to listen on",
+                       Validators<int32>::lessOrEqual(65535));
+  Flag<int32> threadsFlag("threads", "Thread count",
+                          Validators<int32>::greater(0));
+  string path = writeFile("server.flags", "--port=70000\n--threads=0\n");
+
+  EXPECT_FALSE(initWithArgs({"--flagfile=" + path, "--port=-1x"}));
+  EXPECT_EQ("Invalid value for flag --port: -1x. Must be an int32 number.\n",
+            output());
+
+  flags::resetForTest();
+  stringstream validationOutput;
+  flags::setOutputStream(&validationOutput);
+  flags::setValidationThreadCount(2);
+  Flag<int32> portFlag2("port", "Port to listen on",
+                        Validators<int32>::lessOrEqual(65535));
+  Flag<int32> threadsFlag2("threads", "Thread count",
+                           Validators<int32>::greater(0));
+
+  EXPECT_FALSE(initWithArgs({"--flagfile=" + path, "--port=65536"}));
+  EXPECT_EQ(path + ":1: Invalid value for flag --port: 70000."
+                " Must be less than or equal to 65535.\n"
+                + path + ":2: Invalid value for flag --threads: 0."
+                " Must be greater than 0.\n"
+                "Invalid value for flag --port: 65536."
+                " Must be less than or equal to 65535.\n",
+            validationOutput.str());
+}
+
+
+TEST_F(FlagFileTest, errorsFromOtherThreadsHaveNoFileLocation) {
+  MutableFlag<int32> rateFlag("rate", "Requests per second", 1,
+                              Validators<int32>::greater(0));
+  // Sets another flag from a separate thread while this file is parsed.
+  Flag<int32> triggerFlag("trigger", "Sets --rate on another thread", 0,
+                          Checks<int32>::satisfies([&rateFlag](int32) {
+                            std::thread([&rateFlag]() {
+                              rateFlag.set(-1);
+                            }).join();
+                            return true;
+                          }, "Must not fail."));
+  string path = writeFile("server.flags", "--trigger=1\n");
+
+  ASSERT_TRUE(initWithArgs({"--flagfile=" + path}));
+  EXPECT_EQ("Invalid value for flag --rate: -1. Must be greater than 0.\n",
+            output());
+}
+
+
+TEST_F(FlagFileTest, reportsUnknownFlagsAndBadLinesWithFileAndLine) {
+  Flag<int32> portFlag("port", "Port to listen on");
+  string includedPath = writeFile("included.flags", "--port=1\n--colour=red\n");
+  string path = writeFile("main.flags", "--flagfile=included.flags\n");
+
+  EXPECT_FALSE(initWithArgs({"--flagfile=" + path}));
+  EXPECT_EQ(includedPath + ":2: Unrecognized command-line flag: --colour\n",
+            output());
+
+  flags::resetForTest();
+  stringstream otherOutput;
+  flags::setOutputStream(&otherOutput);
+  Flag<int32> portFlag2("port", "Port to listen on");
+  path = writeFile("positional.flags", "--port=1\nsome_file.txt\n");
+
+  EXPECT_FALSE(initWithArgs({"--flagfile=" + path}));
+  EXPECT_EQ(path + ":2: Expected --flag or --flag=value, but got:"
+                " some_file.txt\n",
+            otherOutput.str());
+}
+
+
+TEST_F(FlagFileTest, collectsAllErrorsInFlagFiles) {
+  Flag<int32> portFlag("port", "Port to listen on");
+  Flag<string> nameFlag("name", "Server name");
+  string path = writeFile("server.flags",
+                          "--port=eighty\n"
+                          "stray\n"
+                          "--flagfile=missing.flags\n"
+                          "--name=after errors\n");
+
+  vector<FlagError> errors;
+  const char* argv[] = {"App", nullptr, "--colour=red", nullptr};
+  string flagFileArg = "--flagfile=" + path;
+  argv[1] = flagFileArg.c_str();
+  int argc = 3;
+  EXPECT_FALSE(flags::initCollectingErrors(&argc, argv, &errors));
+
+  ASSERT_EQ(4U, errors.size());
+  EXPECT_EQ(FlagErrorType::INVALID_VALUE, errors[0].type);
+  EXPECT_EQ(path + ":1: Invalid value for flag --port: eighty."
+                " Must be an int32 number.",
+            errors[0].message);
+  EXPECT_EQ(FlagErrorType::BAD_FLAG_FILE, errors[1].type);
+  EXPECT_EQ(path + ":2: Expected --flag or --flag=value, but got: stray",
+            errors[1].message);
+  EXPECT_EQ(FlagErrorType::BAD_FLAG_FILE, errors[2].type);
+  EXPECT_EQ(FlagErrorType::UNRECOGNIZED_FLAG, errors[3].type);
+  EXPECT_EQ("colour", errors[3].flagName);
+
+  EXPECT_EQ("after errors", nameFlag.value());
+}
+
+
+TEST_F(FlagFileTest, failsOnMissingFilesAndIncludeCycles) {
+  EXPECT_FALSE(initWithArgs({"--flagfile"}));
+  EXPECT_EQ("Missing file path for --flagfile.\n", output());
+
+  flags::resetForTest();
+  stringstream missingOutput;
+  flags::setOutputStream(&missingOutput);
+  string missingPath = writeFile("dir/placeholder", "") + ".missing";
+  EXPECT_FALSE(initWithArgs({"--flagfile=" + missingPath}));
+  EXPECT_EQ(0U, missingOutput.str().find(
+      "Could not read flag file " + missingPath + ": "));
+
+  flags::resetForTest();
+  stringstream cycleOutput;
+  flags::setOutputStream(&cycleOutput);
+  string path = writeFile("cycle.flags", "--flagfile=cycle.flags\n");
+  EXPECT_FALSE(initWithArgs({"--flagfile=" + path}));
+  EXPECT_NE(string::npos, cycleOutput.str().find(
+      "Flag files nested too deeply (is there a cycle?)"));
+}
+
+
+TEST_F(FlagFileTest, acceptsEmptyFiles) {
+  Flag<int32> portFlag("port", "Port to listen on", 80);
+  string path = writeFile("empty.flags", "");
+
+  ASSERT_TRUE(initWithArgs({"--flagfile=" + path}));
+  EXPECT_EQ(80, portFlag.value());
+}
+
+
+TEST_F(FlagFileTest, reloadSetsChangedMutableFlags) {
+  MutableFlag<int32> batchSizeFlag("batchSize", "Batch size", 16);
+  MutableFlag<string> modeFlag("mode", "Mode");
+  MutableFlag<bool> verboseFlag("verbose", "Verbose logging", false);
+  string path = writeFile("server.flags",
+                          "--batchSize=32\n--mode=fast\n--verbose=false\n");
+  ASSERT_TRUE(initWithArgs({"--flagfile=" + path}));
+
+  writeFile("server.flags",
+            "--batchSize=64\n--mode=fast\n--verbose=false\n--verbose\n"
+                "--flagfile=extra.flags\n");
+  string extraPath = writeFile("extra.flags", "--batchSize=128\n");
+  vector<const AbstractFlag*> changedFlags;
+  vector<string> flagFilePaths;
+  ASSERT_TRUE(flags::reloadFlagFile(path, &changedFlags, &flagFilePaths));
+
+  // Only the last value for each flag counts, and unchanged ones are skipped.
+  EXPECT_EQ(128, batchSizeFlag.value());
+  EXPECT_EQ("fast", modeFlag.value());
+  EXPECT_TRUE(verboseFlag.value());
+  EXPECT_EQ((vector<const AbstractFlag*>{verboseFlag.flag(),
+                                         batchSizeFlag.flag()}),
+            changedFlags);
+  EXPECT_EQ((vector<string>{path, extraPath}), flagFilePaths);
+  EXPECT_EQ("", output());
+}
+
+
+TEST_F(FlagFileTest, reloadSetsSmallFloatingPointChanges) {
+  MutableFlag<double> rateFlag("rate", "Sampling rate", 0.5);
+  string path = writeFile("server.flags", "--rate=0.1234561\n");
+  ASSERT_TRUE(initWithArgs({"--flagfile=" + path}));
+
+  writeFile("server.flags", "--rate=0.1234564\n");
+  vector<const AbstractFlag*> changedFlags;
+  ASSERT_TRUE(flags::reloadFlagFile(path, &changedFlags));
+  EXPECT_EQ(0.1234564, rateFlag.value());
+  EXPECT_EQ((vector<const AbstractFlag*>{rateFlag.flag()}), changedFlags);
+}
+
+
+TEST_F(FlagFileTest, reloadChangesNothingUnlessAllValuesAreValid) {
+  MutableFlag<int32> batchSizeFlag("batchSize", "Batch size", 16,
+                                   Validators<int32>::greater(0));
+  MutableFlag<string> modeFlag("mode", "Mode", "slow");
+  string path = writeFile("server.flags", "--batchSize=32\n");
+  ASSERT_TRUE(initWithArgs({"--flagfile=" + path}));
+
+  writeFile("server.flags", "--mode=fast\n--batchSize=0\n");
+  vector<const AbstractFlag*> changedFlags;
+  EXPECT_FALSE(flags::reloadFlagFile(path, &changedFlags));
+
+  EXPECT_EQ(32, batchSizeFlag.value());
+  EXPECT_EQ("slow", modeFlag.value());
+  EXPECT_TRUE(changedFlags.empty());
+  EXPECT_EQ(
+      path + ":2: Invalid value for flag --batchSize: 0."
+          " Must be greater than 0.\n"
+          "Flag file " + path + " not reloaded; flags are unchanged.\n",
+      output());
+
+  // Parse errors also leave flags unchanged.
+  writeFile("server.flags", "--mode=fast\n--unknown=1\n");
+  EXPECT_FALSE(flags::reloadFlagFile(path));
+  EXPECT_EQ("slow", modeFlag.value());
+}
+
+
+TEST_F(FlagFileTest, reloadIgnoresChangesToImmutableFlags) {
+  Flag<int32> portFlag("port", "Port to listen on");
+  MutableFlag<int32> batchSizeFlag("batchSize", "Batch size", 16);
+  string path = writeFile("server.flags", "--port=8080\n");
+  ASSERT_TRUE(initWithArgs({"--flagfile=" + path}));
+
+  writeFile("server.flags", "--port=9090\n--batchSize=8\n");
+  vector<const AbstractFlag*> changedFlags;
+  ASSERT_TRUE(flags::reloadFlagFile(path, &changedFlags));
+
+  EXPECT_EQ(8080, portFlag.value());
+  EXPECT_EQ(8, batchSizeFlag.value());
+  EXPECT_EQ((vector<const AbstractFlag*>{batchSizeFlag.flag()}), changedFlags);
+  EXPECT_EQ(
+      "Ignoring new value for flag --port from " + path
+          + ", which only changes on restart.\n",
+      output());
+}
+
+
+TEST_F(FlagFileTest, reloadKeepsValuesFromLaterArgs) {
+  MutableFlag<int32> rateFlag("rate", "Requests per second", 1);
+  MutableFlag<int32> burstFlag("burst", "Burst size", 1);
+  MutableFlag<int32> batchSizeFlag("batchSize", "Batch size", 16);
+  string path = writeFile("server.flags",
+                          "--rate=10\n--burst=20\n--batchSize=32\n");
+  ASSERT_TRUE(initWithArgs({"--burst=2", "--flagfile=" + path, "--rate=5"}));
+  ASSERT_EQ(5, rateFlag.value());
+  ASSERT_EQ(20, burstFlag.value());
+
+  // Deleted lines don't revert flags, either.
+  writeFile("server.flags", "--rate=30\n--burst=40\n");
+  vector<const AbstractFlag*> changedFlags;
+  ASSERT_TRUE(flags::reloadFlagFile(path, &changedFlags));
+
+  EXPECT_EQ(5, rateFlag.value());
+  EXPECT_EQ(40, burstFlag.value());
+  EXPECT_EQ(32, batchSizeFlag.value());
+  EXPECT_EQ((vector<const AbstractFlag*>{burstFlag.flag()}), changedFlags);
+  EXPECT_EQ(
+      "Ignoring new value for flag --rate from " + path
+          + ", which a later command-line arg set.\n",
+      output());
+}
+
+
+TEST_F(FlagFileTest, reloadsWhileFlagsAreListedOnAnotherThread) {
+  MutableFlag<int32> rateFlag("rate", "Requests per second", 1);
+  Flag<int32> portFlag("port", "Port to listen on");
+  string path = writeFile("server.flags", "--rate=10\n--port=80\n");
+  ASSERT_TRUE(initWithArgs({"--flagfile=" + path}));
+
+  // Listing flags (sorted by name) mustn't reorder what reloads look up.
+  std::atomic<int> reloadCount(0);
+  std::atomic<bool> isDone(false);
+  std::thread reloader([&]() {
+    while (!isDone.load()) {
+      EXPECT_TRUE(flags::reloadFlagFile(path));
+      ++reloadCount;
+    }
+  });
+  while (reloadCount.load() == 0) {
+    std::this_thread::yield();
+  }
+
+  for (int i = 0; i < 100; ++i) {
+    vector<flags::FlagReadCount> readCounts = flags::flagReadCounts();
+    EXPECT_EQ(2U, readCounts.size());
+  }
+  isDone.store(true);
+  reloader.join();
+
+  EXPECT_EQ(10, rateFlag.value());
+  EXPECT_EQ("", output());
+}
+
+
+TEST_F(FlagFileTest, reloadsWhileFlagsAreDeclaredOnAnotherThread) {
+  MutableFlag<int32> rateFlag("rate", "Requests per second", 1);
+  string path = writeFile("server.flags", "--rate=10\n");
+  ASSERT_TRUE(initWithArgs({"--flagfile=" + path}));
+
+  std::atomic<int> reloadCount(0);
+  std::atomic<bool> isDone(false);
+  std::thread reloader([&]() {
+    while (!isDone.load()) {
+      EXPECT_TRUE(flags::reloadFlagFile(path));
+      ++reloadCount;
+    }
+  });
+  while (reloadCount.load() == 0) {
+    std::this_thread::yield();
+  }
+
+  // Each new flag is indexed by the next reload's lookups.
+  vector<unique_ptr<Flag<int32>>> lateFlags;
+  for (int i = 0; i < 100; ++i) {
+    lateFlags.emplace_back(new Flag<int32>("late" + std::to_string(i),
+                                           "A flag declared after init()", i));
+  }
+  isDone.store(true);
+  reloader.join();
+
+  EXPECT_EQ(10, rateFlag.value());
+  EXPECT_EQ(101U, flags::flagReadCounts().size());
+  EXPECT_EQ("", output());
+}
+
+
+}  // namespace
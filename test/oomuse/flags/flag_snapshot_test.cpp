@@ -0,0 +1,380 @@
+/**
+ * Copyright 2015 Eric W. Barndollar. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "oomuse/core/Validators.h"
+#include "oomuse/core/int_types.h"
+#include "oomuse/flags/ByteSize.h"
+#include "oomuse/flags/DenseIntSet.h"
+#include "oomuse/flags/EnumValues.h"
+#include "oomuse/flags/Flag.h"
+#include "oomuse/flags/MutableFlag.h"
+#include "oomuse/flags/flags.h"
+#include "oomuse/flags/flags_test_util.h"
+
+using oomuse::ByteSize;
+using oomuse::DenseIntSet;
+using oomuse::Flag;
+using oomuse::MutableFlag;
+using oomuse::Validators;
+using oomuse::flags::FlagError;
+using oomuse::flags::FlagErrorType;
+using oomuse::flags::test::FlagsTestBase;
+using oomuse::flags::test::initWithArgs;
+using std::string;
+using std::unordered_set;
+using std::vector;
+
+namespace chrono = std::chrono;
+namespace filesystem = std::filesystem;
+namespace flags = oomuse::flags;
+
+namespace {
+
+
+enum class Mode {FAST, SAFE};
+
+constexpr auto flagEnumValues(Mode) {
+  return flags::enumValues<Mode>({
+      {"fast", Mode::FAST},
+      {"safe", Mode::SAFE}});
+}
+
+
+/** Like Mode, as if a later version of the program renumbered it. */
+enum class RenumberedMode {UNSET, FAST, SAFE};
+
+constexpr auto flagEnumValues(RenumberedMode) {
+  return flags::enumValues<RenumberedMode>({
+      {"fast", RenumberedMode::FAST},
+      {"safe", RenumberedMode::SAFE}});
+}
+
+
+/** Test fixture that writes snapshots into a fresh temporary directory. */
+class FlagSnapshotTest : public FlagsTestBase {
+ protected:
+  /** Creates a fresh temporary directory for the test. */
+  FlagSnapshotTest()
+      : directory_(filesystem::temp_directory_path()
+                   / "oomuse_flag_snapshot_test"
+                   / testing::UnitTest::GetInstance()->current_test_info()
+                         ->name()) {
+    filesystem::create_directories(directory_);
+  }
+
+  virtual ~FlagSnapshotTest() { filesystem::remove_all(directory_); }
+
+  /** Returns path of a file with given name in the temporary directory. */
+  string pathOf(const string& name) const {
+    return (directory_ / name).string();
+  }
+
+ private:
+  filesystem::path directory_;
+};
+
+
+/** Runs a program with port & name flags, snapshotting them to path. */
+void writePortAndNameSnapshot(const string& path, const string& portArg) {
+  Flag<int32> portFlag("port", "Port to listen on");
+  Flag<string> nameFlag("name", "Server name");
+  ASSERT_TRUE(initWithArgs({portArg, "--name=main"}));
+  ASSERT_TRUE(flags::writeFlagSnapshot(path));
+}
+
+
+TEST_F(FlagSnapshotTest, loadsEveryKindOfValue) {
+  string path = pathOf("all.snapshot");
+  {
+    Flag<int32> countFlag("count", "A count");
+    Flag<double> rateFlag("rate", "A rate");
+    Flag<string> nameFlag("name", "A name");
+    Flag<vector<string>> hostsFlag("hosts", "Hosts");
+    Flag<unordered_set<int64>> idsFlag("ids", "IDs");
+    Flag<DenseIntSet> shardsFlag("shards", "Shards");
+    Flag<Mode> modeFlag("mode", "A mode", Mode::FAST);
+    Flag<chrono::milliseconds> timeoutFlag("timeout", "A timeout");
+    Flag<ByteSize> cacheSizeFlag("cache_size", "A cache size");
+    MutableFlag<int32> levelFlag("level", "A level", 1);
+    Flag<bool> enabledFlag("enabled", "Enabled", true);
+    Flag<int32> unsetFlag("unset", "Never set", 3);
+
+    ASSERT_TRUE(initWithArgs({
+        "--count=-7", "--rate=0.1", "--name=Main server", "--hosts=a,,bc",
+        "--ids=5,1000000000000", "--shards=0,3,64", "--mode=safe",
+        "--timeout=1.5s", "--cache_size=64KiB", "--level=9",
+        "--enabled=false"}));
+    ASSERT_TRUE(flags::writeFlagSnapshot(path));
+  }
+
+  resetFlags();
+  Flag<int32> countFlag("count", "A count");
+  Flag<double> rateFlag("rate", "A rate");
+  Flag<string> nameFlag("name", "A name");
+  Flag<vector<string>> hostsFlag("hosts", "Hosts");
+  Flag<unordered_set<int64>> idsFlag("ids", "IDs");
+  Flag<DenseIntSet> shardsFlag("shards", "Shards");
+  Flag<Mode> modeFlag("mode", "A mode", Mode::FAST);
+  Flag<chrono::milliseconds> timeoutFlag("timeout", "A timeout");
+  Flag<ByteSize> cacheSizeFlag("cache_size", "A cache size");
+  MutableFlag<int32> levelFlag("level", "A level", 1);
+  Flag<bool> enabledFlag("enabled", "Enabled", true);
+  Flag<int32> unsetFlag("unset", "Never set", 3);
+
+  ASSERT_TRUE(initWithArgs({"--flag_snapshot=" + path}));
+
+  EXPECT_EQ(-7, countFlag.value());
+  EXPECT_EQ(0.1, rateFlag.value());
+  EXPECT_EQ("Main server", nameFlag.value());
+  EXPECT_EQ((vector<string>{"a", "", "bc"}), hostsFlag.value());
+  EXPECT_EQ((unordered_set<int64>{5, 1000000000000}), idsFlag.value());
+  EXPECT_EQ("0,3,64", flags::printFlagValue(shardsFlag.value()));
+  EXPECT_EQ(Mode::SAFE, modeFlag.value());
+  EXPECT_EQ(chrono::milliseconds(1500), timeoutFlag.value());
+  EXPECT_EQ(ByteSize::kib(64), cacheSizeFlag.value());
+  EXPECT_EQ(9, levelFlag.value());
+  EXPECT_FALSE(enabledFlag.value());
+  EXPECT_FALSE(unsetFlag.wasExplicitlySet());
+  EXPECT_EQ(3, unsetFlag.value());
+  EXPECT_EQ("", output());
+}
+
+
+TEST_F(FlagSnapshotTest, validatesBoundValues) {
+  string path = pathOf("port.snapshot");
+  writePortAndNameSnapshot(path, "--port=80");
+
+  // Validators aren't part of the schema, so may have changed since.
+  resetFlags();
+  Flag<int32> portFlag("port", "Port to listen on",
+                       Validators<int32>::greaterOrEqual(1024));
+  Flag<string> nameFlag("name", "Server name");
+  EXPECT_FALSE(initWithArgs({"--flag_snapshot=" + path}));
+  EXPECT_EQ(path + ": Invalid value for flag --port: 80."
+                " Must be greater than or equal to 1024.\n",
+            output());
+}
+
+
+TEST_F(FlagSnapshotTest, parsesTextWhenFlagsHaveChanged) {
+  string path = pathOf("port.snapshot");
+  writePortAndNameSnapshot(path, "--port=80");
+
+  // Port's type changed, and a flag was added.
+  resetFlags();
+  Flag<int64> portFlag("port", "Port to listen on");
+  Flag<string> nameFlag("name", "Server name");
+  Flag<bool> verboseFlag("verbose", "Verbose logging", false);
+  ASSERT_TRUE(initWithArgs({"--flag_snapshot=" + path}));
+  EXPECT_EQ(80, portFlag.value());
+  EXPECT_EQ("main", nameFlag.value());
+  EXPECT_FALSE(verboseFlag.wasExplicitlySet());
+}
+
+
+TEST_F(FlagSnapshotTest, keepsExactFloatingPointValuesAsText) {
+  string path = pathOf("rate.snapshot");
+  {
+    Flag<double> rateFlag("rate", "A rate");
+    Flag<float> ratioFlag("ratio", "A ratio");
+    ASSERT_TRUE(initWithArgs({"--rate=0.123456789012345", "--ratio=0.1"}));
+    ASSERT_TRUE(flags::writeFlagSnapshot(path));
+  }
+
+  resetFlags();
+  Flag<double> rateFlag("rate", "A rate");
+  Flag<double> ratioFlag("ratio", "A ratio (now a double)");
+  ASSERT_TRUE(initWithArgs({"--flag_snapshot=" + path}));
+  EXPECT_EQ(0.123456789012345, rateFlag.value());
+  EXPECT_EQ(0.1, ratioFlag.value());
+}
+
+
+TEST_F(FlagSnapshotTest, parsesTextWhenEnumValuesHaveChanged) {
+  string path = pathOf("mode.snapshot");
+  {
+    Flag<Mode> modeFlag("mode", "Mode");
+    ASSERT_TRUE(initWithArgs({"--mode=safe"}));
+    ASSERT_TRUE(flags::writeFlagSnapshot(path));
+  }
+
+  resetFlags();
+  Flag<RenumberedMode> modeFlag("mode", "Mode");
+  ASSERT_TRUE(initWithArgs({"--flag_snapshot=" + path}));
+  EXPECT_EQ(RenumberedMode::SAFE, modeFlag.value());
+}
+
+
+TEST_F(FlagSnapshotTest, validatesTextWhenFlagsHaveChanged) {
+  string path = pathOf("port.snapshot");
+  writePortAndNameSnapshot(path, "--port=80");
+
+  resetFlags();
+  Flag<int32> portFlag("port", "Port to listen on",
+                       Validators<int32>::greaterOrEqual(1024));
+  Flag<string> nameFlag("name", "Server name");
+  Flag<bool> verboseFlag("verbose", "Verbose logging", false);
+  EXPECT_FALSE(initWithArgs({"--flag_snapshot=" + path}));
+  EXPECT_EQ(0u, output().find(path + ": Invalid value for flag --port: 80."))
+      << output();
+}
+
+
+TEST_F(FlagSnapshotTest, reportsSnapshottedFlagsThatNoLongerExist) {
+  string path = pathOf("port.snapshot");
+  writePortAndNameSnapshot(path, "--port=80");
+
+  resetFlags();
+  Flag<string> nameFlag("name", "Server name");
+  vector<FlagError> errors;
+  vector<const char*> argv = {"App", nullptr, nullptr};
+  string arg = "--flag_snapshot=" + path;
+  argv[1] = arg.c_str();
+  int argc = 2;
+  EXPECT_FALSE(flags::initCollectingErrors(&argc, argv.data(), &errors));
+  ASSERT_EQ(1u, errors.size());
+  EXPECT_EQ(FlagErrorType::UNRECOGNIZED_FLAG, errors[0].type);
+  EXPECT_EQ(path + ": Unrecognized command-line flag: --port",
+            errors[0].message);
+  EXPECT_EQ("main", nameFlag.value());
+}
+
+
+TEST_F(FlagSnapshotTest, laterArgsOverrideSnapshotValues) {
+  string path = pathOf("port.snapshot");
+  writePortAndNameSnapshot(path, "--port=80");
+
+  resetFlags();
+  Flag<int32> portFlag("port", "Port to listen on");
+  Flag<string> nameFlag("name", "Server name");
+  ASSERT_TRUE(initWithArgs({"--name=first", "--flag_snapshot=" + path,
+                            "--port=8080"}));
+  EXPECT_EQ(8080, portFlag.value());
+  EXPECT_EQ("main", nameFlag.value());
+}
+
+
+TEST_F(FlagSnapshotTest, loadsFromFlagFiles) {
+  string path = pathOf("port.snapshot");
+  writePortAndNameSnapshot(path, "--port=80");
+
+  string flagFilePath = pathOf("main.flags");
+  std::ofstream(flagFilePath) << "--flag_snapshot=port.snapshot\n";
+
+  resetFlags();
+  Flag<int32> portFlag("port", "Port to listen on");
+  Flag<string> nameFlag("name", "Server name");
+  ASSERT_TRUE(initWithArgs({"--flagfile=" + flagFilePath}));
+  EXPECT_EQ(80, portFlag.value());
+}
+
+
+TEST_F(FlagSnapshotTest, rejectsMissingAndMalformedSnapshots) {
+  Flag<int32> portFlag("port", "Port to listen on");
+  EXPECT_FALSE(initWithArgs({"--flag_snapshot="}));
+  EXPECT_EQ("Missing file path for --flag_snapshot.\n", output());
+
+  string missingPath = pathOf("missing.snapshot");
+  resetFlags();
+  Flag<int32> portFlag2("port", "Port to listen on");
+  EXPECT_FALSE(initWithArgs({"--flag_snapshot=" + missingPath}));
+  EXPECT_EQ(0u, output().find("Could not read flag snapshot " + missingPath))
+      << output();
+
+  string textPath = pathOf("text.snapshot");
+  std::ofstream(textPath) << "--port=80\n";
+  resetFlags();
+  Flag<int32> portFlag3("port", "Port to listen on");
+  EXPECT_FALSE(initWithArgs({"--flag_snapshot=" + textPath}));
+  EXPECT_EQ("Could not read flag snapshot " + textPath
+                + ": Not a flag snapshot.\n",
+            output());
+  EXPECT_FALSE(portFlag3.hasValue());
+}
+
+
+TEST_F(FlagSnapshotTest, rejectsTruncatedSnapshots) {
+  string path = pathOf("port.snapshot");
+  writePortAndNameSnapshot(path, "--port=80");
+  filesystem::resize_file(path, filesystem::file_size(path) - 1);
+
+  resetFlags();
+  Flag<int32> portFlag("port", "Port to listen on");
+  Flag<string> nameFlag("name", "Server name");
+  EXPECT_FALSE(initWithArgs({"--flag_snapshot=" + path}));
+  EXPECT_EQ("Could not read flag snapshot " + path
+                + ": Flag snapshot is truncated or corrupt.\n",
+            output());
+}
+
+
+TEST_F(FlagSnapshotTest, concurrentWritersNeverLeavePartialSnapshots) {
+  Flag<int32> portFlag("port", "Port to listen on");
+  Flag<string> nameFlag("name", "Server name");
+  ASSERT_TRUE(initWithArgs({"--port=80", "--name=main"}));
+
+  // Like replicas sharing a snapshot path, each writes its own temp file.
+  string path = pathOf("port.snapshot");
+  vector<std::thread> writers;
+  for (int i = 0; i < 4; ++i) {
+    writers.emplace_back([&path]() {
+      for (int j = 0; j < 50; ++j) {
+        EXPECT_TRUE(flags::writeFlagSnapshot(path));
+      }
+    });
+  }
+  for (std::thread& writer : writers) {
+    writer.join();
+  }
+  EXPECT_EQ("", output());
+
+  int fileCount = 0;
+  for (const auto& entry : filesystem::directory_iterator(pathOf(""))) {
+    EXPECT_EQ(path, entry.path().string());
+    ++fileCount;
+  }
+  EXPECT_EQ(1, fileCount);
+
+  resetFlags();
+  Flag<int32> portFlag2("port", "Port to listen on");
+  Flag<string> nameFlag2("name", "Server name");
+  ASSERT_TRUE(initWithArgs({"--flag_snapshot=" + path}));
+  EXPECT_EQ(80, portFlag2.value());
+  EXPECT_EQ("main", nameFlag2.value());
+}
+
+
+TEST_F(FlagSnapshotTest, outputsWhySnapshotCouldNotBeWritten) {
+  Flag<int32> portFlag("port", "Port to listen on");
+  ASSERT_TRUE(initWithArgs({"--port=80"}));
+
+  string path = pathOf("no_such_directory/port.snapshot");
+  EXPECT_FALSE(flags::writeFlagSnapshot(path));
+  EXPECT_EQ(0u, output().find("Could not write flag snapshot " + path))
+      << output();
+}
+
+
+}  // namespace
@@ -17,19 +17,36 @@
 #include "oomuse/flags/Flag.h"
 #include "oomuse/flags/flags.h"
 
-#include <sstream>
+#include <chrono>
+#include <cstdio>
+#include <memory>
 #include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
 
 #include "gtest/gtest.h"
 #include "oomuse/core/Validators.h"
 #include "oomuse/core/int_types.h"
+#include "oomuse/flags/flags_test_util.h"
 
+using oomuse::ByteSize;
+using oomuse::DenseIntSet;
 using oomuse::Flag;
 using oomuse::FlagRequired;
+using oomuse::FlagText;
+using oomuse::flags::FlagError;
+using oomuse::flags::FlagErrorType;
+using oomuse::flags::test::FlagsTestBase;
+using oomuse::Validator;
 using oomuse::Validators;
+using std::chrono::milliseconds;
+using std::chrono::nanoseconds;
+using std::chrono::seconds;
 using std::string;
-using std::stringstream;
-using testing::Test;
+using std::unique_ptr;
+using std::unordered_set;
+using std::vector;
 
 namespace flags = oomuse::flags;
 
@@ -43,23 +60,27 @@ static const double DOUBLE_EPSILON = 0.000000000000001;
 static const float FLOAT_EPSILON = 0.00001F;
 
 
-/** Test fixture for common flags test setup. */
-class FlagTest : public Test {
- protected:
-  /** Reset flags library global state before every test. */
-  FlagTest() {
-    flags::resetForTest();
-    flags::setOutputStream(&outputStream_);
-  }
+/** Validator that takes a while, failing values over a limit. */
+class SlowValidator : public Validator<int32> {
+ public:
+  explicit SlowValidator(int32 limit) : limit_(limit) {}
 
-  /** Returns text that has been ouput to the configured output stream. */
-  string output() const { return outputStream_.str(); }
+  virtual string checkValidationErrors(const int32& value) const override {
+    // Sleep longer for smaller values, so later args would tend to finish
+    // first if output weren't kept in order.
+    std::this_thread::sleep_for(std::chrono::milliseconds(20 - value % 20));
+    return (value > limit_) ? "Too big." : "";
+  }
 
  private:
-  stringstream outputStream_;
+  int32 limit_;
 };
 
 
+/** Test fixture for common flags test setup. */
+class FlagTest : public FlagsTestBase {};
+
+
 TEST_F(FlagTest, parsesOptionalIntFlag) {
   Flag<int32> intFlag("intFlag", "A test flag with integer value");
 
@@ -116,6 +137,51 @@ TEST_F(FlagTest, parsesRequiredStringFlag) {
 }
 
 
+TEST_F(FlagTest, staticNameAndDescriptionAreNotCopied) {
+  static const char NAME[] = "literal";
+  static const char DESCRIPTION[] = "A flag with literal text";
+  Flag<int32> staticFlag(FlagText::fromStatic(NAME),
+                         FlagText::fromStatic(DESCRIPTION));
+
+  EXPECT_EQ(NAME, staticFlag.name().data());
+  EXPECT_EQ(DESCRIPTION, staticFlag.description().data());
+}
+
+
+TEST_F(FlagTest, charArrayNameAndDescriptionAreCopied) {
+  char name[32];
+  char description[32];
+  std::snprintf(name, sizeof(name), "shard_%d", 1);
+  std::snprintf(description, sizeof(description), "Shard %d address", 1);
+  Flag<string> shardFlag(name, description);
+  std::snprintf(name, sizeof(name), "shard_%d", 2);
+  std::snprintf(description, sizeof(description), "Shard %d address", 2);
+
+  EXPECT_EQ("shard_1", shardFlag.name());
+  EXPECT_EQ("Shard 1 address", shardFlag.description());
+  EXPECT_NE(static_cast<const char*>(name), shardFlag.name().data());
+}
+
+
+TEST_F(FlagTest, nonLiteralNameAndDescriptionAreCopied) {
+  unique_ptr<Flag<int32>> copiedFlag;
+  {
+    string name = "copied";
+    const char* description = "A flag with copied text";
+    copiedFlag.reset(new Flag<int32>(name, description));
+    name = "changed";
+  }
+
+  int argc = 2;
+  const char* argv[] = {"App", "--copied=3", nullptr};
+  ASSERT_TRUE(flags::init(&argc, argv));
+
+  EXPECT_EQ("copied", copiedFlag->name());
+  EXPECT_EQ("A flag with copied text", copiedFlag->description());
+  EXPECT_EQ(3, copiedFlag->value());
+}
+
+
 TEST_F(FlagTest, canSetNoFlagsIfNoneAreRequired) {
   // Testing explicit FlagRequired::NO value (which could instead be omitted).
   Flag<string> nameFlag("name", "Your first name", FlagRequired::NO);
@@ -433,6 +499,67 @@ TEST_F(FlagTest, nonNumericValueFailsValidation) {
 }
 
 
+TEST_F(FlagTest, numbersIgnoreSurroundingWhitespace) {
+  Flag<int32> int32Flag("int32Flag", "An int32 number");
+  Flag<double> doubleFlag("doubleFlag", "A double number");
+
+  int argc = 3;
+  const char* argv[] =
+      {"App", "--int32Flag= 12 ", "--doubleFlag=\t+1.5", nullptr};
+
+  // Should parse successfully.
+  ASSERT_TRUE(flags::init(&argc, argv));
+
+  // Verify flag values.
+  EXPECT_EQ(12, int32Flag.value());
+  EXPECT_NEAR(1.5, doubleFlag.value(), DOUBLE_EPSILON);
+
+  // No errors should have been output.
+  EXPECT_EQ("", output());
+}
+
+
+TEST_F(FlagTest, radixPrefixesFailValidationByDefault) {
+  Flag<int32> int32Flag("int32Flag", "An int32 number");
+
+  int argc = 2;
+  const char* argv[] = {"App", "--int32Flag=0x10", nullptr};
+
+  // Trying to parse flags should fail.
+  EXPECT_FALSE(flags::init(&argc, argv));
+
+  // Verify validation error for hex value.
+  EXPECT_EQ(
+      "Invalid value for flag --int32Flag: 0x10. Must be an int32 number.\n",
+      output());
+}
+
+
+TEST_F(FlagTest, parsesExtendedNumberSyntaxIfEnabled) {
+  flags::NumberSyntax numberSyntax;
+  numberSyntax.allowRadixPrefixes = true;
+  numberSyntax.allowDigitSeparators = true;
+  flags::setNumberSyntax(numberSyntax);
+
+  Flag<int32> maskFlag("mask", "A bit mask");
+  Flag<int64> limitFlag("limit", "A large limit");
+
+  int argc = 3;
+  const char* argv[] =
+      {"App", "--mask=0b1010_1010", "--limit=-0x7FFF_FFFF_FFFF", nullptr};
+
+  // Should parse successfully.
+  ASSERT_TRUE(flags::init(&argc, argv));
+
+  // Verify flag values.
+  EXPECT_EQ(0xAA, maskFlag.value());
+  EXPECT_EQ(-0x7FFFFFFFFFFFL, limitFlag.value());
+
+  // No errors should have been output.
+  EXPECT_EQ("", output());
+}
+
+
 TEST_F(FlagTest, emptyStringAndWhitespaceParseCorrectly) {
   Flag<string> flag1("flag1", "First string flag");
   Flag<string> flag2("flag2", "Second string flag");
@@ -452,6 +579,200 @@ TEST_F(FlagTest, emptyStringAndWhitespaceParseCorrectly) {
 }
 
 
+TEST_F(FlagTest, parsesListFlags) {
+  Flag<vector<int64>> shardsFlag("shards", "Shard IDs to serve");
+  Flag<vector<double>> weightsFlag("weights", "Weights", vector<double>{1.0});
+  Flag<vector<string>> hostsFlag("hosts", "Hosts to connect to");
+  Flag<vector<string>> tagsFlag("tags", "Tags", vector<string>{"a", "b"});
+
+  int argc = 4;
+  const char* argv[] = {"App", "--shards=3, 1,4", "--hosts=db1,,db2:80",
+                        "--tags=", nullptr};
+
+  // Should parse successfully.
+  ASSERT_TRUE(flags::init(&argc, argv));
+
+  // Verify flag values, with items split by commas.
+  EXPECT_EQ((vector<int64>{3, 1, 4}), shardsFlag.value());
+  EXPECT_EQ((vector<double>{1.0}), weightsFlag.value());
+  EXPECT_EQ((vector<string>{"db1", "", "db2:80"}), hostsFlag.value());
+  EXPECT_EQ(vector<string>(), tagsFlag.value());
+
+  // Lists print the way they're written.
+  EXPECT_EQ("3,1,4", shardsFlag.printableValue());
+  EXPECT_EQ("a,b", tagsFlag.printableDefaultValue());
+  EXPECT_STREQ("list<int64>", shardsFlag.typeName());
+  EXPECT_STREQ("list<string>", hostsFlag.typeName());
+
+  // No errors should have been output.
+  EXPECT_EQ("", output());
+}
+
+
+TEST_F(FlagTest, invalidListItemFailsValidation) {
+  Flag<vector<int32>> portsFlag("ports", "Ports to listen on");
+
+  int argc = 2;
+  const char* argv[] = {"App", "--ports=80,443,http", nullptr};
+
+  // Trying to parse flags should fail.
+  EXPECT_FALSE(flags::init(&argc, argv));
+
+  // Verify validation error names just the bad item.
+  EXPECT_EQ(
+      "Invalid value for flag --ports: http."
+          " List item 3 must be a valid int32.\n",
+      output());
+}
+
+
+TEST_F(FlagTest, checksEachListItem) {
+  using Ids = vector<int64>;
+  Flag<Ids> idsFlag("ids", "Positive IDs",
+                    oomuse::Checks<Ids>::eachItem(
+                        oomuse::Checks<int64>::greater(0)));
+
+  int argc = 2;
+  const char* argv[] = {"App", "--ids=5,0,7", nullptr};
+
+  // Trying to parse flags should fail.
+  EXPECT_FALSE(flags::init(&argc, argv));
+
+  // Verify validation error points out the failing item.
+  EXPECT_EQ(
+      "Invalid value for flag --ids: 5,0,7."
+          " List item 2 (0): Must be greater than 0.\n",
+      output());
+}
+
+
+TEST_F(FlagTest, checksWholeLists) {
+  using Ids = vector<int64>;
+  Flag<Ids> idsFlag("ids", "Positive IDs, at most 3",
+                    oomuse::Checks<Ids>::allOf(
+                        oomuse::Checks<Ids>::sizeLessOrEqual(3),
+                        oomuse::Checks<Ids>::eachItem(
+                            oomuse::Checks<int64>::greater(0))));
+
+  int argc = 2;
+  const char* argv[] = {"App", "--ids=1,2,3,4", nullptr};
+
+  // Trying to parse flags should fail.
+  EXPECT_FALSE(flags::init(&argc, argv));
+
+  // Verify validation error for the whole list.
+  EXPECT_EQ(
+      "Invalid value for flag --ids: 1,2,3,4."
+          " Size/length must be less than or equal to 3.\n",
+      output());
+}
+
+
+TEST_F(FlagTest, parsesSetFlags) {
+  Flag<unordered_set<int64>> tenantsFlag("excludedTenants", "Tenant IDs");
+  Flag<unordered_set<string>> featuresFlag("features", "Enabled features");
+  Flag<DenseIntSet> shardsFlag("shards", "Shards to serve", DenseIntSet{0});
+
+  int argc = 4;
+  const char* argv[] = {"App", "--excludedTenants=9,3,9",
+                        "--features=zoom,fast", "--shards=70,2,70", nullptr};
+
+  // Should parse successfully.
+  ASSERT_TRUE(flags::init(&argc, argv));
+
+  // Verify flag values, ignoring duplicate items.
+  EXPECT_EQ((unordered_set<int64>{3, 9}), tenantsFlag.value());
+  EXPECT_EQ((unordered_set<string>{"fast", "zoom"}), featuresFlag.value());
+  EXPECT_EQ((DenseIntSet{2, 70}), shardsFlag.value());
+  EXPECT_TRUE(shardsFlag.value().contains(70));
+  EXPECT_FALSE(shardsFlag.value().contains(0));
+
+  // Sets print their items in order.
+  EXPECT_EQ("3,9", tenantsFlag.printableValue());
+  EXPECT_EQ("fast,zoom", featuresFlag.printableValue());
+  EXPECT_EQ("2,70", shardsFlag.printableValue());
+  EXPECT_EQ("0", shardsFlag.printableDefaultValue());
+  EXPECT_STREQ("set<string>", featuresFlag.typeName());
+  EXPECT_STREQ("dense_int_set", shardsFlag.typeName());
+
+  // No errors should have been output.
+  EXPECT_EQ("", output());
+}
+
+
+TEST_F(FlagTest, denseIntSetItemOutOfRangeFailsValidation) {
+  Flag<DenseIntSet> shardsFlag("shards", "Shards to serve");
+
+  int argc = 2;
+  const char* argv[] = {"App", "--shards=1,-2", nullptr};
+
+  // Trying to parse flags should fail.
+  EXPECT_FALSE(flags::init(&argc, argv));
+
+  // Verify validation error names just the bad item.
+  EXPECT_EQ(
+      "Invalid value for flag --shards: -2."
+          " List item 2 must be an integer from 0 to 65535.\n",
+      output());
+}
+
+
+TEST_F(FlagTest, parsesDurationAndByteSizeFlags) {
+  Flag<milliseconds> timeoutFlag("timeout", "RPC timeout", milliseconds(250));
+  Flag<nanoseconds> delayFlag("delay", "Retry delay");
+  Flag<ByteSize> cacheSizeFlag("cacheSize", "Cache size", ByteSize::mib(64));
+
+  int argc = 4;
+  const char* argv[] = {"App", "--timeout=1.5s", "--delay=2us",
+                        "--cacheSize=1.5GiB", nullptr};
+
+  // Should parse successfully.
+  ASSERT_TRUE(flags::init(&argc, argv));
+
+  // Verify flag values.
+  EXPECT_EQ(milliseconds(1500), timeoutFlag.value());
+  EXPECT_EQ(nanoseconds(2000), delayFlag.value());
+  EXPECT_EQ(1610612736U, cacheSizeFlag.value().bytes());
+
+  // Values print in the largest unit that shows them exactly.
+  EXPECT_EQ("1.5s", timeoutFlag.printableValue());
+  EXPECT_EQ("250ms", timeoutFlag.printableDefaultValue());
+  EXPECT_EQ("1.5GiB", cacheSizeFlag.printableValue());
+  EXPECT_EQ("64MiB", cacheSizeFlag.printableDefaultValue());
+  EXPECT_STREQ("duration", timeoutFlag.typeName());
+  EXPECT_STREQ("byte_size", cacheSizeFlag.typeName());
+
+  // No errors should have been output.
+  EXPECT_EQ("", output());
+}
+
+
+TEST_F(FlagTest, invalidDurationAndByteSizeValuesFailValidation) {
+  Flag<seconds> intervalFlag("interval", "Poll interval");
+  Flag<ByteSize> cacheSizeFlag("cacheSize", "Cache size");
+  Flag<milliseconds> timeoutFlag(
+      "timeout", "RPC timeout", milliseconds(250),
+      oomuse::Checks<milliseconds>::lessOrEqual(milliseconds(60000)));
+
+  int argc = 4;
+  const char* argv[] = {"App", "--interval=1500ms", "--cacheSize=0.1KiB",
+                        "--timeout=2m", nullptr};
+
+  // Should find all errors.
+  vector<FlagError> errors;
+  EXPECT_FALSE(flags::initCollectingErrors(&argc, argv, &errors));
+
+  EXPECT_EQ(
+      "Invalid value for flag --interval: 1500ms."
+          " Must be a whole multiple of 1s.\n"
+          "Invalid value for flag --cacheSize: 0.1KiB."
+          " Must be a whole number of bytes, like 512, 64KiB, or 1.5GB.\n"
+          "Invalid value for flag --timeout: 2m."
+          " Must be less than or equal to 1m.\n",
+      output());
+}
+
+
 TEST_F(FlagTest, parsesValidatedValueCorrectly) {
   Flag<int32> nonNegativeFlag("nonNegative", "A non-negative number",
                               Validators<int32>::greaterOrEqual(0));
@@ -620,6 +941,206 @@ TEST_F(FlagTest, initFailsIfGivenUnrecognizedFlagName) {
 }
 
 
+TEST_F(FlagTest, findsFlagsAmongManyRegisteredFlags) {
+  // Register flags in non-sorted order, as static initialization would.
+  vector<unique_ptr<Flag<int32>>> manyFlags;
+  for (int32 i = 999; i >= 0; --i) {
+    string name = "flag" + std::to_string((i * 7) % 1000);
+    manyFlags.emplace_back(new Flag<int32>(name, "One of many flags"));
+  }
+
+  int argc = 4;
+  const char* argv[] =
+      {"App", "--flag0=1", "--flag500=2", "--flag999=3", nullptr};
+
+  // Should parse successfully.
+  ASSERT_TRUE(flags::init(&argc, argv));
+
+  // Verify flag values.
+  for (auto& flag : manyFlags) {
+    if (flag->name() == "flag0") {
+      EXPECT_EQ(1, flag->value());
+    } else if (flag->name() == "flag500") {
+      EXPECT_EQ(2, flag->value());
+    } else if (flag->name() == "flag999") {
+      EXPECT_EQ(3, flag->value());
+    } else {
+      EXPECT_FALSE(flag->hasValue());
+    }
+  }
+
+  // No errors should have been output.
+  EXPECT_EQ("", output());
+}
+
+
+TEST_F(FlagTest, initFailsIfFlagNameOnlyMatchesPrefix) {
+  Flag<bool> flag1("flag1", "First flag");
+  Flag<bool> flag10("flag10", "Tenth flag");
+
+  int argc = 2;
+  const char* argv[] = {"App", "--flag", nullptr};
+
+  // Trying to parse flags should fail.
+  EXPECT_FALSE(flags::init(&argc, argv));
+
+  // Verify validation error for unrecognized flag name.
+  EXPECT_EQ("Unrecognized command-line flag: --flag\n", output());
+}
+
+
+TEST_F(FlagTest, parallelValidationSetsValidValues) {
+  flags::setValidationThreadCount(4);
+  vector<unique_ptr<Flag<int32>>> slowFlags;
+  vector<string> args;
+  for (int i = 0; i < 16; ++i) {
+    string name = "slow" + std::to_string(i);
+    slowFlags.emplace_back(new Flag<int32>(name, "A slowly validated flag",
+        unique_ptr<Validator<int32>>(new SlowValidator(100))));
+    args.push_back("--" + name + "=" + std::to_string(i));
+  }
+  Flag<string> requiredFlag("required", "A required flag", FlagRequired::YES,
+                            Validators<string>::sizeGreaterOrEqual(2));
+  args.push_back("--required=ok");
+
+  vector<const char*> argv = {"App"};
+  for (const string& arg : args) {
+    argv.push_back(arg.c_str());
+  }
+  argv.push_back(nullptr);
+  int argc = static_cast<int>(argv.size()) - 1;
+
+  ASSERT_TRUE(flags::init(&argc, argv.data()));
+  for (int i = 0; i < 16; ++i) {
+    ASSERT_TRUE(slowFlags[i]->hasValue());
+    EXPECT_EQ(i, slowFlags[i]->value());
+  }
+  EXPECT_EQ("ok", requiredFlag.value());
+  EXPECT_EQ("", output());
+}
+
+
+TEST_F(FlagTest, parallelValidationOutputsErrorsInArgvOrder) {
+  flags::setValidationThreadCount(4);
+  Flag<int32> flagA("a", "Flag a",
+                    unique_ptr<Validator<int32>>(new SlowValidator(5)));
+  Flag<int32> flagB("b", "Flag b",
+                    unique_ptr<Validator<int32>>(new SlowValidator(5)));
+  Flag<int32> flagC("c", "Flag c",
+                    unique_ptr<Validator<int32>>(new SlowValidator(5)));
+  Flag<int32> flagD("d", "Flag d", Validators<int32>::less(0));
+
+  int argc = 6;
+  const char* argv[] = {"App", "--a=6", "--b=1", "--c=19", "--d=1", "--b=7",
+                        nullptr};
+
+  EXPECT_FALSE(flags::init(&argc, argv));
+  EXPECT_EQ(
+      "Invalid value for flag --a: 6. Too big.\n"
+          "Invalid value for flag --c: 19. Too big.\n"
+          "Invalid value for flag --d: 1. Must be less than 0.\n"
+          "Invalid value for flag --b: 7. Too big.\n",
+      output());
+
+  // Valid values are still set.
+  EXPECT_EQ(1, flagB.value());
+}
+
+
+TEST_F(FlagTest, parallelValidationStillFailsFastOnParseErrors) {
+  flags::setValidationThreadCount(2);
+  Flag<int32> flagA("a", "Flag a", Validators<int32>::greater(0));
+
+  int argc = 3;
+  const char* argv[] = {"App", "--a=-1", "--a=x", nullptr};
+
+  // Validators never run, so only the parse error is output.
+  EXPECT_FALSE(flags::init(&argc, argv));
+  EXPECT_EQ("Invalid value for flag --a: x. Must be an int32 number.\n",
+            output());
+  EXPECT_FALSE(flagA.hasValue());
+}
+
+
+TEST_F(FlagTest, initCollectingErrorsFindsAllErrors) {
+  Flag<int32> countFlag("count", "A count", Validators<int32>::greater(0));
+  Flag<bool> verboseFlag("verbose", "Verbose output");
+  Flag<string> nameFlag("name", "A name", FlagRequired::YES);
+  Flag<string> hostFlag("host", "A host", FlagRequired::YES);
+  Flag<double> rateFlag("rate", "A rate");
+
+  int argc = 7;
+  const char* argv[] = {"App", "--count=0", "--colour=red", "pos",
+                        "--verbose=maybe", "--host=example.com", "--rate=0.5",
+                        nullptr};
+
+  vector<FlagError> errors;
+  EXPECT_FALSE(flags::initCollectingErrors(&argc, argv, &errors));
+
+  ASSERT_EQ(4U, errors.size());
+  EXPECT_EQ(FlagErrorType::INVALID_VALUE, errors[0].type);
+  EXPECT_EQ("count", errors[0].flagName);
+  EXPECT_EQ("Invalid value for flag --count: 0. Must be greater than 0.",
+            errors[0].message);
+  EXPECT_EQ(FlagErrorType::UNRECOGNIZED_FLAG, errors[1].type);
+  EXPECT_EQ("colour", errors[1].flagName);
+  EXPECT_EQ(FlagErrorType::INVALID_VALUE, errors[2].type);
+  EXPECT_EQ("verbose", errors[2].flagName);
+  EXPECT_EQ(FlagErrorType::MISSING_REQUIRED_FLAG, errors[3].type);
+  EXPECT_EQ("name", errors[3].flagName);
+
+  // All errors are still output, in order.
+  EXPECT_EQ(
+      "Invalid value for flag --count: 0. Must be greater than 0.\n"
+          "Unrecognized command-line flag: --colour\n"
+          "Invalid value for flag --verbose: maybe. Must be true or false.\n"
+          "Missing required command-line flag --name.\n",
+      output());
+
+  // Valid flags are still set, and positional args kept.
+  EXPECT_EQ("example.com", hostFlag.value());
+  EXPECT_EQ(0.5, rateFlag.value());
+  ASSERT_EQ(2, argc);
+  EXPECT_STREQ("pos", argv[1]);
+}
+
+
+TEST_F(FlagTest, initCollectingErrorsIncludesParallelValidationErrors) {
+  flags::setValidationThreadCount(2);
+  Flag<int32> countFlag("count", "A count", Validators<int32>::greater(0));
+  Flag<int32> limitFlag("limit", "A limit", Validators<int32>::less(10));
+
+  int argc = 4;
+  const char* argv[] = {"App", "--limit=10", "--count=x", "--count=-1",
+                        nullptr};
+
+  vector<FlagError> errors;
+  EXPECT_FALSE(flags::initCollectingErrors(&argc, argv, &errors));
+
+  // Parse errors are found while parsing, before validators run.
+  ASSERT_EQ(3U, errors.size());
+  EXPECT_EQ("Invalid value for flag --count: x. Must be an int32 number.",
+            errors[0].message);
+  EXPECT_EQ("Invalid value for flag --limit: 10. Must be less than 10.",
+            errors[1].message);
+  EXPECT_EQ("count", errors[2].flagName);
+}
+
+
+TEST_F(FlagTest, initCollectingErrorsSucceedsWithoutErrors) {
+  Flag<int32> countFlag("count", "A count", FlagRequired::YES);
+
+  int argc = 2;
+  const char* argv[] = {"App", "--count=3", nullptr};
+
+  vector<FlagError> errors;
+  EXPECT_TRUE(flags::initCollectingErrors(&argc, argv, &errors));
+  EXPECT_TRUE(errors.empty());
+  EXPECT_EQ(3, countFlag.value());
+  EXPECT_EQ("", output());
+}
+
+
 TEST_F(FlagTest, printUsageNoFlags) {
   flags::printUsage("App", "first_arg second_arg", "Some extra notes.");
 
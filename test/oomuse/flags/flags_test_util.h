@@ -0,0 +1,78 @@
+/**
+ * Copyright 2015 Eric W. Barndollar. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef OOMUSE_FLAGS_FLAGS_TEST_UTIL_H
+#define OOMUSE_FLAGS_FLAGS_TEST_UTIL_H
+
+#include <initializer_list>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "oomuse/flags/flags.h"
+
+namespace oomuse {
+namespace flags {
+namespace test {
+
+
+/**
+ * Base test fixture for flags library tests, which resets flags library global
+ * state before every test and captures the library's output.
+ */
+class FlagsTestBase : public testing::Test {
+ protected:
+  /** Reset flags library global state before every test. */
+  FlagsTestBase() { resetFlags(); }
+
+  /**
+   * Resets flags library global state and clears output, as if starting a new
+   * run of the program (so that flags for the run can then be declared).
+   */
+  void resetFlags() {
+    resetForTest();
+    setOutputStream(&outputStream_);
+    outputStream_.str("");
+  }
+
+  /** Returns text that has been output to the configured output stream. */
+  std::string output() const { return outputStream_.str(); }
+
+ private:
+  std::stringstream outputStream_;
+};
+
+
+/** Calls flags::init() with the given args after the program name. */
+inline bool initWithArgs(std::initializer_list<std::string> args) {
+  std::vector<std::string> argStrings(args);
+  std::vector<const char*> argv = {"App"};
+  for (const std::string& arg : argStrings) {
+    argv.push_back(arg.c_str());
+  }
+  argv.push_back(nullptr);
+
+  int argc = static_cast<int>(argv.size()) - 1;
+  return init(&argc, argv.data());
+}
+
+
+}  // namespace test
+}  // namespace flags
+}  // namespace oomuse
+
+#endif  // OOMUSE_FLAGS_FLAGS_TEST_UTIL_H
@@ -0,0 +1,200 @@
+/**
+ * Copyright 2015 Eric W. Barndollar. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include "gtest/gtest.h"
+#include "oomuse/core/int_types.h"
+#include "oomuse/flags/Checks.h"
+#include "oomuse/flags/Flag.h"
+#include "oomuse/flags/MutableFlag.h"
+#include "oomuse/flags/flags.h"
+#include "oomuse/flags/flags_test_util.h"
+
+using oomuse::Checks;
+using oomuse::Flag;
+using oomuse::MutableFlag;
+using oomuse::flags::FlagInitProfile;
+using oomuse::flags::InitProfile;
+using oomuse::flags::test::FlagsTestBase;
+using std::string;
+
+namespace chrono = std::chrono;
+namespace flags = oomuse::flags;
+
+namespace {
+
+
+/** A fake allocation count, advanced by slowCheck() (on any thread). */
+std::atomic<int64> fakeAllocations(0);
+
+int64 fakeAllocationCount() { return fakeAllocations.load(); }
+
+
+/** Returns a check that takes at least 2ms (and "allocates" once). */
+auto slowCheck() {
+  return Checks<int32>::satisfies([](int32) {
+    std::this_thread::sleep_for(chrono::milliseconds(2));
+    ++fakeAllocations;
+    return true;
+  }, "Must be checked slowly.");
+}
+
+
+/** Test fixture for common init() profiling test setup. */
+class InitProfileTest : public FlagsTestBase {
+ protected:
+  /** Resets fake allocation count before every test. */
+  InitProfileTest() { fakeAllocations = 0; }
+};
+
+
+TEST_F(InitProfileTest, recordsNothingUnlessEnabled) {
+  Flag<int32> portFlag("port", "Port to listen on");
+
+  int argc = 2;
+  const char* argv[] = {"App", "--port=80", nullptr};
+  ASSERT_TRUE(flags::init(&argc, argv));
+
+  const InitProfile& profile = flags::initProfile();
+  EXPECT_EQ(0u, profile.registeredFlagCount);
+  EXPECT_EQ(0, profile.total.time.count());
+  EXPECT_TRUE(profile.flags.empty());
+  EXPECT_EQ("", output());
+}
+
+
+TEST_F(InitProfileTest, recordsPhasesAndFlagsMostExpensiveFirst) {
+  Flag<int32> portFlag("port", "Port to listen on");
+  Flag<int32> shardFlag("shard", "Shard to serve", slowCheck());
+  Flag<int32> unsetFlag("unset", "Never set", 1);
+  flags::setInitProfiling(true, &fakeAllocationCount);
+
+  int argc = 4;
+  const char* argv[] = {"App", "--port=80", "--shard=3", "--shard=4",
+                        nullptr};
+  ASSERT_TRUE(flags::init(&argc, argv));
+
+  const InitProfile& profile = flags::initProfile();
+  EXPECT_EQ(3u, profile.registeredFlagCount);
+  EXPECT_EQ(0, profile.environment.allocations);  // Counted, but none.
+  EXPECT_EQ(2, profile.args.allocations);
+  EXPECT_EQ(2, profile.total.allocations);
+  EXPECT_GE(profile.args.time, chrono::milliseconds(4));
+  EXPECT_GE(profile.total.time, profile.args.time);
+
+  // The slowly checked flag comes first, and its checks aren't parse time.
+  ASSERT_EQ(2u, profile.flags.size());
+  const FlagInitProfile& shardTimes = profile.flags[0];
+  EXPECT_EQ(&shardFlag, shardTimes.flag);
+  EXPECT_EQ(2, shardTimes.valueCount);
+  EXPECT_GE(shardTimes.validationTime, chrono::milliseconds(4));
+  EXPECT_LT(shardTimes.parseTime, chrono::milliseconds(2));
+
+  const FlagInitProfile& portTimes = profile.flags[1];
+  EXPECT_EQ(&portFlag, portTimes.flag);
+  EXPECT_EQ(1, portTimes.valueCount);
+  EXPECT_EQ(0, portTimes.validationTime.count());
+
+  EXPECT_EQ("", output());
+}
+
+
+TEST_F(InitProfileTest, profilesFlagsDeclaredDuringInit) {
+  // Declares (and sets) another flag while init() is running.
+  std::unique_ptr<MutableFlag<int32>> lateFlag;
+  Flag<int32> shardFlag("shard", "Shard to serve",
+                        Checks<int32>::satisfies([&lateFlag](int32) {
+                          lateFlag = std::make_unique<MutableFlag<int32>>(
+                              "late", "Declared late", 1, slowCheck());
+                          return lateFlag->set(2);
+                        }, "Must declare a flag."));
+  flags::setInitProfiling(true, &fakeAllocationCount);
+
+  int argc = 2;
+  const char* argv[] = {"App", "--shard=3", nullptr};
+  ASSERT_TRUE(flags::init(&argc, argv));
+
+  const InitProfile& profile = flags::initProfile();
+  ASSERT_EQ(2u, profile.flags.size());
+  const FlagInitProfile& lateTimes =
+      (profile.flags[0].flag == &shardFlag) ? profile.flags[1]
+                                            : profile.flags[0];
+  EXPECT_EQ(lateFlag->flag(), lateTimes.flag);
+  EXPECT_GE(lateTimes.validationTime, chrono::milliseconds(2));
+}
+
+
+TEST_F(InitProfileTest, timesParallelValidationsToo) {
+  Flag<int32> shardFlag("shard", "Shard to serve", slowCheck());
+  Flag<int32> replicaFlag("replica", "Replica to serve", slowCheck());
+  flags::setValidationThreadCount(2);
+  flags::setInitProfiling(true);
+
+  int argc = 3;
+  const char* argv[] = {"App", "--shard=3", "--replica=1", nullptr};
+  ASSERT_TRUE(flags::init(&argc, argv));
+
+  const InitProfile& profile = flags::initProfile();
+  EXPECT_EQ(-1, profile.validation.allocations);  // Not counted.
+  EXPECT_GE(profile.validation.time, chrono::milliseconds(2));
+  ASSERT_EQ(2u, profile.flags.size());
+  for (const FlagInitProfile& flagTimes : profile.flags) {
+    EXPECT_GE(flagTimes.validationTime, chrono::milliseconds(2));
+  }
+}
+
+
+TEST_F(InitProfileTest, profileArgOutputsReport) {
+  Flag<int32> portFlag("port", "Port to listen on");
+  Flag<int32> shardFlag("shard", "Shard to serve", slowCheck());
+
+  int argc = 5;
+  const char* argv[] = {"App", "--port=80", "--flags_profile=1", "--shard=3",
+                        "positional", nullptr};
+  ASSERT_TRUE(flags::init(&argc, argv));
+  EXPECT_EQ(2, argc);
+  EXPECT_STREQ("positional", argv[1]);
+
+  // Just the top flag is listed, in both lists.
+  string report = output();
+  EXPECT_EQ(0u, report.find("Flags init() profile: 2 flags registered, 2 set.\n"
+                            "  phase                 time  allocations\n"
+                            "  registration "))
+      << report;
+  EXPECT_NE(string::npos, report.find("  total "));
+  EXPECT_NE(string::npos, report.find("Most expensive flags:\n"));
+  EXPECT_NE(string::npos, report.find("Slowest validators:\n"));
+  EXPECT_NE(string::npos, report.find("       1  --shard\n"));
+  EXPECT_EQ(string::npos, report.find("--port\n"));
+}
+
+
+TEST_F(InitProfileTest, rejectsInvalidProfileArg) {
+  int argc = 2;
+  const char* argv[] = {"App", "--flags_profile=0", nullptr};
+  EXPECT_FALSE(flags::init(&argc, argv));
+  EXPECT_EQ("Invalid value for flag --flags_profile: 0. Must be a positive "
+                "number of flags to list.\n",
+            output());
+}
+
+
+}  // namespace
@@ -0,0 +1,125 @@
+/**
+ * Copyright 2015 Eric W. Barndollar. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "oomuse/flags/list_parsing.h"
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "oomuse/core/int_types.h"
+
+using oomuse::flags::ListSplitter;
+using oomuse::flags::countListItems;
+using oomuse::flags::findDelimiters;
+using std::size_t;
+using std::string;
+using std::string_view;
+using std::vector;
+
+namespace {
+
+
+/** Splits text with a ListSplitter. */
+vector<string> split(string_view text, char delimiter = ',') {
+  vector<string> items;
+  ListSplitter splitter(text, delimiter);
+  string_view item;
+  while (splitter.next(&item)) {
+    items.emplace_back(item);
+  }
+  return items;
+}
+
+
+/** Splits text one char at a time, as a reference for split(). */
+vector<string> splitSlowly(const string& text) {
+  vector<string> items;
+  if (text.empty()) {
+    return items;
+  }
+
+  items.emplace_back();
+  for (char c : text) {
+    if (c == ',') {
+      items.emplace_back();
+    } else {
+      items.back() += c;
+    }
+  }
+  return items;
+}
+
+
+TEST(ListParsingTest, splitsShortLists) {
+  EXPECT_EQ(vector<string>(), split(""));
+  EXPECT_EQ(vector<string>{"a"}, split("a"));
+  EXPECT_EQ((vector<string>{"a", "bc", "def"}), split("a,bc,def"));
+  EXPECT_EQ((vector<string>{"1", "2"}), split("1;2", ';'));
+
+  // Every delimiter separates two items, even if empty.
+  EXPECT_EQ((vector<string>{"", ""}), split(","));
+  EXPECT_EQ((vector<string>{"a", "", "b", ""}), split("a,,b,"));
+  EXPECT_EQ((vector<string>{" a ", " b"}), split(" a , b"));
+}
+
+
+TEST(ListParsingTest, splitsLongListsAcrossBlocks) {
+  // Items of varied lengths put delimiters at every position in a block,
+  // including the first and last char of blocks.
+  for (size_t itemLength = 0; itemLength <= 70; ++itemLength) {
+    string text;
+    for (size_t i = 0; i < 200; ++i) {
+      if (i != 0) {
+        text += ',';
+      }
+      text += string((itemLength + i) % 71, static_cast<char>('a' + i % 26));
+    }
+
+    vector<string> expectedItems = splitSlowly(text);
+    EXPECT_EQ(expectedItems, split(text)) << itemLength;
+    EXPECT_EQ(expectedItems.size(), countListItems(text)) << itemLength;
+  }
+}
+
+
+TEST(ListParsingTest, countsListItems) {
+  EXPECT_EQ(0U, countListItems(""));
+  EXPECT_EQ(1U, countListItems("abc"));
+  EXPECT_EQ(3U, countListItems("a,,"));
+  EXPECT_EQ(129U, countListItems(string(128, ',')));
+  EXPECT_EQ(2U, countListItems("a;b", ';'));
+}
+
+
+TEST(ListParsingTest, findsDelimitersInFullAndPartialBlocks) {
+  string block(64, 'x');
+  block[0] = ',';
+  block[17] = ',';
+  block[63] = ',';
+  EXPECT_EQ((uint64(1) << 0) | (uint64(1) << 17) | (uint64(1) << 63),
+            findDelimiters(block.data(), block.size(), ','));
+
+  // Chars past size are ignored.
+  EXPECT_EQ((uint64(1) << 0) | (uint64(1) << 17),
+            findDelimiters(block.data(), 63, ','));
+  EXPECT_EQ(0U, findDelimiters(block.data() + 1, 16, ','));
+}
+
+
+}  // namespace
@@ -0,0 +1,213 @@
+/**
+ * Copyright 2015 Eric W. Barndollar. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "oomuse/flags/number_parsing.h"
+
+#include <sstream>
+#include <string>
+
+#include "gtest/gtest.h"
+#include "oomuse/core/int_types.h"
+
+using oomuse::flags::NumberSyntax;
+using oomuse::flags::outputNumber;
+using oomuse::flags::parseBool;
+using oomuse::flags::parseNumber;
+using std::string;
+using std::stringstream;
+
+namespace {
+
+
+/** A sufficiently small double used for floating-point comparison. */
+static const double DOUBLE_EPSILON = 0.000000000000001;
+
+
+/** Returns syntax with both radix prefixes and digit separators allowed. */
+NumberSyntax extendedSyntax() {
+  NumberSyntax syntax;
+  syntax.allowRadixPrefixes = true;
+  syntax.allowDigitSeparators = true;
+  return syntax;
+}
+
+
+TEST(NumberParsingTest, parsesBoolsIgnoringCase) {
+  bool value = false;
+  EXPECT_TRUE(parseBool("TrUe", &value));
+  EXPECT_TRUE(value);
+  EXPECT_TRUE(parseBool(" FALSE ", &value));
+  EXPECT_FALSE(value);
+
+  // Empty text (as in just --flag) means true.
+  EXPECT_TRUE(parseBool("", &value));
+  EXPECT_TRUE(value);
+
+  for (const char* text : {"1", "0", "yes", "truee", "t rue"}) {
+    EXPECT_FALSE(parseBool(text, &value)) << text;
+  }
+}
+
+
+TEST(NumberParsingTest, parsesDecimalIntegers) {
+  int32 value32 = 0;
+  EXPECT_TRUE(parseNumber("1234", &value32));
+  EXPECT_EQ(1234, value32);
+  EXPECT_TRUE(parseNumber("+17", &value32));
+  EXPECT_EQ(17, value32);
+  EXPECT_TRUE(parseNumber("-0", &value32));
+  EXPECT_EQ(0, value32);
+
+  int64 value64 = 0;
+  EXPECT_TRUE(parseNumber("-9223372036854775808", &value64));
+  EXPECT_EQ(-9223372036854775807L - 1L, value64);
+}
+
+
+TEST(NumberParsingTest, ignoresSurroundingWhitespace) {
+  int32 intValue = 0;
+  EXPECT_TRUE(parseNumber(" \t42\n ", &intValue));
+  EXPECT_EQ(42, intValue);
+
+  double doubleValue = 0.0;
+  EXPECT_TRUE(parseNumber("  -1.5  ", &doubleValue));
+  EXPECT_NEAR(-1.5, doubleValue, DOUBLE_EPSILON);
+}
+
+
+TEST(NumberParsingTest, rejectsMalformedIntegers) {
+  int32 value = 7;
+  for (const char* text : {"", "   ", "-", "+-3", "--3", "- 3", "3 4", "12ab",
+                           "0x10", "1_000", "1.5", "1e3"}) {
+    EXPECT_FALSE(parseNumber(text, &value)) << text;
+  }
+
+  // Failed parses must leave value unchanged.
+  EXPECT_EQ(7, value);
+}
+
+
+TEST(NumberParsingTest, rejectsOutOfRangeIntegers) {
+  int32 value32 = 0;
+  EXPECT_TRUE(parseNumber("2147483647", &value32));
+  EXPECT_FALSE(parseNumber("2147483648", &value32));
+  EXPECT_TRUE(parseNumber("-2147483648", &value32));
+  EXPECT_FALSE(parseNumber("-2147483649", &value32));
+
+  int64 value64 = 0;
+  EXPECT_FALSE(parseNumber("9223372036854775808", &value64));
+  EXPECT_FALSE(parseNumber("-9223372036854775809", &value64));
+  EXPECT_FALSE(parseNumber("99999999999999999999999", &value64));
+}
+
+
+TEST(NumberParsingTest, parsesRadixPrefixesIfAllowed) {
+  NumberSyntax syntax;
+  syntax.allowRadixPrefixes = true;
+
+  int32 value32 = 0;
+  EXPECT_TRUE(parseNumber("0x1F", &value32, syntax));
+  EXPECT_EQ(31, value32);
+  EXPECT_TRUE(parseNumber("-0X80000000", &value32, syntax));
+  EXPECT_EQ(-2147483647 - 1, value32);
+  EXPECT_TRUE(parseNumber("0o17", &value32, syntax));
+  EXPECT_EQ(15, value32);
+  EXPECT_TRUE(parseNumber("0b101", &value32, syntax));
+  EXPECT_EQ(5, value32);
+
+  // Leading zeros stay decimal rather than C-style octal.
+  EXPECT_TRUE(parseNumber("010", &value32, syntax));
+  EXPECT_EQ(10, value32);
+
+  EXPECT_FALSE(parseNumber("0x", &value32, syntax));
+  EXPECT_FALSE(parseNumber("0x80000000", &value32, syntax));
+  EXPECT_FALSE(parseNumber("0b102", &value32, syntax));
+  EXPECT_FALSE(parseNumber("0x-5", &value32, syntax));
+}
+
+
+TEST(NumberParsingTest, parsesDigitSeparatorsIfAllowed) {
+  NumberSyntax syntax = extendedSyntax();
+
+  int64 value = 0;
+  EXPECT_TRUE(parseNumber("1_000_000", &value, syntax));
+  EXPECT_EQ(1000000, value);
+  EXPECT_TRUE(parseNumber("-0xFFFF_FFFF", &value, syntax));
+  EXPECT_EQ(-4294967295L, value);
+
+  for (const char* text : {"_1", "1_", "1__0", "0x_1", "-_1"}) {
+    EXPECT_FALSE(parseNumber(text, &value, syntax)) << text;
+  }
+
+  double doubleValue = 0.0;
+  EXPECT_TRUE(parseNumber("1_000.2_5", &doubleValue, syntax));
+  EXPECT_NEAR(1000.25, doubleValue, DOUBLE_EPSILON);
+  EXPECT_FALSE(parseNumber("1_.5", &doubleValue, syntax));
+}
+
+
+TEST(NumberParsingTest, parsesFloatingPointNumbers) {
+  double value = 0.0;
+  EXPECT_TRUE(parseNumber("+.5", &value));
+  EXPECT_NEAR(0.5, value, DOUBLE_EPSILON);
+  EXPECT_TRUE(parseNumber("-2.5e-3", &value));
+  EXPECT_NEAR(-0.0025, value, DOUBLE_EPSILON);
+  EXPECT_TRUE(parseNumber("7", &value));
+  EXPECT_NEAR(7.0, value, DOUBLE_EPSILON);
+
+  float floatValue = 0.0F;
+  EXPECT_TRUE(parseNumber("3.25", &floatValue));
+  EXPECT_EQ(3.25F, floatValue);
+}
+
+
+TEST(NumberParsingTest, rejectsMalformedOrNonFiniteFloatingPointNumbers) {
+  double value = 0.0;
+  for (const char* text : {"", ".", "e5", "1.5x", "--1", "+-1", "0x1p3",
+                           "inf", "-inf", "nan", "1e999", "1.0 2"}) {
+    EXPECT_FALSE(parseNumber(text, &value)) << text;
+  }
+
+  float floatValue = 0.0F;
+  EXPECT_FALSE(parseNumber("1e39", &floatValue));
+}
+
+
+TEST(NumberParsingTest, outputsFloatingPointNumbersLosslessly) {
+  for (double value : {0.1234561, 0.1234564, 1e-300, 123456789.125, -2.5}) {
+    stringstream text;
+    outputNumber(value, &text);
+    double parsedValue = 0.0;
+    ASSERT_TRUE(parseNumber(text.str(), &parsedValue)) << text.str();
+    EXPECT_EQ(value, parsedValue) << text.str();
+  }
+
+  stringstream floatText;
+  outputNumber(0.1F, &floatText);
+  EXPECT_EQ("0.1", floatText.str());
+}
+
+
+TEST(NumberParsingTest, rejectsOverlongSeparatedNumbers) {
+  string digits(300, '1');
+  digits[1] = '_';
+
+  double value = 0.0;
+  EXPECT_FALSE(parseNumber(digits, &value, extendedSyntax()));
+}
+
+
+}  // namespace
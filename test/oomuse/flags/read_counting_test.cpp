@@ -0,0 +1,175 @@
+/**
+ * Copyright 2015 Eric W. Barndollar. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "oomuse/core/int_types.h"
+#include "oomuse/flags/CachedFlagReader.h"
+#include "oomuse/flags/Flag.h"
+#include "oomuse/flags/MutableFlag.h"
+#include "oomuse/flags/flags.h"
+
+using oomuse::CachedFlagReader;
+using oomuse::Flag;
+using oomuse::MutableFlag;
+using oomuse::flags::FlagReadCount;
+using oomuse::flags::IS_COUNTING_FLAG_READS;
+using std::string;
+using std::stringstream;
+using std::thread;
+using std::vector;
+using testing::Test;
+
+namespace flags = oomuse::flags;
+
+namespace {
+
+
+/** Test fixture for common flag read counting test setup. */
+class ReadCountingTest : public Test {
+ protected:
+  /** Reset flags library global state before every test. */
+  ReadCountingTest() { flags::resetForTest(); }
+
+  /** Returns reads expected to be counted for given number of reads. */
+  static uint64 countedReads(uint64 readCount) {
+    return IS_COUNTING_FLAG_READS ? readCount : 0;
+  }
+};
+
+
+TEST_F(ReadCountingTest, sortsFlagsByReadCountThenName) {
+  Flag<int32> portFlag("port", "Port to listen on", 80);
+  Flag<int32> shardFlag("shard", "Shard to serve", 1);
+  Flag<int32> backlogFlag("backlog", "Max pending connections", 5);
+  Flag<int32> unreadFlag("unread", "Never read", 0);
+  for (int i = 0; i < 3; ++i) {
+    shardFlag.countRead();
+  }
+  portFlag.countRead();
+  backlogFlag.countRead();
+
+  vector<FlagReadCount> readCounts = flags::flagReadCounts();
+  ASSERT_EQ(4u, readCounts.size());
+  EXPECT_EQ(&shardFlag, readCounts[0].flag);
+  EXPECT_EQ(3u, readCounts[0].readCount);
+  EXPECT_EQ(&backlogFlag, readCounts[1].flag);
+  EXPECT_EQ(1u, readCounts[1].readCount);
+  EXPECT_EQ(&portFlag, readCounts[2].flag);
+  EXPECT_EQ(1u, readCounts[2].readCount);
+  EXPECT_EQ(&unreadFlag, readCounts[3].flag);
+  EXPECT_EQ(0u, readCounts[3].readCount);
+}
+
+
+TEST_F(ReadCountingTest, countsValueReadsOnlyWhenCompiledIn) {
+  Flag<int32> portFlag("port", "Port to listen on", 80);
+  MutableFlag<string> modeFlag("mode", "Serving mode", string("fast"));
+
+  EXPECT_EQ(80, portFlag.value());
+  EXPECT_EQ(80, portFlag.value());
+  EXPECT_EQ("fast", modeFlag.value());
+  EXPECT_EQ(4u, modeFlag.read([](const string& mode) { return mode.size(); }));
+  EXPECT_EQ(countedReads(2), portFlag.readCount());
+  EXPECT_EQ(countedReads(2), modeFlag.readCount());
+
+  // Reads by the library itself (like printing) aren't counted.
+  EXPECT_EQ("80", portFlag.printableValue());
+  EXPECT_EQ("fast", modeFlag.printableValue());
+  EXPECT_EQ(countedReads(2), portFlag.readCount());
+  EXPECT_EQ(countedReads(2), modeFlag.readCount());
+}
+
+
+TEST_F(ReadCountingTest, countsCachedReads) {
+  MutableFlag<int32> batchSizeFlag("batch_size", "Packets per batch", 10);
+  CachedFlagReader<int32> batchSize(batchSizeFlag);  // Reads once.
+
+  for (int i = 0; i < 5; ++i) {
+    EXPECT_EQ(10, batchSize.value());
+  }
+  EXPECT_EQ(countedReads(6), batchSizeFlag.readCount());
+}
+
+
+TEST_F(ReadCountingTest, sumsCountsOverThreads) {
+  Flag<int32> portFlag("port", "Port to listen on", 80);
+  Flag<int32> shardFlag("shard", "Shard to serve", 1);
+
+  // Later threads reuse the counters of earlier ones, which keep their counts.
+  for (int round = 0; round < 2; ++round) {
+    vector<thread> threads;
+    for (int i = 0; i < 4; ++i) {
+      threads.emplace_back([&portFlag, &shardFlag]() {
+        for (int j = 0; j < 1000; ++j) {
+          portFlag.countRead();
+        }
+        shardFlag.countRead();
+      });
+    }
+    for (thread& readerThread : threads) {
+      readerThread.join();
+    }
+  }
+
+  EXPECT_EQ(8000u, portFlag.readCount());
+  EXPECT_EQ(8u, shardFlag.readCount());
+}
+
+
+TEST_F(ReadCountingTest, resetForTestClearsCounts) {
+  Flag<int32> portFlag("port", "Port to listen on", 80);
+  portFlag.countRead();
+  ASSERT_EQ(1u, portFlag.readCount());
+
+  flags::resetForTest();
+  EXPECT_EQ(0u, portFlag.readCount());
+  portFlag.countRead();
+  EXPECT_EQ(1u, portFlag.readCount());
+}
+
+
+TEST_F(ReadCountingTest, printsReport) {
+  Flag<int32> portFlag("port", "Port to listen on", 80);
+  Flag<int32> shardFlag("shard", "Shard to serve", 1);
+  Flag<int32> unreadFlag("unread", "Never read", 0);
+  shardFlag.countRead();
+  shardFlag.countRead();
+  portFlag.countRead();
+
+  stringstream report;
+  flags::printFlagReadCounts(flags::flagReadCounts(), &report);
+  EXPECT_EQ("Flag reads: 3 flags, 2 read.\n"
+            "                 reads  flag\n"
+            "                     2  --shard\n"
+            "                     1  --port\n"
+            "                     0  --unread\n",
+            report.str());
+
+  stringstream topReport;
+  flags::printFlagReadCounts(flags::flagReadCounts(), &topReport, 1);
+  EXPECT_EQ("Flag reads: 3 flags, 2 read.\n"
+            "                 reads  flag\n"
+            "                     2  --shard\n",
+            topReport.str());
+}
+
+
+}  // namespace
@@ -0,0 +1,164 @@
+/**
+ * Copyright 2015 Eric W. Barndollar. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "oomuse/flags/unit_parsing.h"
+
+#include <limits>
+#include <sstream>
+#include <string>
+
+#include "gtest/gtest.h"
+#include "oomuse/core/int_types.h"
+
+using oomuse::flags::outputByteSize;
+using oomuse::flags::outputDuration;
+using oomuse::flags::parseByteSize;
+using oomuse::flags::parseDuration;
+using std::numeric_limits;
+using std::string;
+using std::stringstream;
+
+namespace {
+
+
+const int64 SECOND = 1000000000;
+
+
+string printDuration(int64 nanoseconds) {
+  stringstream ss;
+  outputDuration(nanoseconds, &ss);
+  return ss.str();
+}
+
+
+string printByteSize(uint64 bytes) {
+  stringstream ss;
+  outputByteSize(bytes, &ss);
+  return ss.str();
+}
+
+
+TEST(UnitParsingTest, parsesDurations) {
+  int64 nanoseconds = 0;
+  EXPECT_TRUE(parseDuration("250ms", &nanoseconds));
+  EXPECT_EQ(250000000, nanoseconds);
+  EXPECT_TRUE(parseDuration(" 1.5s ", &nanoseconds));
+  EXPECT_EQ(1500000000, nanoseconds);
+  EXPECT_TRUE(parseDuration("1h30m", &nanoseconds));
+  EXPECT_EQ(5400 * SECOND, nanoseconds);
+  EXPECT_TRUE(parseDuration("-.5us", &nanoseconds));
+  EXPECT_EQ(-500, nanoseconds);
+  EXPECT_TRUE(parseDuration("3ns", &nanoseconds));
+  EXPECT_EQ(3, nanoseconds);
+  EXPECT_TRUE(parseDuration("0", &nanoseconds));
+  EXPECT_EQ(0, nanoseconds);
+  EXPECT_TRUE(parseDuration("0.000000001s", &nanoseconds));
+  EXPECT_EQ(1, nanoseconds);
+}
+
+
+TEST(UnitParsingTest, invalidDurationsFail) {
+  int64 nanoseconds = 0;
+  for (const char* text : {"", "5", "ms", "1.s5", "5 ms", "5sec", "5S", "1..5s",
+                           "1.5ns", "0.0000000001s", "1h-30m", "--1s"}) {
+    EXPECT_FALSE(parseDuration(text, &nanoseconds)) << text;
+  }
+}
+
+
+TEST(UnitParsingTest, durationsOutOfRangeFail) {
+  int64 nanoseconds = 0;
+  EXPECT_TRUE(parseDuration("9223372036854775807ns", &nanoseconds));
+  EXPECT_EQ(numeric_limits<int64>::max(), nanoseconds);
+  EXPECT_TRUE(parseDuration("-9223372036854775808ns", &nanoseconds));
+  EXPECT_EQ(numeric_limits<int64>::min(), nanoseconds);
+
+  for (const char* text : {"9223372036854775808ns", "2562048h",
+                           "9223372036s1s", "99999999999999999999ns"}) {
+    EXPECT_FALSE(parseDuration(text, &nanoseconds)) << text;
+  }
+}
+
+
+TEST(UnitParsingTest, parsesByteSizes) {
+  uint64 bytes = 0;
+  EXPECT_TRUE(parseByteSize("512", &bytes));
+  EXPECT_EQ(512U, bytes);
+  EXPECT_TRUE(parseByteSize("512B", &bytes));
+  EXPECT_EQ(512U, bytes);
+  EXPECT_TRUE(parseByteSize("64KiB", &bytes));
+  EXPECT_EQ(65536U, bytes);
+  EXPECT_TRUE(parseByteSize("1.5GiB", &bytes));
+  EXPECT_EQ(1610612736U, bytes);
+  EXPECT_TRUE(parseByteSize("2.5MB", &bytes));
+  EXPECT_EQ(2500000U, bytes);
+  EXPECT_TRUE(parseByteSize("16TiB", &bytes));
+  EXPECT_EQ(uint64(16) << 40, bytes);
+  EXPECT_TRUE(parseByteSize("18446744073709551615", &bytes));
+  EXPECT_EQ(numeric_limits<uint64>::max(), bytes);
+}
+
+
+TEST(UnitParsingTest, invalidByteSizesFail) {
+  uint64 bytes = 0;
+  for (const char* text : {"", "KiB", "-1", "1.5B", "0.1KiB", "5kb", "5 KB",
+                           "1KB2", "18446744073709551616", "16777216TiB"}) {
+    EXPECT_FALSE(parseByteSize(text, &bytes)) << text;
+  }
+}
+
+
+TEST(UnitParsingTest, outputsDurationsInLargestExactUnit) {
+  EXPECT_EQ("0s", printDuration(0));
+  EXPECT_EQ("250ms", printDuration(250000000));
+  EXPECT_EQ("1.5s", printDuration(1500000000));
+  EXPECT_EQ("1.5h", printDuration(5400 * SECOND));
+  EXPECT_EQ("61s", printDuration(61 * SECOND));
+  EXPECT_EQ("1.25us", printDuration(1250));
+  EXPECT_EQ("-3ns", printDuration(-3));
+  EXPECT_EQ("-9223372036854775808ns",
+            printDuration(numeric_limits<int64>::min()));
+}
+
+
+TEST(UnitParsingTest, outputsByteSizesInLargestExactUnit) {
+  EXPECT_EQ("0B", printByteSize(0));
+  EXPECT_EQ("1023B", printByteSize(1023));
+  EXPECT_EQ("1.5KiB", printByteSize(1536));
+  EXPECT_EQ("1.5KB", printByteSize(1500));
+  EXPECT_EQ("1MB", printByteSize(1000000));
+  EXPECT_EQ("1000KiB", printByteSize(1024000));
+  EXPECT_EQ("1.5GiB", printByteSize(1610612736));
+}
+
+
+TEST(UnitParsingTest, outputRoundTripsThroughParsing) {
+  for (int64 nanoseconds : {int64(1), int64(999), 1250 * SECOND / 1000,
+                            -SECOND, numeric_limits<int64>::max()}) {
+    int64 parsed = 0;
+    EXPECT_TRUE(parseDuration(printDuration(nanoseconds), &parsed));
+    EXPECT_EQ(nanoseconds, parsed);
+  }
+  for (uint64 bytes : {uint64(1), uint64(1536), uint64(1) << 50,
+                       numeric_limits<uint64>::max()}) {
+    uint64 parsed = 0;
+    EXPECT_TRUE(parseByteSize(printByteSize(bytes), &parsed));
+    EXPECT_EQ(bytes, parsed);
+  }
+}
+
+
+}  // namespace
@@ -0,0 +1,108 @@
+/**
+ * Copyright 2015 Eric W. Barndollar. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * Command-line tool that prints the flags another process has published to
+ * shared memory (see oomuse::flags::publishToSharedMemory()), one per line:
+ *
+ * <name>\t<type>\t<explicit|default|unset>\t<value>\t<default value>
+ */
+
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "oomuse/core/int_types.h"
+#include "oomuse/flags/Flag.h"
+#include "oomuse/flags/SharedFlagsReader.h"
+#include "oomuse/flags/flags.h"
+
+using oomuse::Flag;
+using oomuse::flags::SharedFlagInfo;
+using oomuse::flags::SharedFlagsReader;
+using std::cerr;
+using std::cout;
+using std::endl;
+using std::string;
+using std::vector;
+
+namespace flags = oomuse::flags;
+
+namespace {
+
+
+Flag<bool> headerFlag("header", "Print a header line naming each column",
+                      false);
+
+
+/** Returns segment name for a pid or segment name arg. */
+string getSegmentName(const string& arg) {
+  if (!arg.empty() && (arg.find_first_not_of("0123456789") == string::npos)) {
+    return SharedFlagsReader::segmentNameForProcess(std::stoll(arg));
+  }
+
+  return arg;
+}
+
+
+const char* getStatus(const SharedFlagInfo& flag) {
+  if (flag.wasExplicitlySet) {
+    return "explicit";
+  }
+  return flag.hasValue ? "default" : "unset";
+}
+
+
+}  // namespace
+
+
+int main(int argc, const char* argv[]) {
+  flags::initOrPrintUsageAndDie(
+      &argc, argv, "oomuse-flags_dump", "<pid or segment name>",
+      "Prints flags published to shared memory by another process.");
+  if (argc != 2) {
+    flags::printUsage("oomuse-flags_dump", "<pid or segment name>");
+    return EXIT_FAILURE;
+  }
+
+  string segmentName = getSegmentName(argv[1]);
+  SharedFlagsReader reader;
+  string errorMsg;
+  if (!reader.open(segmentName, &errorMsg)) {
+    cerr << "Could not open published flags " << segmentName << ": "
+         << errorMsg << endl;
+    return EXIT_FAILURE;
+  }
+
+  vector<SharedFlagInfo> sharedFlags;
+  if (!reader.readSnapshot(&sharedFlags)) {
+    cerr << "Could not read consistent snapshot of " << segmentName << "."
+         << endl;
+    return EXIT_FAILURE;
+  }
+
+  if (headerFlag.value()) {
+    cout << "name\ttype\tstatus\tvalue\tdefault" << endl;
+  }
+  for (const SharedFlagInfo& flag : sharedFlags) {
+    cout << flag.name << "\t" << flag.typeName << "\t" << getStatus(flag)
+         << "\t" << flag.value << (flag.isValueTruncated ? "..." : "")
+         << "\t" << flag.defaultValue << endl;
+  }
+
+  return EXIT_SUCCESS;
+}
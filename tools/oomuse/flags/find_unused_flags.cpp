@@ -0,0 +1,64 @@
+/**
+ * Copyright 2015 Eric W. Barndollar. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * Command-line tool that merges flag usage files written by many runs (see
+ * oomuse::flags::writeFlagUsage()) and prints each flag that went unused, as
+ * tab-separated lines after a header line:
+ *
+ * <name>\t<unused|never_set|never_read>\t<runs>\t<set runs>\t<reads>\t
+ * <has default: 0|1>
+ */
+
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+#include "oomuse/flags/FlagUsageReport.h"
+#include "oomuse/flags/flags.h"
+
+using oomuse::flags::FlagUsageReport;
+using std::cerr;
+using std::cout;
+using std::endl;
+using std::string;
+
+namespace flags = oomuse::flags;
+
+
+int main(int argc, const char* argv[]) {
+  flags::initOrPrintUsageAndDie(
+      &argc, argv, "oomuse-flags_unused", "<flag usage file>...",
+      "Lists flags never set or never read over the runs that wrote the "
+      "given flag usage files.");
+  if (argc < 2) {
+    flags::printUsage("oomuse-flags_unused", "<flag usage file>...");
+    return EXIT_FAILURE;
+  }
+
+  FlagUsageReport report;
+  for (int i = 1; i < argc; ++i) {
+    string errorMsg;
+    if (!report.addFile(argv[i], &errorMsg)) {
+      cerr << "Could not read flag usage " << argv[i] << ": " << errorMsg
+           << endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  report.printUnusedFlags(&cout);
+  return EXIT_SUCCESS;
+}